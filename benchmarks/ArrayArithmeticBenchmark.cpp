@@ -0,0 +1,151 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Reports the throughput of each ArrayArithmetic kernel at every instruction set level supported
+ * by this cpu, after checking that all levels compute the same results.
+ *
+ * Usage: ArrayArithmeticBenchmark [blockSize] [numIterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "DspObject.h"
+
+#define NUM_KERNELS 9
+#define NUM_LEVELS 4
+
+static const char *kernelNames[NUM_KERNELS] = {
+  "add", "add constant", "subtract", "subtract constant", "multiply", "multiply constant",
+  "divide", "divide constant", "fill"
+};
+
+/** Applies the given kernel to the indices [startIndex, endIndex) of the buffers. */
+void runKernel(int kernel, float *input0, float *input1, float *output, int startIndex, int endIndex) {
+  switch (kernel) {
+    case 0: ArrayArithmetic::add(input0, input1, output, startIndex, endIndex); break;
+    case 1: ArrayArithmetic::add(input0, 0.5f, output, startIndex, endIndex); break;
+    case 2: ArrayArithmetic::subtract(input0, input1, output, startIndex, endIndex); break;
+    case 3: ArrayArithmetic::subtract(input0, 0.5f, output, startIndex, endIndex); break;
+    case 4: ArrayArithmetic::multiply(input0, input1, output, startIndex, endIndex); break;
+    case 5: ArrayArithmetic::multiply(input0, 0.5f, output, startIndex, endIndex); break;
+    case 6: ArrayArithmetic::divide(input0, input1, output, startIndex, endIndex); break;
+    case 7: ArrayArithmetic::divide(input0, 3.0f, output, startIndex, endIndex); break;
+    case 8: ArrayArithmetic::fill(output, 0.5f, startIndex, endIndex); break;
+    default: break;
+  }
+}
+
+/**
+ * Returns true if the current kernels compute the same results as the scalar reference for all
+ * (aligned and unaligned) ranges within a buffer of the given length.
+ */
+bool checkKernels(float *input0, float *input1, float *output, float *reference, int length) {
+  ArrayArithmeticLevel level = ArrayArithmetic::getKernelLevel();
+  for (int kernel = 0; kernel < NUM_KERNELS; kernel++) {
+    for (int startIndex = 0; startIndex < 4 && startIndex < length; startIndex++) {
+      for (int endIndex = startIndex; endIndex <= length; endIndex++) {
+        memset(reference, 0, length * sizeof(float));
+        memset(output, 0, length * sizeof(float));
+        ArrayArithmetic::setKernelLevel(ARRAY_ARITHMETIC_SCALAR);
+        runKernel(kernel, input0, input1, reference, startIndex, endIndex);
+        ArrayArithmetic::setKernelLevel(level);
+        runKernel(kernel, input0, input1, output, startIndex, endIndex);
+        if (memcmp(reference, output, length * sizeof(float)) != 0) {
+          printf("%s: %s differs from scalar for [%i, %i).\n",
+              ArrayArithmetic::getKernelLevelName(level), kernelNames[kernel], startIndex, endIndex);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/** Returns the throughput of the given kernel in millions of samples per second. */
+double measure(int kernel, float *input0, float *input1, float *output, int blockSize, int numIterations) {
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  for (int i = 0; i < numIterations; i++) {
+    runKernel(kernel, input0, input1, output, 0, blockSize);
+  }
+  gettimeofday(&end, NULL);
+  double durationUs = (end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_usec - start.tv_usec);
+  return ((double) blockSize * numIterations) / durationUs;
+}
+
+int main(int argc, char * const argv[]) {
+  int blockSize = (argc > 1) ? atoi(argv[1]) : 64;
+  int numIterations = (argc > 2) ? atoi(argv[2]) : 1000000;
+  if (blockSize < 1) blockSize = 1;
+  
+  float *input0 = ALLOC_ALIGNED_BUFFER(blockSize * sizeof(float));
+  float *input1 = ALLOC_ALIGNED_BUFFER(blockSize * sizeof(float));
+  float *output = ALLOC_ALIGNED_BUFFER(blockSize * sizeof(float));
+  float *reference = ALLOC_ALIGNED_BUFFER(blockSize * sizeof(float));
+  for (int i = 0; i < blockSize; i++) {
+    input0[i] = 1.0f + (float) rand() / RAND_MAX; // no zeros, no denormals
+    input1[i] = 1.0f + (float) rand() / RAND_MAX;
+  }
+  
+  ArrayArithmetic::initKernels();
+  ArrayArithmeticLevel selectedLevel = ArrayArithmetic::getKernelLevel();
+  
+  bool isLevelSupported[NUM_LEVELS];
+  double throughput[NUM_LEVELS][NUM_KERNELS];
+  for (int level = 0; level < NUM_LEVELS; level++) {
+    isLevelSupported[level] = ArrayArithmetic::setKernelLevel((ArrayArithmeticLevel) level);
+    if (!isLevelSupported[level]) continue;
+    if (!checkKernels(input0, input1, output, reference, blockSize)) return 1;
+    for (int kernel = 0; kernel < NUM_KERNELS; kernel++) {
+      measure(kernel, input0, input1, output, blockSize, numIterations/10); // warm up
+      throughput[level][kernel] = measure(kernel, input0, input1, output, blockSize, numIterations);
+    }
+  }
+  
+  printf("%i iterations over %i samples, selected level: %s\n", numIterations, blockSize,
+      ArrayArithmetic::getKernelLevelName(selectedLevel));
+  printf("%-18s", "Msamples/s");
+  for (int level = 0; level < NUM_LEVELS; level++) {
+    printf("%10s", ArrayArithmetic::getKernelLevelName((ArrayArithmeticLevel) level));
+  }
+  printf("\n");
+  for (int kernel = 0; kernel < NUM_KERNELS; kernel++) {
+    printf("%-18s", kernelNames[kernel]);
+    for (int level = 0; level < NUM_LEVELS; level++) {
+      if (isLevelSupported[level]) {
+        printf("%10.1f", throughput[level][kernel]);
+      } else {
+        printf("%10s", "-");
+      }
+    }
+    printf("\n");
+  }
+  
+  FREE_ALIGNED_BUFFER(input0);
+  FREE_ALIGNED_BUFFER(input1);
+  FREE_ALIGNED_BUFFER(output);
+  FREE_ALIGNED_BUFFER(reference);
+  return 0;
+}
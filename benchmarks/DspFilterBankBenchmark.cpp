@@ -0,0 +1,156 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Compares the per-block cost of processing a patch with many independent filter chains (e.g.
+ * the voices of a synthesizer) one filter at a time against processing them in filter banks, at
+ * every instruction set level supported by this cpu, after checking that both produce exactly
+ * the same output.
+ *
+ * Usage: DspFilterBankBenchmark [numVoices] [numBlocks]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "PdGraph.h"
+#include "ZenGarden.h"
+
+#define BLOCK_SIZE 64
+#define SAMPLE_RATE 44100.0f
+#define NUM_CHANNELS 2
+#define NUM_LEVELS 4
+#define PATCH_DIRECTORY "/tmp/"
+#define PATCH_FILENAME "DspFilterBankBenchmark.pd"
+
+void *callbackFunction(ZGCallbackFunction function, void *userData, void *ptr) {
+  return NULL; // ignore all prints
+}
+
+/** Writes a patch with the given number of voices, each a chain of filters mixed into [dac~]. */
+bool writePatch(int numVoices) {
+  FILE *file = fopen(PATCH_DIRECTORY PATCH_FILENAME, "w");
+  if (file == NULL) return false;
+  
+  fprintf(file, "#N canvas 0 0 450 300 10;\n");
+  fprintf(file, "#X obj 10 10 dac~;\n"); // object 0
+  for (int i = 0; i < numVoices; i++) {
+    fprintf(file, "#N canvas 0 0 450 300 voice%i 0;\n", i);
+    fprintf(file, "#X obj 10 10 phasor~ %i;\n", 100 + 7*i);
+    fprintf(file, "#X obj 10 40 lop~ %i;\n", 500 + 50*i);
+    fprintf(file, "#X obj 10 70 bp~ %i 5;\n", 1000 + 30*i);
+    fprintf(file, "#X obj 10 100 hip~ 20;\n");
+    fprintf(file, "#X obj 10 130 *~ 0.001;\n");
+    fprintf(file, "#X obj 10 160 outlet~;\n");
+    for (int j = 0; j < 5; j++) fprintf(file, "#X connect %i 0 %i 0;\n", j, j+1);
+    fprintf(file, "#X restore 10 %i pd voice%i;\n", 40 + i, i);
+    fprintf(file, "#X connect %i 0 0 0;\n", i+1);
+    fprintf(file, "#X connect %i 0 0 1;\n", i+1);
+  }
+  fclose(file);
+  return true;
+}
+
+/** Returns a new context processing the patch, or <code>NULL</code> if it cannot be loaded. */
+ZGContext *newContext(bool isFilterBankEnabled) {
+  ZGContext *context = zg_context_new(NUM_CHANNELS, NUM_CHANNELS, BLOCK_SIZE, SAMPLE_RATE,
+      callbackFunction, NULL);
+  ZGGraph *graph = zg_context_new_graph_from_file(context, PATCH_DIRECTORY, PATCH_FILENAME);
+  if (graph == NULL) {
+    zg_context_delete(context);
+    return NULL;
+  }
+  graph->setDspFilterBankEnabled(isFilterBankEnabled);
+  zg_graph_attach(graph);
+  return context;
+}
+
+/** Returns the average duration of one block in microseconds. */
+double measure(ZGContext *context, float *inputBuffers, float *outputBuffers, int numBlocks) {
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  for (int i = 0; i < numBlocks; i++) {
+    zg_context_process(context, inputBuffers, outputBuffers);
+  }
+  gettimeofday(&end, NULL);
+  double durationUs = (end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_usec - start.tv_usec);
+  return durationUs / numBlocks;
+}
+
+int main(int argc, char * const argv[]) {
+  int numVoices = (argc > 1) ? atoi(argv[1]) : 64;
+  int numBlocks = (argc > 2) ? atoi(argv[2]) : 10000;
+  
+  if (!writePatch(numVoices)) {
+    printf("Could not write the patch %s%s.\n", PATCH_DIRECTORY, PATCH_FILENAME);
+    return 1;
+  }
+  
+  ZGContext *serialContext = newContext(false);
+  ZGContext *bankContext = newContext(true);
+  if (serialContext == NULL || bankContext == NULL) {
+    printf("Could not load the patch %s%s.\n", PATCH_DIRECTORY, PATCH_FILENAME);
+    return 1;
+  }
+  ArrayArithmeticLevel selectedLevel = ArrayArithmetic::getKernelLevel();
+  
+  float inputBuffers[BLOCK_SIZE * NUM_CHANNELS] = {0.0f};
+  float serialBuffers[BLOCK_SIZE * NUM_CHANNELS];
+  float bankBuffers[BLOCK_SIZE * NUM_CHANNELS];
+  
+  printf("%i voices, %i blocks of %i samples, selected level: %s\n", numVoices, numBlocks,
+      BLOCK_SIZE, ArrayArithmetic::getKernelLevelName(selectedLevel));
+  for (int level = 0; level < NUM_LEVELS; level++) {
+    if (!ArrayArithmetic::setKernelLevel((ArrayArithmeticLevel) level)) continue;
+    
+    // both contexts continue from the same state with every level
+    for (int i = 0; i < 100; i++) {
+      zg_context_process(serialContext, inputBuffers, serialBuffers);
+      zg_context_process(bankContext, inputBuffers, bankBuffers);
+      if (memcmp(serialBuffers, bankBuffers, sizeof(serialBuffers)) != 0) {
+        printf("%s: filter banks differ from serial processing.\n",
+            ArrayArithmetic::getKernelLevelName((ArrayArithmeticLevel) level));
+        return 1;
+      }
+    }
+    
+    // alternate between both variants to even out effects of the environment
+    double serialUs = 0.0;
+    double bankUs = 0.0;
+    for (int i = 0; i < 3; i++) {
+      serialUs += measure(serialContext, inputBuffers, serialBuffers, numBlocks) / 3.0;
+      bankUs += measure(bankContext, inputBuffers, bankBuffers, numBlocks) / 3.0;
+    }
+    printf("%-8s serial: %8.3f us/block, filter banks: %8.3f us/block (%.1f%%)\n",
+        ArrayArithmetic::getKernelLevelName((ArrayArithmeticLevel) level),
+        serialUs, bankUs, 100.0 * bankUs / serialUs);
+    
+    // the contexts have processed the same number of blocks and are in the same state again
+  }
+  
+  ArrayArithmetic::setKernelLevel(selectedLevel);
+  zg_context_delete(serialContext);
+  zg_context_delete(bankContext);
+  remove(PATCH_DIRECTORY PATCH_FILENAME);
+  return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Compares the per-block cost of processing a patch with many small subpatches using the flat dsp
+ * process plan against the recursive walk through all subgraphs.
+ *
+ * Usage: DspProcessPlanBenchmark [numSubpatches] [numBlocks]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "PdGraph.h"
+#include "ZenGarden.h"
+
+#define BLOCK_SIZE 64
+#define SAMPLE_RATE 44100.0f
+#define NUM_CHANNELS 2
+#define PATCH_DIRECTORY "/tmp/"
+#define PATCH_FILENAME "DspProcessPlanBenchmark.pd"
+
+void *callbackFunction(ZGCallbackFunction function, void *userData, void *ptr) {
+  return NULL; // ignore all prints
+}
+
+/** Writes a patch with the given number of small subpatches, all of which are mixed into [dac~]. */
+bool writePatch(int numSubpatches) {
+  FILE *file = fopen(PATCH_DIRECTORY PATCH_FILENAME, "w");
+  if (file == NULL) return false;
+  
+  fprintf(file, "#N canvas 0 0 450 300 10;\n");
+  fprintf(file, "#X obj 10 10 dac~;\n"); // object 0
+  for (int i = 0; i < numSubpatches; i++) {
+    fprintf(file, "#N canvas 0 0 450 300 sub%i 0;\n", i);
+    fprintf(file, "#X obj 10 10 osc~ %i;\n", 100 + i);
+    fprintf(file, "#X obj 10 40 *~ 0.001;\n");
+    fprintf(file, "#X obj 10 70 outlet~;\n");
+    fprintf(file, "#X connect 0 0 1 0;\n");
+    fprintf(file, "#X connect 1 0 2 0;\n");
+    fprintf(file, "#X restore 10 %i pd sub%i;\n", 40 + i, i);
+    fprintf(file, "#X connect %i 0 0 0;\n", i+1);
+    fprintf(file, "#X connect %i 0 0 1;\n", i+1);
+  }
+  fclose(file);
+  return true;
+}
+
+/** Returns the average duration of one block in microseconds. */
+double measure(ZGContext *context, float *inputBuffers, float *outputBuffers, int numBlocks) {
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  for (int i = 0; i < numBlocks; i++) {
+    zg_context_process(context, inputBuffers, outputBuffers);
+  }
+  gettimeofday(&end, NULL);
+  double durationUs = (end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_usec - start.tv_usec);
+  return durationUs / numBlocks;
+}
+
+int main(int argc, char * const argv[]) {
+  int numSubpatches = (argc > 1) ? atoi(argv[1]) : 500;
+  int numBlocks = (argc > 2) ? atoi(argv[2]) : 10000;
+  
+  if (!writePatch(numSubpatches)) {
+    printf("Could not write the patch %s%s.\n", PATCH_DIRECTORY, PATCH_FILENAME);
+    return 1;
+  }
+  
+  ZGContext *context = zg_context_new(NUM_CHANNELS, NUM_CHANNELS, BLOCK_SIZE, SAMPLE_RATE,
+      callbackFunction, NULL);
+  ZGGraph *graph = zg_context_new_graph_from_file(context, PATCH_DIRECTORY, PATCH_FILENAME);
+  if (graph == NULL) {
+    printf("Could not load the patch %s%s.\n", PATCH_DIRECTORY, PATCH_FILENAME);
+    zg_context_delete(context);
+    return 1;
+  }
+  zg_graph_attach(graph);
+  
+  float inputBuffers[BLOCK_SIZE * NUM_CHANNELS] = {0.0f};
+  float outputBuffers[BLOCK_SIZE * NUM_CHANNELS];
+  
+  // warm up both variants, then alternate between them to even out effects of the environment
+  double planUs = 0.0;
+  double recursiveUs = 0.0;
+  for (int i = 0; i < 4; i++) {
+    graph->setDspProcessPlanEnabled(false);
+    double us = measure(context, inputBuffers, outputBuffers, numBlocks);
+    if (i > 0) recursiveUs += us;
+    
+    graph->setDspProcessPlanEnabled(true);
+    us = measure(context, inputBuffers, outputBuffers, numBlocks);
+    if (i > 0) planUs += us;
+  }
+  recursiveUs /= 3.0;
+  planUs /= 3.0;
+  
+  printf("%i subpatches, %i blocks of %i samples\n", numSubpatches, numBlocks, BLOCK_SIZE);
+  printf("recursive walk: %8.3f us/block\n", recursiveUs);
+  printf("process plan:   %8.3f us/block (%.1f%%)\n", planUs, 100.0 * planUs / recursiveUs);
+  
+  zg_context_delete(context);
+  remove(PATCH_DIRECTORY PATCH_FILENAME);
+  return 0;
+}
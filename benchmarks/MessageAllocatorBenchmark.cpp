@@ -0,0 +1,217 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Stresses the MessageAllocator from four threads at once and checks that no two live messages
+ * share memory. Every round stands for one block. All threads copy messages into the arena and
+ * into blocks of all size classes. Block messages are freed in the next round by another thread,
+ * such that the free lists are pushed and popped concurrently from different threads. Arena
+ * messages are freed within their round, except for one message every few rounds, which lingers
+ * into the next round and pins its arena half. Between rounds, while no thread allocates, the
+ * main thread calls beginBlock() as the context does, which switches between the arena halves.
+ *
+ * Every message is filled with values identifying it and checked before it is freed. The program
+ * fails if a message was overwritten or if any blocks are still live at the end.
+ *
+ * Usage: MessageAllocatorBenchmark [numRounds]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "MessageAllocator.h"
+
+#define NUM_THREADS 4
+#define NUM_MESSAGES_PER_ROUND 16
+
+// arena messages are small. Block messages range from the smallest to beyond the largest size class.
+#define MAX_ARENA_ELEMENTS 8
+#define MAX_BLOCK_ELEMENTS 80
+
+// one arena message of every thread lingers into the next round once every this many rounds
+#define LINGER_INTERVAL 7
+
+/** A barrier for all worker threads and the main thread. pthread_barrier_t is not available everywhere. */
+typedef struct Barrier {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int numThreads;
+  int numWaiting;
+  int generation;
+} Barrier;
+
+void barrierInit(Barrier *barrier, int numThreads) {
+  pthread_mutex_init(&barrier->mutex, NULL);
+  pthread_cond_init(&barrier->cond, NULL);
+  barrier->numThreads = numThreads;
+  barrier->numWaiting = 0;
+  barrier->generation = 0;
+}
+
+void barrierWait(Barrier *barrier) {
+  pthread_mutex_lock(&barrier->mutex);
+  int generation = barrier->generation;
+  if (++barrier->numWaiting == barrier->numThreads) {
+    barrier->numWaiting = 0;
+    barrier->generation++;
+    pthread_cond_broadcast(&barrier->cond);
+  } else {
+    while (generation == barrier->generation) {
+      pthread_cond_wait(&barrier->cond, &barrier->mutex);
+    }
+  }
+  pthread_mutex_unlock(&barrier->mutex);
+}
+
+MessageAllocator *allocator;
+Barrier barrier;
+int numRounds;
+
+/** The block messages allocated by each thread in the previous round, freed by the next thread. */
+PdMessage *blockMessages[2][NUM_THREADS][NUM_MESSAGES_PER_ROUND];
+
+volatile int numCorruptMessages = 0;
+
+/** Returns a copy of a message identifying the given thread, round and index, made by the allocator. */
+PdMessage *newMessage(int thread, int round, int index, int numElements, bool toArena) {
+  PdMessage *message = PD_MESSAGE_ON_STACK(numElements);
+  message->initWithTimestampAndNumElements(round, numElements);
+  for (int i = 0; i < numElements; i++) {
+    message->setFloat(i, (float) (thread + NUM_THREADS * (index + NUM_MESSAGES_PER_ROUND * i)));
+  }
+  if (index % 3 == 0) message->setSymbol(numElements-1, toArena ? "arena" : "block");
+  return toArena ? allocator->copyMessageToArena(message) : allocator->copyMessage(message);
+}
+
+/** Checks that the message still holds what it was created with, then frees it. */
+void checkAndFreeMessage(PdMessage *message, int thread, int round, int index, bool toArena) {
+  int numElements = message->getNumElements();
+  bool isCorrupt = (message->getTimestamp() != round);
+  for (int i = 0; i < numElements && !isCorrupt; i++) {
+    if (i == numElements-1 && index % 3 == 0) {
+      isCorrupt = !message->isSymbol(i, toArena ? "arena" : "block");
+    } else {
+      isCorrupt = !message->isFloat(i) ||
+          message->getFloat(i) != (float) (thread + NUM_THREADS * (index + NUM_MESSAGES_PER_ROUND * i));
+    }
+  }
+  if (isCorrupt) __sync_add_and_fetch(&numCorruptMessages, 1);
+  allocator->freeMessage(message);
+}
+
+void *stress(void *arg) {
+  int thread = (int) (long) arg;
+  int previousThread = (thread + NUM_THREADS - 1) % NUM_THREADS;
+  unsigned int random = 1 + thread;
+  PdMessage *arenaMessages[NUM_MESSAGES_PER_ROUND];
+  PdMessage *lingeringMessage = NULL;
+  int lingeringRound = 0;
+
+  for (int round = 0; round < numRounds; round++) {
+    barrierWait(&barrier); // beginBlock() has been called
+
+    PdMessage **messages = blockMessages[round % 2][thread];
+    for (int i = 0; i < NUM_MESSAGES_PER_ROUND; i++) {
+      random = random * 1103515245 + 12345;
+      int numArenaElements = 1 + (random >> 16) % MAX_ARENA_ELEMENTS;
+      int numBlockElements = 1 + (random >> 8) % MAX_BLOCK_ELEMENTS;
+      arenaMessages[i] = newMessage(thread, round, i, numArenaElements, true);
+      messages[i] = newMessage(thread, round, i, numBlockElements, false);
+    }
+
+    // the messages of the previous round of the previous thread are freed while others allocate
+    if (round > 0) {
+      PdMessage **previousMessages = blockMessages[(round-1) % 2][previousThread];
+      for (int i = 0; i < NUM_MESSAGES_PER_ROUND; i++) {
+        checkAndFreeMessage(previousMessages[i], previousThread, round-1, i, false);
+      }
+    }
+    if (lingeringMessage != NULL) {
+      checkAndFreeMessage(lingeringMessage, thread, lingeringRound, 0, true);
+      lingeringMessage = NULL;
+    }
+    for (int i = (round % LINGER_INTERVAL == 0) ? 1 : 0; i < NUM_MESSAGES_PER_ROUND; i++) {
+      checkAndFreeMessage(arenaMessages[i], thread, round, i, true);
+    }
+    if (round % LINGER_INTERVAL == 0) {
+      lingeringMessage = arenaMessages[0];
+      lingeringRound = round;
+    }
+
+    barrierWait(&barrier); // all allocations of this round are done
+  }
+
+  // free whatever is left over from the last round
+  barrierWait(&barrier);
+  PdMessage **previousMessages = blockMessages[(numRounds-1) % 2][previousThread];
+  for (int i = 0; i < NUM_MESSAGES_PER_ROUND; i++) {
+    checkAndFreeMessage(previousMessages[i], previousThread, numRounds-1, i, false);
+  }
+  if (lingeringMessage != NULL) {
+    checkAndFreeMessage(lingeringMessage, thread, lingeringRound, 0, true);
+  }
+  return NULL;
+}
+
+int main(int argc, char * const argv[]) {
+  numRounds = (argc > 1) ? atoi(argv[1]) : 100000;
+  if (numRounds < 1) numRounds = 1;
+
+  allocator = new MessageAllocator();
+  barrierInit(&barrier, NUM_THREADS + 1);
+
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  pthread_t threads[NUM_THREADS];
+  for (int i = 0; i < NUM_THREADS; i++) {
+    pthread_create(&threads[i], NULL, &stress, (void *) (long) i);
+  }
+  for (int round = 0; round < numRounds; round++) {
+    allocator->beginBlock();
+    barrierWait(&barrier);
+    barrierWait(&barrier);
+  }
+  barrierWait(&barrier);
+  for (int i = 0; i < NUM_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  gettimeofday(&end, NULL);
+  double durationUs = (end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_usec - start.tv_usec);
+
+  int numMessages = 2 * NUM_THREADS * NUM_MESSAGES_PER_ROUND * numRounds;
+  printf("%i threads, %i rounds, %i messages\n", NUM_THREADS, numRounds, numMessages);
+  printf("%.3f us/round, %.1f ns/message\n", durationUs / numRounds, 1000.0 * durationUs / numMessages);
+  printf("block allocations: %llu, arena allocations: %llu, failed allocations: %llu, slabs: %u\n",
+      allocator->getNumBlockAllocations(), allocator->getNumArenaAllocations(),
+      allocator->getNumFailedAllocations(), allocator->getNumSlabs());
+
+  int numLiveBlocks = allocator->getNumLiveBlocks();
+  delete allocator;
+
+  if (numCorruptMessages > 0 || numLiveBlocks != 0) {
+    printf("FAILED: %i corrupt messages, %i live blocks.\n", numCorruptMessages, numLiveBlocks);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
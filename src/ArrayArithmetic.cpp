@@ -0,0 +1,197 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ArrayArithmetic.h"
+
+#if ARRAY_ARITHMETIC_DISPATCH
+// all intrinsics are available to functions compiled with the respective target attribute
+#include <immintrin.h>
+#endif
+
+/*
+ * Each kernel computes its operation for the indices [startIndex, endIndex), in vectors of the
+ * given width and then sample by sample for the remainder. Buffers are loaded and stored unaligned,
+ * as dsp buffers are only guaranteed to be 16-byte aligned and the operations may start at any
+ * index. All levels produce exactly the same results.
+ */
+
+#define DEFINE_SCALAR_KERNEL(_name, _op) \
+  static void _name(float *input0, float *input1, float *output, int startIndex, int endIndex) { \
+    for (int i = startIndex; i < endIndex; i++) { \
+      output[i] = input0[i] _op input1[i]; \
+    } \
+  }
+
+#define DEFINE_SCALAR_CONSTANT_KERNEL(_name, _op) \
+  static void _name(float *input, float constant, float *output, int startIndex, int endIndex) { \
+    for (int i = startIndex; i < endIndex; i++) { \
+      output[i] = input[i] _op constant; \
+    } \
+  }
+
+DEFINE_SCALAR_KERNEL(addScalar, +)
+DEFINE_SCALAR_CONSTANT_KERNEL(addConstantScalar, +)
+DEFINE_SCALAR_KERNEL(subtractScalar, -)
+DEFINE_SCALAR_CONSTANT_KERNEL(subtractConstantScalar, -)
+DEFINE_SCALAR_KERNEL(multiplyScalar, *)
+DEFINE_SCALAR_CONSTANT_KERNEL(multiplyConstantScalar, *)
+DEFINE_SCALAR_KERNEL(divideScalar, /)
+DEFINE_SCALAR_CONSTANT_KERNEL(divideConstantScalar, /)
+
+static void fillScalar(float *input, float constant, int startIndex, int endIndex) {
+  for (int i = startIndex; i < endIndex; i++) {
+    input[i] = constant;
+  }
+}
+
+static const ArrayArithmeticKernels scalarKernels = {
+  addScalar, addConstantScalar, subtractScalar, subtractConstantScalar,
+  multiplyScalar, multiplyConstantScalar, divideScalar, divideConstantScalar, fillScalar
+};
+
+#if ARRAY_ARITHMETIC_DISPATCH
+
+#define DEFINE_VECTOR_KERNEL(_name, _target, _width, _loadu, _storeu, _vectorOp, _op) \
+  __attribute__((target(_target))) \
+  static void _name(float *input0, float *input1, float *output, int startIndex, int endIndex) { \
+    int i = startIndex; \
+    for (int n = endIndex - (_width); i <= n; i += (_width)) { \
+      _storeu(output+i, _vectorOp(_loadu(input0+i), _loadu(input1+i))); \
+    } \
+    for (; i < endIndex; i++) { \
+      output[i] = input0[i] _op input1[i]; \
+    } \
+  }
+
+#define DEFINE_VECTOR_CONSTANT_KERNEL(_name, _target, _width, _vector, _set1, _loadu, _storeu, _vectorOp, _op) \
+  __attribute__((target(_target))) \
+  static void _name(float *input, float constant, float *output, int startIndex, int endIndex) { \
+    const _vector constVec = _set1(constant); \
+    int i = startIndex; \
+    for (int n = endIndex - (_width); i <= n; i += (_width)) { \
+      _storeu(output+i, _vectorOp(_loadu(input+i), constVec)); \
+    } \
+    for (; i < endIndex; i++) { \
+      output[i] = input[i] _op constant; \
+    } \
+  }
+
+#define DEFINE_VECTOR_FILL_KERNEL(_name, _target, _width, _vector, _set1, _storeu) \
+  __attribute__((target(_target))) \
+  static void _name(float *input, float constant, int startIndex, int endIndex) { \
+    const _vector constVec = _set1(constant); \
+    int i = startIndex; \
+    for (int n = endIndex - (_width); i <= n; i += (_width)) { \
+      _storeu(input+i, constVec); \
+    } \
+    for (; i < endIndex; i++) { \
+      input[i] = constant; \
+    } \
+  }
+
+/** Defines all kernels of one level, named by the given suffix, and their table. */
+#define DEFINE_VECTOR_KERNELS(_suffix, _target, _width, _vector, _set1, _loadu, _storeu, _add, _sub, _mul, _div) \
+  DEFINE_VECTOR_KERNEL(add##_suffix, _target, _width, _loadu, _storeu, _add, +) \
+  DEFINE_VECTOR_CONSTANT_KERNEL(addConstant##_suffix, _target, _width, _vector, _set1, _loadu, _storeu, _add, +) \
+  DEFINE_VECTOR_KERNEL(subtract##_suffix, _target, _width, _loadu, _storeu, _sub, -) \
+  DEFINE_VECTOR_CONSTANT_KERNEL(subtractConstant##_suffix, _target, _width, _vector, _set1, _loadu, _storeu, _sub, -) \
+  DEFINE_VECTOR_KERNEL(multiply##_suffix, _target, _width, _loadu, _storeu, _mul, *) \
+  DEFINE_VECTOR_CONSTANT_KERNEL(multiplyConstant##_suffix, _target, _width, _vector, _set1, _loadu, _storeu, _mul, *) \
+  DEFINE_VECTOR_KERNEL(divide##_suffix, _target, _width, _loadu, _storeu, _div, /) \
+  DEFINE_VECTOR_CONSTANT_KERNEL(divideConstant##_suffix, _target, _width, _vector, _set1, _loadu, _storeu, _div, /) \
+  DEFINE_VECTOR_FILL_KERNEL(fill##_suffix, _target, _width, _vector, _set1, _storeu) \
+  static const ArrayArithmeticKernels _suffix##Kernels = { \
+    add##_suffix, addConstant##_suffix, subtract##_suffix, subtractConstant##_suffix, \
+    multiply##_suffix, multiplyConstant##_suffix, divide##_suffix, divideConstant##_suffix, fill##_suffix \
+  };
+
+DEFINE_VECTOR_KERNELS(Sse, "sse", 4, __m128, _mm_set1_ps, _mm_loadu_ps, _mm_storeu_ps,
+    _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_div_ps)
+DEFINE_VECTOR_KERNELS(Avx2, "avx2", 8, __m256, _mm256_set1_ps, _mm256_loadu_ps, _mm256_storeu_ps,
+    _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_div_ps)
+DEFINE_VECTOR_KERNELS(Avx512, "avx512f", 16, __m512, _mm512_set1_ps, _mm512_loadu_ps, _mm512_storeu_ps,
+    _mm512_add_ps, _mm512_sub_ps, _mm512_mul_ps, _mm512_div_ps)
+
+ArrayArithmeticKernels ArrayArithmetic::kernels = SseKernels;
+ArrayArithmeticLevel ArrayArithmetic::kernelLevel = ARRAY_ARITHMETIC_SSE;
+
+#else // !ARRAY_ARITHMETIC_DISPATCH
+
+// the operations are chosen at compile time, the table is not used
+ArrayArithmeticKernels ArrayArithmetic::kernels = scalarKernels;
+ArrayArithmeticLevel ArrayArithmetic::kernelLevel = ARRAY_ARITHMETIC_SCALAR;
+
+#endif // ARRAY_ARITHMETIC_DISPATCH
+
+void ArrayArithmetic::initKernels() {
+  #if ARRAY_ARITHMETIC_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    setKernelLevel(ARRAY_ARITHMETIC_AVX512);
+  } else if (__builtin_cpu_supports("avx2")) {
+    setKernelLevel(ARRAY_ARITHMETIC_AVX2);
+  } else {
+    setKernelLevel(ARRAY_ARITHMETIC_SSE);
+  }
+  #endif
+}
+
+bool ArrayArithmetic::setKernelLevel(ArrayArithmeticLevel level) {
+  #if ARRAY_ARITHMETIC_DISPATCH
+  // contexts may be constructed while others are processing. All kernels produce the
+  // same results, such that it does not matter which of them a concurrent operation picks up.
+  __builtin_cpu_init();
+  switch (level) {
+    case ARRAY_ARITHMETIC_SCALAR: kernels = scalarKernels; break;
+    case ARRAY_ARITHMETIC_SSE: kernels = SseKernels; break;
+    case ARRAY_ARITHMETIC_AVX2: {
+      if (!__builtin_cpu_supports("avx2")) return false;
+      kernels = Avx2Kernels;
+      break;
+    }
+    case ARRAY_ARITHMETIC_AVX512: {
+      if (!__builtin_cpu_supports("avx512f")) return false;
+      kernels = Avx512Kernels;
+      break;
+    }
+    default: return false;
+  }
+  kernelLevel = level;
+  return true;
+  #else
+  return (level == kernelLevel);
+  #endif
+}
+
+ArrayArithmeticLevel ArrayArithmetic::getKernelLevel() {
+  return kernelLevel;
+}
+
+const char *ArrayArithmetic::getKernelLevelName(ArrayArithmeticLevel level) {
+  switch (level) {
+    case ARRAY_ARITHMETIC_SCALAR: return "scalar";
+    case ARRAY_ARITHMETIC_SSE: return "sse";
+    case ARRAY_ARITHMETIC_AVX2: return "avx2";
+    case ARRAY_ARITHMETIC_AVX512: return "avx512";
+    default: return "unknown";
+  }
+}
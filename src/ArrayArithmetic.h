@@ -34,18 +34,67 @@
 #include <arm_neon.h>
 #endif
 
+#if !__APPLE__ && __SSE__ && __GNUC__ && (__x86_64__ || __i386__)
+// On x86 (other than with the Accelerate framework) the widest kernels supported by the cpu are
+// selected at runtime, such that a single binary can make use of AVX2 and AVX-512 where available.
+#define ARRAY_ARITHMETIC_DISPATCH 1
+#endif
+
+/** The instruction set levels for which <code>ArrayArithmetic</code> kernels are available. */
+typedef enum ArrayArithmeticLevel {
+  ARRAY_ARITHMETIC_SCALAR,
+  ARRAY_ARITHMETIC_SSE,   // 4-wide
+  ARRAY_ARITHMETIC_AVX2,  // 8-wide
+  ARRAY_ARITHMETIC_AVX512 // 16-wide
+} ArrayArithmeticLevel;
+
+/** A table of the kernels implementing each <code>ArrayArithmetic</code> operation at one level. */
+typedef struct ArrayArithmeticKernels {
+  void (*add)(float *input0, float *input1, float *output, int startIndex, int endIndex);
+  void (*addConstant)(float *input, float constant, float *output, int startIndex, int endIndex);
+  void (*subtract)(float *input0, float *input1, float *output, int startIndex, int endIndex);
+  void (*subtractConstant)(float *input, float constant, float *output, int startIndex, int endIndex);
+  void (*multiply)(float *input0, float *input1, float *output, int startIndex, int endIndex);
+  void (*multiplyConstant)(float *input, float constant, float *output, int startIndex, int endIndex);
+  void (*divide)(float *input0, float *input1, float *output, int startIndex, int endIndex);
+  void (*divideConstant)(float *input, float constant, float *output, int startIndex, int endIndex);
+  void (*fill)(float *input, float constant, int startIndex, int endIndex);
+} ArrayArithmeticKernels;
+
 /**
  * This class offers static inline functions for computing basic arithmetic with float arrays.
  * It offers a central place for optimised implementations of common compute-intensive operations.
  * In all SSE cases, input vectors can be (16-byte) unaligned, but output vectors must be aligned.
+ * Where <code>ARRAY_ARITHMETIC_DISPATCH</code> is defined, the operations are forwarded to a table
+ * of kernels which is chosen once for the cpu by <code>initKernels()</code>.
  */
 class ArrayArithmetic {
   
   public:
   
+    /**
+     * Selects the widest kernels supported by the cpu. It is called by every <code>PdContext</code>
+     * on construction and may safely be called more than once. Until then the SSE kernels are used.
+     */
+    static void initKernels();
+  
+    /**
+     * Selects the kernels of the given level. Returns false, and leaves the kernels unchanged, if
+     * the level is not supported by the cpu (or by the build). Intended for benchmarking and testing.
+     */
+    static bool setKernelLevel(ArrayArithmeticLevel level);
+  
+    /** Returns the level of the kernels currently in use. */
+    static ArrayArithmeticLevel getKernelLevel();
+  
+    /** Returns a readable name of the given level, e.g. <code>"avx2"</code>. */
+    static const char *getKernelLevelName(ArrayArithmeticLevel level);
+  
     static inline void add(float *input0, float *input1, float *output, int startIndex, int endIndex) {
       #if __APPLE__
       vDSP_vadd(input0+startIndex, 1, input1+startIndex, 1, output+startIndex, 1, endIndex-startIndex);
+      #elif ARRAY_ARITHMETIC_DISPATCH
+      kernels.add(input0, input1, output, startIndex, endIndex);
       #elif __SSE__
       input0 += startIndex;
       input1 += startIndex;
@@ -105,6 +154,8 @@ class ArrayArithmetic {
     static inline void add(float *input, float constant, float *output, int startIndex, int endIndex) {
       #if __APPLE__
       vDSP_vsadd(input+startIndex, 1, &constant, output+startIndex, 1, endIndex-startIndex);
+      #elif ARRAY_ARITHMETIC_DISPATCH
+      kernels.addConstant(input, constant, output, startIndex, endIndex);
       #elif __SSE__
       input += startIndex;
       output += startIndex;
@@ -162,6 +213,8 @@ class ArrayArithmetic {
     static inline void subtract(float *input0, float *input1, float *output, int startIndex, int endIndex) {
       #if __APPLE__
       vDSP_vsub(input1+startIndex, 1, input0+startIndex, 1, output+startIndex, 1, endIndex-startIndex);
+      #elif ARRAY_ARITHMETIC_DISPATCH
+      kernels.subtract(input0, input1, output, startIndex, endIndex);
       #elif __SSE__
       input0 += startIndex;
       input1 += startIndex;
@@ -221,6 +274,8 @@ class ArrayArithmetic {
       #if __APPLE__
       float negation = -1.0f * constant;
       vDSP_vsadd(input+startIndex, 1, &negation, output+startIndex, 1, endIndex-startIndex);
+      #elif ARRAY_ARITHMETIC_DISPATCH
+      kernels.subtractConstant(input, constant, output, startIndex, endIndex);
       #elif __SSE__
       input += startIndex;
       output += startIndex;
@@ -276,6 +331,8 @@ class ArrayArithmetic {
     static inline void multiply(float *input0, float *input1, float *output, int startIndex, int endIndex) {
       #if __APPLE__
       vDSP_vmul(input0+startIndex, 1, input1+startIndex, 1, output+startIndex, 1, endIndex-startIndex);
+      #elif ARRAY_ARITHMETIC_DISPATCH
+      kernels.multiply(input0, input1, output, startIndex, endIndex);
       #elif __SSE__
       input0 += startIndex;
       input1 += startIndex;
@@ -334,6 +391,8 @@ class ArrayArithmetic {
     static inline void multiply(float *input, float constant, float *output, int startIndex, int endIndex) {
       #if __APPLE__
       vDSP_vsmul(input+startIndex, 1, &constant, output+startIndex, 1, endIndex-startIndex);
+      #elif ARRAY_ARITHMETIC_DISPATCH
+      kernels.multiplyConstant(input, constant, output, startIndex, endIndex);
       #elif __SSE__
       input += startIndex;
       output += startIndex;
@@ -390,6 +449,8 @@ class ArrayArithmetic {
     static inline void divide(float *input0, float *input1, float *output, int startIndex, int endIndex) {
       #if __APPLE__
       vDSP_vdiv(input1+startIndex, 1, input0+startIndex, 1, output+startIndex, 1, endIndex-startIndex);
+      #elif ARRAY_ARITHMETIC_DISPATCH
+      kernels.divide(input0, input1, output, startIndex, endIndex);
       #elif __SSE__
       input0 += startIndex;
       input1 += startIndex;
@@ -425,6 +486,8 @@ class ArrayArithmetic {
     static inline void divide(float *input, float constant, float *output, int startIndex, int endIndex) {
       #if __APPLE__
       vDSP_vsdiv(input+startIndex, 1, &constant, output+startIndex, 1, endIndex-startIndex);
+      #elif ARRAY_ARITHMETIC_DISPATCH
+      kernels.divideConstant(input, constant, output, startIndex, endIndex);
       #elif __SSE__
       input += startIndex;
       output += startIndex;
@@ -460,6 +523,8 @@ class ArrayArithmetic {
     static inline void fill(float *input, float constant, int startIndex, int endIndex) {
       #if __APPLE__
       vDSP_vfill(&constant, input+startIndex, 1, endIndex-startIndex);
+      #elif ARRAY_ARITHMETIC_DISPATCH
+      kernels.fill(input, constant, startIndex, endIndex);
       #elif __SSE__
       input += startIndex;
       int n = endIndex - startIndex;
@@ -510,6 +575,12 @@ class ArrayArithmetic {
   private:
     ArrayArithmetic(); // no instances of this object are allowed
     ~ArrayArithmetic();
+  
+    /** The kernels currently in use. */
+    static ArrayArithmeticKernels kernels;
+  
+    /** The level of the kernels currently in use. */
+    static ArrayArithmeticLevel kernelLevel;
 };
 
 #endif // _ARRAY_ARITHMETIC_H_
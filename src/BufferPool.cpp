@@ -23,83 +23,162 @@
 #include "BufferPool.h"
 #include "DspObject.h"
 
+// the smallest number of buffers in a new arena. Arenas grow geometrically after that.
+#define MIN_ARENA_BUFFERS 16
+
+// the reference count of a buffer which is available or retired
+#define BUFFER_NOT_RESERVED -1
+
 BufferPool::BufferPool(unsigned short size) {
   bufferSize = size;
+  reuseBuffers = true;
+  numReservedBuffers = 0;
+  numPeakBuffers = 0;
  
   zeroBuffer = ALLOC_ALIGNED_BUFFER(bufferSize * sizeof(float));
   memset(zeroBuffer, 0, bufferSize*sizeof(float)); // zero the zero buffer!
 }
 
 BufferPool::~BufferPool() {
-  // free all buffers, reserved and available
-  for (list<std::pair<float *, unsigned int> >::iterator it = reserved.begin(); it != reserved.end(); ++it) {
-    FREE_ALIGNED_BUFFER((*it).first);
+  freeArenas(&arenaList);
+  freeArenas(&releasedArenaList);
+  FREE_ALIGNED_BUFFER(zeroBuffer);
+}
+
+void BufferPool::addArena(unsigned int numBuffers) {
+  BufferArena arena;
+  arena.firstIndex = arenaList.empty() ? 0 : arenaList.back().firstIndex + arenaList.back().numBuffers;
+  arena.numBuffers = max(numBuffers, max((unsigned int) MIN_ARENA_BUFFERS, arena.firstIndex));
+  arena.buffers = ALLOC_ALIGNED_BUFFER(arena.numBuffers * bufferSize * sizeof(float));
+  memset(arena.buffers, 0, arena.numBuffers * bufferSize * sizeof(float));
+  arenaList.push_back(arena);
+}
+
+void BufferPool::freeArenas(vector<BufferArena> *arenas) {
+  for (int i = 0; i < arenas->size(); i++) {
+    FREE_ALIGNED_BUFFER(arenas->at(i).buffers);
   }
-  while (!pool.empty()) {
-    FREE_ALIGNED_BUFFER(pool.top());
-    pool.pop();
+  arenas->clear();
+}
+
+void BufferPool::freeReleasedArenas() {
+  freeArenas(&releasedArenaList);
+}
+
+int BufferPool::getBufferIndex(float *buffer) {
+  // there are only a few arenas. There is exactly one after the pool has been repacked.
+  for (int i = 0; i < arenaList.size(); i++) {
+    BufferArena *arena = &arenaList[i];
+    if (buffer >= arena->buffers && buffer < arena->buffers + arena->numBuffers * bufferSize) {
+      int index = arena->firstIndex + (int) ((buffer - arena->buffers) / bufferSize);
+      return (index < referenceCounts.size()) ? index : -1;
+    }
   }
-  FREE_ALIGNED_BUFFER(zeroBuffer);
+  return -1;
+}
+
+float *BufferPool::getBufferAtIndex(unsigned int index) {
+  for (int i = 0; i < arenaList.size(); i++) {
+    BufferArena *arena = &arenaList[i];
+    if (index < arena->firstIndex + arena->numBuffers) {
+      return arena->buffers + (index - arena->firstIndex) * bufferSize;
+    }
+  }
+  return NULL;
 }
 
 float *BufferPool::getBuffer(unsigned int numDependencies) {
-  float *buffer = NULL;
-  if (pool.size() > 0) {
-    buffer = pool.top();
-    pool.pop();
+  unsigned int index;
+  if (!pool.empty()) {
+    index = pool.back();
+    pool.pop_back();
   } else {
-    buffer = ALLOC_ALIGNED_BUFFER(bufferSize * sizeof(float));
-    memset(buffer, 0, bufferSize * sizeof(float));
+    // take the next unused buffer from the last arena
+    index = referenceCounts.size();
+    if (arenaList.empty() || index == arenaList.back().firstIndex + arenaList.back().numBuffers) {
+      addArena(1);
+    }
+    referenceCounts.push_back(BUFFER_NOT_RESERVED);
+    if (referenceCounts.size() > numPeakBuffers) numPeakBuffers = referenceCounts.size();
   }
-  reserved.push_back(std::pair<float *, unsigned int>(buffer, numDependencies));
-//  printf("%i/%i buffer used.\n", getNumReservedBuffers(), getNumTotalBuffers());
-  return buffer;
+  referenceCounts[index] = numDependencies;
+  ++numReservedBuffers;
+  return getBufferAtIndex(index);
 }
 
 void BufferPool::releaseBuffer(float *buffer) {
   // an object may try to release the zero buffer. This should not be possible.
   if (buffer == zeroBuffer) return;
   
-  for (list<std::pair<float *, unsigned int> >::iterator it = reserved.begin(); it != reserved.end(); ++it) {
-    if ((*it).first == buffer) {
-      --((*it).second);
-      if ((*it).second <= 0) {
-        reserved.erase(it);
-        pool.push(buffer);
-//        printf("%i/%i buffer used.\n", getNumReservedBuffers(), getNumTotalBuffers());
-        break;
-      }
+  // if the buffer is not reserved, nothing changes. Untracked buffers are left alone.
+  int index = getBufferIndex(buffer);
+  if (index < 0 || referenceCounts[index] <= 0) return;
+  
+  if (--referenceCounts[index] == 0) {
+    referenceCounts[index] = BUFFER_NOT_RESERVED;
+    --numReservedBuffers;
+    if (reuseBuffers) {
+      pool.push_back(index);
+    } else {
+      retired.push_back(index);
     }
   }
-  // if the buffer is not in the reserved pool, nothing changes. Untracked buffers are left alone.
 }
 
 void BufferPool::reserveBuffer(float *buffer, unsigned int reserveCount) {
   if (buffer == zeroBuffer) return; // no need to reserve the zero buffer
   
-  for (list<std::pair<float *, unsigned int> >::iterator it = reserved.begin(); it != reserved.end(); ++it) {
-    if ((*it).first == buffer) {
-      (*it).second += reserveCount;
-      return;
-    }
+  int index = getBufferIndex(buffer);
+  if (index >= 0 && referenceCounts[index] != BUFFER_NOT_RESERVED) {
+    referenceCounts[index] += reserveCount;
+    return;
   }
   
   printf("Attempt to reserve unreserved buffer %p +%i.\n  "
       "This may be ok if the buffer is global such as an adc~ input buffer.\n", buffer, reserveCount);
 }
 
-/*
-void BufferPool::resizeBuffers(unsigned int newBufferSize) {
-  for (list<std::pair<float *, unsigned int> >::iterator it = reserved.begin(); it != reserved.end(); ++it) {
-    float *buffer = (*it).first;
-    float *newBuffer = (float *) realloc(buffer, newBufferSize * sizeof(float));
-    if (newBuffer != buffer) { // buffer should start at same address so that it is still 16-byte aligned
-      free(buffer);
-      free(newBuffer);
-      (*it).first = (float *) valloc(newBufferSize * sizeof(float));
+void BufferPool::releaseAllBuffers() {
+  pool.clear();
+  retired.clear();
+  // the buffers at the lowest addresses are handed out first
+  for (int i = referenceCounts.size()-1; i >= 0; i--) {
+    referenceCounts[i] = BUFFER_NOT_RESERVED;
+    pool.push_back(i);
+  }
+  numReservedBuffers = 0;
+}
+
+void BufferPool::retireAvailableBuffers() {
+  retired.insert(retired.end(), pool.begin(), pool.end());
+  pool.clear();
+}
+
+void BufferPool::reclaimUnreferencedBuffers(vector<bool> *isReferenced) {
+  pool.clear();
+  retired.clear();
+  numReservedBuffers = 0;
+  for (int i = referenceCounts.size()-1; i >= 0; i--) {
+    if (isReferenced->at(i)) {
+      if (referenceCounts[i] == BUFFER_NOT_RESERVED) {
+        retired.push_back(i);
+      } else {
+        ++numReservedBuffers;
+      }
+    } else {
+      referenceCounts[i] = BUFFER_NOT_RESERVED;
+      pool.push_back(i);
     }
   }
-  
-  // TODO(mhroth): resize all buffers in pool
 }
-*/
+
+void BufferPool::repack(unsigned int numBuffers) {
+  releasedArenaList.insert(releasedArenaList.end(), arenaList.begin(), arenaList.end());
+  arenaList.clear();
+  pool.clear();
+  retired.clear();
+  referenceCounts.assign(numBuffers, 1);
+  if (numBuffers > 0) addArena(numBuffers);
+  numReservedBuffers = numBuffers;
+  numPeakBuffers = numBuffers;
+}
@@ -23,10 +23,14 @@
 #ifndef _BUFFER_POOL_
 #define _BUFFER_POOL_
 
-#include <list>
-#include <stack>
+#include <vector>
 using namespace std;
 
+/**
+ * A <code>BufferPool</code> hands out the dsp buffers of a root graph. Buffers are carved out of
+ * large contiguous arenas and are identified by their index in the pool, such that the reference
+ * count of a buffer is found in constant time from its address.
+ */
 class BufferPool {
   public:
     BufferPool(unsigned short bufferSize);
@@ -44,25 +48,114 @@ class BufferPool {
     /** Add to the reserve cound of the given buffer. */
     void reserveBuffer(float *buffer, unsigned int reserveCount);
   
-    /** Resizes all buffers in the pool (reserved and available). */
-//    void resizeBuffers(unsigned int newBufferSize);
+    /**
+     * Makes all buffers available again, regardless of their reserve count. Used when the buffers
+     * of all objects are about to be reassigned, e.g. when the process order of a root graph is
+     * recomputed, such that repeated reordering does not leak buffers.
+     */
+    void releaseAllBuffers();
+  
+    /**
+     * Moves all available buffers to the retired buffers, such that they are not handed out again
+     * until <code>releaseAllBuffers()</code> is called. Available buffers may still be read and
+     * written by the objects to which they were assigned before being released. This is used when
+     * the buffers of only some objects are reassigned, such that the new buffers are not shared
+     * with any of the other objects.
+     */
+    void retireAvailableBuffers();
+  
+    /**
+     * Returns every buffer which is not marked as referenced to the available buffers, whether it
+     * was reserved, available or retired, and retires the available buffers which are referenced.
+     * Used when the buffers of only some objects are reassigned. The buffers which none of the
+     * other objects refer to anymore may then be reused by those objects, while the others are not.
+     */
+    void reclaimUnreferencedBuffers(vector<bool> *isReferenced);
+  
+    /**
+     * Returns the index of the given buffer in this pool, or -1 if the buffer does not belong to
+     * the pool (e.g. the zero buffer, or a buffer owned by an object such as <code>send~</code>).
+     */
+    int getBufferIndex(float *buffer);
+  
+    /**
+     * Replaces all buffers with a single zeroed arena of <code>numBuffers</code> contiguous
+     * buffers, each reserved once. The previous buffers no longer belong to the pool, but their
+     * memory is only freed by <code>freeReleasedArenas()</code>, as the audio thread may still be
+     * processing them. Used once the buffers of a process order have been assigned according to
+     * their lifetimes.
+     */
+    void repack(unsigned int numBuffers);
+  
+    /** Frees the memory of all buffers which have been replaced by <code>repack()</code>. */
+    void freeReleasedArenas();
+  
+    /** Returns the buffer at the given index. */
+    float *getBufferAtIndex(unsigned int index);
   
     float *getZeroBuffer() { return zeroBuffer; }
   
-    unsigned int getNumReservedBuffers() { return reserved.size(); }
+    /**
+     * If <code>false</code>, released buffers are not handed out again until
+     * <code>releaseAllBuffers()</code> is called, and every call to <code>getBuffer()</code>
+     * returns a distinct buffer. Reusing buffers minimises memory, but creates dependencies
+     * between otherwise independent objects. Buffers are reused by default.
+     */
+    void setReuseBuffers(bool reuseBuffers) { this->reuseBuffers = reuseBuffers; }
+    bool isReusingBuffers() { return reuseBuffers; }
+  
+    unsigned int getNumReservedBuffers() { return numReservedBuffers; }
     unsigned int getNumAvailableBuffers() { return pool.size(); }
-    unsigned int getNumTotalBuffers() { return (pool.size() + reserved.size()); }
+    unsigned int getNumTotalBuffers() { return referenceCounts.size(); }
+  
+    /**
+     * Returns the largest number of buffers which the pool has held since it was last repacked.
+     * Directly after a repack this is the number of buffers which are live at the same time in the
+     * process order.
+     */
+    unsigned int getNumPeakBuffers() { return numPeakBuffers; }
   
   private:
-    /** A pool of reserved buffers, paired with the number of outstanding dependencies. */
-    list<std::pair<float *, unsigned int> > reserved;
+    /** A contiguous block of buffers. Buffer <code>i</code> of the pool is at index i - firstIndex. */
+    typedef struct BufferArena {
+      float *buffers;
+      unsigned int firstIndex;
+      unsigned int numBuffers;
+    } BufferArena;
+  
+    /** Creates a new arena with room for at least <code>numBuffers</code> buffers. */
+    void addArena(unsigned int numBuffers);
+  
+    /** Frees all arenas of the given list and clears it. */
+    static void freeArenas(vector<BufferArena> *arenas);
+  
+    vector<BufferArena> arenaList;
   
-    /** A pool of available buffers. */
-    stack<float *> pool;
+    /** The arenas which have been replaced by <code>repack()</code> but not yet freed. */
+    vector<BufferArena> releasedArenaList;
+  
+    /**
+     * The reference count of every buffer which has been handed out, by index. Buffers which are
+     * available or retired have a negative count. A reserved buffer may have a count of zero if it
+     * has no dependencies, in which case it stays reserved.
+     */
+    vector<int> referenceCounts;
+  
+    /** The indices of the available buffers. The most recently released buffer is at the back. */
+    vector<unsigned int> pool;
+  
+    /** The indices of buffers which have been retired, or released while not reusing buffers. */
+    vector<unsigned int> retired;
+  
+    unsigned int numReservedBuffers;
+  
+    unsigned int numPeakBuffers;
   
     float *zeroBuffer;
   
     unsigned short bufferSize;
+  
+    bool reuseBuffers;
 };
 
 #endif // _BUFFER_POOL_
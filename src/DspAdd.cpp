@@ -31,6 +31,7 @@ MessageObject *DspAdd::newObject(PdMessage *initMessage, PdGraph *graph) {
 
 DspAdd::DspAdd(PdMessage *initMessage, PdGraph *graph) : DspObject(2, 2, 0, 1, graph) {
   constant = initMessage->isFloat(0) ? initMessage->getFloat(0) : 0.0f;
+  processFunction = &processScalar;
   processFunctionNoMessage = &processScalar;
 }
 
@@ -59,12 +60,26 @@ void DspAdd::processMessage(int inletIndex, PdMessage *message) {
 void DspAdd::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
   DspAdd *d = reinterpret_cast<DspAdd *>(dspObject);
   
-  ArrayArithmetic::add(d->dspBufferAtInlet[0] , d->dspBufferAtInlet[1],
-      d->dspBufferAtOutlet[0], 0, toIndex);
+  if (d->isConstantAtInlet(0) && d->isConstantAtInlet(1)) {
+    d->fillConstantAtOutlet(d->getConstantAtInlet(0) + d->getConstantAtInlet(1), 0, fromIndex, toIndex);
+  } else if (d->isConstantAtInlet(1)) {
+    ArrayArithmetic::add(d->dspBufferAtInlet[0], d->getConstantAtInlet(1),
+        d->dspBufferAtOutlet[0], 0, toIndex);
+    d->clearConstantAtOutlet(0);
+  } else {
+    ArrayArithmetic::add(d->dspBufferAtInlet[0] , d->dspBufferAtInlet[1],
+        d->dspBufferAtOutlet[0], 0, toIndex);
+    d->clearConstantAtOutlet(0);
+  }
 }
 
 void DspAdd::processScalar(DspObject *dspObject, int fromIndex, int toIndex) {
   DspAdd *d = reinterpret_cast<DspAdd *>(dspObject);
-  ArrayArithmetic::add(d->dspBufferAtInlet[0] , d->constant,
-      d->dspBufferAtOutlet[0], fromIndex, toIndex);
+  if (d->isConstantAtInlet(0)) {
+    d->fillConstantAtOutlet(d->getConstantAtInlet(0) + d->constant, 0, fromIndex, toIndex);
+  } else {
+    ArrayArithmetic::add(d->dspBufferAtInlet[0] , d->constant,
+        d->dspBufferAtOutlet[0], fromIndex, toIndex);
+    d->clearConstantAtOutlet(0);
+  }
 }
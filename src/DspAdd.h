@@ -35,6 +35,7 @@ class DspAdd : public DspObject {
   
     static const char *getObjectLabel() { return "+~"; }
     string toString();
+    bool canProcessInPlace() { return true; }
   
     void onInletConnectionUpdate(unsigned int inletIndex);
     
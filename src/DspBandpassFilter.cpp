@@ -22,6 +22,7 @@
 
 #include "DspBandpassFilter.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 MessageObject *DspBandpassFilter::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspBandpassFilter(initMessage, graph);
@@ -56,8 +57,8 @@ void DspBandpassFilter::calcFiltCoeff(float fc, float q) {
 void DspBandpassFilter::processMessage(int inletIndex, PdMessage *message) {
   switch (inletIndex) {
     case 0: {
-      if (message->isSymbol(0, "clear")) {
-        x1 = x2 = dspBufferAtOutlet[0][0] = dspBufferAtOutlet[0][1] = 0.0f;
+      if (message->isInternedSymbol(0, SymbolTable::CLEAR)) {
+        x1 = x2 = y1 = y2 = 0.0f;
       }
       break;
     }
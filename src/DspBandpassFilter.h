@@ -37,6 +37,7 @@ class DspBandpassFilter : public DspFilter {
     ~DspBandpassFilter();
   
     static const char *getObjectLabel() { return "bp~"; }
+    ObjectType getObjectType() { return DSP_BANDPASS_FILTER; }
 
   private:
     void processMessage(int inletIndex, PdMessage *message);
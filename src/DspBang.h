@@ -37,6 +37,8 @@ class DspBang : public DspObject {
     string toString() { return string(getObjectLabel()); }
   
     ConnectionType getConnectionType(int outletIndex) { return MESSAGE; }
+  
+    bool doesScheduleMessages() { return true; }
     
   private:
     static void processDsp(DspObject *dspObject, int fromIndex, int toIndex);
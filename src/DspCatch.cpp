@@ -36,10 +36,13 @@ DspCatch::DspCatch(PdMessage *initMessage, PdGraph *graph) : DspObject(0, 0, 0,
     name = NULL;
     graph->printErr("catch~ must be initialised with a name.");
   }
+  buffer = ALLOC_ALIGNED_BUFFER(graph->getBlockSize() * sizeof(float));
+  memset(buffer, 0, graph->getBlockSize() * sizeof(float));
   processFunction = &processNone;
 }
 
 DspCatch::~DspCatch() {
+  FREE_ALIGNED_BUFFER(buffer);
   free(name);
 }
 
@@ -52,46 +55,37 @@ string DspCatch::toString() {
 void DspCatch::addThrow(DspThrow *dspThrow) {
   if (!strcmp(dspThrow->getName(), name)) { // make sure that the throw~ really does match this catch~
     throwList.push_back(dspThrow); // NOTE(mhroth): no dupicate detection
-    
-    // update the process function
-    switch (throwList.size()) {
-      case 0: processFunction = &processNone; break;
-      case 1: processFunction = &processOne; break;
-      default: processFunction = &processMany; break;
-    }
+    dspThrow->setDspCatch(this);
   }
 }
 
 void DspCatch::removeThrow(DspThrow *dspThrow) {
   if (!strcmp(dspThrow->getName(), name)) {
     throwList.remove(dspThrow);
-    
-    switch (throwList.size()) {
-      case 0: processFunction = &processNone; break;
-      case 1: processFunction = &processOne; break;
-      default: processFunction = &processMany; break;
-    }
+    if (dspThrow->getDspCatch() == this) dspThrow->setDspCatch(NULL);
   }
 }
 
-void DspCatch::processNone(DspObject *dspObject, int fromIndex, int toIndex) {
-  DspCatch *d = reinterpret_cast<DspCatch *>(dspObject);
-  memset(d->dspBufferAtOutlet[0], 0, toIndex*sizeof(float));
+void DspCatch::commitDspState() {
+  DspObject::commitDspState();
+  if (throwList.empty()) {
+    // the buffer may still hold the input of the last throw~ which was removed
+    if (processFunction == &processSignal) memset(buffer, 0, graph->getBlockSize() * sizeof(float));
+    processFunction = &processNone;
+  } else {
+    processFunction = &processSignal;
+  }
 }
 
-void DspCatch::processOne(DspObject *dspObject, int fromIndex, int toIndex) {
+void DspCatch::processNone(DspObject *dspObject, int fromIndex, int toIndex) {
   DspCatch *d = reinterpret_cast<DspCatch *>(dspObject);
-  DspThrow *dspThrow = d->throwList.front();
-  memcpy(d->dspBufferAtOutlet[0], dspThrow->getBuffer(), toIndex*sizeof(float));
+  memset(d->dspBufferAtOutlet[0], 0, toIndex*sizeof(float));
 }
 
-// process at least two throw~s
-void DspCatch::processMany(DspObject *dspObject, int fromIndex, int toIndex) {
+void DspCatch::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
+  // the throw~s have already summed their inputs into the buffer. Output it and clear it for the
+  // next block.
   DspCatch *d = reinterpret_cast<DspCatch *>(dspObject);
-  list<DspThrow *>::iterator it = d->throwList.begin();
-  ArrayArithmetic::add((*it++)->getBuffer(), (*it++)->getBuffer(), d->dspBufferAtOutlet[0], 0, toIndex);
-  while (it != d->throwList.end()) {
-    ArrayArithmetic::add(d->dspBufferAtOutlet[0], (*it++)->getBuffer(), d->dspBufferAtOutlet[0],
-        0, toIndex);
-  };
+  memcpy(d->dspBufferAtOutlet[0], d->buffer, toIndex*sizeof(float));
+  memset(d->buffer, 0, toIndex*sizeof(float));
 }
@@ -41,17 +41,23 @@ class DspCatch : public DspObject {
     void addThrow(DspThrow *dspThrow);
     void removeThrow(DspThrow *dspThrow);
   
+    /** Returns the buffer into which all associated <code>throw~</code>s accumulate their input. */
+    float *getBuffer() { return buffer; }
+  
     const char *getName() { return name; }
     static const char *getObjectLabel() { return "catch~"; }
     ObjectType getObjectType() { return DSP_CATCH; }
     string toString();
   
+    /** The buffer is only output from the next block on if any <code>throw~</code> is registered. */
+    void commitDspState();
+  
   private:
     static void processNone(DspObject *dspObject, int fromIndex, int toIndex);
-    static void processOne(DspObject *dspObject, int fromIndex, int toIndex);
-    static void processMany(DspObject *dspObject, int fromIndex, int toIndex);
+    static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
     
     char *name;
+    float *buffer;
     list<DspThrow *> throwList; // list of associated throw~ objects
 };
 
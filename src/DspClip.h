@@ -35,6 +35,7 @@ class DspClip : public DspObject {
   
     static const char *getObjectLabel() { return "clip~"; }
     string toString();
+    bool canProcessInPlace() { return true; }
 
   private:
     static void processScalar(DspObject *dspObject, int fromIndex, int toIndex);
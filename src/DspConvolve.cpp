@@ -0,0 +1,241 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "DspConvolve.h"
+#include "PdContext.h"
+#include "PdGraph.h"
+#include "RealFft.h"
+#include "SymbolTable.h"
+
+MessageObject *DspConvolve::newObject(PdMessage *initMessage, PdGraph *graph) {
+  return new DspConvolve(initMessage, graph);
+}
+
+DspConvolve::DspConvolve(PdMessage *initMessage, PdGraph *graph) : DspObject(1, 1, 0, 1, graph) {
+  name = initMessage->isSymbol(0) ? StaticUtils::copyString(initMessage->getSymbol(0)) : NULL;
+  table = NULL;
+  
+  partitionSize = 1;
+  while (partitionSize < blockSizeInt) partitionSize <<= 1;
+  realFft = graph->getContext()->getRealFft(2*partitionSize);
+  
+  numPartitions = 0;
+  directResponse = ALLOC_ALIGNED_BUFFER(partitionSize * sizeof(float));
+  partitionReal = NULL;
+  partitionImag = NULL;
+  inputSpectraReal = NULL;
+  inputSpectraImag = NULL;
+  inputSpectraIndex = 0;
+  inputFrame = ALLOC_ALIGNED_BUFFER(2 * partitionSize * sizeof(float));
+  tailOutput = ALLOC_ALIGNED_BUFFER(partitionSize * sizeof(float));
+  fftReal = ALLOC_ALIGNED_BUFFER(2 * partitionSize * sizeof(float));
+  fftImag = ALLOC_ALIGNED_BUFFER(2 * partitionSize * sizeof(float));
+  fftBuffer = ALLOC_ALIGNED_BUFFER(2 * partitionSize * sizeof(float));
+  fftOutput = ALLOC_ALIGNED_BUFFER(2 * partitionSize * sizeof(float));
+  memset(directResponse, 0, partitionSize * sizeof(float));
+  clear();
+  
+  processFunction = &processSignal;
+  processFunctionNoMessage = &processSignal;
+}
+
+DspConvolve::~DspConvolve() {
+  free(name);
+  FREE_ALIGNED_BUFFER(directResponse);
+  free(partitionReal);
+  free(partitionImag);
+  free(inputSpectraReal);
+  free(inputSpectraImag);
+  FREE_ALIGNED_BUFFER(inputFrame);
+  FREE_ALIGNED_BUFFER(tailOutput);
+  FREE_ALIGNED_BUFFER(fftReal);
+  FREE_ALIGNED_BUFFER(fftImag);
+  FREE_ALIGNED_BUFFER(fftBuffer);
+  FREE_ALIGNED_BUFFER(fftOutput);
+}
+
+char *DspConvolve::getName() {
+  return name;
+}
+
+void DspConvolve::setTable(MessageTable *aTable) {
+  table = aTable;
+  loadImpulseResponse();
+}
+
+void DspConvolve::processMessage(int inletIndex, PdMessage *message) {
+  if (message->isInternedSymbol(0, SymbolTable::SET)) {
+    if (message->isSymbol(1)) {
+      // change the table from which the impulse response is read
+      free(name);
+      name = StaticUtils::copyString(message->getSymbol(1));
+      table = graph->getTable(name);
+    }
+    loadImpulseResponse();
+  } else if (message->isInternedSymbol(0, SymbolTable::CLEAR)) {
+    clear();
+  }
+}
+
+void DspConvolve::clear() {
+  memset(inputFrame, 0, 2 * partitionSize * sizeof(float));
+  memset(tailOutput, 0, partitionSize * sizeof(float));
+  framePosition = 0;
+  if (numPartitions > 1) {
+    memset(inputSpectraReal, 0, (numPartitions-1) * (partitionSize+1) * sizeof(float));
+    memset(inputSpectraImag, 0, (numPartitions-1) * (partitionSize+1) * sizeof(float));
+  }
+}
+
+void DspConvolve::loadImpulseResponse() {
+  int length = 0;
+  float *response = (table != NULL) ? table->getBuffer(&length) : NULL;
+  int newNumPartitions = (length + partitionSize - 1) / partitionSize;
+  int numBins = partitionSize + 1;
+  
+  memset(directResponse, 0, partitionSize * sizeof(float));
+  for (int i = 0; i < partitionSize && i < length; i++) {
+    directResponse[i] = response[i];
+  }
+  
+  if (newNumPartitions != numPartitions) {
+    // the spectra of past input do not depend on the impulse response and are kept unless the
+    // size of the delay line changes
+    int numSpectra = (newNumPartitions > 1) ? (newNumPartitions-1) : 0;
+    partitionReal = (float *) realloc(partitionReal, numSpectra * numBins * sizeof(float));
+    partitionImag = (float *) realloc(partitionImag, numSpectra * numBins * sizeof(float));
+    inputSpectraReal = (float *) realloc(inputSpectraReal, numSpectra * numBins * sizeof(float));
+    inputSpectraImag = (float *) realloc(inputSpectraImag, numSpectra * numBins * sizeof(float));
+    memset(inputSpectraReal, 0, numSpectra * numBins * sizeof(float));
+    memset(inputSpectraImag, 0, numSpectra * numBins * sizeof(float));
+    inputSpectraIndex = 0;
+    numPartitions = newNumPartitions;
+  }
+  
+  // the inverse fft is not normalised
+  float scale = 1.0f / (2.0f * partitionSize);
+  for (int k = 1; k < numPartitions; k++) {
+    int n = length - k*partitionSize;
+    if (n > partitionSize) n = partitionSize;
+    memset(fftBuffer, 0, 2 * partitionSize * sizeof(float));
+    memcpy(fftBuffer, response + k*partitionSize, n * sizeof(float));
+    realFft->forward(fftBuffer, fftReal, fftImag);
+    ArrayArithmetic::multiply(fftReal, scale, partitionReal + (k-1)*numBins, 0, numBins);
+    ArrayArithmetic::multiply(fftImag, scale, partitionImag + (k-1)*numBins, 0, numBins);
+  }
+}
+
+/*
+ * The spectrum of the last two partitions of input, multiplied with the spectrum of partition k
+ * and transformed back, yields the contribution of partition k to the output k partitions later
+ * in its second half (overlap-save). The contributions of all partitions but the first one to the
+ * next partition of output are thus known as soon as the current partition of input is complete.
+ */
+void DspConvolve::processPartition() {
+  int numBins = partitionSize + 1;
+  int numSpectra = numPartitions - 1;
+  
+  if (numSpectra > 0) {
+    realFft->forward(inputFrame, fftReal, fftImag);
+    inputSpectraIndex = (inputSpectraIndex + 1) % numSpectra;
+    memcpy(inputSpectraReal + inputSpectraIndex*numBins, fftReal, numBins * sizeof(float));
+    memcpy(inputSpectraImag + inputSpectraIndex*numBins, fftImag, numBins * sizeof(float));
+    
+    // multiply the spectrum of the input i partitions ago with that of partition i+1
+    memset(fftReal, 0, numBins * sizeof(float));
+    memset(fftImag, 0, numBins * sizeof(float));
+    for (int i = 0; i < numSpectra; i++) {
+      int j = inputSpectraIndex - i;
+      if (j < 0) j += numSpectra;
+      float *xReal = inputSpectraReal + j*numBins;
+      float *xImag = inputSpectraImag + j*numBins;
+      float *hReal = partitionReal + i*numBins;
+      float *hImag = partitionImag + i*numBins;
+      int b = 0;
+      #if __SSE__
+      for (; b <= numBins-4; b += 4) {
+        __m128 xr = _mm_loadu_ps(xReal+b); __m128 xi = _mm_loadu_ps(xImag+b);
+        __m128 hr = _mm_loadu_ps(hReal+b); __m128 hi = _mm_loadu_ps(hImag+b);
+        _mm_storeu_ps(fftReal+b, _mm_add_ps(_mm_loadu_ps(fftReal+b),
+            _mm_sub_ps(_mm_mul_ps(xr, hr), _mm_mul_ps(xi, hi))));
+        _mm_storeu_ps(fftImag+b, _mm_add_ps(_mm_loadu_ps(fftImag+b),
+            _mm_add_ps(_mm_mul_ps(xr, hi), _mm_mul_ps(xi, hr))));
+      }
+      #endif
+      for (; b < numBins; b++) {
+        fftReal[b] += xReal[b] * hReal[b] - xImag[b] * hImag[b];
+        fftImag[b] += xReal[b] * hImag[b] + xImag[b] * hReal[b];
+      }
+    }
+    
+    realFft->inverse(fftReal, fftImag, fftOutput, fftBuffer);
+    memcpy(tailOutput, fftOutput + partitionSize, partitionSize * sizeof(float));
+  }
+  
+  // the current partition of input becomes the previous one
+  memcpy(inputFrame, inputFrame + partitionSize, partitionSize * sizeof(float));
+}
+
+void DspConvolve::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
+  DspConvolve *d = reinterpret_cast<DspConvolve *>(dspObject);
+  if (d->numPartitions == 0) {
+    d->fillConstantAtOutlet(0.0f, 0, fromIndex, toIndex); // there is no impulse response
+    return;
+  }
+  d->clearConstantAtOutlet(0);
+  
+  float *input = d->dspBufferAtInlet[0];
+  float *output = d->dspBufferAtOutlet[0];
+  int partitionSize = d->partitionSize;
+  while (fromIndex < toIndex) {
+    // process up to the end of the current partition
+    int n = partitionSize - d->framePosition;
+    if (n > toIndex - fromIndex) n = toIndex - fromIndex;
+    float *frame = d->inputFrame + partitionSize + d->framePosition;
+    memcpy(frame, input + fromIndex, n * sizeof(float));
+    
+    // the first partition of the impulse response is convolved directly
+    float *out = output + fromIndex;
+    memcpy(out, d->tailOutput + d->framePosition, n * sizeof(float));
+    for (int m = 0; m < partitionSize; m++) {
+      float h = d->directResponse[m];
+      float *x = frame - m;
+      int i = 0;
+      #if __SSE__
+      const __m128 hVec = _mm_set1_ps(h);
+      for (; i <= n-4; i += 4) {
+        _mm_storeu_ps(out+i, _mm_add_ps(_mm_loadu_ps(out+i), _mm_mul_ps(hVec, _mm_loadu_ps(x+i))));
+      }
+      #endif
+      for (; i < n; i++) {
+        out[i] += h * x[i];
+      }
+    }
+    
+    d->framePosition += n;
+    fromIndex += n;
+    if (d->framePosition == partitionSize) {
+      d->processPartition();
+      d->framePosition = 0;
+    }
+  }
+}
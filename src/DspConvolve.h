@@ -0,0 +1,114 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _DSP_CONVOLVE_H_
+#define _DSP_CONVOLVE_H_
+
+#include "DspObject.h"
+#include "TableReceiverInterface.h"
+
+class RealFft;
+
+/**
+ * [convolve~ name]
+ * Convolves the input with the impulse response stored in the named table, without latency. The
+ * impulse response is split into partitions of (at least) the block size. The first partition is
+ * convolved directly, all others in the frequency domain, where the spectra of past inputs are
+ * kept in a delay line and multiplied with the spectra of the partitions once per partition.
+ * The impulse response is read when the table is set, either on creation or with the
+ * <code>set</code> message. Sending <code>set</code> again re-reads a table which has been changed.
+ * The <code>clear</code> message discards the input heard so far.
+ */
+class DspConvolve : public DspObject, public TableReceiverInterface {
+  
+  public:
+    static MessageObject *newObject(PdMessage *initMessage, PdGraph *graph);
+    DspConvolve(PdMessage *initMessage, PdGraph *graph);
+    ~DspConvolve();
+    
+    static const char *getObjectLabel() { return "convolve~"; }
+    ObjectType getObjectType() { return DSP_CONVOLVE; }
+  
+    char *getName();
+    void setTable(MessageTable *table);
+  
+  private:
+    static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
+  
+    void processMessage(int inletIndex, PdMessage *message);
+  
+    /** Computes the direct part of the convolution and the spectra of the partitions from the table. */
+    void loadImpulseResponse();
+  
+    /**
+     * Called once a partition of input has been received. Its spectrum is added to the delay line
+     * and the contribution of all but the first partition to the next partition of output computed.
+     */
+    void processPartition();
+  
+    /** Discards all input received so far. */
+    void clear();
+  
+    char *name;
+    MessageTable *table;
+  
+    /** The fft plan of twice the partition size, shared with the context. */
+    RealFft *realFft;
+  
+    /** The length of each partition, the smallest power of two not less than the block size. */
+    int partitionSize;
+  
+    /** The number of partitions of the impulse response, including the first one. */
+    int numPartitions;
+  
+    /** The first partition of the impulse response. */
+    float *directResponse;
+  
+    /**
+     * The spectra of all other partitions, each of <code>partitionSize+1</code> bins. They are
+     * scaled by the normalisation of the inverse fft.
+     */
+    float *partitionReal;
+    float *partitionImag;
+  
+    /** The spectra of past partitions of input, <code>numPartitions-1</code> of them. */
+    float *inputSpectraReal;
+    float *inputSpectraImag;
+  
+    /** The index of the spectrum of the latest partition of input in the delay line. */
+    int inputSpectraIndex;
+  
+    /** The previous and the current partition of input, the latter filled up to <code>framePosition</code>. */
+    float *inputFrame;
+    int framePosition;
+  
+    /** The contribution of all but the first partition to the output of the current partition. */
+    float *tailOutput;
+  
+    /** Working memory of the ffts, each of twice the partition size. */
+    float *fftReal;
+    float *fftImag;
+    float *fftBuffer;
+    float *fftOutput;
+};
+
+#endif // _DSP_CONVOLVE_H_
@@ -22,39 +22,22 @@
 
 #include "ArrayArithmetic.h"
 #include "DspCosine.h"
+#include "LookupTable.h"
 #include "PdGraph.h"
 
-// initialise the static class variables
-float *DspCosine::cos_table = NULL;
-int DspCosine::refCount = 0;
-
 MessageObject *DspCosine::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspCosine(initMessage, graph);
 }
 
 DspCosine::DspCosine(PdMessage *initMessage, PdGraph *graph) : DspObject(0, 1, 0, 1, graph) {
-  this->sampleRate = graph->getSampleRate();
   processFunction = &procesSignal;
-  #if !__APPLE__ // only create the lookup table if it is really needed
-  refCount++;
-  if (cos_table == NULL) {
-    int sampleRateInt = (int) sampleRate;
-    cos_table = (float *) malloc((sampleRateInt + 1) * sizeof(float));
-    for (int i = 0; i < sampleRateInt; i++) {
-      cos_table[i] = cosf(2.0f * M_PI * ((float) i) / sampleRate);
-    }
-    cos_table[sampleRateInt] = cos_table[0];
-  }
+  #if !__APPLE__ // only fetch the lookup table if it is really needed
+  cosTable = LookupTable::getCosineTable();
   #endif
 }
 
 DspCosine::~DspCosine() {
-  #if !__APPLE__
-  if (--refCount == 0) {
-    free(cos_table);
-    cos_table = NULL;
-  }
-  #endif
+  // nothing to do
 }
 
 void DspCosine::procesSignal(DspObject *dspObject, int fromIndex, int toIndex) {
@@ -67,11 +50,13 @@ void DspCosine::procesSignal(DspObject *dspObject, int fromIndex, int toIndex) {
   vDSP_vsmul(d->dspBufferAtInlet[0], 1, &twoPi, d->dspBufferAtOutlet[0], 1, toIndex);
   vvcosf(d->dspBufferAtOutlet[0], d->dspBufferAtOutlet[0], &toIndex);
   #else
+  const float *cosTable = d->cosTable;
   for (int i = fromIndex; i < toIndex; ++i) {
-    // works because cosine is symmetric about zero
+    // works because cosine is symmetric about zero. The guard entry of the table covers fractions
+    // which round up to one.
     float f = fabsf(d->dspBufferAtInlet[0][i]);
     f -= floorf(f);
-    d->dspBufferAtOutlet[0][i] = cos_table[(int) (f * d->sampleRate)];
+    d->dspBufferAtOutlet[0][i] = cosTable[(int) (f * (float) (1 << COSINE_TABLE_BITS))];
   }
   #endif
 }
@@ -39,9 +39,7 @@ class DspCosine : public DspObject {
   private:
     static void procesSignal(DspObject *dspObject, int fromIndex, int toIndex);
   
-    float sampleRate;
-    static float *cos_table; // the Cosine lookup table
-    static int refCount; // a reference counter for Cosine table. Now we know when to free it.
+    const float *cosTable; // the shared cosine table
 };
 
 #endif // _DSP_COSINE_H_
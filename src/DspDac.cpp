@@ -29,19 +29,13 @@ MessageObject *DspDac::newObject(PdMessage *initMessage, PdGraph *graph) {
 }
 
 DspDac::DspDac(PdGraph *graph) : DspObject(0, graph->getNumOutputChannels(), 0, 0, graph) {
-  // cache pointers to global output buffers in dspBufferAtOutlet
-  int numInlets = graph->getNumOutputChannels();
-  if (numInlets > 2) dspBufferAtOutlet[2] = (float *) calloc(numInlets-2, sizeof(float *));
-  
-  for (int i = 0; i < numInlets; i++) {
-    setDspBufferAtOutlet(graph->getGlobalDspBufferAtOutlet(i), i);
-  }
-  
+  // the output buffers are not cached. They are resolved in every block because the
+  // context may redirect the output of a graph to a private buffer when processing graphs in parallel.
   processFunction = &processSignal;
 }
 
 DspDac::~DspDac() {
-  free(dspBufferAtOutlet[2]);
+  // nothing to do
 }
 
 void DspDac::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
@@ -57,13 +51,18 @@ void DspDac::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
       // allow fallthrough
     }
     case 2: {
-      ArrayArithmetic::add(d->dspBufferAtOutlet[1], d->dspBufferAtInlet[1],
-          d->dspBufferAtOutlet[1], 0, toIndex);
+      // silent inputs add nothing
+      if (!d->isSilentAtInlet(1)) {
+        float *globalOutputBuffer = d->graph->getGlobalDspBufferAtOutlet(1);
+        ArrayArithmetic::add(globalOutputBuffer, d->dspBufferAtInlet[1], globalOutputBuffer, 0, toIndex);
+      }
       // allow fallthrough
     }
     case 1: {
-      ArrayArithmetic::add(d->dspBufferAtOutlet[0], d->dspBufferAtInlet[0],
-          d->dspBufferAtOutlet[0], 0, toIndex);
+      if (!d->isSilentAtInlet(0)) {
+        float *globalOutputBuffer = d->graph->getGlobalDspBufferAtOutlet(0);
+        ArrayArithmetic::add(globalOutputBuffer, d->dspBufferAtInlet[0], globalOutputBuffer, 0, toIndex);
+      }
       // allow fallthrough
     }
     case 0: break;
@@ -34,6 +34,7 @@ class DspDac : public DspObject {
   
     static const char *getObjectLabel() { return "dac~"; }
     string toString() { return string(DspDac::getObjectLabel()); }
+    ObjectType getObjectType() { return DSP_DAC; }
   
   private:
     static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
@@ -30,18 +30,18 @@ MessageObject *DspDelayWrite::newObject(PdMessage *initMessage, PdGraph *graph)
 
 DspDelayWrite::DspDelayWrite(PdMessage *initMessage, PdGraph *graph) : DspObject(0, 1, 0, 0, graph) {
   if (initMessage->isSymbol(0) && initMessage->isFloat(1)) {
-    bufferLength = (int) ceilf(StaticUtils::millisecondsToSamples(initMessage->getFloat(1), 
-        graph->getSampleRate())); 
-    if (bufferLength % blockSizeInt != 0) {
-      bufferLength = ((bufferLength/blockSizeInt)+2) * blockSizeInt;
-    } else {
-      bufferLength += blockSizeInt;
-    }
+    // the buffer holds the delay and one block more, as readers read after the block has been
+    // written. Its length is a power of two, such that indices are wrapped with a mask.
+    int minBufferLength = (int) ceilf(StaticUtils::millisecondsToSamples(initMessage->getFloat(1),
+        graph->getSampleRate())) + blockSizeInt;
+    bufferLength = 1;
+    while (bufferLength < minBufferLength) bufferLength <<= 1;
     headIndex = 0;
-    // buffer[bufferLength] == buffer[0], which makes calculation in vd~ easier
+    // buffer[bufferLength] == buffer[0], which allows vd~ to interpolate without wrapping on Apple
     int numBufferLengthBytes = (bufferLength+1)*sizeof(float);
     dspBufferAtOutlet[0] = ALLOC_ALIGNED_BUFFER(numBufferLengthBytes);
     memset(dspBufferAtOutlet[0], 0, numBufferLengthBytes); // zero the delay buffer
+    plannedDspBufferAtOutlet[0] = dspBufferAtOutlet[0];
     name = StaticUtils::copyString(initMessage->getSymbol(0));
   } else {
     graph->printErr("ERROR: delwrite~ must be initialised as [delwrite~ name delay].");
@@ -60,10 +60,14 @@ DspDelayWrite::~DspDelayWrite() {
 
 void DspDelayWrite::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
   DspDelayWrite *d = reinterpret_cast<DspDelayWrite *>(dspObject);
+  if (d->bufferLength == 0) return;
   
-  // copy inlet buffer to delay buffer
-  memcpy(d->dspBufferAtOutlet[0] + d->headIndex, d->dspBufferAtInlet[0], toIndex*sizeof(float));
-  if (d->headIndex == 0) d->dspBufferAtOutlet[0][d->bufferLength] = d->dspBufferAtOutlet[0][0];
-  d->headIndex += toIndex;
-  if (d->headIndex >= d->bufferLength) d->headIndex = 0;
+  // copy inlet buffer to delay buffer. The block only wraps around the end of the buffer if the
+  // block size is not a power of two.
+  float *buffer = d->dspBufferAtOutlet[0];
+  int n = min(toIndex, d->bufferLength - d->headIndex);
+  memcpy(buffer + d->headIndex, d->dspBufferAtInlet[0], n*sizeof(float));
+  memcpy(buffer, d->dspBufferAtInlet[0] + n, (toIndex-n)*sizeof(float));
+  buffer[d->bufferLength] = buffer[0];
+  d->headIndex = (d->headIndex + toIndex) & (d->bufferLength - 1);
 }
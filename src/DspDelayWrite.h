@@ -38,6 +38,11 @@ class DspDelayWrite : public DspObject {
   
     const char *getName() { return name; }
   
+    /**
+     * Returns the delay buffer, the index at which the next block will be written and the length of
+     * the buffer. The length is a power of two. The buffer holds one more sample than its length,
+     * a copy of the first.
+     */
     inline float *getBuffer(int *index, int *length) {
       *index = headIndex;
       *length = bufferLength;
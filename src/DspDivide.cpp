@@ -65,11 +65,21 @@ void DspDivide::processMessage(int inletIndex, PdMessage *message) {
 
 void DspDivide::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
   DspDivide *d = reinterpret_cast<DspDivide *>(dspObject);
-  ArrayArithmetic::divide(d->dspBufferAtInlet[0], d->dspBufferAtInlet[1],
-      d->dspBufferAtOutlet[0], 0, toIndex);
+  if (d->isConstantAtInlet(0) && d->isConstantAtInlet(1)) {
+    d->fillConstantAtOutlet(d->getConstantAtInlet(0) / d->getConstantAtInlet(1), 0, fromIndex, toIndex);
+  } else {
+    ArrayArithmetic::divide(d->dspBufferAtInlet[0], d->dspBufferAtInlet[1],
+        d->dspBufferAtOutlet[0], 0, toIndex);
+    d->clearConstantAtOutlet(0);
+  }
 }
 
 void DspDivide::processScalar(DspObject *dspObject, int fromIndex, int toIndex) {
   DspDivide *d = reinterpret_cast<DspDivide *>(dspObject);
-  ArrayArithmetic::divide(d->dspBufferAtInlet[0], d->constant, d->dspBufferAtOutlet[0], fromIndex, toIndex);
+  if (d->isConstantAtInlet(0)) {
+    d->fillConstantAtOutlet(d->getConstantAtInlet(0) / d->constant, 0, fromIndex, toIndex);
+  } else {
+    ArrayArithmetic::divide(d->dspBufferAtInlet[0], d->constant, d->dspBufferAtOutlet[0], fromIndex, toIndex);
+    d->clearConstantAtOutlet(0);
+  }
 }
@@ -34,6 +34,7 @@ class DspDivide : public DspObject {
 
     static const char *getObjectLabel() { return "/~"; }
     string toString();
+    bool canProcessInPlace() { return true; }
 
   private:
     static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
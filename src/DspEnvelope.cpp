@@ -22,8 +22,13 @@
 
 #include "ArrayArithmetic.h"
 #include "DspEnvelope.h"
+#include "LookupTable.h"
 #include "PdGraph.h"
 
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
 /** By default, the analysis window size is 1024 samples. */
 #define DEFAULT_WINDOW_SIZE 1024
 
@@ -35,8 +40,8 @@ DspEnvelope::DspEnvelope(PdMessage *initMessage, PdGraph *graph) : DspObject(0,
   if (initMessage->isFloat(0)) {
     if (initMessage->isFloat(1)) {
       // if two parameters are provided, set the window size and window interval
-      windowSize = initMessage->getFloat(0);
-      windowInterval = initMessage->getFloat(1);
+      windowSize = (int) initMessage->getFloat(0);
+      setWindowInterval((int) initMessage->getFloat(1));
     } else {
       // if one parameter is provided, set the window size
       windowSize = (int) initMessage->getFloat(0);
@@ -70,8 +75,7 @@ DspEnvelope::DspEnvelope(PdMessage *initMessage, PdGraph *graph) : DspObject(0,
 }
 
 DspEnvelope::~DspEnvelope() {
-  free(signalBuffer);
-  free(hanningCoefficients);
+  free(windowSums);
 }
 
 string DspEnvelope::toString() {
@@ -85,61 +89,80 @@ void DspEnvelope::setWindowInterval(int newInterval) {
   if (i == 0) {
     // windowInterval is a multiple of blockSize. Awesome :)
     this->windowInterval = newInterval;
-  } else if (i <= graph->getBlockSize()/2) {
-    // windowInterval is closer to the smaller multiple of blockSize
-    this->windowInterval = (newInterval/graph->getBlockSize())*graph->getBlockSize();
   } else {
-    // windowInterval is closer to the larger multiple of blockSize
-    this->windowInterval = ((newInterval/graph->getBlockSize())+1)*graph->getBlockSize();
+    // otherwise it is rounded up to the next multiple of blockSize, as in Pd
+    this->windowInterval = newInterval + graph->getBlockSize() - i;
   }
 }
 
 void DspEnvelope::initBuffers() {
-  // ensure that the buffer is big enough to take the number of whole blocks needed to fill it
-  numSamplesReceived = 0;
-  numSamplesReceivedSinceLastInterval = 0;
-  int numBlocksPerWindow = (windowSize % graph->getBlockSize() == 0) ? (windowSize/graph->getBlockSize()) : (windowSize/graph->getBlockSize()) + 1;
-  int bufferSize = numBlocksPerWindow * graph->getBlockSize();
-  signalBuffer = (float *) malloc(bufferSize * sizeof(float));
-  hanningCoefficients = (float *) malloc(bufferSize * sizeof(float));
-  float N_1 = (float) (windowSize - 1); // (N == windowSize) - 1
-  float hanningSum = 0.0f;
-  for (int i = 0; i < windowSize; i++) {
-    // calcualte the hanning window coefficients
-    hanningCoefficients[i] = 0.5f * (1.0f - cosf((2.0f * M_PI * (float) i) / N_1));
-    hanningSum += hanningCoefficients[i];
+  // as in Pd, the first window ends with the first block, and one more ends every interval
+  numWindows = (windowSize + windowInterval - 1) / windowInterval;
+  windowSums = (float *) calloc(numWindows, sizeof(float));
+  windowSumsHead = 0;
+  numSamplesUntilWindowEnd = graph->getBlockSize();
+  // the window is normalised such that it represents a weighted averaging
+  hanningCoefficients = LookupTable::getHannWindow(windowSize);
+}
+
+/**
+ * Returns the sum of <code>x[i]*x[i]*w[i]</code> over the <code>n</code> samples. The sum is
+ * accumulated in four interleaved partial sums with or without SSE2, such that both give the same
+ * result.
+ */
+static float sumWeightedSquares(const float *x, const float *w, int n) {
+  int i = 0;
+  #if __SSE2__
+  __m128 sum = _mm_setzero_ps();
+  for (; i <= n - 4; i += 4) {
+    __m128 v = _mm_loadu_ps(x+i);
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_mul_ps(v, v), _mm_loadu_ps(w+i)));
   }
-  for (int i = 0; i < windowSize; i++) {
-    // normalise the hanning coefficients such that they represent a normalised weighted averaging
-    hanningCoefficients[i] /= hanningSum;
+  float sums[4];
+  _mm_storeu_ps(sums, sum);
+  #else
+  float sums[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  for (; i <= n - 4; i += 4) {
+    sums[0] += (x[i] * x[i]) * w[i];
+    sums[1] += (x[i+1] * x[i+1]) * w[i+1];
+    sums[2] += (x[i+2] * x[i+2]) * w[i+2];
+    sums[3] += (x[i+3] * x[i+3]) * w[i+3];
   }
+  #endif
+  for (; i < n; i++) {
+    sums[0] += (x[i] * x[i]) * w[i];
+  }
+  return (sums[0] + sums[1]) + (sums[2] + sums[3]);
 }
 
-// windowSize and windowInterval are constrained to be multiples of the block size
+// windowSize and windowInterval are constrained to be at least the block size. Instead of storing
+// the signal and weighting a whole window at the end of each interval, every block is added to all
+// windows which it overlaps, each with the part of the hanning window that applies to the block.
 void DspEnvelope::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
   DspEnvelope *d = reinterpret_cast<DspEnvelope *>(dspObject);
+  int n = toIndex - fromIndex;
   
-  // copy the input into the signal buffer
-  memcpy(d->signalBuffer + d->numSamplesReceived, d->dspBufferAtInlet[0], toIndex*sizeof(float));
-  d->numSamplesReceived += toIndex;
-  d->numSamplesReceivedSinceLastInterval += toIndex;
-  if (d->numSamplesReceived >= d->windowSize) {
-    d->numSamplesReceived = 0;
-  }
-  if (d->numSamplesReceivedSinceLastInterval == d->windowInterval) {
-    d->numSamplesReceivedSinceLastInterval -= d->windowInterval;
-    // apply hanning window to signal and calculate Root Mean Square
-    float rms = 0.0f;
-    #if __APPLE__
-    float rmsBuffer[d->windowSize];
-    vDSP_vsq(d->signalBuffer, 1, rmsBuffer, 1, d->windowSize); // signalBuffer^2 
-    vDSP_vmul(rmsBuffer, 1, d->hanningCoefficients, 1, rmsBuffer, 1, d->windowSize); // * hanning window
-    vDSP_sve(rmsBuffer, 1, &rms, d->windowSize); // sum the result
-    #else
-    for (int i = 0; i < d->windowSize; ++i) {
-      rms += d->signalBuffer[i] * d->signalBuffer[i] * d->hanningCoefficients[i];
+  // silent blocks add nothing to the windows
+  if (!d->isSilentAtInlet(0)) {
+    float *input = d->dspBufferAtInlet[0] + fromIndex;
+    for (int j = 0; j < d->numWindows; j++) {
+      // the index of the start of the window, relative to the start of this block
+      int windowStart = d->numSamplesUntilWindowEnd + j*d->windowInterval - d->windowSize;
+      if (windowStart >= n) break; // this and all later windows start after this block
+      int i = (windowStart > 0) ? windowStart : 0;
+      d->windowSums[(d->windowSumsHead + j) % d->numWindows] +=
+          sumWeightedSquares(input + i, d->hanningCoefficients + i - windowStart, n - i);
     }
-    #endif
+  }
+  
+  d->numSamplesUntilWindowEnd -= n;
+  if (d->numSamplesUntilWindowEnd <= 0) {
+    // the first window has ended. Its slot in the ring is reused for the window which starts now.
+    float rms = d->windowSums[d->windowSumsHead];
+    d->windowSums[d->windowSumsHead] = 0.0f;
+    d->windowSumsHead = (d->windowSumsHead + 1) % d->numWindows;
+    d->numSamplesUntilWindowEnd += d->windowInterval;
+    
     // finish RMS calculation. sqrt is removed as it can be combined with the log operation.
     // result is normalised such that 1 RMS == 100 dB
     rms = 10.0f * log10f(rms) + 100.0f;
@@ -34,8 +34,8 @@ class DspEnvelope : public DspObject {
     /*
      * @param windowSize  The window size in samples of the analysis. Defaults to 1024.
      * @param windowInterval  The window interval in samples of the analysis.
-     * The interval must be a multiple of the block size. If not, then it is reset to
-     * the nearest multiple. Defaults to windowSize/2, according to the mentioned constraints.
+     * The interval must be a multiple of the block size. If not, then it is rounded up to
+     * the next multiple, as in Pd. Defaults to windowSize/2, according to the mentioned constraints.
      */
     DspEnvelope(PdMessage *initMessage, PdGraph *graph);
     ~DspEnvelope();
@@ -45,6 +45,8 @@ class DspEnvelope : public DspObject {
 
     ConnectionType getConnectionType(int outletIndex) { return MESSAGE; }
   
+    bool doesScheduleMessages() { return true; }
+  
   private:
     static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
   
@@ -55,11 +57,23 @@ class DspEnvelope : public DspObject {
     int windowSize;
     int windowInterval;
   
-    int numSamplesReceived;
-    int numSamplesReceivedSinceLastInterval;
+    /**
+     * The number of windows which overlap at any time. A new one starts every interval and one
+     * ends every interval.
+     */
+    int numWindows;
+  
+    /**
+     * The ring of weighted sums of squares of the windows which have not yet ended, starting with
+     * the one which ends first at <code>windowSums[windowSumsHead]</code>.
+     */
+    float *windowSums;
+    int windowSumsHead;
+  
+    /** The number of samples from the start of the next block until the end of the first window. */
+    int numSamplesUntilWindowEnd;
   
-    float *signalBuffer;
-    float *hanningCoefficients;
+    const float *hanningCoefficients; // the shared normalised hanning window of size windowSize
 };
 
 #endif // _DSP_ENVELOPE_H_
@@ -25,6 +25,10 @@
 
 class PdGraph;
 
+// The largest distance of the filter state from its steady state, relative to the size of the
+// latter, at which the filter output is considered to have settled for a constant input.
+#define STEADY_STATE_THRESHOLD 1e-6f
+
 DspFilter::DspFilter(int numMessageInlets, PdGraph *graph) : DspObject(numMessageInlets, 1, 0, 1, graph) {
   x1 = x2 = y1 = y2 = 0.0f;
 
@@ -40,9 +44,34 @@ void DspFilter::onInletConnectionUpdate(unsigned int inletIndex) {
   // TODO(mhroth)
 }
 
+bool DspFilter::isInSteadyState(float x, float *y) {
+  // the steady state output is the input scaled by the dc gain of the filter
+  if (x1 != x || x2 != x) return false;
+  float denominator = 1.0f + b[3] + b[4];
+  if (x == 0.0f) {
+    *y = 0.0f;
+  } else if (denominator != 0.0f) {
+    *y = x * (b[0] + b[1] + b[2]) / denominator;
+  } else {
+    return false; // there is no steady state
+  }
+  float threshold = STEADY_STATE_THRESHOLD * (1.0f + fabsf(*y));
+  return (fabsf(y1 - *y) <= threshold && fabsf(y2 - *y) <= threshold);
+}
+
 void DspFilter::processFilter(DspObject *dspObject, int fromIndex, int toIndex) {
   DspFilter *d = reinterpret_cast<DspFilter *>(dspObject);
   
+  // once the output has settled for a constant input, it is constant as well
+  float y = 0.0f;
+  if (d->isConstantAtInlet(0) && d->isInSteadyState(d->getConstantAtInlet(0), &y)) {
+    d->y1 = d->y2 = y;
+    d->fillConstantAtOutlet(y, 0, fromIndex, toIndex);
+    return;
+  }
+  d->clearConstantAtOutlet(0);
+  
+  #if __APPLE__
   int n = toIndex - fromIndex; // number of samples to process
   float bufferIn[n+2]; // new inlet buffer
   bufferIn[0] = d->x2; bufferIn[1] = d->x1;
@@ -51,19 +80,30 @@ void DspFilter::processFilter(DspObject *dspObject, int fromIndex, int toIndex)
   float bufferOut[n+2]; // new outlet buffer
   bufferOut[0] = d->y2; bufferOut[1] = d->y1;
   
-  #if __APPLE__
   vDSP_deq22(bufferIn, 1, d->b, bufferOut, 1, n);
-  #else
-  int _toIndex = n + 2;
-  for (int i = 2; i < _toIndex; ++i) {
-    bufferOut[i] = d->b[0]*bufferIn[i] + d->b[1]*bufferIn[i-1] + d->b[2]*bufferIn[i-2] -
-        d->b[3]*bufferOut[i-1] - d->b[4]*bufferOut[i-2];
-  }
-  #endif
   
   memcpy(d->dspBufferAtOutlet[0]+fromIndex, bufferOut+2, n*sizeof(float));
   
   // retain state
   d->x2 = bufferIn[n]; d->x1 = bufferIn[n+1];
   d->y2 = bufferOut[n]; d->y1 = bufferOut[n+1];
+  #else
+  // the state is kept in registers, rather than copying the block around it
+  // (see DspFilterBank for processing many filters at once)
+  float *input = d->dspBufferAtInlet[0];
+  float *output = d->dspBufferAtOutlet[0];
+  float b0 = d->b[0], b1 = d->b[1], b2 = d->b[2], b3 = d->b[3], b4 = d->b[4];
+  float x1 = d->x1, x2 = d->x2, y1 = d->y1, y2 = d->y2;
+  for (int i = fromIndex; i < toIndex; ++i) {
+    float x = input[i];
+    float y = b0*x + b1*x1 + b2*x2 - b3*y1 - b4*y2;
+    output[i] = y;
+    x2 = x1; x1 = x;
+    y2 = y1; y1 = y;
+  }
+  
+  // retain state
+  d->x1 = x1; d->x2 = x2;
+  d->y1 = y1; d->y2 = y2;
+  #endif
 }
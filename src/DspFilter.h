@@ -28,6 +28,9 @@
 /** The superclass of lop~, hip~, bp~, and biquad~ */
 class DspFilter : public DspObject {
   
+  // processes the filters of a plan level together, in vector lanes
+  friend class DspFilterBank;
+  
   public:
     DspFilter(int numMessageInlets, PdGraph *graph);
     ~DspFilter();
@@ -36,6 +39,12 @@ class DspFilter : public DspObject {
   
   protected:  
     static void processFilter(DspObject *dspObject, int fromIndex, int toIndex);
+  
+    /**
+     * Returns true if the filter state has settled for the given constant input. The steady state
+     * output is then returned in <code>y</code>.
+     */
+    bool isInSteadyState(float x, float *y);
     
     float x1, x2, y1, y2;
     float b[5]; // filter coefficients
@@ -0,0 +1,268 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include "ArrayArithmetic.h"
+#include "DspFilter.h"
+#include "DspFilterBank.h"
+
+#if ARRAY_ARITHMETIC_DISPATCH
+#include <immintrin.h>
+#endif
+
+// the widest vector of lanes (AVX-512)
+#define MAX_FILTER_LANES 16
+
+/*
+ * A kernel runs one biquad per lane, four samples at a time. The samples of four lanes are loaded
+ * from the buffers of their filters as a 4x4 block, which is transposed such that each vector
+ * holds one sample of every lane, and the output is transposed back in the same way. The terms
+ * are summed in the same order as in DspFilter::processFilter(), and multiplications and
+ * additions must not be fused, such that every lane produces exactly the output of the scalar loop.
+ */
+#if ARRAY_ARITHMETIC_DISPATCH
+
+// transposes the 4x4 blocks in each 128-bit lane of the given rows, as _MM_TRANSPOSE4_PS() does for SSE
+#define TRANSPOSE_4X4(_vector, _unpacklo, _unpackhi, _unpacklo_pd, _unpackhi_pd, _castps, _castpd, r0, r1, r2, r3) { \
+  _vector t0 = _unpacklo(r0, r1); \
+  _vector t1 = _unpacklo(r2, r3); \
+  _vector t2 = _unpackhi(r0, r1); \
+  _vector t3 = _unpackhi(r2, r3); \
+  r0 = _castpd(_unpacklo_pd(_castps(t0), _castps(t1))); \
+  r1 = _castpd(_unpackhi_pd(_castps(t0), _castps(t1))); \
+  r2 = _castpd(_unpacklo_pd(_castps(t2), _castps(t3))); \
+  r3 = _castpd(_unpackhi_pd(_castps(t2), _castps(t3))); \
+}
+
+// replaces the next sample r of all lanes with its output and advances the state
+#define FILTER_STEP(_vector, _add, _sub, _mul, r) { \
+  _vector x = r; \
+  r = _sub(_sub(_add(_add(_mul(b0, x), _mul(b1, x1)), _mul(b2, x2)), _mul(b3, y1)), _mul(b4, y2)); \
+  x2 = x1; x1 = x; \
+  y2 = y1; y1 = r; \
+}
+
+/*
+ * Defines a kernel of the given width. _loadRow(k) loads the four samples at index i of lanes k,
+ * k+4, k+8 and k+12 (as far as they exist) into one row, and _storeRow(k, r) stores them back.
+ */
+#define DEFINE_FILTER_KERNEL(_name, _target, _width, _vector, _loadu, _storeu, _add, _sub, _mul, \
+    _transpose, _loadRow, _storeRow) \
+  __attribute__((target(_target))) \
+  static void _name(float **inputs, float **outputs, int numSamples, float *coefficients, float *state) { \
+    _vector b0 = _loadu(coefficients); \
+    _vector b1 = _loadu(coefficients + _width); \
+    _vector b2 = _loadu(coefficients + 2*_width); \
+    _vector b3 = _loadu(coefficients + 3*_width); \
+    _vector b4 = _loadu(coefficients + 4*_width); \
+    _vector x1 = _loadu(state); \
+    _vector x2 = _loadu(state + _width); \
+    _vector y1 = _loadu(state + 2*_width); \
+    _vector y2 = _loadu(state + 3*_width); \
+    for (int i = 0; i < numSamples; i += 4) { \
+      _vector r0 = _loadRow(0); \
+      _vector r1 = _loadRow(1); \
+      _vector r2 = _loadRow(2); \
+      _vector r3 = _loadRow(3); \
+      _transpose(r0, r1, r2, r3); \
+      FILTER_STEP(_vector, _add, _sub, _mul, r0); \
+      FILTER_STEP(_vector, _add, _sub, _mul, r1); \
+      FILTER_STEP(_vector, _add, _sub, _mul, r2); \
+      FILTER_STEP(_vector, _add, _sub, _mul, r3); \
+      _transpose(r0, r1, r2, r3); \
+      _storeRow(0, r0); \
+      _storeRow(1, r1); \
+      _storeRow(2, r2); \
+      _storeRow(3, r3); \
+    } \
+    _storeu(state, x1); \
+    _storeu(state + _width, x2); \
+    _storeu(state + 2*_width, y1); \
+    _storeu(state + 3*_width, y2); \
+  }
+
+#define TRANSPOSE_SSE(r0, r1, r2, r3) _MM_TRANSPOSE4_PS(r0, r1, r2, r3)
+#define LOAD_ROW_SSE(k) _mm_loadu_ps(inputs[k]+i)
+#define STORE_ROW_SSE(k, r) _mm_storeu_ps(outputs[k]+i, r)
+
+#define TRANSPOSE_AVX2(r0, r1, r2, r3) TRANSPOSE_4X4(__m256, _mm256_unpacklo_ps, _mm256_unpackhi_ps, \
+    _mm256_unpacklo_pd, _mm256_unpackhi_pd, _mm256_castps_pd, _mm256_castpd_ps, r0, r1, r2, r3)
+#define LOAD_ROW_AVX2(k) _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(inputs[k]+i)), \
+    _mm_loadu_ps(inputs[k+4]+i), 1)
+#define STORE_ROW_AVX2(k, r) { \
+  _mm_storeu_ps(outputs[k]+i, _mm256_castps256_ps128(r)); \
+  _mm_storeu_ps(outputs[k+4]+i, _mm256_extractf128_ps(r, 1)); \
+}
+
+#define TRANSPOSE_AVX512(r0, r1, r2, r3) TRANSPOSE_4X4(__m512, _mm512_unpacklo_ps, _mm512_unpackhi_ps, \
+    _mm512_unpacklo_pd, _mm512_unpackhi_pd, _mm512_castps_pd, _mm512_castpd_ps, r0, r1, r2, r3)
+#define LOAD_ROW_AVX512(k) _mm512_insertf32x4(_mm512_insertf32x4(_mm512_insertf32x4( \
+    _mm512_castps128_ps512(_mm_loadu_ps(inputs[k]+i)), _mm_loadu_ps(inputs[k+4]+i), 1), \
+    _mm_loadu_ps(inputs[k+8]+i), 2), _mm_loadu_ps(inputs[k+12]+i), 3)
+#define STORE_ROW_AVX512(k, r) { \
+  _mm_storeu_ps(outputs[k]+i, _mm512_castps512_ps128(r)); \
+  _mm_storeu_ps(outputs[k+4]+i, _mm512_extractf32x4_ps(r, 1)); \
+  _mm_storeu_ps(outputs[k+8]+i, _mm512_extractf32x4_ps(r, 2)); \
+  _mm_storeu_ps(outputs[k+12]+i, _mm512_extractf32x4_ps(r, 3)); \
+}
+
+// AVX-512 implies FMA, which the compiler would otherwise use to contract the terms. Some versions
+// of GCC falsely warn about the undefined vectors used by their own AVX-512 intrinsics.
+#if !__clang__
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+DEFINE_FILTER_KERNEL(processLanesSse, "sse", 4, __m128, _mm_loadu_ps, _mm_storeu_ps,
+    _mm_add_ps, _mm_sub_ps, _mm_mul_ps, TRANSPOSE_SSE, LOAD_ROW_SSE, STORE_ROW_SSE)
+DEFINE_FILTER_KERNEL(processLanesAvx2, "avx2", 8, __m256, _mm256_loadu_ps, _mm256_storeu_ps,
+    _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, TRANSPOSE_AVX2, LOAD_ROW_AVX2, STORE_ROW_AVX2)
+DEFINE_FILTER_KERNEL(processLanesAvx512, "avx512f", 16, __m512, _mm512_loadu_ps, _mm512_storeu_ps,
+    _mm512_add_ps, _mm512_sub_ps, _mm512_mul_ps, TRANSPOSE_AVX512, LOAD_ROW_AVX512, STORE_ROW_AVX512)
+#if !__clang__
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#endif // ARRAY_ARITHMETIC_DISPATCH
+
+DspFilterBank::DspFilterBank(int blockSize) {
+  this->blockSize = blockSize;
+  zeroBuffer = ALLOC_ALIGNED_BUFFER(blockSize * sizeof(float));
+  memset(zeroBuffer, 0, blockSize * sizeof(float));
+  unusedBuffer = ALLOC_ALIGNED_BUFFER(blockSize * sizeof(float));
+  laneCoefficients = ALLOC_ALIGNED_BUFFER(5 * MAX_FILTER_LANES * sizeof(float));
+  laneState = ALLOC_ALIGNED_BUFFER(4 * MAX_FILTER_LANES * sizeof(float));
+}
+
+DspFilterBank::~DspFilterBank() {
+  FREE_ALIGNED_BUFFER(zeroBuffer);
+  FREE_ALIGNED_BUFFER(unusedBuffer);
+  FREE_ALIGNED_BUFFER(laneCoefficients);
+  FREE_ALIGNED_BUFFER(laneState);
+}
+
+bool DspFilterBank::isAvailable() {
+  #if ARRAY_ARITHMETIC_DISPATCH
+  return true;
+  #else
+  return false;
+  #endif
+}
+
+void DspFilterBank::addFilter(DspFilter *filter) {
+  filterList.push_back(filter);
+}
+
+int DspFilterBank::getNumFilters() {
+  return (int) filterList.size();
+}
+
+DspFilter *DspFilterBank::getFilter(int index) {
+  return filterList[index];
+}
+
+void DspFilterBank::process() {
+  // the kernels process blocks of four samples
+  int width = 1;
+  #if ARRAY_ARITHMETIC_DISPATCH
+  if ((blockSize & 0x3) == 0) {
+    switch (ArrayArithmetic::getKernelLevel()) {
+      case ARRAY_ARITHMETIC_SSE: width = 4; break;
+      case ARRAY_ARITHMETIC_AVX2: width = 8; break;
+      case ARRAY_ARITHMETIC_AVX512: width = 16; break;
+      default: break;
+    }
+  }
+  #endif
+  
+  // filters with pending messages or a constant input take their own (cheaper) path
+  laneList.clear();
+  for (int i = 0; i < filterList.size(); i++) {
+    DspFilter *filter = filterList[i];
+    if (width > 1 && filter->processFunction == &DspFilter::processFilter && !filter->isConstantAtInlet(0)) {
+      laneList.push_back(filter);
+    } else {
+      filter->processFunction(filter, 0, blockSize);
+    }
+  }
+  if (laneList.size() < 2) {
+    // a single filter gains nothing from lanes
+    for (int i = 0; i < laneList.size(); i++) {
+      DspFilter::processFilter(laneList[i], 0, blockSize);
+    }
+    return;
+  }
+  
+  // A group takes as long as its slowest (serial) recursion, whatever the width. A remainder which
+  // fits into a narrower vector is processed in that instead, as it moves less data.
+  int numLanes = laneList.size();
+  DspFilter **filters = &laneList[0];
+  while (numLanes > 0) {
+    while (width > 4 && numLanes <= width/2) width /= 2;
+    int n = min(numLanes, width);
+    processLanes(filters, n, width);
+    filters += n;
+    numLanes -= n;
+  }
+}
+
+void DspFilterBank::processLanes(DspFilter **filters, int numLanes, int width) {
+  // gather the coefficients, state and buffers of each filter
+  for (int j = 0; j < width; j++) {
+    if (j < numLanes) {
+      DspFilter *filter = filters[j];
+      for (int k = 0; k < 5; k++) laneCoefficients[k*width + j] = filter->b[k];
+      laneState[j] = filter->x1;
+      laneState[width + j] = filter->x2;
+      laneState[2*width + j] = filter->y1;
+      laneState[3*width + j] = filter->y2;
+      laneInputs[j] = filter->dspBufferAtInlet[0];
+      laneOutputs[j] = filter->dspBufferAtOutlet[0];
+    } else {
+      for (int k = 0; k < 5; k++) laneCoefficients[k*width + j] = 0.0f;
+      for (int k = 0; k < 4; k++) laneState[k*width + j] = 0.0f;
+      laneInputs[j] = zeroBuffer;
+      laneOutputs[j] = unusedBuffer;
+    }
+  }
+  
+  #if ARRAY_ARITHMETIC_DISPATCH
+  switch (width) {
+    case 4: processLanesSse(laneInputs, laneOutputs, blockSize, laneCoefficients, laneState); break;
+    case 8: processLanesAvx2(laneInputs, laneOutputs, blockSize, laneCoefficients, laneState); break;
+    case 16: processLanesAvx512(laneInputs, laneOutputs, blockSize, laneCoefficients, laneState); break;
+    default: break;
+  }
+  #endif
+  
+  // retain the state of each filter
+  for (int j = 0; j < numLanes; j++) {
+    DspFilter *filter = filters[j];
+    filter->x1 = laneState[j];
+    filter->x2 = laneState[width + j];
+    filter->y1 = laneState[2*width + j];
+    filter->y2 = laneState[3*width + j];
+    filter->clearConstantAtOutlet(0);
+  }
+}
@@ -0,0 +1,86 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _DSP_FILTER_BANK_H_
+#define _DSP_FILTER_BANK_H_
+
+#include <vector>
+using namespace std;
+
+class DspFilter;
+
+/**
+ * A <code>DspFilterBank</code> processes a group of mutually independent filters (<code>lop~</code>,
+ * <code>hip~</code> and <code>bp~</code>) together. The filters are gathered into the lanes of
+ * SSE, AVX2 or AVX-512 vectors, as selected by <code>ArrayArithmetic</code>, such that 4, 8 or 16
+ * of the otherwise strictly serial recursions are computed at once. The output is exactly the same
+ * as if each filter were processed on its own. Filters which are not in their plain state (i.e.
+ * which have pending messages, or a constant input) are processed on their own.
+ */
+class DspFilterBank {
+  
+  public:
+    DspFilterBank(int blockSize);
+    ~DspFilterBank();
+  
+    /** Returns true if filters can be processed in lanes on this platform. */
+    static bool isAvailable();
+  
+    void addFilter(DspFilter *filter);
+  
+    int getNumFilters();
+    DspFilter *getFilter(int index);
+  
+    /**
+     * Processes all filters for the whole block. The filters must not write to the input of any
+     * other filter of the bank.
+     */
+    void process();
+  
+  private:
+    /**
+     * Processes the given filters in a single group of lanes of the given vector width. Lanes
+     * beyond <code>numLanes</code> are padded with filters which produce only silence.
+     */
+    void processLanes(DspFilter **filters, int numLanes, int width);
+  
+    int blockSize;
+  
+    vector<DspFilter *> filterList;
+  
+    /** The filters which are processed in lanes in the current block. */
+    vector<DspFilter *> laneList;
+  
+    /** The input and output buffers of each lane in the current group. The widest vector has 16 lanes. */
+    float *laneInputs[16];
+    float *laneOutputs[16];
+  
+    /** The input and output of unused lanes. */
+    float *zeroBuffer;
+    float *unusedBuffer;
+  
+    /** The coefficients <code>b[0..4]</code> and the state x1, x2, y1, y2 of each lane, lane by lane. */
+    float *laneCoefficients;
+    float *laneState;
+};
+
+#endif // _DSP_FILTER_BANK_H_
@@ -37,6 +37,7 @@ class DspHighpassFilter : public DspFilter {
     ~DspHighpassFilter();
   
     static const char *getObjectLabel() { return "hip~"; }
+    ObjectType getObjectType() { return DSP_HIGHPASS_FILTER; }
   
   private:
     void processMessage(int inletIndex, PdMessage *message);
@@ -29,6 +29,7 @@ MessageObject *DspImplicitAdd::newObject(PdMessage *initMessage, PdGraph *graph)
 
 DspImplicitAdd::DspImplicitAdd(PdMessage *initMessage, PdGraph *graph) : DspObject(0, 2, 0, 1, graph) {
   processFunction = &processSignal;
+  destination = NULL;
 }
 
 DspImplicitAdd::~DspImplicitAdd() {
@@ -37,5 +38,10 @@ DspImplicitAdd::~DspImplicitAdd() {
 
 void DspImplicitAdd::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
   DspImplicitAdd *d = reinterpret_cast<DspImplicitAdd *>(dspObject);
-  ArrayArithmetic::add(d->dspBufferAtInlet[0], d->dspBufferAtInlet[1], d->dspBufferAtOutlet[0], 0, toIndex);
+  if (d->isConstantAtInlet(0) && d->isConstantAtInlet(1)) {
+    d->fillConstantAtOutlet(d->getConstantAtInlet(0) + d->getConstantAtInlet(1), 0, fromIndex, toIndex);
+  } else {
+    ArrayArithmetic::add(d->dspBufferAtInlet[0], d->dspBufferAtInlet[1], d->dspBufferAtOutlet[0], 0, toIndex);
+    d->clearConstantAtOutlet(0);
+  }
 }
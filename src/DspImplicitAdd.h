@@ -38,9 +38,17 @@ public:
   
   static const char *getObjectLabel() { return "+~~"; }
   string toString() { return string(getObjectLabel()); }
+  bool canProcessInPlace() { return true; }
+  ObjectType getObjectType() { return DSP_IMPLICIT_ADD; }
+  
+  /** Sets the object into whose inlet this implicit add (possibly via further adds) sums. */
+  void setDestination(DspObject *destination) { this->destination = destination; }
+  DspObject *getDestination() { return destination; }
   
   private:
     static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
+  
+    DspObject *destination;
 };
 
 #endif // _DSP_IMPLICIT_ADD_H_
@@ -57,10 +57,10 @@ void DspInlet::setDspBufferAtInlet(float *buffer, unsigned int inletIndex) {
       it != outgoingDspConnections[0].end(); ++it) {
     ObjectLetPair letPair = *it;
     DspObject *dspObject = reinterpret_cast<DspObject *>(letPair.first);
-    dspObject->setDspBufferAtInlet(dspBufferAtInlet[0], letPair.second);
+    dspObject->setDspBufferAtInlet(plannedDspBufferAtInlet[0], letPair.second);
   }
 }
 
 float *DspInlet::getDspBufferAtOutlet(int outletIndex) {
-  return (dspBufferAtInlet[0] == NULL) ? graph->getBufferPool()->getZeroBuffer() : dspBufferAtInlet[0];
+  return (plannedDspBufferAtInlet[0] == NULL) ? graph->getBufferPool()->getZeroBuffer() : plannedDspBufferAtInlet[0];
 }
@@ -74,10 +74,11 @@ void DspLine::processDspWithIndex(int fromIndex, int toIndex) {
   if (numSamplesToTarget <= 0.0f) { // if we have already reached the target
     int n = toIndex - fromIndex;
     if (n > 0) { // n may be zero
-      ArrayArithmetic::fill(dspBufferAtOutlet[0], target, fromIndex, toIndex);
+      fillConstantAtOutlet(target, 0, fromIndex, toIndex);
       lastOutputSample = target;
     }
   } else {
+    clearConstantAtOutlet(0);
     // the number of samples to be processed this iteration
     int n = toIndex - fromIndex;
     if (n > 0) { // n may be zero
@@ -22,6 +22,7 @@
 
 #include "DspLowpassFilter.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 MessageObject *DspLowpassFilter::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspLowpassFilter(initMessage, graph);
@@ -58,8 +59,8 @@ void DspLowpassFilter::processMessage(int inletIndex, PdMessage *message) {
           break;
         }
         case SYMBOL: {
-          if (message->isSymbol(0, "clear")) {
-            x1 = x2 = dspBufferAtOutlet[0][0] = dspBufferAtOutlet[0][1] = 0.0f;
+          if (message->isInternedSymbol(0, SymbolTable::CLEAR)) {
+            x1 = x2 = y1 = y2 = 0.0f;
           }
           break;
         }
@@ -37,6 +37,7 @@ class DspLowpassFilter : public DspFilter {
     ~DspLowpassFilter();
   
     static const char *getObjectLabel() { return "lop~"; }
+    ObjectType getObjectType() { return DSP_LOWPASS_FILTER; }
   
     void processMessage(int inletIndex, PdMessage *message);
   
@@ -32,6 +32,7 @@ MessageObject *DspMultiply::newObject(PdMessage *initMessage, PdGraph *graph) {
 DspMultiply::DspMultiply(PdMessage *initMessage, PdGraph *graph) : DspObject(2, 2, 0, 1, graph) {
   constant = initMessage->isFloat(0) ? initMessage->getFloat(0) : 0.0f;
   inputConstant = 0.0f;
+  processFunction = &processScalar;
   processFunctionNoMessage = &processScalar;
 }
 
@@ -66,12 +67,35 @@ void DspMultiply::processMessage(int inletIndex, PdMessage *message) {
 
 void DspMultiply::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
   DspMultiply *d = reinterpret_cast<DspMultiply *>(dspObject);
-  ArrayArithmetic::multiply(d->dspBufferAtInlet[0] , d->dspBufferAtInlet[1],
-      d->dspBufferAtOutlet[0], 0, toIndex);
+  if (d->isConstantAtInlet(0) && d->isConstantAtInlet(1)) {
+    d->fillConstantAtOutlet(d->getConstantAtInlet(0) * d->getConstantAtInlet(1), 0, fromIndex, toIndex);
+  } else if (d->isSilentAtInlet(0) || d->isSilentAtInlet(1)) {
+    // a silent signal silences the other one
+    d->fillConstantAtOutlet(0.0f, 0, fromIndex, toIndex);
+  } else if (d->isConstantAtInlet(1)) {
+    ArrayArithmetic::multiply(d->dspBufferAtInlet[0], d->getConstantAtInlet(1),
+        d->dspBufferAtOutlet[0], 0, toIndex);
+    d->clearConstantAtOutlet(0);
+  } else if (d->isConstantAtInlet(0)) {
+    ArrayArithmetic::multiply(d->dspBufferAtInlet[1], d->getConstantAtInlet(0),
+        d->dspBufferAtOutlet[0], 0, toIndex);
+    d->clearConstantAtOutlet(0);
+  } else {
+    ArrayArithmetic::multiply(d->dspBufferAtInlet[0] , d->dspBufferAtInlet[1],
+        d->dspBufferAtOutlet[0], 0, toIndex);
+    d->clearConstantAtOutlet(0);
+  }
 }
 
 void DspMultiply::processScalar(DspObject *dspObject, int fromIndex, int toIndex) {
   DspMultiply *d = reinterpret_cast<DspMultiply *>(dspObject);
-  ArrayArithmetic::multiply(d->dspBufferAtInlet[0] , d->constant,
-      d->dspBufferAtOutlet[0], fromIndex, toIndex);
+  if (d->isConstantAtInlet(0)) {
+    d->fillConstantAtOutlet(d->getConstantAtInlet(0) * d->constant, 0, fromIndex, toIndex);
+  } else if (d->constant == 0.0f) {
+    d->fillConstantAtOutlet(0.0f, 0, fromIndex, toIndex);
+  } else {
+    ArrayArithmetic::multiply(d->dspBufferAtInlet[0] , d->constant,
+        d->dspBufferAtOutlet[0], fromIndex, toIndex);
+    d->clearConstantAtOutlet(0);
+  }
 }
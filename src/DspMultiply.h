@@ -34,6 +34,7 @@ class DspMultiply : public DspObject {
   
     static const char *getObjectLabel() { return "*~"; }
     string toString();
+    bool canProcessInPlace() { return true; }
   
 
   private:
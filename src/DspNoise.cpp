@@ -22,24 +22,113 @@
 
 #include "DspNoise.h"
 #include "MersenneTwister.h"
+#include "PdContext.h"
+#include "PdGraph.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+// the upper 23 bits of a random word become the mantissa of a float in [2,4), which is then
+// shifted to [-1,1)
+#define MANTISSA_SHIFT 9
+#define EXPONENT_TWO 0x40000000
+#define OFFSET 3.0f
 
 MessageObject *DspNoise::newObject(PdMessage *initMessage, PdGraph *graph) {
-  return new DspNoise(graph);
+  return new DspNoise(initMessage, graph);
 }
 
-DspNoise::DspNoise(PdGraph *graph) : DspObject(1, 0, 0, 1, graph) {
-  twister = new MTRand(); // use new seed
-  processFunction = &processSignal;
+DspNoise::DspNoise(PdMessage *initMessage, PdGraph *graph) : DspObject(1, 0, 0, 1, graph) {
+  twister = initMessage->isSymbol(0, "mt") ? new MTRand() : NULL;
+  seed(graph->getContext()->getNextRandomSeed());
+  processFunction = (twister == NULL) ? &processSignal : &processTwister;
+  processFunctionNoMessage = processFunction;
 }
 
 DspNoise::~DspNoise() {
   delete twister;
 }
 
+string DspNoise::toString() {
+  return (twister == NULL) ? string(getObjectLabel()) : string(getObjectLabel()) + " mt";
+}
+
+void DspNoise::seed(unsigned int seed) {
+  if (twister != NULL) twister->seed(seed);
+  
+  // the words are filled with the splitmix32 sequence, which is never zero for all four words of
+  // a generator in practice
+  for (int i = 0; i < 16; i++) {
+    unsigned int h = (seed += 0x9E3779B9);
+    h = (h ^ (h >> 16)) * 0x85EBCA6B;
+    h = (h ^ (h >> 13)) * 0xC2B2AE35;
+    state[i] = h ^ (h >> 16);
+  }
+  for (int i = 0; i < 4; i++) {
+    if ((state[i] | state[4+i] | state[8+i] | state[12+i]) == 0) state[12+i] = 1;
+  }
+}
+
+void DspNoise::processMessage(int inletIndex, PdMessage *message) {
+  if (message->isSymbol(0, "seed") && message->isFloat(1)) {
+    seed((unsigned int) (int) message->getFloat(1));
+  }
+}
+
 void DspNoise::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
   DspNoise *d = reinterpret_cast<DspNoise *>(dspObject);
+  float *output = d->dspBufferAtOutlet[0];
+  unsigned int *state = d->state;
   
-  for (int i = 0; i < toIndex; i++) {
+  // four samples are generated at a time, one from each generator. Those beyond the end of the
+  // range are discarded.
+  #if __SSE2__
+  __m128i x = _mm_loadu_si128((__m128i *) state);
+  __m128i y = _mm_loadu_si128((__m128i *) (state+4));
+  __m128i z = _mm_loadu_si128((__m128i *) (state+8));
+  __m128i w = _mm_loadu_si128((__m128i *) (state+12));
+  const __m128i exponent = _mm_set1_epi32(EXPONENT_TWO);
+  const __m128 offset = _mm_set1_ps(OFFSET);
+  for (int i = fromIndex; i < toIndex; i += 4) {
+    __m128i t = _mm_xor_si128(x, _mm_slli_epi32(x, 11));
+    x = y; y = z; z = w;
+    w = _mm_xor_si128(_mm_xor_si128(w, _mm_srli_epi32(w, 19)), _mm_xor_si128(t, _mm_srli_epi32(t, 8)));
+    __m128 values = _mm_sub_ps(
+        _mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(w, MANTISSA_SHIFT), exponent)), offset);
+    if (i + 4 <= toIndex) {
+      _mm_storeu_ps(output+i, values);
+    } else {
+      float remainder[4];
+      _mm_storeu_ps(remainder, values);
+      for (int j = i; j < toIndex; j++) output[j] = remainder[j-i];
+    }
+  }
+  _mm_storeu_si128((__m128i *) state, x);
+  _mm_storeu_si128((__m128i *) (state+4), y);
+  _mm_storeu_si128((__m128i *) (state+8), z);
+  _mm_storeu_si128((__m128i *) (state+12), w);
+  #else
+  for (int i = fromIndex; i < toIndex; i += 4) {
+    for (int j = 0; j < 4; j++) {
+      unsigned int t = state[j] ^ (state[j] << 11);
+      state[j] = state[4+j];
+      state[4+j] = state[8+j];
+      state[8+j] = state[12+j];
+      state[12+j] = (state[12+j] ^ (state[12+j] >> 19)) ^ (t ^ (t >> 8));
+      if (i + j < toIndex) {
+        union { unsigned int i; float f; } value;
+        value.i = (state[12+j] >> MANTISSA_SHIFT) | EXPONENT_TWO;
+        output[i+j] = value.f - OFFSET;
+      }
+    }
+  }
+  #endif
+}
+
+void DspNoise::processTwister(DspObject *dspObject, int fromIndex, int toIndex) {
+  DspNoise *d = reinterpret_cast<DspNoise *>(dspObject);
+  for (int i = fromIndex; i < toIndex; i++) {
     d->dspBufferAtOutlet[0][i] = ((float) d->twister->rand(2.0)) - 1.0f;
   }
 }
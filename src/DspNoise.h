@@ -28,19 +28,38 @@
 class MTRand;
 class PdGraph;
 
-/** [noise~] */
+/**
+ * [noise~], [noise~ mt]
+ * White noise in [-1,1). By default it is generated by four interleaved xorshift128 generators,
+ * four samples at a time. With the argument <code>mt</code> a Mersenne Twister is used instead.
+ * The generators are seeded from the context, such that the output is reproducible. The message
+ * <code>seed float</code> reseeds them.
+ */
 class DspNoise : public DspObject {
     
   public:
     static MessageObject *newObject(PdMessage *initMessage, PdGraph *graph);
-    DspNoise(PdGraph *graph);
+    DspNoise(PdMessage *initMessage, PdGraph *graph);
     ~DspNoise();
   
     static const char *getObjectLabel() { return "noise~"; }
+    string toString();
   
   private:
     static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
+    static void processTwister(DspObject *dspObject, int fromIndex, int toIndex);
+    void processMessage(int inletIndex, PdMessage *message);
+  
+    /** Seeds the generators from the given seed. */
+    void seed(unsigned int seed);
+  
+    /**
+     * The state of the xorshift128 generators, the words x, y, z and w of each in turn. The four
+     * generators are interleaved, such that each word of all of them forms one vector.
+     */
+    unsigned int state[16];
   
+    /** The Mersenne Twister. <code>NULL</code> unless it has been requested. */
     MTRand *twister;
 };
 
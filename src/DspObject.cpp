@@ -24,9 +24,17 @@
 #include "BufferPool.h"
 #include "DspImplicitAdd.h"
 #include "DspObject.h"
+#include "PdContext.h"
 #include "PdGraph.h"
 
 
+// the state of buffers about which nothing is known
+static const SignalState unknownSignalState = {0.0f, false, false};
+
+// the state of the zero buffer
+static const SignalState silentSignalState = {0.0f, true, false};
+
+
 #pragma mark - Constructor/Destructor
 
 DspObject::DspObject(int numMessageInlets, int numDspInlets, int numMessageOutlets, int numDspOutlets, PdGraph *graph) :
@@ -51,10 +59,23 @@ void DspObject::init(int numDspInlets, int numDspOutlets, int blockSize) {
   outgoingDspConnections = vector<list<ObjectLetPair> >(numDspOutlets);
 
   memset(dspBufferAtInlet, 0, sizeof(float *) * 3);
-  if (numDspInlets > 2) dspBufferAtInlet[2] = (float *) calloc(numDspInlets-2, sizeof(float *));
+  memset(plannedDspBufferAtInlet, 0, sizeof(float *) * 3);
+  if (numDspInlets > 2) {
+    dspBufferAtInlet[2] = (float *) calloc(numDspInlets-2, sizeof(float *));
+    plannedDspBufferAtInlet[2] = (float *) calloc(numDspInlets-2, sizeof(float *));
+  }
   
   memset(dspBufferAtOutlet, 0, sizeof(float *) * 3);
-  if (numDspOutlets > 2) dspBufferAtOutlet[2] = (float *) calloc(numDspOutlets-2, sizeof(float *));
+  memset(plannedDspBufferAtOutlet, 0, sizeof(float *) * 3);
+  if (numDspOutlets > 2) {
+    dspBufferAtOutlet[2] = (float *) calloc(numDspOutlets-2, sizeof(float *));
+    plannedDspBufferAtOutlet[2] = (float *) calloc(numDspOutlets-2, sizeof(float *));
+  }
+  
+  signalStateAtInlet[0] = signalStateAtInlet[1] = &unknownSignalState;
+  signalStateAtOutlet[0] = signalStateAtOutlet[1] = unknownSignalState;
+  plannedSignalStateAtInlet[0] = plannedSignalStateAtInlet[1] = &unknownSignalState;
+  isPlannedRetainedAtOutlet[0] = isPlannedRetainedAtOutlet[1] = false;
 }
 
 DspObject::~DspObject() {  
@@ -63,8 +84,14 @@ DspObject::~DspObject() {
   clearMessageQueue();
   
   // inlet and outlet buffers are managed by the BufferPool
-  if (getNumDspInlets() > 2) free(dspBufferAtInlet[2]);
-  if (getNumDspOutlets() > 2) free(dspBufferAtOutlet[2]);
+  if (getNumDspInlets() > 2) {
+    free(dspBufferAtInlet[2]);
+    free(plannedDspBufferAtInlet[2]);
+  }
+  if (getNumDspOutlets() > 2) {
+    free(dspBufferAtOutlet[2]);
+    free(plannedDspBufferAtOutlet[2]);
+  }
 }
 
 
@@ -76,17 +103,76 @@ ConnectionType DspObject::getConnectionType(int outletIndex) {
 
 float *DspObject::getDspBufferAtInlet(int inletIndex) {
   return (inletIndex < 2)
-      ? dspBufferAtInlet[inletIndex] : ((float **) dspBufferAtInlet[2])[inletIndex-2];
+      ? plannedDspBufferAtInlet[inletIndex] : ((float **) plannedDspBufferAtInlet[2])[inletIndex-2];
 }
 
 float *DspObject::getDspBufferAtOutlet(int outletIndex) {
-  if (outletIndex < 2) return dspBufferAtOutlet[outletIndex];
-  else return ((float **) dspBufferAtOutlet[2])[outletIndex-2];
+  if (outletIndex < 2) return plannedDspBufferAtOutlet[outletIndex];
+  else return ((float **) plannedDspBufferAtOutlet[2])[outletIndex-2];
+}
+
+SignalState *DspObject::getSignalStateAtOutlet(int outletIndex) {
+  return (outletIndex < 2) ? signalStateAtOutlet + outletIndex : NULL;
+}
+
+void DspObject::setSignalStateAtInlet(const SignalState *signalState, int inletIndex) {
+  if (inletIndex < 2) {
+    plannedSignalStateAtInlet[inletIndex] = (signalState != NULL) ? signalState : &unknownSignalState;
+  }
+}
+
+void DspObject::setRetainedAtOutlet(bool isRetained, int outletIndex) {
+  if (outletIndex < 2) isPlannedRetainedAtOutlet[outletIndex] = isRetained;
+}
+
+void DspObject::commitDspState() {
+  // the arrays are sized as in init(), from the connection lists which never change in size
+  int numDspInlets = incomingDspConnections.size();
+  memcpy(dspBufferAtInlet, plannedDspBufferAtInlet, sizeof(float *) * 2);
+  if (numDspInlets > 2) {
+    memcpy(dspBufferAtInlet[2], plannedDspBufferAtInlet[2], (numDspInlets-2) * sizeof(float *));
+  }
+  int numDspOutlets = outgoingDspConnections.size();
+  memcpy(dspBufferAtOutlet, plannedDspBufferAtOutlet, sizeof(float *) * 2);
+  if (numDspOutlets > 2) {
+    memcpy(dspBufferAtOutlet[2], plannedDspBufferAtOutlet[2], (numDspOutlets-2) * sizeof(float *));
+  }
+  
+  // the buffers may now be written by other objects, or hold something else entirely
+  for (int i = 0; i < 2; i++) {
+    signalStateAtInlet[i] = plannedSignalStateAtInlet[i];
+    signalStateAtOutlet[i].isConstant = false;
+    signalStateAtOutlet[i].isRetained = isPlannedRetainedAtOutlet[i];
+  }
+  
+  // the connections may have changed since the last commit
+  for (int i = 0; i < numDspInlets; i++) {
+    onInletConnectionUpdate(i);
+  }
+}
+
+const SignalState *DspObject::getSilentSignalState() {
+  return &silentSignalState;
+}
+
+void DspObject::fillConstantAtOutlet(float value, int outletIndex, int fromIndex, int toIndex) {
+  SignalState *signalState = signalStateAtOutlet + outletIndex;
+  if (fromIndex == 0 && toIndex == blockSizeInt) {
+    if (!signalState->isRetained || !signalState->isConstant || signalState->value != value) {
+      ArrayArithmetic::fill(dspBufferAtOutlet[outletIndex], value, 0, toIndex);
+      signalState->isConstant = true;
+      signalState->value = value;
+    }
+  } else {
+    // only a part of the block is known to be constant
+    ArrayArithmetic::fill(dspBufferAtOutlet[outletIndex], value, fromIndex, toIndex);
+    signalState->isConstant = false;
+  }
 }
 
 list<ObjectLetPair> DspObject::getIncomingConnections(unsigned int inletIndex) {
   list<ObjectLetPair> messageConnectionList = MessageObject::getIncomingConnections(inletIndex);
-  list<ObjectLetPair> dspConnectionList = incomingDspConnections.empty()
+  list<ObjectLetPair> dspConnectionList = (inletIndex >= incomingDspConnections.size())
       ? list<ObjectLetPair>() : incomingDspConnections[inletIndex];
   messageConnectionList.insert(messageConnectionList.end(), dspConnectionList.begin(), dspConnectionList.end());
   return messageConnectionList;
@@ -98,7 +184,7 @@ list<ObjectLetPair> DspObject::getIncomingDspConnections(unsigned int inletIndex
 
 list<ObjectLetPair> DspObject::getOutgoingConnections(unsigned int outletIndex) {
   list<ObjectLetPair> messageConnectionList = MessageObject::getOutgoingConnections(outletIndex);
-  list<ObjectLetPair> dspConnectionList = outgoingDspConnections.empty()
+  list<ObjectLetPair> dspConnectionList = (outletIndex >= outgoingDspConnections.size())
       ? list<ObjectLetPair>() : outgoingDspConnections[outletIndex];
   messageConnectionList.insert(messageConnectionList.end(), dspConnectionList.begin(), dspConnectionList.end());
   return messageConnectionList;
@@ -120,7 +206,8 @@ void DspObject::addConnectionFromObjectToInlet(MessageObject *messageObject, int
     connections->push_back(objectLetPair);
   }
   
-  onInletConnectionUpdate(inletIndex);
+  // the objects of live graphs are updated when their dsp state is committed
+  if (!graph->isLive()) onInletConnectionUpdate(inletIndex);
 }
 
 void DspObject::removeConnectionFromObjectToInlet(MessageObject *messageObject, int outletIndex, int inletIndex) {
@@ -132,7 +219,7 @@ void DspObject::removeConnectionFromObjectToInlet(MessageObject *messageObject,
     MessageObject::removeConnectionFromObjectToInlet(messageObject, outletIndex, inletIndex);
   }
   
-  onInletConnectionUpdate(inletIndex);
+  if (!graph->isLive()) onInletConnectionUpdate(inletIndex);
 }
 
 void DspObject::onInletConnectionUpdate(unsigned int inletIndex) {
@@ -161,13 +248,13 @@ void DspObject::removeConnectionToObjectFromOutlet(MessageObject *messageObject,
 }
 
 void DspObject::setDspBufferAtInlet(float *buffer, unsigned int inletIndex) {
-  if (inletIndex < 2) dspBufferAtInlet[inletIndex] = buffer;
-  else ((float **) dspBufferAtInlet[2])[inletIndex-2] = buffer;
+  if (inletIndex < 2) plannedDspBufferAtInlet[inletIndex] = buffer;
+  else ((float **) plannedDspBufferAtInlet[2])[inletIndex-2] = buffer;
 }
 
 void DspObject::setDspBufferAtOutlet(float *buffer, unsigned int outletIndex) {
-  if (outletIndex < 2) dspBufferAtOutlet[outletIndex] = buffer;
-  else ((float **) dspBufferAtOutlet[2])[outletIndex-2] = buffer;
+  if (outletIndex < 2) plannedDspBufferAtOutlet[outletIndex] = buffer;
+  else ((float **) plannedDspBufferAtOutlet[2])[outletIndex-2] = buffer;
 }
 
 
@@ -177,7 +264,7 @@ void DspObject::clearMessageQueue() {
   while (!messageQueue.empty()) {
     MessageLetPair messageLetPair = messageQueue.front();
     PdMessage *message = messageLetPair.first;
-    message->freeMessage();
+    graph->getContext()->getMessageAllocator()->freeMessage(message);
     messageQueue.pop();
   }
 }
@@ -186,9 +273,11 @@ void DspObject::receiveMessage(int inletIndex, PdMessage *message) {
   // Queue the message to be processed during the DSP round only if the graph is switched on.
   // Otherwise messages would begin to pile up because the graph is not processed.
   if (graph->isSwitchedOn()) {
-    // Copy the message to the heap so that it is available to process later.
-    // The message is released once it is consumed in processDsp().
-    messageQueue.push(make_pair(message->copyToHeap(), inletIndex));
+    // Copy the message so that it is available to process later. It is usually consumed in this
+    // block, so it is copied into the message arena of the context. The message is released once
+    // it is consumed in processDsp().
+    messageQueue.push(make_pair(
+        graph->getContext()->getMessageAllocator()->copyMessageToArena(message), inletIndex));
     
     // only process the message if the process function is set to the default no-message function.
     // If it is set to anything else, then it is assumed that messages should not be processed.
@@ -214,7 +303,8 @@ void DspObject::processFunctionMessage(DspObject *dspObject, int fromIndex, int
     dspObject->processFunctionNoMessage(dspObject,
         ceil(blockIndexOfLastMessage), ceil(blockIndexOfCurrentMessage));
     dspObject->processMessage(inletIndex, message);
-    message->freeMessage(); // free the message from the head, the message has been consumed.
+    // free the message from the head, the message has been consumed.
+    dspObject->graph->getContext()->getMessageAllocator()->freeMessage(message);
     dspObject->messageQueue.pop();
     
     blockIndexOfLastMessage = blockIndexOfCurrentMessage;
@@ -318,6 +408,7 @@ list<DspObject *> DspObject::getProcessOrder() {
             processList.splice(processList.end(), parentProcessList);
             
             DspImplicitAdd *dspAdd = new DspImplicitAdd(dspAddInitMessage, getGraph());
+            dspAdd->setDestination(this);
             float *buffer = reinterpret_cast<DspObject *>(leftOlPair.first)->getDspBufferAtOutlet(leftOlPair.second);
             dspAdd->setDspBufferAtInlet(buffer, 0);
             bufferPool->releaseBuffer(buffer);
@@ -341,10 +432,12 @@ list<DspObject *> DspObject::getProcessOrder() {
       }
     }
     
-    // release the inlet buffers only after everything has been set up
-    for (int i = 0; i < getNumDspInlets(); i++) {
-      float *buffer = getDspBufferAtInlet(i);
-      bufferPool->releaseBuffer(buffer);
+    // release the inlet buffers only after everything has been set up. An object which can process
+    // in place may reuse them for its outlets. Otherwise they are released after the outlets are set.
+    if (canProcessInPlace()) {
+      for (int i = 0; i < getNumDspInlets(); i++) {
+        bufferPool->releaseBuffer(getDspBufferAtInlet(i));
+      }
     }
     
     // set the outlet buffers
@@ -355,6 +448,12 @@ list<DspObject *> DspObject::getProcessOrder() {
       }
     }
     
+    if (!canProcessInPlace()) {
+      for (int i = 0; i < getNumDspInlets(); i++) {
+        bufferPool->releaseBuffer(getDspBufferAtInlet(i));
+      }
+    }
+    
     // NOTE(mhroth): even if an object does not process audio, its buffer still needs to be connected.
     // They may be passed on to other objects, such as s~/r~ pairs
     if (doesProcessAudio()) processList.push_back(this);
@@ -39,6 +39,17 @@
 
 typedef std::pair<PdMessage *, unsigned int> MessageLetPair;
 
+/**
+ * What is known about the content of a dsp buffer in the current block. It is kept by the object
+ * which writes the buffer and read by the objects which process it. A constant buffer holds
+ * <code>value</code> at every index. A silent buffer is a constant buffer of zeros.
+ */
+typedef struct SignalState {
+  float value;
+  bool isConstant;
+  bool isRetained; // no other object writes to the buffer, it keeps its content between blocks
+} SignalState;
+
 /**
  * A <code>DspObject</code> is the abstract superclass of any object which processes audio.
  * <code>DspObject</code> is a subclass of <code>MessageObject</code>, such that all of the former
@@ -72,7 +83,10 @@ class DspObject : public MessageObject {
     /** Returns the connection type of the given outlet. */
     virtual ConnectionType getConnectionType(int outletIndex);
 
-    /** Get and set buffers at inlets and outlets. */
+    /**
+     * Get and set buffers at inlets and outlets. These are the buffers planned by the editing thread.
+     * The buffers which are processed only change in <code>commitDspState()</code>.
+     */
     virtual void setDspBufferAtInlet(float *buffer, unsigned int inletIndex);
     virtual void setDspBufferAtOutlet(float *buffer, unsigned int outletIndex);
     virtual float *getDspBufferAtInlet(int inletIndex);
@@ -82,6 +96,39 @@ class DspObject : public MessageObject {
     /** Return true if a buffer from the Buffer Pool should set set at the given outlet. False otherwise. */
     virtual bool canSetBufferAtOutlet(unsigned int outletIndex) { return true; }
   
+    /**
+     * Returns true if the outlet buffers may be the same as one of the inlet buffers. This is the
+     * case if each output sample depends only on the input samples at the same index, and all inputs
+     * at an index are read before the output at that index is written. Buffers which are not used
+     * anymore after this object are then reused for its outlets.
+     */
+    virtual bool canProcessInPlace() { return false; }
+  
+    /**
+     * Returns the state of the buffer at the given outlet, or <code>NULL</code> if it is not kept
+     * for the outlet. The state is only ever marked as constant by objects which know it to be.
+     */
+    SignalState *getSignalStateAtOutlet(int outletIndex);
+  
+    /**
+     * Sets the state of the buffer at the given inlet, as kept by the object writing it. If
+     * <code>NULL</code>, nothing is known about the buffer.
+     */
+    void setSignalStateAtInlet(const SignalState *signalState, int inletIndex);
+  
+    /** Sets whether no other object writes to the buffer at the given outlet. */
+    void setRetainedAtOutlet(bool isRetained, int outletIndex);
+  
+    /**
+     * Makes the planned buffers and signal states those which are processed. It is called on the
+     * audio thread between blocks, while the editing thread waits. Subclasses also switch their
+     * process function here if it depends on state which the editing thread has changed.
+     */
+    virtual void commitDspState();
+  
+    /** Returns the state of the zero buffer, which is always silent. */
+    static const SignalState *getSilentSignalState();
+  
     virtual void addConnectionFromObjectToInlet(MessageObject *messageObject, int outletIndex, int inletIndex);
     virtual void addConnectionToObjectFromOutlet(MessageObject *messageObject, int inletIndex, int outletIndex);
     virtual void removeConnectionFromObjectToInlet(MessageObject *messageObject, int outletIndex, int inletIndex);
@@ -89,6 +136,20 @@ class DspObject : public MessageObject {
   
     virtual bool doesProcessAudio() { return true; }
   
+    /**
+     * Returns true if the object sends messages while it processes audio, such as [snapshot~]. The
+     * messages are delivered immediately and may reach any object, so the object is always processed
+     * in order with all others.
+     */
+    virtual bool doesSendMessages() { return false; }
+  
+    /**
+     * Returns true if the object schedules messages while it processes audio, such as [env~]. The
+     * order of the messages depends on the order in which these objects are processed, so they are
+     * never processed in parallel.
+     */
+    virtual bool doesScheduleMessages() { return false; }
+  
     virtual bool isLeafNode();
 
     virtual list<DspObject *> getProcessOrder();
@@ -139,6 +200,27 @@ class DspObject : public MessageObject {
   
     /** Immediately deletes all messages in the message queue without executing them. */
     void clearMessageQueue();
+  
+    /** Returns true if the buffer at the given inlet holds the same value at every index. */
+    inline bool isConstantAtInlet(int inletIndex) { return signalStateAtInlet[inletIndex]->isConstant; }
+  
+    /** Returns true if the buffer at the given inlet holds only zeros. */
+    inline bool isSilentAtInlet(int inletIndex) {
+      return signalStateAtInlet[inletIndex]->isConstant && signalStateAtInlet[inletIndex]->value == 0.0f;
+    }
+  
+    /** Returns the value of a constant buffer at the given inlet. */
+    inline float getConstantAtInlet(int inletIndex) { return signalStateAtInlet[inletIndex]->value; }
+  
+    /**
+     * Fills the buffer at the given outlet with a constant value. If the whole block is filled, the
+     * buffer is marked as constant. It is not written at all if it still holds the same value from
+     * the previous block.
+     */
+    void fillConstantAtOutlet(float value, int outletIndex, int fromIndex, int toIndex);
+  
+    /** Marks the buffer at the given outlet as not constant, e.g. after it has been processed normally. */
+    inline void clearConstantAtOutlet(int outletIndex) { signalStateAtOutlet[outletIndex].isConstant = false; }
     
     // both float and int versions of the blocksize are stored as different internal mechanisms
     // require different number formats
@@ -153,6 +235,22 @@ class DspObject : public MessageObject {
     /* An array of pointers to resolved dsp buffers at each outlet. */
     float *dspBufferAtOutlet[3];
   
+    /** The state of the buffers at the first two inlets. Never <code>NULL</code>. */
+    const SignalState *signalStateAtInlet[2];
+  
+    /** The state of the buffers at the first two outlets. */
+    SignalState signalStateAtOutlet[2];
+  
+    /** The buffers at each inlet and outlet as planned by the editing thread. */
+    float *plannedDspBufferAtInlet[3];
+    float *plannedDspBufferAtOutlet[3];
+  
+    /** The planned states of the buffers at the first two inlets. Never <code>NULL</code>. */
+    const SignalState *plannedSignalStateAtInlet[2];
+  
+    /** The planned retention of the buffers at the first two outlets. */
+    bool isPlannedRetainedAtOutlet[2];
+  
     /** List of all dsp objects connecting to this object at each inlet. */
     vector<list<ObjectLetPair> > incomingDspConnections;
   
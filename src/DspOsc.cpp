@@ -21,11 +21,24 @@
  */
 
 #include "DspOsc.h"
+#include "LookupTable.h"
 #include "PdGraph.h"
 
-// initialise the static class variables
-float *DspOsc::cos_table = NULL;
-int DspOsc::refCount = 0;
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+// the lower bits of the phase which interpolate between two entries of the table, and their scale
+#define COS_TABLE_SHIFT (32 - INTERPOLATED_COSINE_TABLE_BITS)
+#define COS_TABLE_FRAC_MASK ((1 << COS_TABLE_SHIFT) - 1)
+#define COS_TABLE_FRAC_SCALE (1.0f / (float) (1 << COS_TABLE_SHIFT))
+
+// one cycle of the phase
+#define PHASE_SCALE 4294967296.0f
+
+// 2^23, above which every float is an integer. Frequencies in cycles per sample are clamped to it,
+// such that they can be rounded through an int.
+#define MAX_NORMALISED_FREQUENCY 8388608.0f
 
 MessageObject *DspOsc::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspOsc(initMessage, graph);
@@ -33,35 +46,23 @@ MessageObject *DspOsc::newObject(PdMessage *initMessage, PdGraph *graph) {
 
 DspOsc::DspOsc(PdMessage *initMessage, PdGraph *graph) : DspObject(2, 2, 0, 1, graph) {
   frequency = initMessage->isFloat(0) ? initMessage->getFloat(0) : 0.0f;
-  sampleStep = frequency * 65536.0f / graph->getSampleRate();
-  #if __SSE3__
-  short step = (short) roundf(sampleStep);
-  inc = _mm_set_epi16(8*step, 8*step, 8*step, 8*step, 8*step, 8*step, 8*step, 8*step);
-  indicies = _mm_set_epi16(7*step, 6*step, 5*step, 4*step, 3*step, 2*step, step, 0);
-  #endif
-  
-  phase = 0.0f;
-  refCount++;
-  if (cos_table == NULL) {
-    cos_table = ALLOC_ALIGNED_BUFFER(65536 * sizeof(float));
-    for (int i = 0; i < 65536; i++) {
-      cos_table[i] = cosf(2.0f * M_PI * ((float) i) / 65536.0f);
-    }
-  }
+  invSampleRate = 1.0f / graph->getSampleRate();
+  phase = 0;
+  cosTable = LookupTable::getInterpolatedCosineTable();
   
   processFunction = &processScalar;
   processFunctionNoMessage = &processScalar;
 }
 
 DspOsc::~DspOsc() {
-  if (--refCount == 0) {
-    FREE_ALIGNED_BUFFER(cos_table);
-    cos_table = NULL;
-  }
+  // nothing to do
 }
 
 void DspOsc::onInletConnectionUpdate(unsigned int inletIndex) {
-  // TODO(mhroth): support this with processSignal
+  // because onInletConnectionUpdate can only be called at block boundaries, it is guaranteed
+  // that no messages will be in the message queue.
+  processFunction = incomingDspConnections[0].empty() ? &processScalar : &processSignal;
+  processFunctionNoMessage = processFunction;
 }
 
 string DspOsc::toString() {
@@ -73,113 +74,121 @@ string DspOsc::toString() {
 void DspOsc::processMessage(int inletIndex, PdMessage *message) {
   switch (inletIndex) {
     case 0: { // update the frequency
-      if (message->isFloat(0)) {
-        updateFrequency(fabsf(message->getFloat(0)));
-        sampleStep = frequency * 65536.0f / graph->getSampleRate();
-      }
+      if (message->isFloat(0)) frequency = message->getFloat(0);
       break;
     }
     case 1: { // update the phase
-      // TODO(mhroth)
+      if (message->isFloat(0)) {
+        float f = message->getFloat(0);
+        phase = (unsigned int) llrintf((f - floorf(f)) * PHASE_SCALE);
+      }
       break;
     }
     default: break;
   }
 }
 
-void DspOsc::updateFrequency(float frequency) {
-  frequency = dspBufferAtInlet[0][0];
-  
-#if __SSE3__
-  sampleStep = frequency * 65536.0f / graph->getSampleRate();
-
-  short step1 = (short) roundf(sampleStep);
-  inc = _mm_set_epi16(8*step1, 8*step1, 8*step1, 8*step1, 8*step1, 8*step1, 8*step1, 8*step1);
-  unsigned short currentIndex1 = _mm_extract_epi16(indicies,0);
-  indicies = _mm_set_epi16(7*step1+currentIndex1, 6*step1+currentIndex1, 5*step1+currentIndex1,
-                              4*step1+currentIndex1, 3*step1+currentIndex1, 2*step1+currentIndex1, step1+currentIndex1, currentIndex1);
+inline unsigned int DspOsc::getPhaseIncrement(float f) {
+  // only the fractional part of the frequency in cycles per sample matters
+  float p = f * invSampleRate;
+  p = (p > -MAX_NORMALISED_FREQUENCY) ? p : -MAX_NORMALISED_FREQUENCY;
+  p = (p < MAX_NORMALISED_FREQUENCY) ? p : MAX_NORMALISED_FREQUENCY;
+  p = p - (float) lrintf(p);
+  return (unsigned int) llrintf(p * PHASE_SCALE);
+}
+
+inline float DspOsc::getCosine(unsigned int phase) {
+  unsigned int index = phase >> COS_TABLE_SHIFT;
+  float frac = ((float) (int) (phase & COS_TABLE_FRAC_MASK)) * COS_TABLE_FRAC_SCALE;
+  return cosTable[2*index] + frac * cosTable[2*index+1];
+}
+
+#if __SSE2__
+/** The same as <code>DspOsc::getCosine()</code>, for four phases at once. */
+static inline __m128 getCosines(const float *table, __m128i phases) {
+  int index[4] __attribute__((aligned(16)));
+  _mm_store_si128((__m128i *) index, _mm_srli_epi32(phases, COS_TABLE_SHIFT));
+  __m128 frac = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(phases, _mm_set1_epi32(COS_TABLE_FRAC_MASK))),
+      _mm_set1_ps(COS_TABLE_FRAC_SCALE));
+  // load the entries with their differences, and separate them
+  __m128 entries01 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (__m64 *) (table + 2*index[0])),
+      (__m64 *) (table + 2*index[1]));
+  __m128 entries23 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (__m64 *) (table + 2*index[2])),
+      (__m64 *) (table + 2*index[3]));
+  __m128 values = _mm_shuffle_ps(entries01, entries23, _MM_SHUFFLE(2, 0, 2, 0));
+  __m128 differences = _mm_shuffle_ps(entries01, entries23, _MM_SHUFFLE(3, 1, 3, 1));
+  return _mm_add_ps(values, _mm_mul_ps(frac, differences));
+}
 #endif
+
+void DspOsc::processConstant(unsigned int increment, int fromIndex, int toIndex) {
+  if (increment == 0) {
+    fillConstantAtOutlet(getCosine(phase), 0, fromIndex, toIndex);
+    return;
+  }
+  clearConstantAtOutlet(0);
   
+  float *output = dspBufferAtOutlet[0];
+  unsigned int currentPhase = phase;
+  int i = fromIndex;
+  #if __SSE2__
+  __m128i phases = _mm_add_epi32(_mm_set1_epi32(currentPhase),
+      _mm_set_epi32(3*increment, 2*increment, increment, 0));
+  __m128i step = _mm_set1_epi32(4*increment);
+  for (int n4 = toIndex - 4; i <= n4; i += 4) {
+    _mm_storeu_ps(output+i, getCosines(cosTable, phases));
+    phases = _mm_add_epi32(phases, step);
+  }
+  currentPhase = (unsigned int) _mm_cvtsi128_si32(phases);
+  #endif
+  for (; i < toIndex; i++) {
+    output[i] = getCosine(currentPhase);
+    currentPhase += increment;
+  }
+  phase = currentPhase;
 }
 
 void DspOsc::processScalar(DspObject *dspObject, int fromIndex, int toIndex) {
   DspOsc *d = reinterpret_cast<DspOsc *>(dspObject);
-  
-  if(d->getIncomingDspConnections(0).size() > 0)
-  {
-    d->updateFrequency(d->dspBufferAtInlet[0][0]);
-  }
-  
-  #if __SSE3__
-  
-  float *output = d->dspBufferAtOutlet[0]+fromIndex;
-  __m128i inc = d->inc;
-  __m128i indicies = d->indicies;
-  int n = toIndex - fromIndex;
-  
-  unsigned short currentIndex = _mm_extract_epi16(indicies,0);
-  short step = _mm_extract_epi16(inc,0)/8;
-  
-  switch (fromIndex & 0x7) {
-    case 0: default: break;
-    case 1: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step; --n; // allow fallthrough
-    case 2: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step; --n;
-    case 3: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step; --n;
-    case 4: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step; --n;
-    case 5: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step; --n;
-    case 6: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step; --n;
-    case 7: {
-      *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step; --n;
-      
-      d->indicies = _mm_set_epi16(7*step+currentIndex, 6*step+currentIndex, 5*step+currentIndex,
-          4*step+currentIndex, 3*step+currentIndex, 2*step+currentIndex, step+currentIndex, currentIndex);
-    }
-  }
-  
-  int n4 = n & 0xFFFFFFF8; // we can process 8 indicies at a time
-  while (n4) {
-    __m128 values = _mm_set_ps(DspOsc::cos_table[(unsigned short) _mm_extract_epi16(indicies,3)],
-                               DspOsc::cos_table[(unsigned short) _mm_extract_epi16(indicies,2)],
-                               DspOsc::cos_table[(unsigned short) _mm_extract_epi16(indicies,1)],
-                               DspOsc::cos_table[(unsigned short) _mm_extract_epi16(indicies,0)]);
-    _mm_store_ps(output, values);
-    output += 4;
-    values = _mm_set_ps(DspOsc::cos_table[(unsigned short) _mm_extract_epi16(indicies,7)],
-                        DspOsc::cos_table[(unsigned short) _mm_extract_epi16(indicies,6)],
-                        DspOsc::cos_table[(unsigned short) _mm_extract_epi16(indicies,5)],
-                        DspOsc::cos_table[(unsigned short) _mm_extract_epi16(indicies,4)]);
-    _mm_store_ps(output, values);
-    indicies = _mm_add_epi16(indicies, inc);
-    output += 4;
-    n4 -= 8;
+  d->processConstant(d->getPhaseIncrement(d->frequency), fromIndex, toIndex);
+}
+
+void DspOsc::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
+  DspOsc *d = reinterpret_cast<DspOsc *>(dspObject);
+  if (d->isConstantAtInlet(0)) {
+    d->processConstant(d->getPhaseIncrement(d->getConstantAtInlet(0)), fromIndex, toIndex);
+    return;
   }
+  d->clearConstantAtOutlet(0);
   
-  currentIndex = _mm_extract_epi16(indicies,0);
-  switch (n & 0x7) {
-    case 7: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step; // allow fallthrough
-    case 6: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step;
-    case 5: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step;
-    case 4: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step;
-    case 3: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step;
-    case 2: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step;
-    case 1: *output++ = DspOsc::cos_table[currentIndex]; currentIndex += step;
-    default: {
-      // set the current index to the correct location, given that the step size is actually
-      // a real number, not an integer
-      // NOTE(mhroth): but doing this will cause clicks :-/ Osc will thus go out of phase over time
-      // Will anyone complain?
-//      d->currentIndex = currentIndex + ((short) ((d->sampleStep - floorf(d->sampleStep)) * n));
-      
-      if ((n & 0x7) == 0) {
-        d->indicies = indicies;
-      } else {
-        d->indicies = _mm_set_epi16(7*step+currentIndex, 6*step+currentIndex, 5*step+currentIndex,
-            4*step+currentIndex, 3*step+currentIndex, 2*step+currentIndex, step+currentIndex, currentIndex);        
-      }
-      break;
-    }
+  float *input = d->dspBufferAtInlet[0];
+  float *output = d->dspBufferAtOutlet[0];
+  unsigned int currentPhase = d->phase;
+  int i = fromIndex;
+  #if __SSE2__
+  // the same operations as getPhaseIncrement(), in the same order
+  const __m128 invSampleRate = _mm_set1_ps(d->invSampleRate);
+  const __m128 minFrequency = _mm_set1_ps(-MAX_NORMALISED_FREQUENCY);
+  const __m128 maxFrequency = _mm_set1_ps(MAX_NORMALISED_FREQUENCY);
+  const __m128 phaseScale = _mm_set1_ps(PHASE_SCALE);
+  __m128i base = _mm_set1_epi32(currentPhase);
+  for (int n4 = toIndex - 4; i <= n4; i += 4) {
+    __m128 p = _mm_mul_ps(_mm_loadu_ps(input+i), invSampleRate);
+    p = _mm_min_ps(_mm_max_ps(p, minFrequency), maxFrequency);
+    p = _mm_sub_ps(p, _mm_cvtepi32_ps(_mm_cvtps_epi32(p)));
+    __m128i increments = _mm_cvtps_epi32(_mm_mul_ps(p, phaseScale));
+    
+    // the running sum of the increments gives the phases of the following samples
+    increments = _mm_add_epi32(increments, _mm_slli_si128(increments, 4));
+    increments = _mm_add_epi32(increments, _mm_slli_si128(increments, 8));
+    _mm_storeu_ps(output+i, getCosines(d->cosTable, _mm_add_epi32(base, _mm_slli_si128(increments, 4))));
+    base = _mm_add_epi32(base, _mm_shuffle_epi32(increments, 0xFF));
   }
-  #else
-  // TODO(mhroth):!!!
+  currentPhase = (unsigned int) _mm_cvtsi128_si32(base);
   #endif
+  for (; i < toIndex; i++) {
+    output[i] = d->getCosine(currentPhase);
+    currentPhase += d->getPhaseIncrement(input[i]);
+  }
+  d->phase = currentPhase;
 }
@@ -25,7 +25,11 @@
 
 #include "DspObject.h"
 
-/** [osc~], [osc~ float] */
+/**
+ * [osc~], [osc~ float]
+ * A cosine oscillator. The frequency is given by a signal at the left inlet, or by floats if no
+ * signal is connected. A float at the right inlet resets the phase, in cycles.
+ */
 class DspOsc : public DspObject {
   
   public:
@@ -40,20 +44,26 @@ class DspOsc : public DspObject {
   
   private:
     static void processScalar(DspObject *dspObject, int fromIndex, int toIndex);
+    static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
     void processMessage(int inletIndex, PdMessage *message);
-    void updateFrequency(float frequency);
   
-    float frequency; // frequency and phase are stored as integers because they are used
-    float sampleStep;
-    int phase;     // in for-loops to traverse the lookup table
+    /** Writes the output for a constant phase increment, from the current phase. */
+    void processConstant(unsigned int increment, int fromIndex, int toIndex);
+  
+    /** Returns the phase increment per sample for the given frequency. */
+    inline unsigned int getPhaseIncrement(float frequency);
+  
+    /** Returns the interpolated cosine of the given phase. */
+    inline float getCosine(unsigned int phase);
+  
+    float frequency; // the frequency if no signal is connected
+    float invSampleRate;
   
-    static float *cos_table; // the cosine lookup table
-    static int refCount; // a reference counter for cos_table. Now we know when to free it.
+    // The phase is a fixed point number of cycles with 32 fractional bits, such that it wraps
+    // around by itself. The upper bits index the cosine table, the lower ones interpolate it.
+    unsigned int phase;
   
-    #if __SSE3__
-    __m128i inc; // the amount by which to increment indicies every step
-    __m128i indicies; // the table lookup indicies
-    #endif
+    const float *cosTable; // the shared interpolated cosine table
 };
 
 #endif // _DSP_OSC_H_
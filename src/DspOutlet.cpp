@@ -37,7 +37,7 @@ DspOutlet::~DspOutlet() {
 }
 
 float *DspOutlet::getDspBufferAtOutlet(int outletIndex) {
-  return (dspBufferAtInlet[0] == NULL) ? graph->getBufferPool()->getZeroBuffer() : dspBufferAtInlet[0];
+  return (plannedDspBufferAtInlet[0] == NULL) ? graph->getBufferPool()->getZeroBuffer() : plannedDspBufferAtInlet[0];
 }
 
 void DspOutlet::setDspBufferAtInlet(float *buffer, unsigned int inletIndex) {
@@ -51,6 +51,6 @@ void DspOutlet::setDspBufferAtInlet(float *buffer, unsigned int inletIndex) {
   for (list<ObjectLetPair>::iterator it = dspConnections.begin(); it != dspConnections.end(); ++it) {
     ObjectLetPair letPair = *it;
     DspObject *dspObject = reinterpret_cast<DspObject *>(letPair.first);
-    dspObject->setDspBufferAtInlet(dspBufferAtInlet[0], letPair.second);
+    dspObject->setDspBufferAtInlet(plannedDspBufferAtInlet[0], letPair.second);
   }
 }
@@ -23,6 +23,7 @@
 #include "BufferPool.h"
 #include "DspReceive.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 MessageObject *DspReceive::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspReceive(initMessage, graph);
@@ -32,15 +33,20 @@ DspReceive::DspReceive(PdMessage *initMessage, PdGraph *graph) : DspObject(1, 0,
   if (initMessage->isSymbol(0)) {
     name = StaticUtils::copyString(initMessage->getSymbol(0));
     dspBufferAtOutlet[0] = ALLOC_ALIGNED_BUFFER(graph->getBlockSize() * sizeof(float));
+    memset(dspBufferAtOutlet[0], 0, graph->getBlockSize() * sizeof(float));
+    plannedDspBufferAtOutlet[0] = dspBufferAtOutlet[0];
   } else {
     name = NULL;
     graph->printErr("receive~ not initialised with a name.");
   }
   processFunction = &processSignal;
+  processFunctionNoMessage = &processSignal;
+  isBypassed = false;
   
   // this pointer contains the send buffer
   // default to zero buffer
   dspBufferAtInlet[0] = graph->getBufferPool()->getZeroBuffer();
+  plannedDspBufferAtInlet[0] = dspBufferAtInlet[0];
 }
 
 DspReceive::~DspReceive() {
@@ -49,11 +55,25 @@ DspReceive::~DspReceive() {
 }
 
 void DspReceive::processMessage(int inletIndex, PdMessage *message) {
-  if (message->hasFormat("ss") && message->isSymbol(0, "set")) {
+  if (message->hasFormat("ss") && message->isInternedSymbol(0, SymbolTable::SET)) {
     graph->printErr("[receive~ %s]: message \"set %s\" is not supported.", name, message->getSymbol(1));
   }
 }
 
+void DspReceive::setBypassed(bool isBypassed) {
+  this->isBypassed = isBypassed;
+}
+
+void DspReceive::commitDspState() {
+  DspObject::commitDspState();
+  processFunction = isBypassed ? &processNone : &processSignal;
+  processFunctionNoMessage = processFunction;
+}
+
+void DspReceive::processNone(DspObject *dspObject, int fromIndex, int toIndex) {
+  // nothing to do, the connected objects read the send~ buffer directly
+}
+
 void DspReceive::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
   DspReceive *d = reinterpret_cast<DspReceive *>(dspObject);
   memcpy(d->dspBufferAtOutlet[0], d->dspBufferAtInlet[0], toIndex*sizeof(float));
@@ -42,10 +42,20 @@ class DspReceive : public DspObject {
   
     bool canSetBufferAtOutlet(unsigned int outletIndex) { return false; }
   
+    /**
+     * Sets whether the objects connected to the outlet read the input of the associated
+     * <code>send~</code> directly. The outlet buffer is then not written anymore.
+     */
+    void setBypassed(bool isBypassed);
+  
+    void commitDspState();
+  
   private:
+    static void processNone(DspObject *dspObject, int fromIndex, int toIndex);
     static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
   
     char *name;
+    bool isBypassed;
 };
 
 #endif // _DSP_RECEIVE_H_
@@ -20,52 +20,36 @@
  *
  */
 
-#include "ArrayArithmetic.h"
-#include "BufferPool.h"
 #include "DspRfft.h"
+#include "PdContext.h"
 #include "PdGraph.h"
+#include "RealFft.h"
 
 MessageObject *DspRfft::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspRfft(initMessage, graph);
 }
 
 DspRfft::DspRfft(PdMessage *initMessage, PdGraph *graph) : DspObject(0, 1, 0, 2, graph) {
-  #if __APPLE__
-  log2n = lrintf(log2f((float) blockSizeInt));
-  fftSetup = vDSP_create_fftsetup(log2n, kFFTRadix2);
-  zeroBuffer = graph->getBufferPool()->getZeroBuffer(); // cache the local zero buffer
-  #else
-  graph->printErr("[rfft~] is not supported on this platform. It is only supported on Apple OS X and iOS platforms.");
-  #endif // __APPLE__
-  
-  processFunction = &processSignal;
+  realFft = graph->getContext()->getRealFft(blockSizeInt);
+  if (realFft != NULL) {
+    processFunction = &processSignal;
+  } else {
+    graph->printErr("[rfft~] requires the block size to be a power of two.");
+    processFunction = &processNone;
+  }
 }
 
 DspRfft::~DspRfft() {
-  #if __APPLE__
-  vDSP_destroy_fftsetup(fftSetup);
-  #endif // __APPLE__
+  // nothing to do, the fft plan belongs to the context
 }
 
 void DspRfft::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
   DspRfft *d = reinterpret_cast<DspRfft *>(dspObject);
-  
-  #if __APPLE__
-  DSPSplitComplex inputVector;
-  inputVector.realp = d->dspBufferAtInlet[0];
-  inputVector.imagp = d->zeroBuffer;
-  DSPSplitComplex outputVector;
-  outputVector.realp = d->dspBufferAtOutlet[0];
-  outputVector.imagp = d->dspBufferAtOutlet[1];
-  vDSP_fft_zop(d->fftSetup, &inputVector, 1, &outputVector, 1, d->log2n, kFFTDirection_Forward);
-  
-  // NOTE(mhroth): vDSP_fft_zop outputs the entire series of symmetric coefficients.
-  // Pd only returns the unique values. The below code makes this object output values in the same
-  // way that Pd does. But since the Apple fft and ifft functions require the symmetric values,
-  // we leave it like this for now.
-  
-  //int halfBlockSize = blockSizeInt >> 1;
-  //memset(dspBufferAtOutlet0+halfBlockSize+1, 0, (halfBlockSize-1) * sizeof(float));
-  //memset(dspBufferAtOutlet[1]+halfBlockSize, 0, halfBlockSize * sizeof(float));
-  #endif // __APPLE__
+  d->realFft->forward(d->dspBufferAtInlet[0], d->dspBufferAtOutlet[0], d->dspBufferAtOutlet[1]);
+}
+
+void DspRfft::processNone(DspObject *dspObject, int fromIndex, int toIndex) {
+  DspRfft *d = reinterpret_cast<DspRfft *>(dspObject);
+  memset(d->dspBufferAtOutlet[0], 0, d->blockSizeInt * sizeof(float));
+  memset(d->dspBufferAtOutlet[1], 0, d->blockSizeInt * sizeof(float));
 }
@@ -23,9 +23,10 @@
 #ifndef _DSP_RFFT_H_
 #define _DSP_RFFT_H_
 
-#include "ArrayArithmetic.h"
 #include "DspObject.h"
 
+class RealFft;
+
 /** [rfft~] */
 class DspRfft : public DspObject {
   
@@ -38,13 +39,10 @@ class DspRfft : public DspObject {
   
   private:
     static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
+    static void processNone(DspObject *dspObject, int fromIndex, int toIndex);
   
-    #if __APPLE__
-    vDSP_Length log2n;
-    FFTSetup fftSetup;
-    float *zeroBuffer;
-    #endif // __APPLE__
-  
+    /** The fft plan of the block size, shared with the context. */
+    RealFft *realFft;
 };
 
 #endif // _DSP_RFFT_H_
@@ -20,41 +20,42 @@
  *
  */
 
-#include "ArrayArithmetic.h"
 #include "DspRifft.h"
+#include "PdContext.h"
 #include "PdGraph.h"
+#include "RealFft.h"
 
 MessageObject *DspRifft::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspRifft(initMessage, graph);
 }
 
 DspRifft::DspRifft(PdMessage *initMessage, PdGraph *graph) : DspObject(0, 2, 0, 1, graph) {
-  #if __APPLE__
-  log2n = lrintf(log2f((float) blockSizeInt));
-  fftSetup = vDSP_create_fftsetup(log2n, kFFTRadix2);
-  #else
-  graph->printErr("[rifft~] is not supported on this platform. It is only supported on Apple OS X and iOS platforms.");
-  #endif // __APPLE__
+  realFft = graph->getContext()->getRealFft(blockSizeInt);
+  if (realFft != NULL) {
+    fftBuffer = ALLOC_ALIGNED_BUFFER(blockSizeInt * sizeof(float));
+    processFunction = &processSignal;
+  } else {
+    graph->printErr("[rifft~] requires the block size to be a power of two.");
+    fftBuffer = NULL;
+    processFunction = &processNone;
+  }
 }
 
 DspRifft::~DspRifft() {
-  #if __APPLE__
-  vDSP_destroy_fftsetup(fftSetup);
-  #endif // __APPLE__
+  if (fftBuffer != NULL) FREE_ALIGNED_BUFFER(fftBuffer);
 }
 
 const char *DspRifft::getObjectLabel() {
   return "rifft~";
 }
 
-void DspRifft::processDspWithIndex(int fromIndex, int toIndex) {
-  #if __APPLE__
-  DSPSplitComplex inputVector;
-  inputVector.realp = dspBufferAtInlet[0];
-  inputVector.imagp = dspBufferAtInlet[1];
-  DSPSplitComplex outputVector;
-  outputVector.realp = dspBufferAtOutlet[0];
-  outputVector.imagp = (float *) alloca(blockSizeInt*sizeof(float)); // this buffer will not contain any useful data
-  vDSP_fft_zop(fftSetup, &inputVector, 1, &outputVector, 1, log2n, kFFTDirection_Inverse);
-  #endif // __APPLE__
+void DspRifft::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
+  DspRifft *d = reinterpret_cast<DspRifft *>(dspObject);
+  d->realFft->inverse(d->dspBufferAtInlet[0], d->dspBufferAtInlet[1], d->dspBufferAtOutlet[0],
+      d->fftBuffer);
+}
+
+void DspRifft::processNone(DspObject *dspObject, int fromIndex, int toIndex) {
+  DspRifft *d = reinterpret_cast<DspRifft *>(dspObject);
+  memset(d->dspBufferAtOutlet[0], 0, d->blockSizeInt * sizeof(float));
 }
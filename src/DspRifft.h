@@ -23,9 +23,10 @@
 #ifndef _DSP_RIFFT_H_
 #define _DSP_RIFFT_H_
 
-#include "ArrayArithmetic.h"
 #include "DspObject.h"
 
+class RealFft;
+
 /** [rifft~] */
 class DspRifft : public DspObject {
   
@@ -37,13 +38,14 @@ class DspRifft : public DspObject {
     static const char *getObjectLabel();
     
   private:
-    void processDspWithIndex(int fromIndex, int toIndex);
-    
-    #if __APPLE__
-    vDSP_Length log2n;
-    FFTSetup fftSetup;
-    #endif // __APPLE__
+    static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
+    static void processNone(DspObject *dspObject, int fromIndex, int toIndex);
+  
+    /** The fft plan of the block size, shared with the context. */
+    RealFft *realFft;
   
+    /** The working memory of the inverse transform. */
+    float *fftBuffer;
 };
 
 #endif // _DSP_RIFFT_H_
@@ -31,11 +31,15 @@ DspSend::DspSend(PdMessage *initMessage, PdGraph *graph) : DspObject(0, 1, 0, 0,
   if (initMessage->isSymbol(0)) {
     name = StaticUtils::copyString(initMessage->getSymbol(0));
     dspBufferAtOutlet[0] = ALLOC_ALIGNED_BUFFER(graph->getBlockSize()*sizeof(float));
+    memset(dspBufferAtOutlet[0], 0, graph->getBlockSize()*sizeof(float));
+    plannedDspBufferAtOutlet[0] = dspBufferAtOutlet[0];
   } else {
     name = NULL;
     graph->printErr("send~ not initialised with a name.");
   }
-  processFunction = &processSignal;
+  numReceivers = 0;
+  numBypassedReceivers = 0;
+  processFunction = &processNone;
 }
 
 DspSend::~DspSend() {
@@ -43,14 +47,28 @@ DspSend::~DspSend() {
   FREE_ALIGNED_BUFFER(dspBufferAtOutlet[0]);
 }
 
+void DspSend::setNumReceivers(int numReceivers) {
+  this->numReceivers = numReceivers;
+}
+
+void DspSend::setNumBypassedReceivers(int numBypassedReceivers) {
+  this->numBypassedReceivers = numBypassedReceivers;
+}
+
+void DspSend::commitDspState() {
+  DspObject::commitDspState();
+  processFunction = (numReceivers > numBypassedReceivers) ? &processSignal : &processNone;
+}
+
+void DspSend::processNone(DspObject *dspObject, int fromIndex, int toIndex) {
+  // nothing to do, all receive~s read the input directly
+}
+
 /*
- * It would be very nice to not have to use memcpys with send~ and receive~, but unfortunately
- * things become very complicated very quickly. If s~ is already in an attached graph, then
- * everything works out fine. If s~ does not yet exist, then it is also easy for r~ to use the
- * zero buffer as its output. Ideally, we'd like to remove s~ and r~ entirely from the dsp graph
- * and all objects receiving from r~ to simply refer to the buffer at s~. But for that we'd need
- * to make sure that the s~ buffer is accordingly retained and not reused before all r~ receivers
- * have had a chance to use it.
+ * If s~ is processed before its r~s in the same root graph, the objects receiving from r~ simply
+ * refer to the input buffer of s~ (see PdGraph::resolveDspReceives()), which is then retained until
+ * all of them have been processed. The input is only copied for the remaining r~s, i.e. those in
+ * other graphs or processed before s~.
  */
 void DspSend::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
   // make a defensive copy of the input in case the buffer is reused before all receives
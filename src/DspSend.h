@@ -37,11 +37,26 @@ class DspSend : public DspObject {
     static const char *getObjectLabel() { return "send~"; }
     string toString() { return string(getObjectLabel()) + " " + string(name); }
     ObjectType getObjectType() { return DSP_SEND; }
+  
+    /** Sets the number of <code>receive~</code> objects registered with the same name. */
+    void setNumReceivers(int numReceivers);
+  
+    /**
+     * Sets the number of <code>receive~</code>s whose outlets have been connected directly to the
+     * input of this object. The input is only copied if some <code>receive~</code> is not.
+     */
+    void setNumBypassedReceivers(int numBypassedReceivers);
+  
+    /** The input is only copied from the next block on if some <code>receive~</code> is not bypassed. */
+    void commitDspState();
     
   private:
+    static void processNone(DspObject *dspObject, int fromIndex, int toIndex);
     static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
   
     char *name;
+    int numReceivers;
+    int numBypassedReceivers;
 };
 
 #endif // _DSP_SEND_H_
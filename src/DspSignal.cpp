@@ -52,5 +52,5 @@ void DspSignal::processMessage(int inletIndex, PdMessage *message) {
 
 void DspSignal::processScalar(DspObject *dspObject, int fromIndex, int toIndex) {
   DspSignal *d = reinterpret_cast<DspSignal *>(dspObject);
-  ArrayArithmetic::fill(d->dspBufferAtOutlet[0], d->constant, fromIndex, toIndex);
+  d->fillConstantAtOutlet(d->constant, 0, fromIndex, toIndex);
 }
@@ -35,8 +35,11 @@ class DspSnapshot : public DspObject {
     
     static const char *getObjectLabel() { return "snapshot~"; }
     string toString() { return string(getObjectLabel()); }
+    ObjectType getObjectType() { return DSP_SNAPSHOT; }
     
     ConnectionType getConnectionType(int outletIndex);
+  
+    bool doesSendMessages() { return true; }
     
   private:
     static void processNull(DspObject *dspObject, int fromIndex, int toIndex);
@@ -36,6 +36,7 @@ class DspSqrt : public DspObject {
     
     static const char *getObjectLabel() { return "sqrt~"; }
     string toString() { return string(getObjectLabel()); }
+    bool canProcessInPlace() { return true; }
   
   private:
     static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
@@ -31,6 +31,7 @@ MessageObject *DspSubtract::newObject(PdMessage *initMessage, PdGraph *graph) {
 
 DspSubtract::DspSubtract(PdMessage *initMessage, PdGraph *graph) : DspObject(2, 2, 0, 1, graph) {
   constant = initMessage->isFloat(0) ? initMessage->getFloat(0) : 0.0f;
+  processFunction = &processScalar;
   processFunctionNoMessage = &processScalar;
 }
 
@@ -58,12 +59,26 @@ void DspSubtract::processMessage(int inletIndex, PdMessage *message) {
 
 void DspSubtract::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
   DspSubtract *d = reinterpret_cast<DspSubtract *>(dspObject);
-  ArrayArithmetic::subtract(d->dspBufferAtInlet[0], d->dspBufferAtInlet[1],
-      d->dspBufferAtOutlet[0], 0, toIndex);
+  if (d->isConstantAtInlet(0) && d->isConstantAtInlet(1)) {
+    d->fillConstantAtOutlet(d->getConstantAtInlet(0) - d->getConstantAtInlet(1), 0, fromIndex, toIndex);
+  } else if (d->isConstantAtInlet(1)) {
+    ArrayArithmetic::subtract(d->dspBufferAtInlet[0], d->getConstantAtInlet(1),
+        d->dspBufferAtOutlet[0], 0, toIndex);
+    d->clearConstantAtOutlet(0);
+  } else {
+    ArrayArithmetic::subtract(d->dspBufferAtInlet[0], d->dspBufferAtInlet[1],
+        d->dspBufferAtOutlet[0], 0, toIndex);
+    d->clearConstantAtOutlet(0);
+  }
 }
 
 void DspSubtract::processScalar(DspObject *dspObject, int fromIndex, int toIndex) {
   DspSubtract *d = reinterpret_cast<DspSubtract *>(dspObject);
-  ArrayArithmetic::subtract(d->dspBufferAtInlet[0], d->constant,
-      d->dspBufferAtOutlet[0], fromIndex, toIndex);
+  if (d->isConstantAtInlet(0)) {
+    d->fillConstantAtOutlet(d->getConstantAtInlet(0) - d->constant, 0, fromIndex, toIndex);
+  } else {
+    ArrayArithmetic::subtract(d->dspBufferAtInlet[0], d->constant,
+        d->dspBufferAtOutlet[0], fromIndex, toIndex);
+    d->clearConstantAtOutlet(0);
+  }
 }
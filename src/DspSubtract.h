@@ -34,6 +34,7 @@ class DspSubtract : public DspObject {
 
     static const char *getObjectLabel() { return "-~"; }
     string toString();
+    bool canProcessInPlace() { return true; }
   
     void onInletConnectionUpdate(unsigned int inletIndex);
 
@@ -23,6 +23,7 @@
 #include "DspTablePlay.h"
 #include "MessageTable.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 MessageObject *DspTablePlay::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspTablePlay(initMessage, graph);
@@ -75,7 +76,7 @@ void DspTablePlay::processMessage(int inletIndex, PdMessage *message) {
       break;
     }
     case SYMBOL: {
-      if (message->isSymbol(0, "set") && message->isSymbol(1)) {
+      if (message->isInternedSymbol(0, SymbolTable::SET) && message->isSymbol(1)) {
         table = graph->getTable(message->getSymbol(1));
       }
       break;
@@ -39,6 +39,8 @@ class DspTablePlay : public DspObject, public TableReceiverInterface {
   
     ConnectionType getConnectionType(int outletIndex);
   
+    bool doesScheduleMessages() { return true; }
+  
     void sendMessage(int outletIndex, PdMessage *message);
   
     char *getName();
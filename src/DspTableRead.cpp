@@ -23,6 +23,7 @@
 #include "ArrayArithmetic.h"
 #include "DspTableRead.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 MessageObject *DspTableRead::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspTableRead(initMessage, graph);
@@ -57,7 +58,7 @@ void DspTableRead::setTable(MessageTable *aTable) {
 void DspTableRead::processMessage(int inletIndex, PdMessage *message) {
   switch (inletIndex) {
     case 0: {
-      if (message->isSymbol(0, "set") && message->isSymbol(1)) {
+      if (message->isInternedSymbol(0, SymbolTable::SET) && message->isSymbol(1)) {
         // change the table from which this object reads
         free(name);
         name = StaticUtils::copyString(message->getSymbol(1));
@@ -23,6 +23,11 @@
 #include "ArrayArithmetic.h"
 #include "DspTableRead4.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
 
 MessageObject *DspTableRead4::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspTableRead4(initMessage, graph);
@@ -32,6 +37,8 @@ DspTableRead4::DspTableRead4(PdMessage *initMessage, PdGraph *graph) : DspObject
   name = initMessage->isSymbol(0) ? StaticUtils::copyString(initMessage->getSymbol(0)) : NULL;
   table = NULL;
   offset = 0.0f;
+  processFunction = &processSignal;
+  processFunctionNoMessage = &processSignal;
 }
 
 DspTableRead4::~DspTableRead4() {
@@ -57,7 +64,7 @@ void DspTableRead4::setTable(MessageTable *aTable) {
 void DspTableRead4::processMessage(int inletIndex, PdMessage *message) {
   switch (inletIndex) {
     case 0: {
-      if (message->isSymbol(0, "set") && message->isSymbol(1)) {
+      if (message->isInternedSymbol(0, SymbolTable::SET) && message->isSymbol(1)) {
         // change the table from which this object reads
         free(name);
         name = StaticUtils::copyString(message->getSymbol(1));
@@ -77,40 +84,82 @@ void DspTableRead4::processMessage(int inletIndex, PdMessage *message) {
   }
 }
 
-void DspTableRead4::processDspWithIndex(int fromIndex, int toIndex) {
-  if (table != NULL) { // ensure that there is a table to read from!
-    int bufferLength = 0;
-    float *buffer = table->getBuffer(&bufferLength);
-    #if __APPLE__
-    //float zero = 0.0f;
-    //float bufferLengthFloat = (float) (bufferLength-2);
-    //vDSP_vclip(inputBuffer+startSampleIndex, 1, &zero, &bufferLengthFloat,
-    //    inputBuffer+startSampleIndex, 1, endSampleIndex-startSampleIndex);
-    // NOTE(mhroth): is isn't clear what the clipping behaviour of vDSP_vlint is, but I
-    // *think* that it is doing the right thing (i.e., clipping OOB indicies)
-    int duration = toIndex - fromIndex;
-    vDSP_vsadd(dspBufferAtInlet[0]+fromIndex, 1, &offset, dspBufferAtOutlet[0]+fromIndex, 1, duration);
-    vDSP_vlint(buffer, dspBufferAtOutlet[0]+fromIndex, 1, dspBufferAtOutlet[0]+fromIndex, 1,
-        duration, bufferLength);
-    #else
-    float *inputBuffer = dspBufferAtInlet[0];
-    int maxIndex = bufferLength-1;
-    for (int i = fromIndex; i < toIndex; i++) {
-      float xf = inputBuffer[i] + offset;
-      int xi = (int) xf;
-      if (xi <= 0) {
-        dspBufferAtOutlet[0][i] = buffer[0];
-      } else if (xi >= maxIndex) {
-        dspBufferAtOutlet[0][i] = buffer[maxIndex];
-      } else {
-        // 2-point linear interpolation (basic and fast)
-        float dx = xf - ((float) xi);
-        float y0 = buffer[xi];
-        float y1 = buffer[xi+1];
-        float slope = (y1 - y0);
-        dspBufferAtOutlet[0][i] = (slope * dx) + y0;
-      }
-    }
-    #endif
+/**
+ * Reads the table at the given index with the 4-point interpolation of Pd. Like in Pd, the index is
+ * clipped to [1, maxIndex+1], such that all four points lie in the table.
+ */
+static inline float readTable4(const float *buffer, int maxIndex, float x) {
+  float maxIndexFloat = (float) maxIndex;
+  x = (x > 1.0f) ? x : 1.0f;
+  x = (x < maxIndexFloat + 1.0f) ? x : (maxIndexFloat + 1.0f);
+  int index = (int) ((x < maxIndexFloat) ? x : maxIndexFloat);
+  float frac = x - (float) index;
+  
+  float a = buffer[index-1];
+  float b = buffer[index];
+  float c = buffer[index+1];
+  float d = buffer[index+2];
+  float cMinusB = c - b;
+  float t1 = (d - a) - 3.0f * cMinusB;
+  float t2 = (d + (a + a)) - 3.0f * b;
+  return b + frac * (cMinusB - (0.1666667f * (1.0f - frac)) * (t1 * frac + t2));
+}
+
+void DspTableRead4::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
+  DspTableRead4 *d = reinterpret_cast<DspTableRead4 *>(dspObject);
+  
+  int bufferLength = 0;
+  float *buffer = (d->table != NULL) ? d->table->getBuffer(&bufferLength) : NULL;
+  int maxIndex = bufferLength - 3;
+  if (maxIndex < 1) {
+    // there is no table, or it is too short to interpolate in
+    d->fillConstantAtOutlet(0.0f, 0, fromIndex, toIndex);
+    return;
+  }
+  
+  if (d->isConstantAtInlet(0)) {
+    d->fillConstantAtOutlet(readTable4(buffer, maxIndex, d->getConstantAtInlet(0) + d->offset), 0,
+        fromIndex, toIndex);
+    return;
+  }
+  d->clearConstantAtOutlet(0);
+  
+  float *input = d->dspBufferAtInlet[0];
+  float *output = d->dspBufferAtOutlet[0];
+  int i = fromIndex;
+  
+  #if __SSE2__
+  const __m128 offsetV = _mm_set1_ps(d->offset);
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 three = _mm_set1_ps(3.0f);
+  const __m128 maxIndexV = _mm_set1_ps((float) maxIndex);
+  const __m128 upperV = _mm_add_ps(maxIndexV, one);
+  int indices[4];
+  for (int n = toIndex - 4; i <= n; i += 4) {
+    __m128 x = _mm_add_ps(_mm_loadu_ps(input+i), offsetV);
+    x = _mm_min_ps(_mm_max_ps(x, one), upperV);
+    __m128i index = _mm_cvttps_epi32(_mm_min_ps(x, maxIndexV));
+    __m128 frac = _mm_sub_ps(x, _mm_cvtepi32_ps(index));
+    
+    // the four points of each index are adjacent. They are loaded together and transposed, such
+    // that a holds the first point of every index, b the second, and so on.
+    _mm_storeu_si128((__m128i *) indices, index);
+    __m128 a = _mm_loadu_ps(buffer + indices[0] - 1);
+    __m128 b = _mm_loadu_ps(buffer + indices[1] - 1);
+    __m128 c = _mm_loadu_ps(buffer + indices[2] - 1);
+    __m128 e = _mm_loadu_ps(buffer + indices[3] - 1);
+    _MM_TRANSPOSE4_PS(a, b, c, e);
+    
+    __m128 cMinusB = _mm_sub_ps(c, b);
+    __m128 t1 = _mm_sub_ps(_mm_sub_ps(e, a), _mm_mul_ps(three, cMinusB));
+    __m128 t2 = _mm_sub_ps(_mm_add_ps(e, _mm_add_ps(a, a)), _mm_mul_ps(three, b));
+    __m128 t3 = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.1666667f), _mm_sub_ps(one, frac)),
+        _mm_add_ps(_mm_mul_ps(t1, frac), t2));
+    _mm_storeu_ps(output+i, _mm_add_ps(b, _mm_mul_ps(frac, _mm_sub_ps(cMinusB, t3))));
+  }
+  #endif
+  
+  for (; i < toIndex; i++) {
+    output[i] = readTable4(buffer, maxIndex, input[i] + d->offset);
   }
 }
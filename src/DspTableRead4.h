@@ -44,8 +44,8 @@ class DspTableRead4 : public DspObject, public TableReceiverInterface {
     void setTable(MessageTable *table);
   
   private:
+    static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
     void processMessage(int inletIndex, PdMessage *message);
-    void processDspWithIndex(int fromIndex, int toIndex);
   
     float offset;
     char *name;
@@ -20,8 +20,11 @@
  *
  */
 
+#include "ArrayArithmetic.h"
+#include "DspCatch.h"
 #include "DspThrow.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 MessageObject *DspThrow::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspThrow(initMessage, graph);
@@ -30,27 +33,42 @@ MessageObject *DspThrow::newObject(PdMessage *initMessage, PdGraph *graph) {
 DspThrow::DspThrow(PdMessage *initMessage, PdGraph *graph) : DspObject(0, 1, 0, 0, graph) {
   if (initMessage->isSymbol(0)) {
     name = StaticUtils::copyString(initMessage->getSymbol(0));
-    buffer = ALLOC_ALIGNED_BUFFER(graph->getBlockSize() * sizeof(float));
   } else {
     name = NULL;
-    buffer = NULL;
     graph->printErr("throw~ may not be initialised without a name. \"set\" message not supported.");
   }
-  processFunction = &processSignal;
+  dspCatch = NULL;
+  liveDspCatch = NULL;
+  processFunction = &processNone;
 }
 
 DspThrow::~DspThrow() {
-  FREE_ALIGNED_BUFFER(buffer);
   free(name);
 }
 
+void DspThrow::setDspCatch(DspCatch *dspCatch) {
+  this->dspCatch = dspCatch;
+}
+
+void DspThrow::commitDspState() {
+  DspObject::commitDspState();
+  liveDspCatch = dspCatch;
+  processFunction = (liveDspCatch == NULL) ? &processNone : &processSignal;
+}
+
 void DspThrow::processMessage(int inletIndex, PdMessage *message) {
-  if (inletIndex == 0 && message->isSymbol(0, "set") && message->isSymbol(1)) {
+  if (inletIndex == 0 && message->isInternedSymbol(0, SymbolTable::SET) && message->isSymbol(1)) {
     graph->printErr("throw~ does not support the \"set\" message.");
   }
 }
 
+void DspThrow::processNone(DspObject *dspObject, int fromIndex, int toIndex) {
+  // nothing to do, there is no catch~ to throw to
+}
+
 void DspThrow::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
+  // accumulate directly into the catch~ buffer, which the catch~ clears once it has been read
   DspThrow *d = reinterpret_cast<DspThrow *>(dspObject);
-  memcpy(d->buffer, d->dspBufferAtInlet[0], toIndex*sizeof(float));
+  float *buffer = d->liveDspCatch->getBuffer();
+  ArrayArithmetic::add(buffer, d->dspBufferAtInlet[0], buffer, 0, toIndex);
 }
@@ -38,7 +38,9 @@ class DspThrow : public DspObject {
     DspThrow(PdMessage *initMessage, PdGraph *graph);
     ~DspThrow();
     
-    float *getBuffer() { return buffer; }
+    /** Sets the <code>catch~</code> into whose buffer this object accumulates its input. May be <code>NULL</code>. */
+    void setDspCatch(DspCatch *dspCatch);
+    DspCatch *getDspCatch() { return dspCatch; }
   
     const char *getName() { return name; }
     static const char *getObjectLabel() { return "throw~"; }
@@ -46,12 +48,19 @@ class DspThrow : public DspObject {
     ObjectType getObjectType() { return DSP_THROW; }
 
     void processMessage(int inletIndex, PdMessage *message);
+  
+    /** The input is accumulated into the buffer of the <code>catch~</code> from the next block on. */
+    void commitDspState();
     
   private:
+    static void processNone(DspObject *dspObject, int fromIndex, int toIndex);
     static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
   
     char *name;
-    float *buffer;
+    DspCatch *dspCatch;
+  
+    /** The <code>catch~</code> into which the input is accumulated while processing. */
+    DspCatch *liveDspCatch;
 };
 
 #endif // _DSP_THROW_H_
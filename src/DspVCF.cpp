@@ -23,70 +23,223 @@
 #include "ArrayArithmetic.h"
 #include "DspVCF.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+// the number of samples for which the coefficients are computed at once, before they are applied
+#define VCF_CHUNK_SIZE 64
+
+// 2^23, above which every float is an integer. Normalised center frequencies are clamped to it,
+// such that they can be rounded through an int.
+#define MAX_NORMALISED_FREQUENCY 8388608.0f
+
+// the state of the filter is reset if it leaves this range, as in Pd. This avoids denormals
+// while the filter decays, and recovers the filter after an infinite or NaN input.
+#define MIN_STATE 1e-20f
+#define MAX_STATE 1e20f
+
+#define TWO_PI 6.28318530717958647692f
+
+// Taylor coefficients of sin(t) and cos(t). For |t| <= pi/2 the truncation errors are below
+// 6e-8 and 7e-9 respectively, i.e. close to float precision.
+#define SIN_3 (-1.0f/6.0f)
+#define SIN_5 (1.0f/120.0f)
+#define SIN_7 (-1.0f/5040.0f)
+#define SIN_9 (1.0f/362880.0f)
+#define SIN_11 (-1.0f/39916800.0f)
+#define COS_2 (-1.0f/2.0f)
+#define COS_4 (1.0f/24.0f)
+#define COS_6 (-1.0f/720.0f)
+#define COS_8 (1.0f/40320.0f)
+#define COS_10 (-1.0f/3628800.0f)
+#define COS_12 (1.0f/479001600.0f)
 
 MessageObject *DspVCF::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspVCF(initMessage, graph);
 }
 
-DspVCF::DspVCF(PdMessage *initMessage, PdGraph *graph) : DspObject(3, 3, 0, 2, graph) {
-  sampleRate = graph->getSampleRate();
-  calculateFilterCoefficients(this->sampleRate/2.0f, 1.0f); // initialise the filter completely open
-  tap_0 = tap_1 = 0.0f;
+DspVCF::DspVCF(PdMessage *initMessage, PdGraph *graph) : DspObject(3, 2, 0, 2, graph) {
+  invSampleRate = 1.0f / graph->getSampleRate();
+  centerFrequency = 0.0f;
+  isFrequencyConnected = false;
+  setQ(initMessage->isFloat(0) ? initMessage->getFloat(0) : 0.0f);
+  re = im = 0.0f;
+  
+  processFunction = &processSignal;
+  processFunctionNoMessage = &processSignal;
 }
 
 DspVCF::~DspVCF() {
   // nothing to do
 }
 
+void DspVCF::onInletConnectionUpdate(unsigned int inletIndex) {
+  isFrequencyConnected = !incomingDspConnections[1].empty();
+}
+
 const char *DspVCF::getObjectLabel() {
   return "vcf~";
 }
 
-void DspVCF::calculateFilterCoefficients(float f, float q) {
-  float r, oneminusr, omega;
-  if (f < 0.001f) f = 10.0f;
-  if (q < 0.0f) q = 0.0f;
-  this->centerFrequency = f;
-  this->q = q;
-  omega = f * (2.0f * M_PI) / sampleRate;
-  if (q < 0.001) oneminusr = 1.0f;
-  else oneminusr = omega/q;
-  if (oneminusr > 1.0f) oneminusr = 1.0f;
-  r = 1.0f - oneminusr;
-  coef1 = 2.0f * sigbp_qcos(omega) * r;
-  coef2 = - r * r;
-  gain = 2 * oneminusr * (oneminusr + r * omega);
+string DspVCF::toString() {
+  char str[snprintf(NULL, 0, "%s %g", getObjectLabel(), q)+1];
+  snprintf(str, sizeof(str), "%s %g", getObjectLabel(), q);
+  return string(str);
 }
 
-float DspVCF::sigbp_qcos(float f) {
-  if (f >= -(0.5f * M_PI) && f <= (0.5f * M_PI)) {
-    float g = f*f;
-    return (((g*g*g * (-1.0f/720.0f) + g*g*(1.0f/24.0f)) - g*0.5) + 1);
-  } else {
-    return 0.0f;
+void DspVCF::setQ(float q) {
+  this->q = (q < 0.0f) ? 0.0f : q;
+  rOne = (this->q > 0.0f) ? 1.0f : 0.0f;
+  qinv = (this->q > 0.0f) ? TWO_PI / this->q : 0.0f;
+  ampCorrect = 2.0f - 2.0f / (this->q + 2.0f);
+}
+
+/*
+ * The pole of the filter is r*e^(i*w), where w is the center frequency in radians per sample and
+ * the radius r = 1 - w/q shrinks towards higher frequencies. With the normalised frequency p in
+ * cycles per sample, w = 2*pi*p. The distance d of p to the nearest integer is in [-1/2, 1/2], and
+ * with a = |d| - 1/4 in [-1/4, 1/4] it is cos(w) = -sin(2*pi*a) and sin(w) = sign(d)*cos(2*pi*a).
+ * Both only need to be approximated for arguments up to pi/2 in magnitude.
+ */
+inline void DspVCF::calcFiltCoeff(float f, float *coefr, float *coefi, float *gain) {
+  float p = f * invSampleRate;
+  p = (p > 0.0f) ? p : 0.0f;
+  p = (p < MAX_NORMALISED_FREQUENCY) ? p : MAX_NORMALISED_FREQUENCY;
+  float r = rOne - p * qinv;
+  r = (r > 0.0f) ? r : 0.0f;
+  *gain = ampCorrect * (1.0f - r);
+  
+  float d = p - (float) ((int) (p + 0.5f));
+  float t = (fabsf(d) - 0.25f) * TWO_PI;
+  float t2 = t * t;
+  float sint = t * (1.0f + t2 * (SIN_3 + t2 * (SIN_5 + t2 * (SIN_7 + t2 * (SIN_9 + t2 * SIN_11)))));
+  float cost = 1.0f + t2 * (COS_2 + t2 * (COS_4 + t2 * (COS_6 + t2 * (COS_8 + t2 * (COS_10 + t2 * COS_12)))));
+  *coefr = r * -sint;
+  *coefi = r * copysignf(cost, d);
+}
+
+void DspVCF::calcFiltCoeffs(float *f, float *coefr, float *coefi, float *gain, int n) {
+  int i = 0;
+  #if __SSE2__
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 quarter = _mm_set1_ps(0.25f);
+  const __m128 twoPi = _mm_set1_ps(TWO_PI);
+  const __m128 maxFrequency = _mm_set1_ps(MAX_NORMALISED_FREQUENCY);
+  const __m128 invSampleRateVec = _mm_set1_ps(invSampleRate);
+  const __m128 rOneVec = _mm_set1_ps(rOne);
+  const __m128 qinvVec = _mm_set1_ps(qinv);
+  const __m128 ampCorrectVec = _mm_set1_ps(ampCorrect);
+  for (int n4 = n - 4; i <= n4; i += 4) {
+    // the same operations as calcFiltCoeff(), in the same order
+    __m128 p = _mm_mul_ps(_mm_loadu_ps(f+i), invSampleRateVec);
+    p = _mm_max_ps(p, zero);
+    p = _mm_min_ps(p, maxFrequency);
+    __m128 r = _mm_max_ps(_mm_sub_ps(rOneVec, _mm_mul_ps(p, qinvVec)), zero);
+    _mm_storeu_ps(gain+i, _mm_mul_ps(ampCorrectVec, _mm_sub_ps(one, r)));
+    
+    __m128 d = _mm_sub_ps(p, _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_add_ps(p, half))));
+    __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_andnot_ps(signMask, d), quarter), twoPi);
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 sint = _mm_add_ps(_mm_set1_ps(SIN_9), _mm_mul_ps(t2, _mm_set1_ps(SIN_11)));
+    sint = _mm_add_ps(_mm_set1_ps(SIN_7), _mm_mul_ps(t2, sint));
+    sint = _mm_add_ps(_mm_set1_ps(SIN_5), _mm_mul_ps(t2, sint));
+    sint = _mm_add_ps(_mm_set1_ps(SIN_3), _mm_mul_ps(t2, sint));
+    sint = _mm_mul_ps(t, _mm_add_ps(one, _mm_mul_ps(t2, sint)));
+    __m128 cost = _mm_add_ps(_mm_set1_ps(COS_10), _mm_mul_ps(t2, _mm_set1_ps(COS_12)));
+    cost = _mm_add_ps(_mm_set1_ps(COS_8), _mm_mul_ps(t2, cost));
+    cost = _mm_add_ps(_mm_set1_ps(COS_6), _mm_mul_ps(t2, cost));
+    cost = _mm_add_ps(_mm_set1_ps(COS_4), _mm_mul_ps(t2, cost));
+    cost = _mm_add_ps(_mm_set1_ps(COS_2), _mm_mul_ps(t2, cost));
+    cost = _mm_add_ps(one, _mm_mul_ps(t2, cost));
+    cost = _mm_or_ps(_mm_andnot_ps(signMask, cost), _mm_and_ps(signMask, d));
+    _mm_storeu_ps(coefr+i, _mm_mul_ps(r, _mm_xor_ps(sint, signMask)));
+    _mm_storeu_ps(coefi+i, _mm_mul_ps(r, cost));
+  }
+  #endif
+  for (; i < n; i++) {
+    calcFiltCoeff(f[i], coefr+i, coefi+i, gain+i);
   }
 }
 
 void DspVCF::processMessage(int inletIndex, PdMessage *message) {
-  // not sure what the other inlets do wrt messages
-  if (inletIndex == 2) {
-    if (message->isFloat(0)) {
-      q = message->getFloat(0); // update the resonance (q)
+  switch (inletIndex) {
+    case 0: {
+      if (message->isInternedSymbol(0, SymbolTable::CLEAR)) {
+        re = im = 0.0f;
+      }
+      break;
+    }
+    case 1: {
+      // the center frequency, if no signal is connected
+      if (message->isFloat(0)) centerFrequency = message->getFloat(0);
+      break;
     }
+    case 2: {
+      if (message->isFloat(0)) setQ(message->getFloat(0));
+      break;
+    }
+    default: break;
   }
 }
 
-void DspVCF::processDspWithIndex(int fromIndex, int toIndex) {
-  /*
-  for (int i = fromIndex; i < toIndex; i++) {
-    calculateFilterCoefficients(dspBufferAtInlet1[i], q);
-    dspBufferAtOutlet0[i] = dspBufferAtInlet0[i] + (coef1 * tap_0) + (coef2 * tap_1);
-    tap_1 = tap_0;
-    tap_0 = dspBufferAtOutlet0[i];
+void DspVCF::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
+  DspVCF *d = reinterpret_cast<DspVCF *>(dspObject);
+  float *input = d->dspBufferAtInlet[0];
+  float *bandpass = d->dspBufferAtOutlet[0];
+  float *lowpass = d->dspBufferAtOutlet[1];
+  float re = d->re;
+  float im = d->im;
+  
+  if (d->isSilentAtInlet(0) && re == 0.0f && im == 0.0f) {
+    // the filter is at rest and stays so
+    d->fillConstantAtOutlet(0.0f, 0, fromIndex, toIndex);
+    d->fillConstantAtOutlet(0.0f, 1, fromIndex, toIndex);
+    return;
+  }
+  d->clearConstantAtOutlet(0);
+  d->clearConstantAtOutlet(1);
+  
+  // The output is the pole times the last output plus the scaled input. The terms depending on the
+  // last output are added last, which keeps the dependency chain between samples short.
+  if (!d->isFrequencyConnected || d->isConstantAtInlet(1)) {
+    // the coefficients are the same for the whole block
+    float coefr, coefi, gain;
+    d->calcFiltCoeff(!d->isFrequencyConnected ? d->centerFrequency : d->getConstantAtInlet(1),
+        &coefr, &coefi, &gain);
+    for (int i = fromIndex; i < toIndex; i++) {
+      float re2 = re;
+      re = (gain * input[i] - coefi * im) + coefr * re2;
+      im = coefi * re2 + coefr * im;
+      bandpass[i] = re;
+      lowpass[i] = im;
+    }
+  } else {
+    float *frequency = d->dspBufferAtInlet[1];
+    float coefr[VCF_CHUNK_SIZE];
+    float coefi[VCF_CHUNK_SIZE];
+    float gain[VCF_CHUNK_SIZE];
+    for (int i = fromIndex; i < toIndex; i += VCF_CHUNK_SIZE) {
+      int n = (toIndex - i < VCF_CHUNK_SIZE) ? toIndex - i : VCF_CHUNK_SIZE;
+      d->calcFiltCoeffs(frequency+i, coefr, coefi, gain, n);
+      float *x = input+i;
+      float *y0 = bandpass+i;
+      float *y1 = lowpass+i;
+      for (int j = 0; j < n; j++) {
+        float re2 = re;
+        re = (gain[j] * x[j] - coefi[j] * im) + coefr[j] * re2;
+        im = coefi[j] * re2 + coefr[j] * im;
+        y0[j] = re;
+        y1[j] = im;
+      }
+    }
   }
-  // dspBufferAtOutlet0[i] *= gain;
-  ArrayArithmetic::multiply(dspBufferAtOutlet0, gain, dspBufferAtOutlet0, fromIndex, toIndex);
-  */
-  // NOTE(mhroth): This object is definitely not working properly. It outputs only zero.
-  ArrayArithmetic::fill(dspBufferAtOutlet[0], 0, fromIndex, toIndex);
+  
+  d->re = (fabsf(re) >= MIN_STATE && fabsf(re) <= MAX_STATE) ? re : 0.0f;
+  d->im = (fabsf(im) >= MIN_STATE && fabsf(im) <= MAX_STATE) ? im : 0.0f;
 }
@@ -25,7 +25,11 @@
 
 #include "DspObject.h"
 
-/** [vcf~], a voltage controlled bandpass filter */
+/**
+ * [vcf~], [vcf~ float]
+ * A voltage controlled bandpass filter with a signal rate center frequency, after Pd. The left
+ * outlet is the bandpass output and the right outlet the lowpass output. The right inlet sets the q.
+ */
 class DspVCF : public DspObject {
   
   public:
@@ -34,22 +38,39 @@ class DspVCF : public DspObject {
     ~DspVCF();
   
     static const char *getObjectLabel();
+    string toString();
     
   private:
+    static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
     void processMessage(int inletIndex, PdMessage *message);
-    void processDspWithIndex(int fromIndex, int toIndex);
+    void onInletConnectionUpdate(unsigned int inletIndex);
+  
+    /** Sets the q of the filter and the per-block quantities derived from it. */
+    void setQ(float q);
   
-    void calculateFilterCoefficients(float f, float q);
-    float sigbp_qcos(float f); // not entirely sure what this is doing. From Pd.
+    /**
+     * Computes the coefficients of the filter for the center frequency <code>f</code>, in Hz: the
+     * real and imaginary parts of the pole and the input gain.
+     */
+    inline void calcFiltCoeff(float f, float *coefr, float *coefi, float *gain);
+  
+    /**
+     * Computes the coefficients of the filter for each of the <code>n</code> center frequencies
+     * in <code>f</code>. The results are the same as those of <code>calcFiltCoeff</code>.
+     */
+    void calcFiltCoeffs(float *f, float *coefr, float *coefi, float *gain, int n);
     
-    float sampleRate;
-    float centerFrequency;
+    float centerFrequency; // the center frequency if no signal is connected to the center frequency inlet
+    bool isFrequencyConnected; // true if a signal is connected to the center frequency inlet
     float q;
-    float coef1;
-    float coef2;
-    float gain;
-    float tap_0;
-    float tap_1;
+    float invSampleRate;
+    float rOne; // the pole radius at zero frequency, 1 if the q is positive and 0 otherwise
+    float qinv; // 2*pi/q, the decrease of the pole radius per cycle per sample of center frequency
+    float ampCorrect; // the gain correction for the q
+  
+    // the state of the filter, the real (bandpass) and imaginary (lowpass) part of the last output
+    float re;
+    float im;
 };
 
 #endif // _DSP_VCF_H_
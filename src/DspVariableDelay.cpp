@@ -25,6 +25,10 @@
 #include "DspVariableDelay.h"
 #include "PdGraph.h"
 
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
 MessageObject *DspVariableDelay::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspVariableDelay(initMessage, graph);
 }
@@ -37,65 +41,141 @@ DspVariableDelay::DspVariableDelay(PdMessage *initMessage, PdGraph *graph) : Del
     graph->printErr("vd~ requires the name of a delayline. None given.");
     name = NULL;
   }
+  isFourPoint = initMessage->isFloat(1) && (initMessage->getFloat(1) == 4.0f);
+  processFunction = &processSignal;
+  processFunctionNoMessage = &processSignal;
 }
 
 DspVariableDelay::~DspVariableDelay() {
   // nothing to do
 }
 
-void DspVariableDelay::processDspWithIndex(int fromIndex, int toIndex) {
+string DspVariableDelay::toString() {
+  return string(getObjectLabel()) + " " + string(name) + (isFourPoint ? " 4" : "");
+}
+
+void DspVariableDelay::processSignal(DspObject *dspObject, int fromIndex, int toIndex) {
+  DspVariableDelay *d = reinterpret_cast<DspVariableDelay *>(dspObject);
+  
   int headIndex;
   int bufferLength;
-  float *buffer = delayline->getBuffer(&headIndex, &bufferLength);
-  float bufferLengthFloat = (float) bufferLength;
+  float *buffer = d->delayline->getBuffer(&headIndex, &bufferLength);
+  float *input = d->dspBufferAtInlet[0];
+  float *output = d->dspBufferAtOutlet[0];
+  float samplesPerMillisecond = d->sampleRate / 1000.0f;
   
-  float targetIndexBase = (float) (headIndex - blockSizeInt);
-  #if __APPLE__
-  float xArray[blockSizeInt];
-  float targetIndexBaseArray[blockSizeInt];
+  // the delay line has already been written in this block. The delay is clipped such that all
+  // interpolation points lie between the oldest sample in the buffer and the newest one. Like Pd,
+  // the 4-point interpolation delays by at least one sample.
+  int sampleIndex = headIndex - d->blockSizeInt + fromIndex;
+  float minDelay = d->isFourPoint ? 1.0f : 0.0f;
+  float maxDelay = (float) (bufferLength - d->blockSizeInt - (d->isFourPoint ? 1 : 0));
   
-  // calculate delay in samples (vector version of StaticUtils::millisecondsToSamples)
-  float samplesPerMillisecond = sampleRate / 1000.0f;
-  vDSP_vsmul(dspBufferAtInlet[0], 1, &samplesPerMillisecond, xArray, 1, blockSizeInt);
+  #if __APPLE__
+  if (!d->isFourPoint) {
+    int n = toIndex - fromIndex;
+    float xArray[n];
+    float targetIndexBaseArray[n];
+    float targetIndexBase = (float) sampleIndex;
+    float bufferLengthFloat = (float) bufferLength;
+    float one = 1.0f;
+    
+    // calculate delay in samples (vector version of StaticUtils::millisecondsToSamples)
+    vDSP_vsmul(input+fromIndex, 1, &samplesPerMillisecond, xArray, 1, n);
+    vDSP_vclip(xArray, 1, &minDelay, &maxDelay, xArray, 1, n);
+    vDSP_vramp(&targetIndexBase, &one, targetIndexBaseArray, 1, n);
+    vDSP_vsub(xArray, 1, targetIndexBaseArray, 1, xArray, 1, n); // targetIndexBaseArray - xArray
+    
+    // ensure that targetSampleIndex is positive
+    for (int i = 0; i < n; i++) {
+      if (xArray[i] < 0.0f) xArray[i] += bufferLengthFloat;
+    }
+    
+    // do table lookup (in buffer) using xArray as indicies, with linear interpolation. The guard
+    // sample at the end of the buffer is the copy of the first.
+    vDSP_vlint(buffer, xArray, 1, output+fromIndex, 1, n, bufferLength);
+    return;
+  }
+  #endif
   
-  float zero = 0.0f;
-  float one = 1.0f;
-  vDSP_vclip(xArray, 1, &zero, &bufferLengthFloat, xArray, 1, blockSizeInt); // clip the delay between 0 and the buffer length
-  vDSP_vramp(&targetIndexBase, &one, targetIndexBaseArray, 1, blockSizeInt);  // create targetIndexBaseArray
-  vDSP_vsub(xArray, 1, targetIndexBaseArray, 1, xArray, 1, blockSizeInt); // targetIndexBaseArray - xArray (== targetSampleIndex)
+  // The delay is split into whole samples and a fraction, rather than subtracting it from the
+  // sample index as a float, which would lose precision in long buffers. The interpolation is
+  // between the sample at index and the next one, with the fraction f. Indices wrap around the
+  // power of two buffer with a mask.
+  int mask = bufferLength - 1;
+  int i = fromIndex;
   
-  // ensure that targetSampleIndex is positive
-  // TODO(mhroth): vectorise this!
-  for (int i = 0; i < blockSizeInt; i++) {
-    if (xArray[i] < 0.0f) {
-      xArray[i] += bufferLengthFloat;
+  #if __SSE2__
+  const __m128 spm = _mm_set1_ps(samplesPerMillisecond);
+  const __m128 minDelayV = _mm_set1_ps(minDelay);
+  const __m128 maxDelayV = _mm_set1_ps(maxDelay);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128i maskV = _mm_set1_epi32(mask);
+  const __m128i oneV = _mm_set1_epi32(1);
+  __m128i sampleIndexV = _mm_setr_epi32(sampleIndex, sampleIndex+1, sampleIndex+2, sampleIndex+3);
+  int x0[4], x1[4];
+  for (int n = toIndex - 4; i <= n; i += 4, sampleIndexV = _mm_add_epi32(sampleIndexV, _mm_set1_epi32(4))) {
+    __m128 delay = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input+i), spm), minDelayV), maxDelayV);
+    __m128i wholeDelay = _mm_cvttps_epi32(delay);
+    __m128 fraction = _mm_sub_ps(delay, _mm_cvtepi32_ps(wholeDelay));
+    
+    // all bits are set (== -1) where the delayed position lies between two samples
+    __m128 isBetween = _mm_cmpgt_ps(fraction, zero);
+    __m128i index = _mm_add_epi32(_mm_sub_epi32(sampleIndexV, wholeDelay), _mm_castps_si128(isBetween));
+    __m128 f = _mm_and_ps(isBetween, _mm_sub_ps(one, fraction));
+    
+    // there is no gather instruction in SSE2, the samples are loaded one by one
+    _mm_storeu_si128((__m128i *) x0, _mm_and_si128(index, maskV));
+    _mm_storeu_si128((__m128i *) x1, _mm_and_si128(_mm_add_epi32(index, oneV), maskV));
+    __m128 y0 = _mm_setr_ps(buffer[x0[0]], buffer[x0[1]], buffer[x0[2]], buffer[x0[3]]);
+    __m128 y1 = _mm_setr_ps(buffer[x1[0]], buffer[x1[1]], buffer[x1[2]], buffer[x1[3]]);
+    __m128 y1MinusY0 = _mm_sub_ps(y1, y0);
+    
+    if (d->isFourPoint) {
+      int xm1[4], x2[4];
+      _mm_storeu_si128((__m128i *) xm1, _mm_and_si128(_mm_sub_epi32(index, oneV), maskV));
+      _mm_storeu_si128((__m128i *) x2, _mm_and_si128(_mm_add_epi32(index, _mm_set1_epi32(2)), maskV));
+      __m128 ym1 = _mm_setr_ps(buffer[xm1[0]], buffer[xm1[1]], buffer[xm1[2]], buffer[xm1[3]]);
+      __m128 y2 = _mm_setr_ps(buffer[x2[0]], buffer[x2[1]], buffer[x2[2]], buffer[x2[3]]);
+      
+      // y0 + f*((y1-y0) - (1-f)/6 * ((y2 - ym1 - 3*(y1-y0))*f + (y2 + 2*ym1 - 3*y0)))
+      __m128 three = _mm_set1_ps(3.0f);
+      __m128 a = _mm_sub_ps(_mm_sub_ps(y2, ym1), _mm_mul_ps(three, y1MinusY0));
+      __m128 b = _mm_sub_ps(_mm_add_ps(y2, _mm_add_ps(ym1, ym1)), _mm_mul_ps(three, y0));
+      __m128 c = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.1666667f), _mm_sub_ps(one, f)),
+          _mm_add_ps(_mm_mul_ps(a, f), b));
+      _mm_storeu_ps(output+i, _mm_add_ps(y0, _mm_mul_ps(f, _mm_sub_ps(y1MinusY0, c))));
+    } else {
+      _mm_storeu_ps(output+i, _mm_add_ps(y0, _mm_mul_ps(f, y1MinusY0)));
     }
   }
+  sampleIndex += i - fromIndex;
+  #endif
   
-  // do table lookup (in buffer) using xArray as indicies, with linear interpolation 
-  vDSP_vlint(buffer, xArray, 1, dspBufferAtOutlet[0], 1, blockSizeInt, bufferLength);
-  #else
-  float *inputbuffer = dspBufferAtInlet[0];
-  for (int i = 0; i < blockSizeInt; i++, targetIndexBase+=1.0f) {
-    float delayInSamples = StaticUtils::millisecondsToSamples(inputbuffer[i], sampleRate);
-    if (delayInSamples < 0.0f) {
-      delayInSamples = 0.0f;
-    } else if (delayInSamples > bufferLengthFloat) {
-      delayInSamples = bufferLengthFloat;
-    }
+  for (; i < toIndex; i++, sampleIndex++) {
+    float delay = input[i] * samplesPerMillisecond;
+    delay = (delay > minDelay) ? delay : minDelay;
+    delay = (delay < maxDelay) ? delay : maxDelay;
+    int wholeDelay = (int) delay;
+    float fraction = delay - (float) wholeDelay;
+    bool isBetween = (fraction > 0.0f);
+    int index = sampleIndex - wholeDelay - (isBetween ? 1 : 0);
+    float f = isBetween ? (1.0f - fraction) : 0.0f;
     
-    float targetSampleIndex = targetIndexBase - delayInSamples;
-    if (targetSampleIndex < 0.0f) {
-      targetSampleIndex += bufferLengthFloat;
-    }
+    float y0 = buffer[index & mask];
+    float y1 = buffer[(index+1) & mask];
+    float y1MinusY0 = y1 - y0;
     
-    // 2-point linear interpolation (basic and fast)
-    int x0 = (int) targetSampleIndex;
-    float dx = targetSampleIndex - ((float) x0);
-    float y0 = buffer[x0];
-    float y1 = buffer[x0+1];
-    float slope = (y1 - y0); // /(x1 - x0) == 1.0f!
-    dspBufferAtOutlet[0][i] = (slope * dx) + y0;
+    if (d->isFourPoint) {
+      float ym1 = buffer[(index-1) & mask];
+      float y2 = buffer[(index+2) & mask];
+      float a = (y2 - ym1) - 3.0f * y1MinusY0;
+      float b = (y2 + (ym1 + ym1)) - 3.0f * y0;
+      float c = (0.1666667f * (1.0f - f)) * (a * f + b);
+      output[i] = y0 + f * (y1MinusY0 - c);
+    } else {
+      output[i] = y0 + f * y1MinusY0;
+    }
   }
-  #endif
 }
@@ -28,8 +28,9 @@
 class DspDelayWrite;
 
 /**
- * [vd~ symbol]
- * This object implements the <code>DelayReceiver</code> interface.
+ * [vd~ symbol], [vd~ symbol 4]
+ * This object implements the <code>DelayReceiver</code> interface. The delay line is read with
+ * linear interpolation, or with the 4-point interpolation of Pd if the second argument is 4.
  */
 class DspVariableDelay : public DelayReceiver {
   
@@ -39,13 +40,14 @@ class DspVariableDelay : public DelayReceiver {
     ~DspVariableDelay();
   
     static const char *getObjectLabel() { return "vd~"; }
-    string toString() { return string(getObjectLabel()) + " " + string(name); }
+    string toString();
     ObjectType getObjectType() { return DSP_VARIABLE_DELAY; }
     
   private:
-    void processDspWithIndex(int fromIndex, int toIndex);
+    static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
   
     float sampleRate;
+    bool isFourPoint;
 };
 
 #endif // _DSP_VARIABLE_DELAY_H_
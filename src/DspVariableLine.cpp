@@ -23,6 +23,7 @@
 #include "ArrayArithmetic.h"
 #include "DspVariableLine.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 MessageObject *DspVariableLine::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new DspVariableLine(initMessage, graph);
@@ -67,7 +68,7 @@ void DspVariableLine::processMessage(int inletIndex, PdMessage *message) {
           messageList.push_back(heapMessage);
         }
         
-      } else if (message->isSymbol(0, "stop")) {
+      } else if (message->isInternedSymbol(0, SymbolTable::STOP)) {
         // clear all pending messages
         clearAllMessagesFrom(messageList.begin());
         
@@ -41,6 +41,8 @@ class DspVariableLine : public DspObject {
   
     // override sendMessage in order to update path
     void sendMessage(int outletIndex, PdMessage *message);
+  
+    bool doesScheduleMessages() { return true; }
     
   private:
     static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
@@ -0,0 +1,131 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "DspWorkerPool.h"
+
+DspWorkerPool::DspWorkerPool(int numThreads) {
+  batchId = 0;
+  isRunning = true;
+  task = NULL;
+  userData = NULL;
+  numTasks = 0;
+  nextTaskIndex = 0;
+  numTasksRemaining = 0;
+  numActiveWorkers = 0;
+
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&batchCondition, NULL);
+  pthread_cond_init(&doneCondition, NULL);
+
+  for (int i = 0; i < numThreads; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, &workerThreadFunction, this) == 0) {
+      threads.push_back(thread);
+    }
+  }
+}
+
+DspWorkerPool::~DspWorkerPool() {
+  pthread_mutex_lock(&mutex);
+  isRunning = false;
+  pthread_cond_broadcast(&batchCondition);
+  pthread_mutex_unlock(&mutex);
+
+  for (int i = 0; i < threads.size(); i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&doneCondition);
+  pthread_cond_destroy(&batchCondition);
+  pthread_mutex_destroy(&mutex);
+}
+
+void *DspWorkerPool::workerThreadFunction(void *pool) {
+  DspWorkerPool *p = reinterpret_cast<DspWorkerPool *>(pool);
+  unsigned int lastBatchId = 0;
+  while (true) {
+    pthread_mutex_lock(&p->mutex);
+    while (p->isRunning && p->batchId == lastBatchId) {
+      pthread_cond_wait(&p->batchCondition, &p->mutex);
+    }
+    if (!p->isRunning) {
+      pthread_mutex_unlock(&p->mutex);
+      return NULL;
+    }
+    lastBatchId = p->batchId;
+    ++p->numActiveWorkers;
+    pthread_mutex_unlock(&p->mutex);
+
+    p->runTasks();
+
+    pthread_mutex_lock(&p->mutex);
+    if (--p->numActiveWorkers == 0) pthread_cond_signal(&p->doneCondition);
+    pthread_mutex_unlock(&p->mutex);
+  }
+}
+
+void DspWorkerPool::runTasks() {
+  int taskIndex;
+  while ((taskIndex = __sync_fetch_and_add(&nextTaskIndex, 1)) < numTasks) {
+    task(userData, taskIndex);
+    if (__sync_sub_and_fetch(&numTasksRemaining, 1) == 0) {
+      pthread_mutex_lock(&mutex);
+      pthread_cond_signal(&doneCondition);
+      pthread_mutex_unlock(&mutex);
+    }
+  }
+}
+
+void DspWorkerPool::execute(void (*task)(void *, int), void *userData, int numTasks) {
+  if (numTasks <= 0) return;
+
+  if (threads.empty() || numTasks == 1) {
+    // nothing to share. Do all of the work here.
+    for (int i = 0; i < numTasks; i++) {
+      task(userData, i);
+    }
+    return;
+  }
+
+  pthread_mutex_lock(&mutex);
+  // a worker which woke late may still be looking at the previous batch. Let it finish before the
+  // task counter is reset, otherwise it could claim a task of the new batch twice.
+  while (numActiveWorkers > 0) {
+    pthread_cond_wait(&doneCondition, &mutex);
+  }
+  this->task = task;
+  this->userData = userData;
+  this->numTasks = numTasks;
+  numTasksRemaining = numTasks;
+  nextTaskIndex = 0;
+  ++batchId; // publish the batch
+  pthread_cond_broadcast(&batchCondition);
+  pthread_mutex_unlock(&mutex);
+
+  runTasks(); // the calling thread also works on the batch
+
+  pthread_mutex_lock(&mutex);
+  while (numTasksRemaining > 0) {
+    pthread_cond_wait(&doneCondition, &mutex);
+  }
+  pthread_mutex_unlock(&mutex);
+}
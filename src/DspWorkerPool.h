@@ -0,0 +1,90 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _DSP_WORKER_POOL_H_
+#define _DSP_WORKER_POOL_H_
+
+#include <pthread.h>
+#include <vector>
+using namespace std;
+
+/**
+ * A <code>DspWorkerPool</code> is a small pool of persistent threads which cooperatively execute
+ * a batch of independent tasks. The thread calling <code>execute()</code> also works on the batch
+ * and the function returns only once all tasks have completed. Tasks are claimed with an atomic
+ * counter, so the number of tasks may exceed the number of threads.
+ */
+class DspWorkerPool {
+
+  public:
+    /**
+     * Creates a pool with <code>numThreads</code> worker threads in addition to the calling thread.
+     * A pool with zero threads executes all tasks on the calling thread.
+     */
+    DspWorkerPool(int numThreads);
+    ~DspWorkerPool();
+
+    /**
+     * Executes <code>task(userData, i)</code> for all <code>i</code> in [0, numTasks). Tasks may
+     * run in any order and on any thread. Returns once all tasks have finished.
+     */
+    void execute(void (*task)(void *, int), void *userData, int numTasks);
+
+    /** Returns the number of worker threads (not including the calling thread). */
+    int getNumThreads() { return (int) threads.size(); }
+
+  private:
+    static void *workerThreadFunction(void *pool);
+
+    /** Claims and runs tasks from the current batch until none are left. */
+    void runTasks();
+
+    vector<pthread_t> threads;
+
+    pthread_mutex_t mutex;
+
+    /** Signalled when a new batch is available or the pool is shutting down. */
+    pthread_cond_t batchCondition;
+
+    /** Signalled when the last task of a batch has finished, or the last active worker goes idle. */
+    pthread_cond_t doneCondition;
+
+    /** Incremented with every new batch. Workers compare it against the last batch they saw. */
+    unsigned int batchId;
+
+    bool isRunning;
+
+    void (*task)(void *, int);
+    void *userData;
+    int numTasks;
+
+    /** The index of the next unclaimed task. Updated atomically. */
+    volatile int nextTaskIndex;
+
+    /** The number of tasks which have not yet finished. Updated atomically. */
+    volatile int numTasksRemaining;
+
+    /** The number of worker threads currently looking at a batch. Guarded by the mutex. */
+    int numActiveWorkers;
+};
+
+#endif // _DSP_WORKER_POOL_H_
@@ -35,6 +35,7 @@ class DspWrap : public DspObject {
 
     static const char *getObjectLabel() { return "wrap~"; }
     string toString() { return string(getObjectLabel()); }
+    bool canProcessInPlace() { return true; }
   
   private:
     static void processSignal(DspObject *dspObject, int fromIndex, int toIndex);
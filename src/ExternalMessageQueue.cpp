@@ -0,0 +1,93 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ExternalMessageQueue.h"
+
+// the number of slots in the queue. Must be a power of two.
+#define EXTERNAL_MESSAGE_QUEUE_LENGTH 256
+// the number of bytes available to each message
+#define EXTERNAL_MESSAGE_SLOT_BYTES 512
+
+ExternalMessageQueue::ExternalMessageQueue() {
+  slots = (ExternalMessageSlot *) malloc(EXTERNAL_MESSAGE_QUEUE_LENGTH * sizeof(ExternalMessageSlot));
+  slotBuffer = (char *) malloc(EXTERNAL_MESSAGE_QUEUE_LENGTH * EXTERNAL_MESSAGE_SLOT_BYTES);
+  for (unsigned int i = 0; i < EXTERNAL_MESSAGE_QUEUE_LENGTH; i++) {
+    slots[i].sequence = i;
+    slots[i].receiverIndex = -1;
+    slots[i].message = (PdMessage *) (slotBuffer + (i * EXTERNAL_MESSAGE_SLOT_BYTES));
+  }
+  writePosition = 0;
+  readPosition = 0;
+}
+
+ExternalMessageQueue::~ExternalMessageQueue() {
+  free(slotBuffer);
+  free(slots);
+}
+
+bool ExternalMessageQueue::push(int receiverIndex, PdMessage *message) {
+  // check that the message fits into a slot
+  if (message->numBytes() > EXTERNAL_MESSAGE_SLOT_BYTES) return false;
+  
+  // claim a slot
+  ExternalMessageSlot *slot = NULL;
+  unsigned int position = writePosition;
+  while (true) {
+    slot = &slots[position & (EXTERNAL_MESSAGE_QUEUE_LENGTH-1)];
+    int difference = (int) (__sync_fetch_and_add(&slot->sequence, 0) - position);
+    if (difference == 0) {
+      // the slot is free. Try to claim it.
+      unsigned int observed = __sync_val_compare_and_swap(&writePosition, position, position+1);
+      if (observed == position) break;
+      position = observed;
+    } else if (difference < 0) {
+      return false; // the consumer has not yet read this slot. The queue is full.
+    } else {
+      position = writePosition; // another producer has claimed this slot. Try the next one.
+    }
+  }
+  
+  // copy the message into the slot. Symbols are interned and need not be copied.
+  message->copyToBuffer((char *) slot->message);
+  slot->receiverIndex = receiverIndex;
+  
+  // publish the slot to the consumer. The producer owns the slot, so the swap always succeeds.
+  __sync_bool_compare_and_swap(&slot->sequence, position, position+1);
+  return true;
+}
+
+PdMessage *ExternalMessageQueue::peek(int *receiverIndex) {
+  ExternalMessageSlot *slot = &slots[readPosition & (EXTERNAL_MESSAGE_QUEUE_LENGTH-1)];
+  if (__sync_fetch_and_add(&slot->sequence, 0) != readPosition + 1) {
+    return NULL; // the slot has not yet been published
+  }
+  *receiverIndex = slot->receiverIndex;
+  return slot->message;
+}
+
+void ExternalMessageQueue::pop() {
+  ExternalMessageSlot *slot = &slots[readPosition & (EXTERNAL_MESSAGE_QUEUE_LENGTH-1)];
+  // hand the slot back to the producers once it has been read
+  __sync_bool_compare_and_swap(&slot->sequence, readPosition + 1,
+      readPosition + EXTERNAL_MESSAGE_QUEUE_LENGTH);
+  ++readPosition;
+}
@@ -0,0 +1,82 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _EXTERNAL_MESSAGE_QUEUE_H_
+#define _EXTERNAL_MESSAGE_QUEUE_H_
+
+#include "PdMessage.h"
+
+/** A single entry of the <code>ExternalMessageQueue</code>. */
+typedef struct ExternalMessageSlot {
+  /** Indicates whether the slot is free to be written or ready to be read. Updated atomically. */
+  volatile unsigned int sequence;
+  
+  /** The resolved receiver to which the message is addressed. */
+  int receiverIndex;
+  
+  /** The message. Its symbols are interned. */
+  PdMessage *message;
+} ExternalMessageSlot;
+
+/**
+ * A bounded lock-free multiple-producer single-consumer ring buffer of messages which are injected
+ * into a context from outside of the audio thread. Each message is copied into a slot of fixed
+ * size, such that neither side allocates memory. Producers claim slots with
+ * an atomic compare-and-swap and never wait on the consumer. The consumer (the audio thread) reads
+ * messages in the order in which they were claimed and never waits on a producer.
+ */
+class ExternalMessageQueue {
+  
+  public:
+    ExternalMessageQueue();
+    ~ExternalMessageQueue();
+  
+    /**
+     * Copies the message into the queue, addressed to the receiver with the given index. Returns
+     * false if the queue is full or if the message does not fit into a slot, in which case nothing
+     * is added. May be called from any thread.
+     */
+    bool push(int receiverIndex, PdMessage *message);
+  
+    /**
+     * Returns the oldest message in the queue and its receiver index, or <code>NULL</code> if the
+     * queue is empty. The message remains valid until <code>pop()</code> is called. Consumer only.
+     */
+    PdMessage *peek(int *receiverIndex);
+  
+    /** Removes the message returned by <code>peek()</code>. Consumer only. */
+    void pop();
+  
+  private:
+    ExternalMessageSlot *slots;
+  
+    /** A single allocation holding the message storage of all slots. */
+    char *slotBuffer;
+  
+    /** The position of the next slot to be claimed by a producer. Updated atomically. */
+    volatile unsigned int writePosition;
+  
+    /** The position of the next slot to be read by the consumer. */
+    unsigned int readPosition;
+};
+
+#endif // _EXTERNAL_MESSAGE_QUEUE_H_
@@ -0,0 +1,83 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "GraphCommandQueue.h"
+#include "PdMessage.h"
+
+GraphCommandQueue::GraphCommandQueue() {
+  head = NULL;
+  retiredHead = NULL;
+}
+
+GraphCommandQueue::~GraphCommandQueue() {
+  freeCommandList(head);
+  freeCommandList(retiredHead);
+}
+
+void GraphCommandQueue::freeCommandList(GraphCommand *commandList) {
+  while (commandList != NULL) {
+    GraphCommand *next = commandList->next;
+    switch (commandList->type) {
+      case GRAPH_COMMAND_SEND_MESSAGE: commandList->message->freeMessage(); break;
+      case GRAPH_COMMAND_SET_TABLE_BUFFER: free(commandList->buffer); break;
+      default: break;
+    }
+    free(commandList);
+    commandList = next;
+  }
+}
+
+void GraphCommandQueue::push(GraphCommand *command) {
+  // reclaim commands which the consumer has finished with. The whole list is taken at once, so
+  // that producers never compete for individual nodes.
+  freeCommandList(__sync_lock_test_and_set(&retiredHead, (GraphCommand *) NULL));
+  
+  GraphCommand *node = (GraphCommand *) malloc(sizeof(GraphCommand));
+  *node = *command;
+  do {
+    node->next = head;
+  } while (!__sync_bool_compare_and_swap(&head, node->next, node));
+}
+
+GraphCommand *GraphCommandQueue::popAll() {
+  GraphCommand *commandList = __sync_lock_test_and_set(&head, (GraphCommand *) NULL);
+  
+  // the list is linked from newest to oldest. Reverse it.
+  GraphCommand *orderedList = NULL;
+  while (commandList != NULL) {
+    GraphCommand *next = commandList->next;
+    commandList->next = orderedList;
+    orderedList = commandList;
+    commandList = next;
+  }
+  return orderedList;
+}
+
+void GraphCommandQueue::retire(GraphCommand *commandList) {
+  if (commandList == NULL) return;
+  
+  GraphCommand *tail = commandList;
+  while (tail->next != NULL) tail = tail->next;
+  do {
+    tail->next = retiredHead;
+  } while (!__sync_bool_compare_and_swap(&retiredHead, tail->next, commandList));
+}
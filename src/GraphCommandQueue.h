@@ -0,0 +1,101 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _GRAPH_COMMAND_QUEUE_H_
+#define _GRAPH_COMMAND_QUEUE_H_
+
+#include <stdlib.h>
+
+class MessageObject;
+class MessageTable;
+class PdMessage;
+
+/**
+ * Enumerates the requests which other threads make of the audio thread. Graph edits are not among
+ * them. They are planned on the editing thread and published as a whole (see
+ * <code>PdContext::beginEdit()</code>).
+ */
+typedef enum GraphCommandType {
+  GRAPH_COMMAND_RESOLVE_RECEIVER,
+  GRAPH_COMMAND_REGISTER_EXTERNAL_RECEIVER,
+  GRAPH_COMMAND_UNREGISTER_EXTERNAL_RECEIVER,
+  GRAPH_COMMAND_SEND_MESSAGE,
+  GRAPH_COMMAND_SET_TABLE_BUFFER
+} GraphCommandType;
+
+/**
+ * A single request. Only the fields relevant to the command type are used. A command which
+ * resolves a receiver name binds <code>receiverHandle</code> to <code>receiverName</code>. The
+ * external receiver commands only use <code>receiverName</code>. A message sent to an object is a
+ * heap copy, and a table buffer is allocated with <code>malloc()</code>. The audio thread swaps it
+ * with the buffer of the table. Both are freed along with the command.
+ */
+typedef struct GraphCommand {
+  GraphCommandType type;
+  MessageObject *toObject;
+  int inletIndex;
+  PdMessage *message;
+  MessageTable *table;
+  float *buffer;
+  int bufferLength;
+  char *receiverName;
+  int receiverHandle;
+  struct GraphCommand *next;
+} GraphCommand;
+
+/**
+ * A lock-free multiple-producer single-consumer queue of <code>GraphCommand</code>s. Any number of
+ * threads may add commands, while a single thread (the audio thread) removes all of them at once
+ * at the start of a block. Neither side ever waits on a lock. Command memory is allocated and
+ * freed only by producers, as are the messages and table buffers which the commands hold.
+ */
+class GraphCommandQueue {
+  
+  public:
+    GraphCommandQueue();
+    ~GraphCommandQueue();
+  
+    /** Adds a copy of the given command to the queue. May be called from any thread. */
+    void push(GraphCommand *command);
+  
+    /**
+     * Removes all commands from the queue and returns them as a linked list in the order in which
+     * they were added. Returns <code>NULL</code> if the queue is empty. The list must be returned
+     * with <code>retire()</code> once the commands have been executed. Consumer only.
+     */
+    GraphCommand *popAll();
+  
+    /** Returns a list of executed commands such that their memory can be reused. Consumer only. */
+    void retire(GraphCommand *commandList);
+  
+  private:
+    /** Frees a linked list of commands, including any messages and buffers which they hold. */
+    static void freeCommandList(GraphCommand *commandList);
+  
+    /** The most recently pushed command. Commands are linked from newest to oldest. */
+    GraphCommand *volatile head;
+  
+    /** Commands which have been executed but not yet freed. */
+    GraphCommand *volatile retiredHead;
+};
+
+#endif // _GRAPH_COMMAND_QUEUE_H_
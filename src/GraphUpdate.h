@@ -0,0 +1,117 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _GRAPH_UPDATE_H_
+#define _GRAPH_UPDATE_H_
+
+#include <list>
+#include <vector>
+#include "MessageObject.h"
+using namespace std;
+
+class DelayReceiver;
+class DspDelayWrite;
+class DspFilterBank;
+class DspObject;
+class DspWorkerPool;
+class MessageTable;
+class PdGraph;
+class RemoteMessageReceiver;
+class TableReceiverInterface;
+struct DspGraphPlan;
+
+/** Enumerates the changes which the audio thread makes when it applies a <code>GraphUpdate</code>. */
+typedef enum GraphUpdateRecordType {
+  GRAPH_UPDATE_ADD_RECEIVER,
+  GRAPH_UPDATE_REMOVE_RECEIVER,
+  GRAPH_UPDATE_ADD_TABLE,
+  GRAPH_UPDATE_SET_TABLE,
+  GRAPH_UPDATE_SET_DELAYLINE,
+  GRAPH_UPDATE_SET_MESSAGE_CONNECTIONS,
+  GRAPH_UPDATE_SET_INLET_LIST,
+  GRAPH_UPDATE_SET_DSP_PLAN
+} GraphUpdateRecordType;
+
+/**
+ * A single change to the state which the audio thread reads. Only the fields relevant to the
+ * record type are used. Records which replace a heap object (the message connections, inlet list
+ * or dsp plan) exchange it with the current one when they are applied, such that the record then
+ * holds the object which is no longer used and which is freed along with the update.
+ */
+typedef struct GraphUpdateRecord {
+  GraphUpdateRecordType type;
+  RemoteMessageReceiver *receiver;
+  TableReceiverInterface *tableReceiver;
+  MessageTable *table;
+  DelayReceiver *delayReceiver;
+  DspDelayWrite *delayline;
+  MessageObject *object;
+  vector<list<ObjectLetPair> > *messageConnections;
+  PdGraph *graph;
+  vector<MessageObject *> *inletList;
+  DspGraphPlan *dspGraphPlan;
+} GraphUpdateRecord;
+
+/**
+ * The root graphs of a context, in the groups of mutually independent graphs in which they are
+ * processed, and the private output buffers of all but the first group.
+ */
+typedef struct GraphGroupPlan {
+  vector<PdGraph *> graphList;
+  vector<vector<PdGraph *> > graphGroupList;
+  float *graphGroupOutputBuffers;
+  DspWorkerPool *workerPool;
+} GraphGroupPlan;
+
+/**
+ * The edits to live graphs which have been made since the audio thread last applied an update.
+ * The update is planned completely by the editing thread, including the new dsp process order
+ * and buffers of every edited graph, and is handed to the audio thread with a single atomic
+ * pointer swap. The audio thread applies it at the start of a block: it applies the records in
+ * order, commits the planned buffers of the listed dsp objects, and switches to the new graph
+ * group plan. Objects which are no longer used by the audio thread once it has done so are
+ * deleted by the editing thread after the update has been applied.
+ */
+typedef struct GraphUpdate {
+  /** The changes to the state read by the audio thread, in the order in which they were made. */
+  vector<GraphUpdateRecord> recordList;
+
+  /** The dsp objects whose planned buffers and signal states are made the processed ones. */
+  vector<DspObject *> commitList;
+
+  /** The objects which have been removed from live graphs, including implicit +~~ objects. */
+  vector<MessageObject *> deletedObjectList;
+
+  /** The filter banks of replaced filter bank plans. */
+  vector<DspFilterBank *> deletedFilterBankList;
+
+  /** Worker pools which have been replaced. */
+  vector<DspWorkerPool *> deletedWorkerPoolList;
+
+  /**
+   * The new graph group plan, or <code>NULL</code> if the groups have not changed. Once applied,
+   * it is exchanged with the previous plan.
+   */
+  GraphGroupPlan *graphGroupPlan;
+} GraphUpdate;
+
+#endif // _GRAPH_UPDATE_H_
@@ -0,0 +1,103 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include "LookupTable.h"
+
+pthread_once_t LookupTable::cosineTableOnce = PTHREAD_ONCE_INIT;
+pthread_once_t LookupTable::interpolatedCosineTableOnce = PTHREAD_ONCE_INIT;
+pthread_once_t LookupTable::exp2TableOnce = PTHREAD_ONCE_INIT;
+float *LookupTable::cosineTable = NULL;
+float *LookupTable::interpolatedCosineTable = NULL;
+float *LookupTable::exp2Table = NULL;
+pthread_mutex_t LookupTable::hannWindowMutex = PTHREAD_MUTEX_INITIALIZER;
+map<int, float *> LookupTable::hannWindows;
+
+#pragma mark - Cosine
+
+void LookupTable::initCosineTable() {
+  int size = 1 << COSINE_TABLE_BITS;
+  cosineTable = (float *) malloc((size+1) * sizeof(float));
+  for (int i = 0; i < size; i++) {
+    cosineTable[i] = cosf(2.0f * M_PI * ((float) i) / ((float) size));
+  }
+  cosineTable[size] = cosineTable[0];
+}
+
+const float *LookupTable::getCosineTable() {
+  pthread_once(&cosineTableOnce, &initCosineTable);
+  return cosineTable;
+}
+
+void LookupTable::initInterpolatedCosineTable() {
+  int size = 1 << INTERPOLATED_COSINE_TABLE_BITS;
+  interpolatedCosineTable = (float *) malloc(2 * size * sizeof(float));
+  for (int i = 0; i < size; i++) {
+    interpolatedCosineTable[2*i] = cosf(2.0f * M_PI * ((float) i) / ((float) size));
+    interpolatedCosineTable[2*i+1] = cosf(2.0f * M_PI * ((float) (i+1)) / ((float) size))
+        - interpolatedCosineTable[2*i];
+  }
+}
+
+const float *LookupTable::getInterpolatedCosineTable() {
+  pthread_once(&interpolatedCosineTableOnce, &initInterpolatedCosineTable);
+  return interpolatedCosineTable;
+}
+
+#pragma mark - Hann Window
+
+const float *LookupTable::getHannWindow(int size) {
+  pthread_mutex_lock(&hannWindowMutex);
+  float *window = hannWindows[size];
+  if (window == NULL) {
+    window = (float *) malloc(size * sizeof(float));
+    for (int i = 0; i < size; i++) {
+      window[i] = (float) ((1.0 - cos((2.0 * M_PI * (i+1)) / size)) / size);
+    }
+    hannWindows[size] = window;
+  }
+  pthread_mutex_unlock(&hannWindowMutex);
+  return window;
+}
+
+#pragma mark - Exp2
+
+void LookupTable::initExp2Table() {
+  // a guard entry covers fractions which round up to one
+  int size = 1 << EXP2_TABLE_BITS;
+  exp2Table = (float *) malloc(2 * (size+1) * sizeof(float));
+  for (int i = 0; i <= size; i++) {
+    exp2Table[2*i] = (float) pow(2.0, ((double) i) / ((double) size));
+    exp2Table[2*i+1] = (float) (pow(2.0, ((double) (i+1)) / ((double) size)) - (double) exp2Table[2*i]);
+  }
+  exp2Table[2*size+1] = 0.0f;
+}
+
+float LookupTable::exp2(float x) {
+  pthread_once(&exp2TableOnce, &initExp2Table);
+  if (!(x > -150.0f)) return (x != x) ? x : 0.0f; // NaN or too small for a float
+  if (x > 150.0f) return HUGE_VALF;
+  float i = floorf(x);
+  float f = (x - i) * ((float) (1 << EXP2_TABLE_BITS));
+  int index = (int) f;
+  return ldexpf(exp2Table[2*index] + (f - (float) index) * exp2Table[2*index+1], (int) i);
+}
@@ -0,0 +1,103 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _LOOKUP_TABLE_H_
+#define _LOOKUP_TABLE_H_
+
+#include <map>
+#include <math.h>
+#include <pthread.h>
+using namespace std;
+
+// the number of entries of the cosine table per cycle is 2^COSINE_TABLE_BITS
+#define COSINE_TABLE_BITS 16
+
+// the number of entries of the interpolated cosine table per cycle is 2^INTERPOLATED_COSINE_TABLE_BITS
+#define INTERPOLATED_COSINE_TABLE_BITS 11
+
+// the number of entries of the exp2 table over one octave is 2^EXP2_TABLE_BITS
+#define EXP2_TABLE_BITS 11
+
+/**
+ * <code>LookupTable</code> is the registry of the lookup tables which are shared by all objects of
+ * all contexts. Each table is built once on first use, with proper synchronisation such that
+ * contexts may be created on any thread, and lives as long as the process. Tables are read-only.
+ * Objects should fetch the tables they need on construction.
+ */
+class LookupTable {
+  
+  public:
+    /**
+     * Returns the cosine over one cycle, in 2^<code>COSINE_TABLE_BITS</code> entries, followed by
+     * one guard entry equal to the first.
+     */
+    static const float *getCosineTable();
+  
+    /**
+     * Returns the cosine over one cycle, in 2^<code>INTERPOLATED_COSINE_TABLE_BITS</code> entries.
+     * Each entry is followed by its difference to the next, such that both are loaded together for
+     * linear interpolation. The table is small enough to stay in the cache, and its interpolated
+     * values are more accurate than those of the larger table.
+     */
+    static const float *getInterpolatedCosineTable();
+  
+    /**
+     * Returns a Hann window of the given size as env~ in Pd weights its input, from the oldest
+     * sample to the newest. Coefficient i is (1 - cos(2 pi (i+1) / size)) / size, such that the
+     * coefficients sum to one and the last is zero. Windows are kept for each requested size.
+     */
+    static const float *getHannWindow(int size);
+  
+    /** Returns 2^<code>x</code>, interpolated from a table. The relative error is close to float precision. */
+    static float exp2(float x);
+  
+    /** Returns the frequency in Hz of the given midi note, as <code>mtof</code>. */
+    static inline float midiToFrequency(float note) {
+      return 440.0f * exp2((note - 69.0f) * (1.0f/12.0f));
+    }
+  
+    /** Returns the rms amplitude of the given level in dB, as <code>dbtorms</code>. */
+    static inline float dbToRms(float db) {
+      // 100 dB is an amplitude of 1
+      return (db <= 0.0f) ? 0.0f : exp2((db - 100.0f) * (float) (M_LN10 / (20.0 * M_LN2)));
+    }
+  
+  private:
+    static void initCosineTable();
+    static void initInterpolatedCosineTable();
+    static void initExp2Table();
+  
+    static pthread_once_t cosineTableOnce;
+    static pthread_once_t interpolatedCosineTableOnce;
+    static pthread_once_t exp2TableOnce;
+    static float *cosineTable;
+    static float *interpolatedCosineTable;
+  
+    /** 2^x for x in [0,1], with each entry followed by its difference to the next. */
+    static float *exp2Table;
+  
+    /** Guards <code>hannWindows</code>. */
+    static pthread_mutex_t hannWindowMutex;
+    static map<int, float *> hannWindows;
+};
+
+#endif // _LOOKUP_TABLE_H_
@@ -0,0 +1,291 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+#include <sys/time.h>
+#include "MessageAllocator.h"
+
+// the number of size classes. Blocks of size class i take MIN_BLOCK_BYTES << i bytes.
+#define NUM_SIZE_CLASSES 7
+#define MIN_BLOCK_BYTES 64
+
+// the number of bytes in each slab from which blocks are carved
+#define SLAB_BYTES 16384
+
+// the number of free blocks which are kept in reserve for each size class. Once fewer than half
+// of them are left, the reserve is refilled by the refill thread.
+#define NUM_RESERVED_BLOCKS 64
+
+// the longest time for which the refill thread sleeps, in case a request to wake it was missed
+#define REFILL_TIMEOUT_MS 50
+
+// the number of bytes in each half of the arena
+#define ARENA_BYTES 16384
+
+// the number of bytes reserved for the block header, such that block contents are aligned like
+// those returned by malloc
+#define BLOCK_HEADER_BYTES 16
+
+// blocks which do not belong to a size class. Arena blocks are BLOCK_KIND_ARENA - the arena half.
+#define BLOCK_KIND_SYSTEM -1
+#define BLOCK_KIND_ARENA -2
+
+// the free list heads are tagged pointers. The pointer takes the lower 48 bits.
+#define POINTER_MASK 0x0000FFFFFFFFFFFFULL
+#define TAG_INCREMENT 0x0001000000000000ULL
+
+// the number of blocks of a size class which are carved from one slab
+#define NUM_BLOCKS_PER_SLAB(_sizeClass) ((SLAB_BYTES - BLOCK_HEADER_BYTES) / (MIN_BLOCK_BYTES << (_sizeClass)))
+
+MessageAllocator::MessageAllocator() {
+  freeListHeads = (volatile unsigned long long *) calloc(NUM_SIZE_CLASSES, sizeof(unsigned long long));
+  numFreeBlocks = (volatile int *) calloc(NUM_SIZE_CLASSES, sizeof(int));
+  slabList = NULL;
+  numBlockAllocations = 0;
+  numArenaAllocations = 0;
+  numFailedAllocations = 0;
+  numSlabs = 0;
+  numLiveBlocks = 0;
+  
+  for (int i = 0; i < 2; i++) {
+    arena[i] = (char *) malloc(ARENA_BYTES);
+    arenaPosition[i] = 0;
+    numArenaMessages[i] = 0;
+  }
+  arenaIndex = 0;
+  
+  // the reserve of every size class is filled up front, such that the first messages need no
+  // allocation
+  refill();
+  
+  isRefillRequested = false;
+  isRunning = true;
+  pthread_mutex_init(&refillMutex, NULL);
+  pthread_cond_init(&refillCondition, NULL);
+  pthread_create(&refillThread, NULL, &refillThreadFunction, this);
+}
+
+MessageAllocator::~MessageAllocator() {
+  pthread_mutex_lock(&refillMutex);
+  isRunning = false;
+  pthread_cond_signal(&refillCondition);
+  pthread_mutex_unlock(&refillMutex);
+  pthread_join(refillThread, NULL);
+  pthread_cond_destroy(&refillCondition);
+  pthread_mutex_destroy(&refillMutex);
+  
+  void *slab = slabList;
+  while (slab != NULL) {
+    void *nextSlab = *((void **) slab);
+    free(slab);
+    slab = nextSlab;
+  }
+  free(arena[0]);
+  free(arena[1]);
+  free((void *) numFreeBlocks);
+  free((void *) freeListHeads);
+}
+
+void *MessageAllocator::refillThreadFunction(void *allocator) {
+  MessageAllocator *a = reinterpret_cast<MessageAllocator *>(allocator);
+  pthread_mutex_lock(&a->refillMutex);
+  while (a->isRunning) {
+    if (!a->isRefillRequested) {
+      // a request may be missed if it arrives just before the thread starts to wait, as the
+      // requesting thread does not wait for the lock. The timeout bounds the delay.
+      struct timeval now;
+      gettimeofday(&now, NULL);
+      long long nsec = (now.tv_usec + REFILL_TIMEOUT_MS * 1000LL) * 1000LL;
+      struct timespec timeout;
+      timeout.tv_sec = now.tv_sec + (time_t) (nsec / 1000000000LL);
+      timeout.tv_nsec = (long) (nsec % 1000000000LL);
+      pthread_cond_timedwait(&a->refillCondition, &a->refillMutex, &timeout);
+    }
+    if (a->isRunning && a->isRefillRequested) {
+      a->isRefillRequested = false;
+      pthread_mutex_unlock(&a->refillMutex);
+      a->refill();
+      pthread_mutex_lock(&a->refillMutex);
+    }
+  }
+  pthread_mutex_unlock(&a->refillMutex);
+  return NULL;
+}
+
+void MessageAllocator::requestRefill() {
+  if (isRefillRequested) return; // the refill thread has already been asked
+  isRefillRequested = true;
+  __sync_synchronize();
+  
+  // The caller may be the audio thread, so it never waits for the lock. If the refill thread holds
+  // it, it is awake and either sees the request now or within the timeout.
+  if (pthread_mutex_trylock(&refillMutex) == 0) {
+    pthread_cond_signal(&refillCondition);
+    pthread_mutex_unlock(&refillMutex);
+  }
+}
+
+void MessageAllocator::refill() {
+  for (int i = 0; i < NUM_SIZE_CLASSES; i++) {
+    while (numFreeBlocks[i] < NUM_RESERVED_BLOCKS) {
+      allocateSlab(i);
+    }
+  }
+}
+
+void MessageAllocator::allocateSlab(int sizeClass) {
+  // the first bytes of the slab link it into the list of all slabs
+  char *slab = (char *) malloc(SLAB_BYTES);
+  void *oldSlabList = NULL;
+  do {
+    oldSlabList = slabList;
+    *((void **) slab) = oldSlabList;
+  } while (!__sync_bool_compare_and_swap(&slabList, oldSlabList, (void *) slab));
+  __sync_add_and_fetch(&numSlabs, 1);
+  
+  // all blocks are added to the free list
+  unsigned int blockBytes = MIN_BLOCK_BYTES << sizeClass;
+  for (int i = NUM_BLOCKS_PER_SLAB(sizeClass)-1; i >= 0; i--) {
+    MessageBlockHeader *block = (MessageBlockHeader *) (slab + BLOCK_HEADER_BYTES + i*blockBytes);
+    block->sizeClass = sizeClass;
+    pushBlock(block);
+  }
+}
+
+MessageBlockHeader *MessageAllocator::popBlock(int sizeClass) {
+  volatile unsigned long long *head = freeListHeads + sizeClass;
+  while (true) {
+    unsigned long long oldHead = __sync_fetch_and_add(head, 0ULL);
+    MessageBlockHeader *block = (MessageBlockHeader *) (uintptr_t) (oldHead & POINTER_MASK);
+    if (block == NULL) {
+      // The reserve has run out before the refill thread could replenish it. The slab must be
+      // allocated here, on whichever thread this is. This is counted as a failure.
+      __sync_add_and_fetch(&numFailedAllocations, 1);
+      allocateSlab(sizeClass);
+      continue;
+    }
+    
+    // the block may be taken by another thread in the meantime, in which case its next pointer is
+    // stale. Blocks are never returned to the system, so it can be read, and the tag of the head
+    // will have changed such that the swap fails.
+    unsigned long long newHead = ((oldHead & ~POINTER_MASK) + TAG_INCREMENT) | (uintptr_t) block->next;
+    if (__sync_bool_compare_and_swap(head, oldHead, newHead)) {
+      if (__sync_sub_and_fetch(&numFreeBlocks[sizeClass], 1) < NUM_RESERVED_BLOCKS/2) {
+        requestRefill();
+      }
+      return block;
+    }
+  }
+}
+
+void MessageAllocator::pushBlock(MessageBlockHeader *block) {
+  volatile unsigned long long *head = freeListHeads + block->sizeClass;
+  while (true) {
+    unsigned long long oldHead = __sync_fetch_and_add(head, 0ULL);
+    block->next = (MessageBlockHeader *) (uintptr_t) (oldHead & POINTER_MASK);
+    unsigned long long newHead = ((oldHead & ~POINTER_MASK) + TAG_INCREMENT) | (uintptr_t) block;
+    if (__sync_bool_compare_and_swap(head, oldHead, newHead)) {
+      __sync_add_and_fetch(&numFreeBlocks[block->sizeClass], 1);
+      return;
+    }
+  }
+}
+
+void *MessageAllocator::allocateBlock(unsigned int numBytes) {
+  unsigned int numBlockBytes = numBytes + BLOCK_HEADER_BYTES;
+  int sizeClass = 0;
+  while (sizeClass < NUM_SIZE_CLASSES && (MIN_BLOCK_BYTES << sizeClass) < numBlockBytes) {
+    ++sizeClass;
+  }
+  
+  MessageBlockHeader *block = NULL;
+  if (sizeClass < NUM_SIZE_CLASSES) {
+    block = popBlock(sizeClass);
+    __sync_add_and_fetch(&numBlockAllocations, 1);
+  } else {
+    // the message is too large for any size class. This is counted as a failure.
+    block = (MessageBlockHeader *) malloc(numBlockBytes);
+    block->sizeClass = BLOCK_KIND_SYSTEM;
+    __sync_add_and_fetch(&numFailedAllocations, 1);
+  }
+  __sync_add_and_fetch(&numLiveBlocks, 1);
+  return ((char *) block) + BLOCK_HEADER_BYTES;
+}
+
+void MessageAllocator::freeBlock(void *buffer) {
+  MessageBlockHeader *block = (MessageBlockHeader *) (((char *) buffer) - BLOCK_HEADER_BYTES);
+  __sync_sub_and_fetch(&numLiveBlocks, 1);
+  if (block->sizeClass >= 0) {
+    pushBlock(block);
+  } else if (block->sizeClass == BLOCK_KIND_SYSTEM) {
+    free(block);
+  } else {
+    // arena memory is reclaimed all at once when none of the messages in the half remain
+    __sync_sub_and_fetch(&numArenaMessages[BLOCK_KIND_ARENA - block->sizeClass], 1);
+  }
+}
+
+PdMessage *MessageAllocator::copyMessage(PdMessage *message) {
+  return message->copyToBuffer((char *) allocateBlock(message->numBytes()));
+}
+
+PdMessage *MessageAllocator::copyMessageToArena(PdMessage *message) {
+  unsigned int numBytes = (BLOCK_HEADER_BYTES + message->numBytes() + 15) & ~15;
+  int index = arenaIndex;
+  
+  // the message is counted before the space is claimed, such that the half is never reset while
+  // it is being written
+  __sync_add_and_fetch(&numArenaMessages[index], 1);
+  
+  // the space is claimed with a compare-and-swap, such that the position never passes the end of
+  // the half, however many claims fail
+  unsigned int position = 0;
+  do {
+    position = arenaPosition[index];
+    if (position + numBytes > ARENA_BYTES) {
+      __sync_sub_and_fetch(&numArenaMessages[index], 1);
+      return copyMessage(message);
+    }
+  } while (!__sync_bool_compare_and_swap(&arenaPosition[index], position, position + numBytes));
+  
+  MessageBlockHeader *block = (MessageBlockHeader *) (arena[index] + position);
+  block->sizeClass = BLOCK_KIND_ARENA - index;
+  __sync_add_and_fetch(&numArenaAllocations, 1);
+  __sync_add_and_fetch(&numLiveBlocks, 1);
+  return message->copyToBuffer(((char *) block) + BLOCK_HEADER_BYTES);
+}
+
+void MessageAllocator::freeMessage(PdMessage *message) {
+  freeBlock(message);
+}
+
+void MessageAllocator::beginBlock() {
+  int otherIndex = 1 - arenaIndex;
+  if (numArenaMessages[otherIndex] == 0) {
+    // all messages of the other half have been consumed. It is filled from the start.
+    arenaPosition[otherIndex] = 0;
+    arenaIndex = otherIndex;
+  } else if (numArenaMessages[arenaIndex] == 0) {
+    // a message lingers in the other half. Keep using this one, from the start.
+    arenaPosition[arenaIndex] = 0;
+  }
+}
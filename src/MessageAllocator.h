@@ -0,0 +1,178 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _MESSAGE_ALLOCATOR_H_
+#define _MESSAGE_ALLOCATOR_H_
+
+#include <pthread.h>
+#include "PdMessage.h"
+
+/**
+ * The header preceding every block handed out by the <code>MessageAllocator</code>. While a block
+ * is free, <code>next</code> links it into the free list of its size class.
+ */
+typedef struct MessageBlockHeader {
+  struct MessageBlockHeader *next;
+  
+  /** The size class of the block, or one of the negative block kinds. */
+  int sizeClass;
+} MessageBlockHeader;
+
+/**
+ * Allocates the memory of messages which are copied while a context is processing, such as
+ * scheduled messages and messages queued at the inlets of dsp objects.
+ *
+ * Blocks of a few fixed sizes are carved from slabs. Freed blocks are kept in a lock-free free list
+ * per size class, from which they are reused. Blocks may be allocated and freed on any thread.
+ * A reserve of free blocks is allocated for every size class up front. Once a free list falls
+ * below its low-water mark, a refill thread owned by the allocator tops it up again, such that the
+ * audio thread does not call <code>malloc()</code>. Only if a free list runs empty before it is
+ * refilled, or if a message is larger than the largest size class, is the memory allocated from the
+ * system on the calling thread. Both are counted as failed allocations.
+ *
+ * Messages which are consumed in the block in which they are sent are copied into an arena
+ * instead, by claiming its space with a compare-and-swap. The arena has two halves. At the start of every block the
+ * allocator switches to the other half if all messages in it have been freed, and starts to fill it
+ * again from the beginning.
+ */
+class MessageAllocator {
+  
+  public:
+    MessageAllocator();
+    ~MessageAllocator();
+  
+    /**
+     * Returns a block of at least the given number of bytes, aligned like <code>malloc()</code>.
+     * It must be returned with <code>freeBlock()</code>.
+     */
+    void *allocateBlock(unsigned int numBytes);
+  
+    /** Returns a block from <code>allocateBlock()</code> to the allocator. */
+    void freeBlock(void *block);
+  
+    /**
+     * Returns a copy of the message. It must be freed with <code>freeMessage()</code>.
+     */
+    PdMessage *copyMessage(PdMessage *message);
+  
+    /**
+     * Returns a copy of the message in the arena. It must be freed with
+     * <code>freeMessage()</code>, which should happen within a block or two. If the arena is full,
+     * the message is copied with <code>copyMessage()</code> instead.
+     */
+    PdMessage *copyMessageToArena(PdMessage *message);
+  
+    /** Frees a message returned by <code>copyMessage()</code> or <code>copyMessageToArena()</code>. */
+    void freeMessage(PdMessage *message);
+  
+    /**
+     * Called at the start of every block, while no messages are allocated. The arena half which is
+     * not in use is reset and used from now on if it has no messages left.
+     */
+    void beginBlock();
+  
+    /** The number of blocks which have been taken from the free lists. */
+    unsigned long long getNumBlockAllocations() { return numBlockAllocations; }
+  
+    /** The number of messages which have been copied into the arena. */
+    unsigned long long getNumArenaAllocations() { return numArenaAllocations; }
+  
+    /**
+     * The number of allocations which had to call <code>malloc()</code> on the calling thread,
+     * because the free list was empty or the block was too large for any size class.
+     */
+    unsigned long long getNumFailedAllocations() { return numFailedAllocations; }
+  
+    /** The number of slabs which have been allocated from the system. */
+    unsigned int getNumSlabs() { return numSlabs; }
+  
+    /** The number of blocks and arena messages which have not yet been freed. */
+    int getNumLiveBlocks() { return numLiveBlocks; }
+  
+  private:
+    /**
+     * Takes a block from the free list of the given size class. The refill thread is woken if the
+     * list falls below its low-water mark.
+     */
+    MessageBlockHeader *popBlock(int sizeClass);
+  
+    /** Returns a block to the free list of its size class. */
+    void pushBlock(MessageBlockHeader *block);
+  
+    /** Allocates a new slab and adds its blocks to the free list of the given size class. */
+    void allocateSlab(int sizeClass);
+  
+    /** Allocates slabs until the reserve of every size class is full. */
+    void refill();
+  
+    /** Wakes the refill thread. Never blocks, such that it may be called from the audio thread. */
+    void requestRefill();
+  
+    /** The loop of the refill thread. */
+    static void *refillThreadFunction(void *allocator);
+  
+    /**
+     * The head of the free list of each size class. The lower bits hold the pointer to the first
+     * block, the upper bits a tag which changes with every update, which prevents a stale head
+     * from being swapped back in (the ABA problem).
+     */
+    volatile unsigned long long *freeListHeads;
+  
+    /** The number of blocks in the free list of each size class. Updated atomically. */
+    volatile int *numFreeBlocks;
+  
+    /** All slabs, linked through their first bytes, so that they can be freed. */
+    void *volatile slabList;
+  
+    /** The two halves of the arena. */
+    char *arena[2];
+  
+    /**
+     * The number of bytes used in each half of the arena. Updated with a compare-and-swap, such
+     * that it never exceeds the size of the half.
+     */
+    volatile unsigned int arenaPosition[2];
+  
+    /** The number of messages in each half of the arena which have not been freed. */
+    volatile int numArenaMessages[2];
+  
+    /** The half of the arena in which messages are currently allocated. */
+    volatile int arenaIndex;
+  
+    volatile unsigned long long numBlockAllocations;
+    volatile unsigned long long numArenaAllocations;
+    volatile unsigned long long numFailedAllocations;
+    volatile unsigned int numSlabs;
+    volatile int numLiveBlocks;
+  
+    pthread_t refillThread;
+    pthread_mutex_t refillMutex;
+    pthread_cond_t refillCondition;
+  
+    /** True while the refill thread has been asked to refill the free lists. */
+    volatile bool isRefillRequested;
+  
+    /** False once the refill thread should stop. */
+    volatile bool isRunning;
+};
+
+#endif // _MESSAGE_ALLOCATOR_H_
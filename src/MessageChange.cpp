@@ -21,6 +21,7 @@
  */
 
 #include "MessageChange.h"
+#include "SymbolTable.h"
 
 MessageObject *MessageChange::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new MessageChange(initMessage, graph);
@@ -59,7 +60,7 @@ void MessageChange::processMessage(int inletIndex, PdMessage *message) {
       break;
     }
     case SYMBOL: {
-      if (message->isSymbol(0, "set") && message->isFloat(1)) {
+      if (message->isInternedSymbol(0, SymbolTable::SET) && message->isFloat(1)) {
         prevValue = message->getFloat(1);
       }
       break;
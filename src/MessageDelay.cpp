@@ -22,6 +22,7 @@
 
 #include "MessageDelay.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 MessageObject *MessageDelay::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new MessageDelay(initMessage, graph);
@@ -52,7 +53,7 @@ void MessageDelay::processMessage(int inletIndex, PdMessage *message) {
     case 0: {
       switch (message->getType(0)) {
         case SYMBOL: {
-          if (message->isSymbol(0, "stop")) {
+          if (message->isInternedSymbol(0, SymbolTable::STOP)) {
             cancelScheduledMessageIfExists();
             break;
           }
@@ -22,6 +22,7 @@
 
 #include "MessageLine.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 #define DEFAULT_GRAIN_RATE 20.0 // 20ms
 
@@ -58,7 +59,7 @@ void MessageLine::processMessage(int inletIndex, PdMessage *message) {
             PdMessage *outgoingMessage = PD_MESSAGE_ON_STACK(1);
             outgoingMessage->initWithTimestampAndFloat(message->getTimestamp(), currentValue);
             sendMessage(0, outgoingMessage);
-          } else if (message->isSymbol(0, "stop")) {
+          } else if (message->isInternedSymbol(0, SymbolTable::STOP)) {
             cancelPendingMessage();
           }
           break;
@@ -86,7 +87,7 @@ void MessageLine::processMessage(int inletIndex, PdMessage *message) {
               outgoingMessage->initWithTimestampAndFloat(message->getTimestamp(), currentValue);
               sendMessage(0, outgoingMessage);
             }
-          } else if (message->isSymbol(0, "set") && message->isFloat(1)) {
+          } else if (message->isInternedSymbol(0, SymbolTable::SET) && message->isFloat(1)) {
             cancelPendingMessage();
             
             // set the current value to the given input, without outputting any message
@@ -21,6 +21,7 @@
  */
 
 #include "MessageMakefilename.h"
+#include "SymbolTable.h"
 
 MessageObject *MessageMakefilename::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new MessageMakefilename(initMessage, graph);
@@ -46,7 +47,7 @@ void MessageMakefilename::processMessage(int inletIndex, PdMessage *message) {
         break;
       }
       case SYMBOL: {
-        if (message->isSymbol(0, "set") && message->isSymbol(1)) {
+        if (message->isInternedSymbol(0, SymbolTable::SET) && message->isSymbol(1)) {
           free(format);
           format = StaticUtils::copyString(message->getSymbol(1));
         } else {
@@ -98,6 +98,7 @@ MessageMessageBox::~MessageMessageBox() {
 void MessageMessageBox::processMessage(int inletIndex, PdMessage *message) {
 #define RES_BUFFER_LENGTH 64
   char resolvedName[RES_BUFFER_LENGTH]; // resolution buffer for named destination
+  char resolvedSymbol[RES_BUFFER_LENGTH]; // resolution buffer for symbols, which are interned
   
   // NOTE(mhroth): if any message has more than 64 elements, that's very bad
   PdMessage *outgoingMessage = PD_MESSAGE_ON_STACK(64);
@@ -110,10 +111,8 @@ void MessageMessageBox::processMessage(int inletIndex, PdMessage *message) {
     memcpy(outgoingMessage->getElement(0), messageTemplate->getElement(0), numElements*sizeof(MessageAtom));
     for (int i = 0; i < numElements; i++) {
       if (messageTemplate->isSymbol(i)) {
-        char *buffer = (char *) alloca(RES_BUFFER_LENGTH * sizeof(char));
-        // TODO(mhroth): resolve string, but may be in stack buffer
-        PdMessage::resolveString(messageTemplate->getSymbol(i), message, 1, buffer, RES_BUFFER_LENGTH);
-        outgoingMessage->parseAndSetMessageElement(i, buffer); // buffer is resolved to float or string
+        PdMessage::resolveString(messageTemplate->getSymbol(i), message, 1, resolvedSymbol, RES_BUFFER_LENGTH);
+        outgoingMessage->parseAndSetMessageElement(i, resolvedSymbol); // resolved to float or string
       }
     }
     sendMessage(0, outgoingMessage);
@@ -131,10 +130,8 @@ void MessageMessageBox::processMessage(int inletIndex, PdMessage *message) {
     memcpy(outgoingMessage->getElement(0), messageTemplate->getElement(0), numElements*sizeof(MessageAtom));
     for (int i = 0; i < numElements; i++) {
       if (messageTemplate->isSymbol(i)) {
-        char *buffer = (char *) alloca(RES_BUFFER_LENGTH * sizeof(char));
-        // TODO(mhroth): resolve string, but may be in stack buffer
-        PdMessage::resolveString(messageTemplate->getSymbol(i), message, 1, buffer, RES_BUFFER_LENGTH);
-        outgoingMessage->setSymbol(i, buffer);
+        PdMessage::resolveString(messageTemplate->getSymbol(i), message, 1, resolvedSymbol, RES_BUFFER_LENGTH);
+        outgoingMessage->setSymbol(i, resolvedSymbol);
       }
     }
     graph->sendMessageToNamedReceivers(resolvedName, outgoingMessage);
@@ -22,6 +22,7 @@
 
 #include "MessageMetro.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 MessageObject *MessageMetro::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new MessageMetro(initMessage, graph);
@@ -57,7 +58,7 @@ void MessageMetro::processMessage(int inletIndex, PdMessage *message) {
           break;
         }
         case SYMBOL: {
-          if (message->isSymbol(0, "stop")) {
+          if (message->isInternedSymbol(0, SymbolTable::STOP)) {
             stopMetro();
           }
           break;
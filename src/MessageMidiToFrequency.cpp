@@ -20,6 +20,7 @@
  *
  */
 
+#include "LookupTable.h"
 #include "MessageMidiToFrequency.h"
 
 MessageObject *MessageMidiToFrequency::newObject(PdMessage *initMessage, PdGraph *graph) {
@@ -41,7 +42,7 @@ const char *MessageMidiToFrequency::getObjectLabel() {
 void MessageMidiToFrequency::processMessage(int inletIndex, PdMessage *message) {
   if (message->isFloat(0)) {
     PdMessage *outgoingMessage = PD_MESSAGE_ON_STACK(1);
-    float value = 440.0f * powf(2.0f, (message->getFloat(0) - 69.0f) / 12.0f);
+    float value = LookupTable::midiToFrequency(message->getFloat(0));
     outgoingMessage->initWithTimestampAndFloat(message->getTimestamp(), value);
     sendMessage(0, outgoingMessage);
   }
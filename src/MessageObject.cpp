@@ -21,6 +21,7 @@
  */
 
 #include "MessageObject.h"
+#include "PdContext.h"
 #include "PdGraph.h"
 
 MessageObject::MessageObject(int numMessageInlets, int numMessageOutlets, PdGraph *graph) {
@@ -33,10 +34,11 @@ MessageObject::MessageObject(int numMessageInlets, int numMessageOutlets, PdGrap
   
   // initialise outgoing connections list
   outgoingMessageConnections = vector<list<ObjectLetPair> >(numMessageOutlets);
+  dispatchMessageConnections = new vector<list<ObjectLetPair> >(numMessageOutlets);
 }
 
 MessageObject::~MessageObject() {
-  // nothing to do
+  delete dispatchMessageConnections;
 }
 
 ConnectionType MessageObject::getConnectionType(int outletIndex) {
@@ -86,8 +88,8 @@ void MessageObject::receiveMessage(int inletIndex, PdMessage *message) {
 }
 
 void MessageObject::sendMessage(int outletIndex, PdMessage *message) {
-  list<ObjectLetPair>::iterator it = outgoingMessageConnections[outletIndex].begin();
-  list<ObjectLetPair>::iterator end = outgoingMessageConnections[outletIndex].end();
+  list<ObjectLetPair>::iterator it = (*dispatchMessageConnections)[outletIndex].begin();
+  list<ObjectLetPair>::iterator end = (*dispatchMessageConnections)[outletIndex].end();
   while (it != end) {
     ObjectLetPair objectLetPair = *it++;
     objectLetPair.first->receiveMessage(objectLetPair.second, message);
@@ -115,6 +117,7 @@ void MessageObject::addConnectionToObjectFromOutlet(MessageObject *messageObject
     list<ObjectLetPair> *connections = &outgoingMessageConnections[outletIndex];
     ObjectLetPair objectLetPair = make_pair(messageObject, inletIndex);
     connections->push_back(objectLetPair);
+    updateDispatchMessageConnections();
   }
 }
 
@@ -131,6 +134,23 @@ void MessageObject::removeConnectionToObjectFromOutlet(MessageObject *messageObj
   list<ObjectLetPair> *outgoingConnections = &outgoingMessageConnections[outletIndex];
   ObjectLetPair objectLetPair = make_pair(messageObject, inletIndex);
   outgoingConnections->remove(objectLetPair);
+  updateDispatchMessageConnections();
+}
+
+void MessageObject::updateDispatchMessageConnections() {
+  if (graph != NULL && graph->isLive()) {
+    // the audio thread may be sending messages along the current connections
+    graph->getContext()->setDispatchMessageConnections(this,
+        new vector<list<ObjectLetPair> >(outgoingMessageConnections));
+  } else {
+    *dispatchMessageConnections = outgoingMessageConnections;
+  }
+}
+
+void MessageObject::swapDispatchMessageConnections(vector<list<ObjectLetPair> > **messageConnections) {
+  vector<list<ObjectLetPair> > *connections = dispatchMessageConnections;
+  dispatchMessageConnections = *messageConnections;
+  *messageConnections = connections;
 }
 
 list<ObjectLetPair> MessageObject::getIncomingConnections(unsigned int inletIndex) {
@@ -101,6 +101,12 @@ class MessageObject {
     void updateIncomingMessageConnection(MessageObject *messageObject, int oldOutletIndex,
         int inletIndex, int newOutletIndex);
   
+    /**
+     * Exchanges the outgoing message connections along which messages are sent with the given
+     * ones. Called on the audio thread when the edits of a live graph are applied.
+     */
+    void swapDispatchMessageConnections(vector<list<ObjectLetPair> > **messageConnections);
+  
     /** Returns the label for this object. */
     static const char *getObjectLabel() { return "obj"; }
     virtual string toString() { return string(getObjectLabel()); }
@@ -164,8 +170,19 @@ class MessageObject {
     vector<list<ObjectLetPair> > incomingMessageConnections;
     vector<list<ObjectLetPair> > outgoingMessageConnections;
   
+    /**
+     * The outgoing message connections along which messages are sent. They are a copy of
+     * <code>outgoingMessageConnections</code>, which is only handed to the audio thread once the
+     * edits of a live graph are applied.
+     */
+    vector<list<ObjectLetPair> > *dispatchMessageConnections;
+  
     /** A flag indicating that this object has already been considered when ordering the process tree. */
     bool isOrdered;
+  
+  private:
+    /** Updates <code>dispatchMessageConnections</code> after the outgoing connections have changed. */
+    void updateDispatchMessageConnections();
 };
 
 #endif // _MESSAGE_OBJECT_H_
@@ -22,6 +22,7 @@
 
 #include "MessagePipe.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 MessageObject *MessagePipe::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new MessagePipe(initMessage, graph);
@@ -44,8 +45,13 @@ bool MessagePipe::shouldDistributeMessageToInlets() {
 }
 
 void MessagePipe::sendMessage(int outletIndex, PdMessage *message) {
-  // remove the scheduled message from the list before it is sent
-  scheduledMessagesList.remove(message);
+  // remove the scheduled message from the list before it is sent. Messages are usually sent in the
+  // order in which they were scheduled, so the message is almost always at the front of the list.
+  if (!scheduledMessagesList.empty() && scheduledMessagesList.front() == message) {
+    scheduledMessagesList.pop_front();
+  } else {
+    scheduledMessagesList.remove(message);
+  }
   MessageObject::sendMessage(outletIndex, message);
 }
 
@@ -66,7 +72,7 @@ void MessagePipe::processMessage(int inletIndex, PdMessage *message) {
             }
             scheduledMessagesList.clear();
             break;
-          } else if (message->isSymbol(0, "clear")) {
+          } else if (message->isInternedSymbol(0, SymbolTable::CLEAR)) {
             // cancel all scheduled messages
             for(list<PdMessage *>::iterator it = scheduledMessagesList.begin();
                 it != scheduledMessagesList.end(); it++) {
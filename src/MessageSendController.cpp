@@ -20,17 +20,21 @@
  *
  */
 
+#include <algorithm>
+#include <stdint.h>
 #include "MessageSendController.h"
 #include "PdContext.h"
+#include "SymbolTable.h"
 
 // a special index for referencing the system "pd" receiver
 #define SYSTEM_NAME_INDEX 0x7FFFFFFF
 
-// it might nice if this class were implemented using a hashtable with receiver name as the key
-// and Lists as the value.
+// the initial number of slots in the name hash table. Must be a power of two.
+#define INITIAL_NAME_TABLE_LENGTH 64
+
 MessageSendController::MessageSendController(PdContext *aContext) : MessageObject(0, 0, NULL) {
   context = aContext;
-  sendStack = vector<std::pair<string, set<RemoteMessageReceiver *> > >();
+  nameTable = vector<int>(INITIAL_NAME_TABLE_LENGTH, -1);
 }
 
 MessageSendController::~MessageSendController() {
@@ -45,16 +49,53 @@ bool MessageSendController::receiverExists(const char *receiverName) {
   return (getNameIndex(receiverName) >= 0);
 }
 
+unsigned int MessageSendController::findSlot(char *name) {
+  // the address is mixed with a multiplicative hash, and the table is probed linearly
+  unsigned int mask = nameTable.size() - 1;
+  unsigned int slot = (unsigned int) ((((unsigned long long) (uintptr_t) name) * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+  while (nameTable[slot] != -1 && receiverLists[nameTable[slot]].name != name) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+void MessageSendController::growNameTable() {
+  nameTable = vector<int>(2 * nameTable.size(), -1);
+  for (int i = 0; i < receiverLists.size(); i++) {
+    nameTable[findSlot(receiverLists[i].name)] = i;
+  }
+}
+
 int MessageSendController::getNameIndex(const char *receiverName) {
   if (!strcmp("pd", receiverName)) {
     return SYSTEM_NAME_INDEX; // a special case for sending messages to the system
   }
   
-  for (int i = 0; i < sendStack.size(); i++) {
-    string str = sendStack[i].first;
-    if (!str.compare(receiverName)) return i;
-  }  
-  return -1;
+  // a name which has never been interned cannot have been registered
+  char *name = SymbolTable::lookup(receiverName);
+  if (name == NULL) return -1;
+  return nameTable[findSlot(name)];
+}
+
+int MessageSendController::resolveNameIndex(const char *receiverName) {
+  int nameIndex = getNameIndex(receiverName);
+  if (nameIndex == -1) {
+    ReceiverList receiverList;
+    receiverList.name = SymbolTable::intern(receiverName);
+    receiverList.isExternal = false;
+    receiverList.numDispatches = 0;
+    receiverList.hasRemovedReceivers = false;
+    nameIndex = receiverLists.size();
+    receiverLists.push_back(receiverList);
+    
+    // the table is kept at most half full
+    if (2 * receiverLists.size() > nameTable.size()) {
+      growNameTable();
+    } else {
+      nameTable[findSlot(receiverList.name)] = nameIndex;
+    }
+  }
+  return nameIndex;
 }
 
 void MessageSendController::receiveMessage(const char *name, PdMessage *message) {
@@ -64,7 +105,7 @@ void MessageSendController::receiveMessage(const char *name, PdMessage *message)
   if (index >= 0) sendMessage(index, message);
   
   // check to see if the receiver name has been registered as an external receiver
-  if (externalReceiverSet.find(string(name)) != externalReceiverSet.end()) {
+  if (index >= 0 && index != SYSTEM_NAME_INDEX && receiverLists[index].isExternal) {
     std::pair<const char *, PdMessage *> pair = make_pair(name, message);
     context->callbackFunction(ZG_RECEIVER_MESSAGE, context->callbackUserData, &pair);
   }
@@ -74,48 +115,61 @@ void MessageSendController::sendMessage(int outletIndex, PdMessage *message) {
   if (outletIndex == SYSTEM_NAME_INDEX) {
     context->receiveSystemMessage(message);
   } else {
-    set<RemoteMessageReceiver *> receiverSet = sendStack[outletIndex].second;
-    for (set<RemoteMessageReceiver *>::iterator it = receiverSet.begin(); it != receiverSet.end(); ++it) {
-      RemoteMessageReceiver *receiver = *it;
-      receiver->receiveMessage(0, message);
+    // Receivers may be added or removed while the message is delivered, which may reallocate the
+    // lists. They are therefore indexed anew for every receiver, rather than copied. Every receiver
+    // which is present now is visited exactly once. Those which are removed in the meantime are
+    // replaced by NULL and skipped, those which are added are appended and not visited.
+    int numReceivers = receiverLists[outletIndex].receivers.size();
+    receiverLists[outletIndex].numDispatches++;
+    for (int i = 0; i < numReceivers; i++) {
+      RemoteMessageReceiver *receiver = receiverLists[outletIndex].receivers[i];
+      if (receiver != NULL) receiver->receiveMessage(0, message);
+    }
+    ReceiverList *receiverList = &(receiverLists[outletIndex]);
+    if (--(receiverList->numDispatches) == 0 && receiverList->hasRemovedReceivers) {
+      receiverList->receivers.erase(remove(receiverList->receivers.begin(), receiverList->receivers.end(),
+          (RemoteMessageReceiver *) NULL), receiverList->receivers.end());
+      receiverList->hasRemovedReceivers = false;
     }
   }
 }
 
 void MessageSendController::addReceiver(RemoteMessageReceiver *receiver) {
-  int nameIndex = getNameIndex(receiver->getName());
-  if (nameIndex == -1) {
-    set<RemoteMessageReceiver *> remoteSet = set<RemoteMessageReceiver *>();
-    remoteSet.insert(receiver);
-    std::pair<string, set<RemoteMessageReceiver *> > nameSetPair =
-        make_pair(string(receiver->getName()), remoteSet);
-    sendStack.push_back(nameSetPair);
-    nameIndex = sendStack.size()-1;
+  int nameIndex = resolveNameIndex(receiver->getName());
+  if (nameIndex == SYSTEM_NAME_INDEX) return;
+  vector<RemoteMessageReceiver *> *receivers = &(receiverLists[nameIndex].receivers);
+  for (int i = 0; i < receivers->size(); i++) {
+    if (receivers->at(i) == receiver) return; // each receiver is only added once
   }
-  
-  set<RemoteMessageReceiver *> *receiverSet = &(sendStack[nameIndex].second);
-  receiverSet->insert(receiver);
+  receivers->push_back(receiver);
 }
 
 void MessageSendController::removeReceiver(RemoteMessageReceiver *receiver) {
   int nameIndex = getNameIndex(receiver->getName());
-  if (nameIndex != -1) {
-    set<RemoteMessageReceiver *> *receiverSet = &(sendStack[nameIndex].second);
-    receiverSet->erase(receiver);
-    // NOTE(mhroth):
-    // once the receiver set has been created, it should not be erased anymore from the sendStack.
-    // PdContext depends on the nameIndex to be constant for all receiver names once they are
-    // defined, as a message destined for that receiver may already be in the message queue
-    // with the given index. If the indicies change, then message will be sent to the wrong
-    // receiver set. This is a stupid constraint. Fix it.
+  if (nameIndex != -1 && nameIndex != SYSTEM_NAME_INDEX) {
+    // the list itself remains, such that the name index stays valid
+    vector<RemoteMessageReceiver *> *receivers = &(receiverLists[nameIndex].receivers);
+    for (int i = 0; i < receivers->size(); i++) {
+      if (receivers->at(i) == receiver) {
+        if (receiverLists[nameIndex].numDispatches > 0) {
+          // the list is being traversed. It is compacted once the delivery has finished.
+          receivers->at(i) = NULL;
+          receiverLists[nameIndex].hasRemovedReceivers = true;
+        } else {
+          receivers->erase(receivers->begin() + i);
+        }
+        break;
+      }
+    }
   }
 }
 
 void MessageSendController::registerExternalReceiver(const char *receiverName) {
-  // sets only contain unique items
-  externalReceiverSet.insert(string(receiverName));
+  int nameIndex = resolveNameIndex(receiverName);
+  if (nameIndex != SYSTEM_NAME_INDEX) receiverLists[nameIndex].isExternal = true;
 }
 
 void MessageSendController::unregisterExternalReceiver(const char *receiverName) {
-  externalReceiverSet.erase(string(receiverName));
+  int nameIndex = getNameIndex(receiverName);
+  if (nameIndex != -1 && nameIndex != SYSTEM_NAME_INDEX) receiverLists[nameIndex].isExternal = false;
 }
@@ -23,13 +23,34 @@
 #ifndef _MESSAGE_SEND_CONTROLLER_H_
 #define _MESSAGE_SEND_CONTROLLER_H_
 
-#include <set>
-#include <string>
+#include <vector>
 #include "MessageObject.h"
 #include "RemoteMessageReceiver.h"
 
 class PdContext;
 
+/** The receivers which are registered under one name. */
+typedef struct ReceiverList {
+  /** The interned name of the receivers. */
+  char *name;
+  
+  /** The receivers, in the order in which they were added. */
+  vector<RemoteMessageReceiver *> receivers;
+  
+  /** True if messages to this name are also passed to the context callback. */
+  bool isExternal;
+  
+  /**
+   * The number of messages which are currently being delivered to the receivers. Receivers which
+   * are removed in the meantime are only replaced by <code>NULL</code>, and the list is compacted
+   * once the last delivery has finished.
+   */
+  int numDispatches;
+  
+  /** True if the list holds receivers which were removed during a delivery. */
+  bool hasRemovedReceivers;
+} ReceiverList;
+
 /**
  * Because of features such as external message injection and implicit message sending from message
  * boxes, it must be possible to [send] a message to associated [receive]ers without explicitly
@@ -45,6 +66,10 @@ class PdContext;
  * Alternatively, a message can be sent to receivers using <code>receiveMessage()</code> with
  * name and message arguments (instead of inlet index and message). Messages sent using this
  * alternative will be sent right away (avoiding the message queue).
+ *
+ * Receiver names are interned and mapped to their index with an open addressing hash table, which
+ * is keyed on the address of the interned name. Messages are dispatched directly from the receiver
+ * list of the index, in the order in which the receivers were added.
  */
 class MessageSendController : public MessageObject {
   
@@ -68,6 +93,13 @@ class MessageSendController : public MessageObject {
      */
     int getNameIndex(const char *name);
   
+    /**
+     * Returns the index to which the given receiver name is referenced, adding the name if it is
+     * not yet known. The index remains valid for the lifetime of the controller, such that it may
+     * be used to address receivers which are only created later.
+     */
+    int resolveNameIndex(const char *name);
+  
     void addReceiver(RemoteMessageReceiver *receiver);
   
     void removeReceiver(RemoteMessageReceiver *receiver);
@@ -76,12 +108,23 @@ class MessageSendController : public MessageObject {
     void unregisterExternalReceiver(const char *receiverName);
   
   private:
+    /** Returns the slot of the hash table which holds, or would hold, the given interned name. */
+    unsigned int findSlot(char *name);
+  
+    /** Doubles the size of the hash table and reinserts all names. */
+    void growNameTable();
   
     PdContext *context;
   
-    vector<std::pair<string, set<RemoteMessageReceiver *> > > sendStack;
+    /**
+     * The receivers of every known name, by name index. Lists are never removed, such that the
+     * index of a name remains constant once it has been defined, as messages destined for that
+     * name may already be waiting in the message queue.
+     */
+    vector<ReceiverList> receiverLists;
   
-    set<string> externalReceiverSet;
+    /** Maps interned names to their index in <code>receiverLists</code>. Empty slots are -1. */
+    vector<int> nameTable;
 };
 
 #endif // _MESSAGE_SEND_CONTROLLER_H_
@@ -78,6 +78,15 @@ float *MessageTable::resizeBuffer(int newBufferLength) {
   return buffer;
 }
 
+void MessageTable::swapBuffer(float **buffer, int *bufferLength) {
+  float *swapBuffer = this->buffer;
+  int swapBufferLength = this->bufferLength;
+  this->buffer = *buffer;
+  this->bufferLength = *bufferLength;
+  *buffer = swapBuffer;
+  *bufferLength = swapBufferLength;
+}
+
 void MessageTable::processMessage(int inletIndex, PdMessage *message) {
   // TODO(mhroth): process all of the commands which can be sent to tables
   if (message->isSymbol(0, "read")) {
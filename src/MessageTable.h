@@ -46,6 +46,12 @@ class MessageTable : public RemoteMessageReceiver {
      */
     float *resizeBuffer(int bufferLength);
   
+    /**
+     * Exchanges the table's buffer with the given one, which must have been allocated with
+     * <code>malloc()</code>. The given pointer and length then refer to the previous buffer.
+     */
+    void swapBuffer(float **buffer, int *bufferLength);
+  
   private:
     // tables can receive sent messages
     void processMessage(int inletIndex, PdMessage *message);
@@ -22,6 +22,7 @@
 
 #include "MessageTableRead.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 MessageObject *MessageTableRead::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new MessageTableRead(initMessage, graph);
@@ -68,7 +69,7 @@ void MessageTableRead::processMessage(int inletIndex, PdMessage *message) {
       break;
     }
     case SYMBOL: {
-      if (message->isSymbol(0, "set") && message->isSymbol(1)) {
+      if (message->isInternedSymbol(0, SymbolTable::SET) && message->isSymbol(1)) {
         free(name);
         name = StaticUtils::copyString(message->getSymbol(1));
         table = graph->getTable(name);
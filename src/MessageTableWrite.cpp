@@ -22,6 +22,7 @@
 
 #include "MessageTableWrite.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 
 MessageObject *MessageTableWrite::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new MessageTableWrite(initMessage, graph);
@@ -72,7 +73,7 @@ void MessageTableWrite::processMessage(int inletIndex, PdMessage *message) {
           break;
         }
         case SYMBOL: {
-          if (message->isSymbol(0, "set") && message->isSymbol(1)) {
+          if (message->isInternedSymbol(0, SymbolTable::SET) && message->isSymbol(1)) {
             free(name);
             name = StaticUtils::copyString(message->getSymbol(1));
             table = graph->getTable(name);
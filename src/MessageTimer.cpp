@@ -26,7 +26,7 @@ MessageObject *MessageTimer::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new MessageTimer(initMessage, graph);
 }
 
-MessageTimer::MessageTimer(PdMessage *initMessage, PdGraph *grap) : MessageObject(2, 1, graph) {
+MessageTimer::MessageTimer(PdMessage *initMessage, PdGraph *graph) : MessageObject(2, 1, graph) {
   timestampStart = 0.0;
 }
 
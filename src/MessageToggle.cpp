@@ -21,6 +21,7 @@
  */
 
 #include "MessageToggle.h"
+#include "SymbolTable.h"
 
 MessageObject *MessageToggle::newObject(PdMessage *initMessage, PdGraph *graph) {
   return new MessageToggle(initMessage, graph);
@@ -57,7 +58,7 @@ void MessageToggle::processMessage(int inletIndex, PdMessage *message) {
       break;
     }
     case SYMBOL: {
-      if (message->isSymbol(0, "set")) {
+      if (message->isInternedSymbol(0, SymbolTable::SET)) {
         if (message->isFloat(1)) {
           isOn = (message->getFloat(1) != 0.0f);
           if (isOn) onOutput = message->getFloat(1);
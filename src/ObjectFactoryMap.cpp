@@ -114,6 +114,7 @@
 #include "DspBang.h"
 #include "DspCatch.h"
 #include "DspClip.h"
+#include "DspConvolve.h"
 #include "DspCosine.h"
 #include "DspDac.h"
 #include "DspDelayRead.h"
@@ -254,6 +255,7 @@ ObjectFactoryMap::ObjectFactoryMap() {
   objectFactoryMap[string(DspBang::getObjectLabel())] = &DspBang::newObject;
   objectFactoryMap[string(DspCatch::getObjectLabel())] = &DspCatch::newObject;
   objectFactoryMap[string(DspClip::getObjectLabel())] = &DspClip::newObject;
+  objectFactoryMap[string(DspConvolve::getObjectLabel())] = &DspConvolve::newObject;
   objectFactoryMap[string(DspCosine::getObjectLabel())] = &DspCosine::newObject;
   objectFactoryMap[string(DspDac::getObjectLabel())] = &DspDac::newObject;
   objectFactoryMap[string(DspDelayRead::getObjectLabel())] = &DspDelayRead::newObject;
@@ -291,6 +293,7 @@ ObjectFactoryMap::ObjectFactoryMap() {
   objectFactoryMap[string(DspThrow::getObjectLabel())] = &DspThrow::newObject;
   objectFactoryMap[string(DspVariableDelay::getObjectLabel())] = &DspVariableDelay::newObject;
   objectFactoryMap[string(DspVariableLine::getObjectLabel())] = &DspVariableLine::newObject;
+  objectFactoryMap[string(DspVCF::getObjectLabel())] = &DspVCF::newObject;
   objectFactoryMap[string(DspWrap::getObjectLabel())] = &DspWrap::newObject;
 }
 
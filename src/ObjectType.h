@@ -30,15 +30,20 @@ enum ObjectType {
   DSP_BANDPASS_FILTER,
   DSP_CATCH,
   DSP_CLIP,
+  DSP_CONVOLVE,
   DSP_COSINE,
   DSP_DAC,
   DSP_TABLE_PLAY,
   DSP_DELAY_READ,
   DSP_DELAY_WRITE,
+  DSP_HIGHPASS_FILTER,
+  DSP_IMPLICIT_ADD,
   DSP_INLET,
+  DSP_LOWPASS_FILTER,
   DSP_OUTLET,
   DSP_RECEIVE,
   DSP_SEND,
+  DSP_SNAPSHOT,
   DSP_TABLE_READ,
   DSP_TABLE_READ4,
   DSP_THROW,
@@ -20,54 +20,115 @@
  *
  */
 
+#include <stddef.h>
 #include "OrderedMessageQueue.h"
 
-OrderedMessageQueue::OrderedMessageQueue() {
-  orderedMessageQueue = list<ObjectMessageLetPair>();
+OrderedMessageQueue::OrderedMessageQueue(MessageAllocator *messageAllocator) {
+  this->messageAllocator = messageAllocator;
+  nextInsertionIndex = 0;
 }
 
 OrderedMessageQueue::~OrderedMessageQueue() {
   // destroy all remaining inserted messages
-  for (list<ObjectMessageLetPair>::iterator it = orderedMessageQueue.begin();
-       it != orderedMessageQueue.end(); ++it) {
-    ObjectMessageLetPair omlPair = *it++;
-    omlPair.second.first->freeMessage();
+  for (int i = 0; i < heap.size(); i++) {
+    messageAllocator->freeBlock(heap[i]);
   }
 }
 
-void OrderedMessageQueue::insertMessage(MessageObject *messageObject, int outletIndex, PdMessage *message) {
-  ObjectMessageLetPair omlPair = make_pair(messageObject, make_pair(message, outletIndex));
-  for (list<ObjectMessageLetPair>::iterator it = orderedMessageQueue.begin();
-       it != orderedMessageQueue.end(); ++it) {
-    if (message->getTimestamp() < it->second.first->getTimestamp()) {
-      orderedMessageQueue.insert(it, omlPair);
-      return;
-    }
-  }
-  orderedMessageQueue.push_back(omlPair); // insert at end
+MessageQueueNode *OrderedMessageQueue::getNode(PdMessage *message) {
+  return (MessageQueueNode *) (((char *) message) - offsetof(MessageQueueNode, message));
 }
 
-void OrderedMessageQueue::removeMessage(MessageObject *messageObject, int outletIndex, PdMessage *message) {
-  for (list<ObjectMessageLetPair>::iterator it = orderedMessageQueue.begin();
-       it != orderedMessageQueue.end(); ++it) {
-    ObjectMessageLetPair omlPair = *it;
-    if (omlPair.first == messageObject &&
-        omlPair.second.first == message &&
-        omlPair.second.second == outletIndex) {
-      orderedMessageQueue.erase(it);
-      return;
-    }
+bool OrderedMessageQueue::isEarlier(MessageQueueNode *a, MessageQueueNode *b) {
+  double timestampA = a->message.getTimestamp();
+  double timestampB = b->message.getTimestamp();
+  return (timestampA < timestampB) ||
+      ((timestampA == timestampB) && (a->insertionIndex < b->insertionIndex));
+}
+
+PdMessage *OrderedMessageQueue::insertMessage(MessageObject *messageObject, int outletIndex, PdMessage *message) {
+  // allocate the node and the message at once
+  unsigned int numBytes = offsetof(MessageQueueNode, message) + message->numBytes();
+  MessageQueueNode *node = (MessageQueueNode *) messageAllocator->allocateBlock(numBytes);
+  node->messageObject = messageObject;
+  node->outletIndex = outletIndex;
+  node->insertionIndex = nextInsertionIndex++;
+  PdMessage *nodeMessage = message->copyToBuffer((char *) &(node->message));
+  
+  heap.push_back(node);
+  setNodeAtIndex(node, heap.size()-1);
+  siftUp(heap.size()-1);
+  return nodeMessage;
+}
+
+void OrderedMessageQueue::removeMessage(PdMessage *message) {
+  MessageQueueNode *node = getNode(message);
+  if (node->heapIndex >= 0) {
+    removeNodeAtIndex(node->heapIndex);
+    messageAllocator->freeBlock(node);
   }
 }
 
 ObjectMessageLetPair OrderedMessageQueue::peek() {
-  return orderedMessageQueue.front();
+  MessageQueueNode *node = heap.front();
+  return make_pair(node->messageObject, make_pair(&(node->message), node->outletIndex));
 }
 
 void OrderedMessageQueue::pop() {
-  orderedMessageQueue.pop_front();
+  removeNodeAtIndex(0);
+}
+
+void OrderedMessageQueue::freeMessage(PdMessage *message) {
+  messageAllocator->freeBlock(getNode(message));
 }
 
 bool OrderedMessageQueue::empty() {
-  return orderedMessageQueue.empty();
+  return heap.empty();
+}
+
+void OrderedMessageQueue::removeNodeAtIndex(int index) {
+  MessageQueueNode *node = heap[index];
+  node->heapIndex = -1;
+  MessageQueueNode *lastNode = heap.back();
+  heap.pop_back();
+  if (lastNode != node) {
+    // fill the gap with the last node and move it to its place
+    setNodeAtIndex(lastNode, index);
+    siftUp(index);
+    siftDown(lastNode->heapIndex);
+  }
+}
+
+void OrderedMessageQueue::siftUp(int index) {
+  MessageQueueNode *node = heap[index];
+  while (index > 0) {
+    int parentIndex = (index-1) >> 1;
+    MessageQueueNode *parent = heap[parentIndex];
+    if (!isEarlier(node, parent)) break;
+    setNodeAtIndex(parent, index);
+    index = parentIndex;
+  }
+  setNodeAtIndex(node, index);
+}
+
+void OrderedMessageQueue::siftDown(int index) {
+  MessageQueueNode *node = heap[index];
+  int numNodes = heap.size();
+  while (true) {
+    int childIndex = (index << 1) + 1;
+    if (childIndex >= numNodes) break;
+    if (childIndex+1 < numNodes && isEarlier(heap[childIndex+1], heap[childIndex])) {
+      ++childIndex; // choose the earlier of the two children
+    }
+    MessageQueueNode *child = heap[childIndex];
+    if (!isEarlier(child, node)) break;
+    setNodeAtIndex(child, index);
+    index = childIndex;
+  }
+  setNodeAtIndex(node, index);
+}
+
+void OrderedMessageQueue::setNodeAtIndex(MessageQueueNode *node, int index) {
+  heap[index] = node;
+  node->heapIndex = index;
 }
@@ -23,30 +23,92 @@
 #ifndef _ORDERED_MESSAGE_QUEUE_H_
 #define _ORDERED_MESSAGE_QUEUE_H_
 
+#include "MessageAllocator.h"
 #include "MessageObject.h"
 
 typedef std::pair<MessageObject *, std::pair<PdMessage *, unsigned int> > ObjectMessageLetPair;
 
+/**
+ * A scheduled message along with its destination. The message is stored at the end of the node,
+ * such that the node and message are a single block of the context's <code>MessageAllocator</code>.
+ */
+typedef struct MessageQueueNode {
+  MessageObject *messageObject;
+  unsigned int outletIndex;
+  
+  /** The position of the node in the heap, or -1 if the node is not in the queue. */
+  int heapIndex;
+  
+  /** Orders messages with equal timestamps by the order in which they were inserted. */
+  unsigned long long insertionIndex;
+  
+  PdMessage message; // must be the last field
+} MessageQueueNode;
+
+/**
+ * A priority queue of scheduled messages, implemented as a binary heap. Messages are ordered by
+ * timestamp, and messages with equal timestamps are delivered in the order in which they were
+ * inserted. The queue copies inserted messages and owns the copies. The pointer to a copy serves
+ * as a handle with which the message can be removed without searching the queue.
+ */
 class OrderedMessageQueue {
   
   public:
-    OrderedMessageQueue();
+    OrderedMessageQueue(MessageAllocator *messageAllocator);
     ~OrderedMessageQueue();
     
-    /** Inserts the message into the ordered queue based on its scheduled time. */
-    void insertMessage(MessageObject *messageObject, int outletIndex, PdMessage *message);
+    /**
+     * Inserts a copy of the message into the queue based on its scheduled time. The copy is
+     * returned and remains valid until it is removed with <code>removeMessage()</code>, or until it
+     * is released with <code>freeMessage()</code> after it has been popped.
+     */
+    PdMessage *insertMessage(MessageObject *messageObject, int outletIndex, PdMessage *message);
   
-    /** Removes the given message addressed to the given <code>MessageObject</code> from the queue. */
-    void removeMessage(MessageObject *messageObject, int outletIndex, PdMessage *message);
+    /**
+     * Removes the given message from the queue and frees it. The message must have been returned
+     * by <code>insertMessage()</code>. Nothing happens if the message is no longer in the queue.
+     */
+    void removeMessage(PdMessage *message);
   
     ObjectMessageLetPair peek();
   
+    /**
+     * Removes the earliest message from the queue. The message is not freed and must be released
+     * with <code>freeMessage()</code> once it has been sent.
+     */
     void pop();
   
+    /** Frees a message which has been popped from the queue. */
+    void freeMessage(PdMessage *message);
+  
     bool empty();
   
   private:
-    list<ObjectMessageLetPair> orderedMessageQueue;
+    /** Returns the node which contains the given message. */
+    static MessageQueueNode *getNode(PdMessage *message);
+  
+    /** Returns true if node <code>a</code> must be delivered before node <code>b</code>. */
+    static bool isEarlier(MessageQueueNode *a, MessageQueueNode *b);
+  
+    /** Removes the node at the given heap position and restores the heap order. */
+    void removeNodeAtIndex(int index);
+  
+    /** Moves the node at the given heap position towards the root until the heap is ordered. */
+    void siftUp(int index);
+  
+    /** Moves the node at the given heap position towards the leaves until the heap is ordered. */
+    void siftDown(int index);
+  
+    /** Places the node at the given heap position. */
+    void setNodeAtIndex(MessageQueueNode *node, int index);
+  
+    vector<MessageQueueNode *> heap;
+  
+    /** The allocator of the nodes. */
+    MessageAllocator *messageAllocator;
+  
+    /** The insertion index of the next inserted message. */
+    unsigned long long nextInsertionIndex;
 };
 
 #endif // _ORDERED_MESSAGE_QUEUE_H_
@@ -20,22 +20,34 @@
  *
  */
 
+#include <algorithm>
+#include <sched.h>
 #include "BufferPool.h"
+#include "DspFilterBank.h"
+#include "DspWorkerPool.h"
 #include "MessageSendController.h"
 #include "ObjectFactoryMap.h"
 #include "PdContext.h"
 #include "PdFileParser.h"
+#include "RealFft.h"
+#include "SymbolTable.h"
 
 #include "DelayReceiver.h"
 #include "DspCatch.h"
+#include "DspConvolve.h"
 #include "DspDelayWrite.h"
 #include "DspReceive.h"
 #include "DspSend.h"
+#include "DspTablePlay.h"
+#include "DspTableRead.h"
+#include "DspTableRead4.h"
 #include "DspThrow.h"
 #include "MessageMessageBox.h"
 #include "MessageFloat.h"
 #include "MessageSymbol.h"
 #include "MessageTable.h"
+#include "MessageTableRead.h"
+#include "MessageTableWrite.h"
 #include "TableReceiverInterface.h"
 
 #pragma mark Constructor/Deconstructor
@@ -50,10 +62,26 @@ PdContext::PdContext(int numInputChannels, int numOutputChannels, int blockSize,
   callbackUserData = userData;
   blockStartTimestamp = 0.0;
   blockDurationMs = ((double) blockSize / (double) sampleRate) * 1000.0;
-  messageCallbackQueue = new OrderedMessageQueue();
+
+  // use the widest array arithmetic kernels supported by this cpu
+  ArrayArithmetic::initKernels();
+
+  messageAllocator = new MessageAllocator();
+  messageCallbackQueue = new OrderedMessageQueue(messageAllocator);
+  graphCommandQueue = new GraphCommandQueue();
+  externalMessageQueue = new ExternalMessageQueue();
   objectFactoryMap = new ObjectFactoryMap();
   globalGraphId = 0;
-  bufferPool = new BufferPool(blockSize);
+  randomSeed = 0;
+  numRandomSeeds = 0;
+  workerPool = NULL;
+  isGraphGroupListValid = false;
+  graphGroupPlan = NULL;
+  editDepth = 0;
+  graphUpdate = NULL;
+  pendingGraphUpdate = NULL;
+  publishedGraphUpdate = NULL;
+  retiredGraphUpdate = NULL;
   
   numBytesInInputBuffers = blockSize * numInputChannels * sizeof(float);
   numBytesInOutputBuffers = blockSize * numOutputChannels * sizeof(float);
@@ -64,28 +92,50 @@ PdContext::PdContext(int numInputChannels, int numOutputChannels, int blockSize,
   
   sendController = new MessageSendController(this);
     
-  // configure the context lock, which is recursive
+  // configure the edit lock, which is recursive
   pthread_mutexattr_t mta;
   pthread_mutexattr_init(&mta);
   pthread_mutexattr_settype(&mta, PTHREAD_MUTEX_RECURSIVE);
-  pthread_mutex_init(&contextLock, &mta); 
+  pthread_mutex_init(&editLock, &mta);
+  pthread_mutex_init(&messageQueueLock, NULL);
+  pthread_mutex_init(&receiverHandleLock, NULL);
+  pthread_mutex_init(&realFftLock, NULL);
 }
 
 PdContext::~PdContext() {
+  // apply any outstanding edits, such that everything which they have retired is deleted
+  GraphUpdate *update = takeGraphUpdate();
+  if (update != NULL) applyGraphUpdate(update);
+  if (publishedGraphUpdate != NULL) freeGraphUpdate(publishedGraphUpdate);
+  delete graphCommandQueue;
+  
+  delete workerPool; // stop all worker threads before anything else is torn down
+  
   FREE_ALIGNED_BUFFER(globalDspInputBuffers);
   FREE_ALIGNED_BUFFER(globalDspOutputBuffers);
+  if (graphGroupPlan != NULL) freeGraphGroupPlan(graphGroupPlan);
   
+  delete externalMessageQueue;
   delete messageCallbackQueue;
   delete sendController;
   delete objectFactoryMap;
-  delete bufferPool;
   
   // delete all of the PdGraphs in the graph list
   for (int i = 0; i < graphList.size(); i++) {
     delete graphList[i];
   }
+  
+  // graphs may still hold messages from the allocator
+  delete messageAllocator;
+
+  for (map<int, RealFft *>::iterator it = realFftMap.begin(); it != realFftMap.end(); ++it) {
+    delete it->second;
+  }
 
-  pthread_mutex_destroy(&contextLock);
+  pthread_mutex_destroy(&realFftLock);
+  pthread_mutex_destroy(&receiverHandleLock);
+  pthread_mutex_destroy(&messageQueueLock);
+  pthread_mutex_destroy(&editLock);
 }
 
 
@@ -139,11 +189,45 @@ int PdContext::getNextGraphId() {
   return ++globalGraphId;
 }
 
+void PdContext::setRandomSeed(unsigned int seed) {
+  randomSeed = seed;
+  numRandomSeeds = 0;
+}
+
+unsigned int PdContext::getNextRandomSeed() {
+  // objects may be created on several threads at once, so each of them takes its own count.
+  // Consecutive seeds are decorrelated with the finaliser of MurmurHash3.
+  unsigned int h = randomSeed + __sync_add_and_fetch(&numRandomSeeds, 1) * 0x9E3779B9;
+  h ^= h >> 16;
+  h *= 0x85EBCA6B;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35;
+  h ^= h >> 16;
+  return h;
+}
+
 
 #pragma mark - process
 
 void PdContext::process(float *inputBuffers, float *outputBuffers) {
-  lock(); // lock the context
+  // reclaim the message arena of past blocks
+  messageAllocator->beginBlock();
+  
+  // Take the requests first. Edits published before any of them are then part of the update,
+  // such that the objects which they refer to have been added.
+  GraphCommand *commandList = graphCommandQueue->popAll();
+  
+  // switch to the graphs as last published by the editing thread
+  GraphUpdate *update = takeGraphUpdate();
+  if (update != NULL) applyGraphUpdate(update);
+  
+  executeGraphCommands(commandList);
+  
+  // the editing thread may now delete everything which is no longer used
+  if (update != NULL) __sync_bool_compare_and_swap(&retiredGraphUpdate, NULL, update);
+  
+  // schedule all messages which have been sent from other threads since the last block
+  dequeueExternalMessages();
   
   // set up adc~ buffers
   memcpy(globalDspInputBuffers, inputBuffers, numBytesInInputBuffers);
@@ -171,17 +255,32 @@ void PdContext::process(float *inputBuffers, float *outputBuffers) {
     }
     
     object->sendMessage(outletIndex, message);
-    message->freeMessage(); // free the message now that it has been sent and processed
+    messageCallbackQueue->freeMessage(message); // free the message now that it has been sent and processed
   }
   
-  switch (graphList.size()) {
-    case 0: break;
-    case 1: graphList.front()->processFunction(graphList.front(), 0, 0); break;
-    default: {
-      int numGraphs = graphList.size();
-      PdGraph **graph = &graphList.front();
-      for (int i = 0; i < numGraphs; ++i) {
-        graph[i]->processFunction(graph[i], 0, 0);
+  if (graphGroupPlan == NULL) {
+    // no graph has been attached yet
+  } else if (graphGroupPlan->graphGroupList.size() > 1) {
+    // independent graphs are processed in parallel. The first group writes directly to the global
+    // output buffers, all others to private buffers which are then mixed in a fixed order.
+    int numGroups = graphGroupPlan->graphGroupList.size();
+    graphGroupPlan->workerPool->execute(&processGraphGroup, this, numGroups);
+    int numSamples = numOutputChannels * blockSize;
+    for (int i = 1; i < numGroups; ++i) {
+      float *groupOutputBuffers = graphGroupPlan->graphGroupOutputBuffers + ((i-1) * numSamples);
+      ArrayArithmetic::add(globalDspOutputBuffers, groupOutputBuffers, globalDspOutputBuffers, 0, numSamples);
+    }
+  } else {
+    vector<PdGraph *> *graphList = &(graphGroupPlan->graphList);
+    switch (graphList->size()) {
+      case 0: break;
+      case 1: graphList->front()->processFunction(graphList->front(), 0, 0); break;
+      default: {
+        int numGraphs = graphList->size();
+        PdGraph **graph = &graphList->front();
+        for (int i = 0; i < numGraphs; ++i) {
+          graph[i]->processFunction(graph[i], 0, 0);
+        }
       }
     }
   }
@@ -190,25 +289,490 @@ void PdContext::process(float *inputBuffers, float *outputBuffers) {
   
   // copy the output audio to the given buffer
   memcpy(outputBuffers, globalDspOutputBuffers, numBytesInOutputBuffers);
+}
+
+
+void PdContext::processGraphGroup(void *context, int groupIndex) {
+  PdContext *c = reinterpret_cast<PdContext *>(context);
+  GraphGroupPlan *graphGroupPlan = c->graphGroupPlan;
+  if (groupIndex > 0) {
+    float *groupOutputBuffers = graphGroupPlan->graphGroupOutputBuffers
+        + ((groupIndex-1) * c->numOutputChannels * c->blockSize);
+    memset(groupOutputBuffers, 0, c->numBytesInOutputBuffers);
+  }
+  vector<PdGraph *> *graphGroup = &(graphGroupPlan->graphGroupList[groupIndex]);
+  for (int i = 0; i < graphGroup->size(); ++i) {
+    PdGraph *graph = graphGroup->at(i);
+    graph->processFunction(graph, 0, 0);
+  }
+}
+
+
+#pragma mark - Worker Threads
+
+void PdContext::setNumWorkerThreads(int numThreads) {
+  beginEdit();
+  // the audio thread may still be using the previous pool
+  if (workerPool != NULL) graphUpdate->deletedWorkerPoolList.push_back(workerPool);
+  workerPool = (numThreads > 0) ? new DspWorkerPool(numThreads) : NULL;
+  isGraphGroupListValid = false;
+  endEdit();
+}
+
+int PdContext::getNumWorkerThreads() {
+  return (workerPool != NULL) ? workerPool->getNumThreads() : 0;
+}
+
+void PdContext::getSharedResourceNames(PdGraph *graph, list<string> *names) {
+  // names are prefixed with the kind of resource. Pd names may not contain spaces.
+  list<MessageObject *> nodeList = graph->getNodeList();
+  for (list<MessageObject *>::iterator it = nodeList.begin(); it != nodeList.end(); ++it) {
+    MessageObject *messageObject = *it;
+    switch (messageObject->getObjectType()) {
+      case DSP_SEND: names->push_back(string("send~ ") + ((DspSend *) messageObject)->getName()); break;
+      case DSP_RECEIVE: names->push_back(string("send~ ") + ((DspReceive *) messageObject)->getName()); break;
+      case DSP_THROW: names->push_back(string("throw~ ") + ((DspThrow *) messageObject)->getName()); break;
+      case DSP_CATCH: names->push_back(string("throw~ ") + ((DspCatch *) messageObject)->getName()); break;
+      case DSP_DELAY_WRITE: {
+        names->push_back(string("delwrite~ ") + ((DspDelayWrite *) messageObject)->getName());
+        break;
+      }
+      case DSP_DELAY_READ:
+      case DSP_VARIABLE_DELAY: {
+        names->push_back(string("delwrite~ ") + ((DelayReceiver *) messageObject)->getName());
+        break;
+      }
+      case MESSAGE_TABLE: {
+        names->push_back(string("table ") + ((MessageTable *) messageObject)->getName());
+        names->push_back(string("receive"));
+        break;
+      }
+      case MESSAGE_TABLE_READ: {
+        names->push_back(string("table ") + ((MessageTableRead *) messageObject)->getName());
+        break;
+      }
+      case MESSAGE_TABLE_WRITE: {
+        names->push_back(string("table ") + ((MessageTableWrite *) messageObject)->getName());
+        break;
+      }
+      case DSP_CONVOLVE: names->push_back(string("table ") + ((DspConvolve *) messageObject)->getName()); break;
+      case DSP_TABLE_PLAY: names->push_back(string("table ") + ((DspTablePlay *) messageObject)->getName()); break;
+      case DSP_TABLE_READ: names->push_back(string("table ") + ((DspTableRead *) messageObject)->getName()); break;
+      case DSP_TABLE_READ4: names->push_back(string("table ") + ((DspTableRead4 *) messageObject)->getName()); break;
+      case MESSAGE_RECEIVE:
+      case MESSAGE_NOTEIN: names->push_back(string("receive")); break;
+      case OBJECT_PD: getSharedResourceNames((PdGraph *) messageObject, names); break;
+      default: {
+        if (messageObject->doesProcessAudio()) {
+          DspObject *dspObject = (DspObject *) messageObject;
+          if (dspObject->doesSendMessages()) names->push_back(string("snapshot~"));
+          if (dspObject->doesScheduleMessages()) names->push_back(string("scheduled messages"));
+        }
+        break;
+      }
+    }
+  }
+}
+
+void PdContext::updateGraphGroups() {
+  GraphGroupPlan *plan = new GraphGroupPlan();
+  plan->graphList = graphList;
+  plan->workerPool = workerPool;
+  plan->graphGroupOutputBuffers = NULL;
+  vector<vector<PdGraph *> > *graphGroupList = &(plan->graphGroupList);
+  int numGraphs = graphList.size();
+  
+  if (workerPool == NULL || numGraphs < 2) {
+    // all graphs are processed serially
+    if (numGraphs > 0) graphGroupList->push_back(graphList);
+  } else {
+    vector<list<string> > namesForGraph(numGraphs);
+    bool hasSnapshot = false;
+    for (int i = 0; i < numGraphs; i++) {
+      getSharedResourceNames(graphList[i], &namesForGraph[i]);
+      for (list<string>::iterator it = namesForGraph[i].begin(); it != namesForGraph[i].end(); ++it) {
+        if (!(*it).compare("snapshot~")) hasSnapshot = true;
+      }
+    }
+    
+    // union-find over the graph indices. Graphs sharing a name end up in the same set.
+    vector<int> parent(numGraphs);
+    for (int i = 0; i < numGraphs; i++) parent[i] = i;
+    map<string, int> graphForName;
+    for (int i = 0; i < numGraphs; i++) {
+      for (list<string>::iterator it = namesForGraph[i].begin(); it != namesForGraph[i].end(); ++it) {
+        string name = *it;
+        if (!name.compare("receive") || !name.compare("snapshot~")) {
+          // [snapshot~] sends messages while dsp is being processed. Its messages may reach any
+          // receiver, so all graphs with receivers must be processed together with it.
+          if (!hasSnapshot) continue;
+          name = string("receive");
+        } else if (!name.compare("scheduled messages") && hasSnapshot) {
+          // objects such as [env~] schedule messages while dsp is being processed. Graphs with such
+          // objects share this name, such that the messages are scheduled in a fixed order. Messages
+          // from [snapshot~] may schedule messages as well.
+          name = string("receive");
+        }
+        map<string, int>::iterator nit = graphForName.find(name);
+        if (nit == graphForName.end()) {
+          graphForName[name] = i;
+        } else {
+          int a = i; while (parent[a] != a) a = parent[a];
+          int b = nit->second; while (parent[b] != b) b = parent[b];
+          if (a != b) parent[max(a,b)] = min(a,b); // the set is represented by its first graph
+        }
+      }
+    }
+    
+    vector<int> groupIndexForGraph(numGraphs, -1);
+    for (int i = 0; i < numGraphs; i++) {
+      int root = i; while (parent[root] != root) root = parent[root];
+      if (groupIndexForGraph[root] == -1) {
+        groupIndexForGraph[root] = graphGroupList->size();
+        graphGroupList->push_back(vector<PdGraph *>());
+      }
+      graphGroupList->at(groupIndexForGraph[root]).push_back(graphList[i]);
+    }
+  }
   
-  unlock(); // unlock the context
+  // the output buffers are handed to the graphs when the plan is applied
+  if (graphGroupList->size() > 1 && numBytesInOutputBuffers > 0) {
+    plan->graphGroupOutputBuffers = ALLOC_ALIGNED_BUFFER((graphGroupList->size()-1) * numBytesInOutputBuffers);
+  }
+  // if all graphs are processed in one group, the worker pool is used within the graphs instead
+  DspWorkerPool *graphWorkerPool = (graphGroupList->size() == 1) ? workerPool : NULL;
+  for (int i = 0; i < numGraphs; i++) {
+    graphList[i]->setWorkerPool(graphWorkerPool);
+  }
+  
+  // a plan which the audio thread has not yet picked up is replaced
+  if (graphUpdate->graphGroupPlan != NULL) freeGraphGroupPlan(graphUpdate->graphGroupPlan);
+  graphUpdate->graphGroupPlan = plan;
+  isGraphGroupListValid = true;
 }
 
 
 #pragma mark - Un/Attach Graph
 
 void PdContext::attachGraph(PdGraph *graph) {
-  lock();
+  beginEdit();
   graphList.push_back(graph);
   graph->attachToContext(true);
-  unlock();
+  isGraphGroupListValid = false;
+  // receive~s can only be connected to the inputs of their send~s once these are registered
+  reorderGraphSet.insert(graph);
+  endEdit();
 }
 
 void PdContext::unattachGraph(PdGraph *graph) {
-  lock();
+  beginEdit();
   //graphList.erase(graph); // TODO(mhroth): remove the graph from the graphList
   graph->attachToContext(false);
-  unlock();
+  isGraphGroupListValid = false;
+  endEdit();
+}
+
+
+#pragma mark - Graph Edits
+
+void PdContext::beginEdit() {
+  pthread_mutex_lock(&editLock);
+  if (editDepth++ > 0) return;
+  
+  // an update which the audio thread has not yet picked up is extended by this edit
+  graphUpdate = takeGraphUpdate();
+  if (graphUpdate == NULL && publishedGraphUpdate != NULL) {
+    // the audio thread has picked up the last update. It is done with it by the end of the block.
+    while (!__sync_bool_compare_and_swap(&retiredGraphUpdate, publishedGraphUpdate, NULL)) {
+      sched_yield();
+    }
+    freeGraphUpdate(publishedGraphUpdate);
+    publishedGraphUpdate = NULL;
+    
+    // the buffers which the audio thread used before the update are no longer needed either
+    for (int i = 0; i < graphList.size(); i++) {
+      graphList[i]->getBufferPool()->freeReleasedArenas();
+    }
+  }
+  if (graphUpdate == NULL) {
+    graphUpdate = new GraphUpdate();
+    graphUpdate->graphGroupPlan = NULL;
+  }
+}
+
+void PdContext::endEdit() {
+  if (editDepth > 1) {
+    editDepth--;
+    pthread_mutex_unlock(&editLock);
+    return;
+  }
+  
+  // Plan the new process order of all edited graphs. Planning may itself edit, e.g. to retire
+  // objects, which only adds to the current update as the outermost edit is still open.
+  for (set<PdGraph *>::iterator it = reorderGraphSet.begin(); it != reorderGraphSet.end(); ++it) {
+    (*it)->computeDeepLocalDspProcessOrder();
+  }
+  for (map<PdGraph *, set<MessageObject *> >::iterator it = editedObjectMap.begin();
+      it != editedObjectMap.end(); ++it) {
+    PdGraph *graph = it->first;
+    if (reorderGraphSet.find(graph->getRootGraph()) == reorderGraphSet.end()) {
+      graph->updateDspProcessOrder(&(it->second));
+    }
+  }
+  reorderGraphSet.clear();
+  editedObjectMap.clear();
+  
+  if (!isGraphGroupListValid) updateGraphGroups();
+  for (int i = 0; i < graphList.size(); i++) {
+    graphList[i]->updateDspGraphPlan();
+  }
+  
+  // every object is committed once, however often it has been updated
+  vector<DspObject *> *commitList = &(graphUpdate->commitList);
+  sort(commitList->begin(), commitList->end());
+  commitList->erase(unique(commitList->begin(), commitList->end()), commitList->end());
+  
+  if (graphUpdate->recordList.empty() && commitList->empty() && graphUpdate->deletedObjectList.empty()
+      && graphUpdate->deletedFilterBankList.empty() && graphUpdate->deletedWorkerPoolList.empty()
+      && graphUpdate->graphGroupPlan == NULL) {
+    // nothing which the audio thread reads has changed
+    if (publishedGraphUpdate == graphUpdate) publishedGraphUpdate = NULL;
+    delete graphUpdate;
+  } else {
+    // publish the update. All of it is visible to the audio thread once it picks it up.
+    // The update is not pending, as this edit has taken it back if it was.
+    __sync_bool_compare_and_swap(&pendingGraphUpdate, NULL, graphUpdate);
+    publishedGraphUpdate = graphUpdate;
+  }
+  graphUpdate = NULL;
+  editDepth--;
+  pthread_mutex_unlock(&editLock);
+}
+
+GraphUpdate *PdContext::takeGraphUpdate() {
+  GraphUpdate *update = NULL;
+  GraphUpdate *current;
+  while ((current = __sync_val_compare_and_swap(&pendingGraphUpdate, update, NULL)) != update) {
+    update = current;
+  }
+  return update;
+}
+
+void PdContext::retireObject(MessageObject *object) {
+  beginEdit();
+  graphUpdate->deletedObjectList.push_back(object);
+  endEdit();
+}
+
+void PdContext::retireFilterBank(DspFilterBank *filterBank) {
+  beginEdit();
+  graphUpdate->deletedFilterBankList.push_back(filterBank);
+  endEdit();
+}
+
+void PdContext::setDspGraphPlan(PdGraph *graph, DspGraphPlan *dspGraphPlan) {
+  GraphUpdateRecord record;
+  memset(&record, 0, sizeof(GraphUpdateRecord));
+  record.type = GRAPH_UPDATE_SET_DSP_PLAN;
+  record.graph = graph;
+  record.dspGraphPlan = dspGraphPlan;
+  addGraphUpdateRecord(&record);
+}
+
+void PdContext::setDispatchMessageConnections(MessageObject *object,
+    vector<list<ObjectLetPair> > *messageConnections) {
+  GraphUpdateRecord record;
+  memset(&record, 0, sizeof(GraphUpdateRecord));
+  record.type = GRAPH_UPDATE_SET_MESSAGE_CONNECTIONS;
+  record.object = object;
+  record.messageConnections = messageConnections;
+  addGraphUpdateRecord(&record);
+}
+
+void PdContext::setDispatchInletList(PdGraph *graph, vector<MessageObject *> *inletList) {
+  GraphUpdateRecord record;
+  memset(&record, 0, sizeof(GraphUpdateRecord));
+  record.type = GRAPH_UPDATE_SET_INLET_LIST;
+  record.graph = graph;
+  record.inletList = inletList;
+  addGraphUpdateRecord(&record);
+}
+
+void PdContext::updateDspState(DspObject *dspObject) {
+  if (dspObject->getGraph()->isLive()) {
+    beginEdit();
+    graphUpdate->commitList.push_back(dspObject);
+    endEdit();
+  } else {
+    dspObject->commitDspState();
+  }
+}
+
+void PdContext::addGraphUpdateRecord(GraphUpdateRecord *record) {
+  beginEdit();
+  graphUpdate->recordList.push_back(*record);
+  endEdit();
+}
+
+void PdContext::applyGraphUpdate(GraphUpdate *update) {
+  for (int i = 0; i < update->recordList.size(); i++) {
+    applyGraphUpdateRecord(&(update->recordList[i]));
+  }
+  for (int i = 0; i < update->commitList.size(); i++) {
+    update->commitList[i]->commitDspState();
+  }
+  if (update->graphGroupPlan != NULL) {
+    GraphGroupPlan *plan = graphGroupPlan;
+    graphGroupPlan = update->graphGroupPlan;
+    update->graphGroupPlan = plan; // freed along with the update
+    for (int i = 0; i < graphGroupPlan->graphGroupList.size(); i++) {
+      float *groupOutputBuffers = (i == 0 || graphGroupPlan->graphGroupOutputBuffers == NULL) ? NULL
+          : graphGroupPlan->graphGroupOutputBuffers + ((i-1) * numOutputChannels * blockSize);
+      vector<PdGraph *> *graphGroup = &(graphGroupPlan->graphGroupList[i]);
+      for (int j = 0; j < graphGroup->size(); j++) {
+        graphGroup->at(j)->setDspOutputBuffers(groupOutputBuffers);
+      }
+    }
+  }
+}
+
+void PdContext::applyGraphUpdateRecord(GraphUpdateRecord *record) {
+  switch (record->type) {
+    case GRAPH_UPDATE_ADD_RECEIVER: sendController->addReceiver(record->receiver); break;
+    case GRAPH_UPDATE_REMOVE_RECEIVER: sendController->removeReceiver(record->receiver); break;
+    case GRAPH_UPDATE_ADD_TABLE: liveTableList.push_back(record->table); break;
+    case GRAPH_UPDATE_SET_TABLE: record->tableReceiver->setTable(record->table); break;
+    case GRAPH_UPDATE_SET_DELAYLINE: record->delayReceiver->setDelayline(record->delayline); break;
+    case GRAPH_UPDATE_SET_MESSAGE_CONNECTIONS: {
+      record->object->swapDispatchMessageConnections(&(record->messageConnections));
+      break;
+    }
+    case GRAPH_UPDATE_SET_INLET_LIST: record->graph->swapDispatchInletList(&(record->inletList)); break;
+    case GRAPH_UPDATE_SET_DSP_PLAN: record->graph->swapDspGraphPlan(&(record->dspGraphPlan)); break;
+  }
+}
+
+void PdContext::freeGraphUpdate(GraphUpdate *update) {
+  for (int i = 0; i < update->recordList.size(); i++) {
+    GraphUpdateRecord *record = &(update->recordList[i]);
+    switch (record->type) {
+      case GRAPH_UPDATE_SET_MESSAGE_CONNECTIONS: delete record->messageConnections; break;
+      case GRAPH_UPDATE_SET_INLET_LIST: delete record->inletList; break;
+      case GRAPH_UPDATE_SET_DSP_PLAN: delete record->dspGraphPlan; break;
+      default: break;
+    }
+  }
+  for (int i = 0; i < update->deletedObjectList.size(); i++) {
+    delete update->deletedObjectList[i];
+  }
+  for (int i = 0; i < update->deletedFilterBankList.size(); i++) {
+    delete update->deletedFilterBankList[i];
+  }
+  for (int i = 0; i < update->deletedWorkerPoolList.size(); i++) {
+    delete update->deletedWorkerPoolList[i];
+  }
+  if (update->graphGroupPlan != NULL) freeGraphGroupPlan(update->graphGroupPlan);
+  delete update;
+}
+
+void PdContext::freeGraphGroupPlan(GraphGroupPlan *graphGroupPlan) {
+  if (graphGroupPlan->graphGroupOutputBuffers != NULL) {
+    FREE_ALIGNED_BUFFER(graphGroupPlan->graphGroupOutputBuffers);
+  }
+  delete graphGroupPlan;
+}
+
+void PdContext::addObjectToGraph(PdGraph *graph, MessageObject *object, float canvasX, float canvasY) {
+  beginEdit();
+  graph->addObject(canvasX, canvasY, object);
+  if (graph->isLive() && object->doesProcessAudio()) {
+    editedObjectMap[graph].insert(object);
+  }
+  endEdit();
+}
+
+void PdContext::removeObjectFromGraph(MessageObject *object) {
+  PdGraph *graph = object->getGraph();
+  beginEdit();
+  if (!graph->isLive()) {
+    // nothing to plan
+  } else if (object->getObjectType() == OBJECT_PD) {
+    if (object->doesProcessAudio()) reorderGraphSet.insert(graph->getRootGraph());
+  } else if (object->doesProcessAudio()) {
+    // the objects which were connected to the removed object are affected by its removal
+    set<MessageObject *> *editedObjectSet = &(editedObjectMap[graph]);
+    editedObjectSet->insert(object);
+    for (int i = 0; i < object->getNumInlets(); i++) {
+      list<ObjectLetPair> connections = object->getIncomingConnections(i);
+      for (list<ObjectLetPair>::iterator it = connections.begin(); it != connections.end(); ++it) {
+        editedObjectSet->insert(it->first);
+      }
+    }
+    for (int i = 0; i < object->getNumOutlets(); i++) {
+      list<ObjectLetPair> connections = object->getOutgoingConnections(i);
+      for (list<ObjectLetPair>::iterator it = connections.begin(); it != connections.end(); ++it) {
+        editedObjectSet->insert(it->first);
+      }
+    }
+  }
+  graph->removeObject(object);
+  endEdit();
+}
+
+void PdContext::addConnectionToGraph(PdGraph *graph, MessageObject *fromObject, int outletIndex,
+    MessageObject *toObject, int inletIndex) {
+  beginEdit();
+  graph->addConnection(fromObject, outletIndex, toObject, inletIndex);
+  if (graph->isLive() && (fromObject->doesProcessAudio() || toObject->doesProcessAudio())) {
+    editedObjectMap[graph].insert(fromObject);
+    editedObjectMap[graph].insert(toObject);
+  }
+  endEdit();
+}
+
+void PdContext::removeConnectionFromGraph(PdGraph *graph, MessageObject *fromObject, int outletIndex,
+    MessageObject *toObject, int inletIndex) {
+  beginEdit();
+  graph->removeConnection(fromObject, outletIndex, toObject, inletIndex);
+  if (graph->isLive() && (fromObject->doesProcessAudio() || toObject->doesProcessAudio())) {
+    editedObjectMap[graph].insert(fromObject);
+    editedObjectMap[graph].insert(toObject);
+  }
+  endEdit();
+}
+
+void PdContext::executeGraphCommands(GraphCommand *commandList) {
+  if (commandList == NULL) return; // the common case
+  
+  for (GraphCommand *command = commandList; command != NULL; command = command->next) {
+    switch (command->type) {
+      case GRAPH_COMMAND_RESOLVE_RECEIVER: {
+        if (command->receiverHandle >= receiverNameIndices.size()) {
+          receiverNameIndices.resize(command->receiverHandle + 1, -1);
+        }
+        receiverNameIndices[command->receiverHandle] = sendController->resolveNameIndex(command->receiverName);
+        break;
+      }
+      case GRAPH_COMMAND_REGISTER_EXTERNAL_RECEIVER: {
+        sendController->registerExternalReceiver(command->receiverName);
+        break;
+      }
+      case GRAPH_COMMAND_UNREGISTER_EXTERNAL_RECEIVER: {
+        sendController->unregisterExternalReceiver(command->receiverName);
+        break;
+      }
+      case GRAPH_COMMAND_SEND_MESSAGE: {
+        command->toObject->receiveMessage(command->inletIndex, command->message);
+        break;
+      }
+      case GRAPH_COMMAND_SET_TABLE_BUFFER: {
+        // the command then holds the previous buffer, which is freed along with it
+        command->table->swapBuffer(&(command->buffer), &(command->bufferLength));
+        break;
+      }
+    }
+  }
+  graphCommandQueue->retire(commandList);
 }
 
 
@@ -274,14 +838,24 @@ void PdContext::registerDspReceive(DspReceive *dspReceive) {
   // connect receive~ to associated send~
   DspSend *dspSend = getDspSend(dspReceive->getName());
   if (dspSend != NULL) {
-    dspReceive->setDspBufferAtInlet(dspSend->getDspBufferAtInlet(0), 0);
+    dspReceive->setDspBufferAtInlet(dspSend->getDspBufferAtOutlet(0), 0);
+    dspSend->setNumReceivers(receiveList->size());
+    updateDspState(dspSend);
   }
+  updateDspState(dspReceive);
 }
 
 void PdContext::unregisterDspReceive(DspReceive *dspReceive) {
   list<DspReceive *> *receiveList = &(dspReceiveMap[string(dspReceive->getName())]);
   receiveList->remove(dspReceive);
   dspReceive->setDspBufferAtInlet(dspReceive->getGraph()->getBufferPool()->getZeroBuffer(), 0);
+  updateDspState(dspReceive);
+  
+  DspSend *dspSend = getDspSend(dspReceive->getName());
+  if (dspSend != NULL) {
+    dspSend->setNumReceivers(receiveList->size());
+    updateDspState(dspSend);
+  }
 }
 
 void PdContext::registerDspSend(DspSend *dspSend) {
@@ -294,13 +868,21 @@ void PdContext::registerDspSend(DspSend *dspSend) {
   
   // connect associated receive~s to send~.
   updateDspReceiveForSendWitBuffer(dspSend->getName(), dspSend->getDspBufferAtOutlet(0));
+  dspSend->setNumReceivers(dspReceiveMap[string(dspSend->getName())].size());
+  updateDspState(dspSend);
 }
 
 void PdContext::unregisterDspSend(DspSend *dspSend) {
   dspSendList.remove(dspSend);
   
   // inform all previously connected receive~s that the send~ buffer does not exist anymore.
-  updateDspReceiveForSendWitBuffer(dspSend->getName(), dspSend->getGraph()->getBufferPool()->getZeroBuffer());
+  // Each receive~ uses the zero buffer of its own graph, as every root graph has its own buffer pool.
+  list<DspReceive *> receiveList = dspReceiveMap[string(dspSend->getName())];
+  for (list<DspReceive *>::iterator it = receiveList.begin(); it != receiveList.end(); ++it) {
+    DspReceive *dspReceive = *it;
+    dspReceive->setDspBufferAtInlet(dspReceive->getGraph()->getBufferPool()->getZeroBuffer(), 0);
+    updateDspState(dspReceive);
+  }
 }
 
 DspSend *PdContext::getDspSend(const char *name) {
@@ -315,6 +897,7 @@ void PdContext::updateDspReceiveForSendWitBuffer(const char *name, float *buffer
   for (list<DspReceive *>::iterator it = receiveList.begin(); it != receiveList.end(); ++it) {
     DspReceive *dspReceive = *it;
     dspReceive->setDspBufferAtInlet(buffer, 0);
+    updateDspState(dspReceive);
   }
 }
 
@@ -322,11 +905,20 @@ void PdContext::updateDspReceiveForSendWitBuffer(const char *name, float *buffer
 #pragma mark - Register/Unregister Objects
 
 void PdContext::registerRemoteMessageReceiver(RemoteMessageReceiver *receiver) {
-  sendController->addReceiver(receiver);
+  // the send controller is only read and changed by the audio thread
+  GraphUpdateRecord record;
+  memset(&record, 0, sizeof(GraphUpdateRecord));
+  record.type = GRAPH_UPDATE_ADD_RECEIVER;
+  record.receiver = receiver;
+  addGraphUpdateRecord(&record);
 }
 
 void PdContext::unregisterRemoteMessageReceiver(RemoteMessageReceiver *receiver) {
-  sendController->removeReceiver(receiver);
+  GraphUpdateRecord record;
+  memset(&record, 0, sizeof(GraphUpdateRecord));
+  record.type = GRAPH_UPDATE_REMOVE_RECEIVER;
+  record.receiver = receiver;
+  addGraphUpdateRecord(&record);
 }
 
 void PdContext::registerDelayline(DspDelayWrite *delayline) {
@@ -337,8 +929,15 @@ void PdContext::registerDelayline(DspDelayWrite *delayline) {
   delaylineList.push_back(delayline);
   
   // connect this delayline to all same-named delay receivers
+  GraphUpdateRecord record;
+  memset(&record, 0, sizeof(GraphUpdateRecord));
+  record.type = GRAPH_UPDATE_SET_DELAYLINE;
+  record.delayline = delayline;
   for (list<DelayReceiver *>::iterator it = delayReceiverList.begin(); it != delayReceiverList.end(); it++) {
-    if (!strcmp((*it)->getName(), delayline->getName())) (*it)->setDelayline(delayline);
+    if (!strcmp((*it)->getName(), delayline->getName())) {
+      record.delayReceiver = *it;
+      addGraphUpdateRecord(&record);
+    }
   }
 }
 
@@ -346,8 +945,12 @@ void PdContext::registerDelayReceiver(DelayReceiver *delayReceiver) {
   delayReceiverList.push_back(delayReceiver);
   
   // connect the delay receiver to the named delayline
-  DspDelayWrite *delayline = getDelayline(delayReceiver->getName());
-  delayReceiver->setDelayline(delayline);
+  GraphUpdateRecord record;
+  memset(&record, 0, sizeof(GraphUpdateRecord));
+  record.type = GRAPH_UPDATE_SET_DELAYLINE;
+  record.delayReceiver = delayReceiver;
+  record.delayline = getDelayline(delayReceiver->getName());
+  addGraphUpdateRecord(&record);
 }
 
 DspDelayWrite *PdContext::getDelayline(const char *name) {
@@ -364,7 +967,20 @@ void PdContext::registerDspThrow(DspThrow *dspThrow) {
   DspCatch *dspCatch = getDspCatch(dspThrow->getName());
   if (dspCatch != NULL) {
     dspCatch->addThrow(dspThrow);
+    updateDspState(dspCatch);
+  }
+  updateDspState(dspThrow);
+}
+
+void PdContext::unregisterDspThrow(DspThrow *dspThrow) {
+  throwList.remove(dspThrow);
+  
+  DspCatch *dspCatch = dspThrow->getDspCatch();
+  if (dspCatch != NULL) {
+    dspCatch->removeThrow(dspThrow);
+    updateDspState(dspCatch);
   }
+  updateDspState(dspThrow);
 }
 
 void PdContext::registerDspCatch(DspCatch *dspCatch) {
@@ -377,8 +993,25 @@ void PdContext::registerDspCatch(DspCatch *dspCatch) {
   
   // connect catch~ to all associated throw~s
   for (list<DspThrow *>::iterator it = throwList.begin(); it != throwList.end(); it++) {
-    if (!strcmp((*it)->getName(), dspCatch->getName())) dspCatch->addThrow((*it));
+    if (!strcmp((*it)->getName(), dspCatch->getName())) {
+      dspCatch->addThrow((*it));
+      updateDspState(*it);
+    }
+  }
+  updateDspState(dspCatch);
+}
+
+void PdContext::unregisterDspCatch(DspCatch *dspCatch) {
+  catchList.remove(dspCatch);
+  
+  // disconnect catch~ from all associated throw~s
+  for (list<DspThrow *>::iterator it = throwList.begin(); it != throwList.end(); it++) {
+    if ((*it)->getDspCatch() == dspCatch) {
+      dspCatch->removeThrow((*it));
+      updateDspState(*it);
+    }
   }
+  updateDspState(dspCatch);
 }
 
 DspCatch *PdContext::getDspCatch(const char *name) {
@@ -389,35 +1022,75 @@ DspCatch *PdContext::getDspCatch(const char *name) {
 }
 
 void PdContext::registerTable(MessageTable *table) {  
-  if (getTable(table->getName()) != NULL) {
+  if (getRegisteredTable(table->getName()) != NULL) {
     printErr("Table with name \"%s\" already exists.", table->getName());
     return;
   }
   tableList.push_back(table);
   
+  GraphUpdateRecord record;
+  memset(&record, 0, sizeof(GraphUpdateRecord));
+  record.type = GRAPH_UPDATE_ADD_TABLE;
+  record.table = table;
+  addGraphUpdateRecord(&record);
+  
+  record.type = GRAPH_UPDATE_SET_TABLE;
   for (list<TableReceiverInterface *>::iterator it = tableReceiverList.begin();
       it != tableReceiverList.end(); it++) {
-    if (!strcmp((*it)->getName(), table->getName())) (*it)->setTable(table);
+    if (!strcmp((*it)->getName(), table->getName())) {
+      record.tableReceiver = *it;
+      addGraphUpdateRecord(&record);
+    }
   }
 }
 
-MessageTable *PdContext::getTable(const char *name) {
+MessageTable *PdContext::getRegisteredTable(const char *name) {
   for (list<MessageTable *>::iterator it = tableList.begin(); it != tableList.end(); it++) {
     if (!strcmp((*it)->getName(), name)) return (*it);
   }
   return NULL;
 }
 
+MessageTable *PdContext::getTable(const char *name) {
+  for (list<MessageTable *>::iterator it = liveTableList.begin(); it != liveTableList.end(); it++) {
+    if (!strcmp((*it)->getName(), name)) return (*it);
+  }
+  return NULL;
+}
+
+RealFft *PdContext::getRealFft(int size) {
+  if (!RealFft::isValidSize(size)) return NULL;
+  pthread_mutex_lock(&realFftLock);
+  RealFft *realFft = realFftMap[size];
+  if (realFft == NULL) {
+    realFft = new RealFft(size);
+    realFftMap[size] = realFft;
+  }
+  pthread_mutex_unlock(&realFftLock);
+  return realFft;
+}
+
 void PdContext::registerTableReceiver(TableReceiverInterface *tableReceiver) {
   tableReceiverList.push_back(tableReceiver); // add the new receiver
   
-  MessageTable *table = getTable(tableReceiver->getName());
-  tableReceiver->setTable(table); // set table whether it is NULL or not
+  // set table whether it is NULL or not
+  GraphUpdateRecord record;
+  memset(&record, 0, sizeof(GraphUpdateRecord));
+  record.type = GRAPH_UPDATE_SET_TABLE;
+  record.tableReceiver = tableReceiver;
+  record.table = getRegisteredTable(tableReceiver->getName());
+  addGraphUpdateRecord(&record);
 }
 
 void PdContext::unregisterTableReceiver(TableReceiverInterface *tableReceiver) {
   tableReceiverList.remove(tableReceiver); // remove the receiver
-  tableReceiver->setTable(NULL);
+  
+  GraphUpdateRecord record;
+  memset(&record, 0, sizeof(GraphUpdateRecord));
+  record.type = GRAPH_UPDATE_SET_TABLE;
+  record.tableReceiver = tableReceiver;
+  record.table = NULL;
+  addGraphUpdateRecord(&record);
 }
 
 void PdContext::setValueForName(const char *name, float constant) {
@@ -429,15 +1102,18 @@ float PdContext::getValueForName(const char *name) {
 }
 
 void PdContext::registerExternalReceiver(const char *receiverName) {
-  lock(); // don't update the external receiver registry while processing it, of course!
-  sendController->registerExternalReceiver(receiverName);
-  unlock();
+  // the registry is only changed by the audio thread, between blocks
+  GraphCommand command;
+  command.type = GRAPH_COMMAND_REGISTER_EXTERNAL_RECEIVER;
+  command.receiverName = SymbolTable::intern(receiverName);
+  graphCommandQueue->push(&command);
 }
 
 void PdContext::unregisterExternalReceiver(const char *receiverName) {
-  lock();
-  sendController->unregisterExternalReceiver(receiverName);
-  unlock();
+  GraphCommand command;
+  command.type = GRAPH_COMMAND_UNREGISTER_EXTERNAL_RECEIVER;
+  command.receiverName = SymbolTable::intern(receiverName);
+  graphCommandQueue->push(&command);
 }
 
 
@@ -447,7 +1123,40 @@ void PdContext::sendMessageToNamedReceivers(char *name, PdMessage *message) {
   sendController->receiveMessage(name, message);
 }
 
-void PdContext::scheduleExternalMessageV(const char *receiverName, double timestamp,
+int PdContext::resolveReceiver(const char *receiverName) {
+  if (receiverName == NULL) return -1;
+  
+  pthread_mutex_lock(&receiverHandleLock);
+  map<string, int>::iterator it = receiverHandleMap.find(string(receiverName));
+  int receiverHandle = -1;
+  bool isNewHandle = (it == receiverHandleMap.end());
+  if (isNewHandle) {
+    receiverHandle = receiverHandleMap.size();
+    receiverHandleMap[string(receiverName)] = receiverHandle;
+  } else {
+    receiverHandle = it->second;
+  }
+  pthread_mutex_unlock(&receiverHandleLock);
+  
+  if (isNewHandle) {
+    // The send controller may only be changed by the audio thread. The handle is bound to the
+    // name when the command is executed at the start of a block. Messages to the handle which
+    // arrive before that wait in the queue (see dequeueExternalMessages()).
+    GraphCommand command;
+    command.type = GRAPH_COMMAND_RESOLVE_RECEIVER;
+    command.receiverName = SymbolTable::intern(receiverName);
+    command.receiverHandle = receiverHandle;
+    graphCommandQueue->push(&command);
+  }
+  return receiverHandle;
+}
+
+bool PdContext::scheduleExternalMessageV(const char *receiverName, double timestamp,
+    const char *messageFormat, va_list ap) {
+  return scheduleExternalMessageV(resolveReceiver(receiverName), timestamp, messageFormat, ap);
+}
+
+bool PdContext::scheduleExternalMessageV(int receiverHandle, double timestamp,
     const char *messageFormat, va_list ap) {
   int numElements = strlen(messageFormat);
   PdMessage *message = PD_MESSAGE_ON_STACK(numElements);
@@ -461,39 +1170,48 @@ void PdContext::scheduleExternalMessageV(const char *receiverName, double timest
     }
   }
   
-  scheduleExternalMessage(receiverName, message);
+  return scheduleExternalMessage(receiverHandle, message);
 }
 
-void PdContext::scheduleExternalMessage(const char *receiverName, PdMessage *message) {
-  lock();
-  int receiverNameIndex = sendController->getNameIndex(receiverName);
-  if (receiverNameIndex >= 0) { // if the receiver exists
-    scheduleMessage(sendController, receiverNameIndex, message);
-  }
-  unlock();
+bool PdContext::scheduleExternalMessage(const char *receiverName, PdMessage *message) {
+  return scheduleExternalMessage(resolveReceiver(receiverName), message);
 }
 
-void PdContext::scheduleExternalMessage(const char *receiverName, double timestamp, const char *initString) {
-  // do the heavy lifting of string parsing before the lock (minimise the critical section)
+bool PdContext::scheduleExternalMessage(const char *receiverName, double timestamp, const char *initString) {
   int maxElements = (strlen(initString)/2)+1;
   PdMessage *message = PD_MESSAGE_ON_STACK(maxElements);
   char str[strlen(initString)+1]; strcpy(str, initString);
   message->initWithString(timestamp, maxElements, str);
   
-  lock(); // lock and load
-  int receiverNameIndex = sendController->getNameIndex(receiverName);
-  if (receiverNameIndex >= 0) { // if the receiver exists
-    scheduleMessage(sendController, receiverNameIndex, message);
+  return scheduleExternalMessage(resolveReceiver(receiverName), message);
+}
+
+bool PdContext::scheduleExternalMessage(int receiverHandle, PdMessage *message) {
+  if (receiverHandle < 0 || message == NULL) return false;
+  
+  // if the queue is full or the message is too large for it, the message is dropped
+  return externalMessageQueue->push(receiverHandle, message);
+}
+
+void PdContext::dequeueExternalMessages() {
+  int receiverHandle = -1;
+  PdMessage *message = NULL;
+  while ((message = externalMessageQueue->peek(&receiverHandle)) != NULL) {
+    // A handle may have been resolved after the commands of this block were executed. Its message,
+    // and all which follow it, wait for the next block, such that their order is kept.
+    if (receiverHandle >= receiverNameIndices.size() || receiverNameIndices[receiverHandle] == -1) break;
+    scheduleMessage(sendController, receiverNameIndices[receiverHandle], message);
+    externalMessageQueue->pop();
   }
-  unlock();
 }
 
 PdMessage *PdContext::scheduleMessage(MessageObject *messageObject, unsigned int outletIndex, PdMessage *message) {
   // basic argument checking. It may happen that the message is NULL in case a cancel message
   // is sent multiple times to a particular object, when no message is pending
   if (message != NULL && messageObject != NULL) {
-    message = message->copyToHeap();
-    messageCallbackQueue->insertMessage(messageObject, outletIndex, message);
+    pthread_mutex_lock(&messageQueueLock);
+    message = messageCallbackQueue->insertMessage(messageObject, outletIndex, message);
+    pthread_mutex_unlock(&messageQueueLock);
     return message;
   }
   return NULL;
@@ -501,8 +1219,9 @@ PdMessage *PdContext::scheduleMessage(MessageObject *messageObject, unsigned int
 
 void PdContext::cancelMessage(MessageObject *messageObject, int outletIndex, PdMessage *message) {
   if (message != NULL && outletIndex >= 0 && messageObject != NULL) {
-    messageCallbackQueue->removeMessage(messageObject, outletIndex, message);
-    message->freeMessage();
+    pthread_mutex_lock(&messageQueueLock);
+    messageCallbackQueue->removeMessage(message); // the message is also freed
+    pthread_mutex_unlock(&messageQueueLock);
   }
 }
 
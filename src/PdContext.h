@@ -25,17 +25,22 @@
 
 #include <map>
 #include <pthread.h>
+#include <set>
+#include "ExternalMessageQueue.h"
+#include "GraphCommandQueue.h"
+#include "GraphUpdate.h"
+#include "MessageAllocator.h"
 #include "OrderedMessageQueue.h"
 #include "PdGraph.h"
 #include "ZGCallbackFunction.h"
 
-class BufferPool;
 class DspCatch;
 class DelayReceiver;
 class DspDelayWrite;
 class DspReceive;
 class DspSend;
 class DspThrow;
+class DspWorkerPool;
 class MessageSendController;
 class MessageTable;
 class PdFileParser;
@@ -43,6 +48,7 @@ class RemoteMessageReceiver;
 class TableReceiverInterface;
 class PdMessage;
 class ObjectFactoryMap;
+class RealFft;
 
 /**
  * The <code>PdContext</code> is a container for a set of <code>PdGraph</code>s operating in
@@ -62,15 +68,99 @@ class PdContext {
   
     /**
      * Attach the given <code>graph</code> to this <code>context</code>, also registering all
-     * necessary objects, and computing the dsp object compute order if necessary.
+     * necessary objects, and computing the dsp object compute order if necessary. The graph is
+     * processed from the start of the next block.
      */
     void attachGraph(PdGraph *graph);
     void unattachGraph(PdGraph *graph);
-    
+  
+    /**
+     * Adds the object to the graph. The same is true of all of the following graph edit functions:
+     * the edit is made on the calling thread, which also recomputes the dsp process order and
+     * buffers of the graph if it is attached. The audio thread switches to the new graph at the
+     * start of the next block (see <code>beginEdit()</code>).
+     */
+    void addObjectToGraph(PdGraph *graph, MessageObject *object, float canvasX, float canvasY);
+  
+    /**
+     * Removes the object from its graph and deletes it. The objects of attached graphs are
+     * deleted once the audio thread no longer uses them.
+     */
+    void removeObjectFromGraph(MessageObject *object);
+  
+    void addConnectionToGraph(PdGraph *graph, MessageObject *fromObject, int outletIndex,
+        MessageObject *toObject, int inletIndex);
+    void removeConnectionFromGraph(PdGraph *graph, MessageObject *fromObject, int outletIndex,
+        MessageObject *toObject, int inletIndex);
+  
+    /**
+     * Processes one block. The context is never locked. Edits which have been published since the
+     * last block are applied first. Applying them does not wait on the editing thread, though it
+     * may allocate memory when receivers or tables are registered.
+     */
     void process(float *inputBuffers, float *outputBuffers);
   
-    void lock() { pthread_mutex_lock(&contextLock); }
-    void unlock() { pthread_mutex_unlock(&contextLock); }
+    /**
+     * Sets the number of worker threads with which independent root graphs are processed in
+     * parallel. Graphs are independent if they do not share any [send~]/[receive~],
+     * [throw~]/[catch~], [delwrite~]/[delread~]/[vd~] or table names. Zero (the default) processes
+     * all graphs serially on the calling thread. Note that when worker threads are used, the
+     * callback function may also be called from them.
+     */
+    void setNumWorkerThreads(int numThreads);
+  
+    /** Returns the number of worker threads used to process independent graphs. */
+    int getNumWorkerThreads();
+  
+    /**
+     * Notifies the context that the dependencies between graphs may have changed, e.g. because an
+     * object was added to an attached graph. The groups of independent graphs are recomputed
+     * before the next block is processed.
+     */
+    void invalidateGraphGroups() { isGraphGroupListValid = false; }
+  
+    /**
+     * Queues a request of the audio thread, which is executed at the start of the next block. May
+     * be called from any thread.
+     */
+    void pushGraphCommand(GraphCommand *command) { graphCommandQueue->push(command); }
+  
+    /**
+     * Begins a batch of edits to the graphs of this context. Calls may be nested, and only one
+     * thread edits at a time. Edits to attached graphs do not change anything which the audio
+     * thread reads. They are collected in a <code>GraphUpdate</code>, which the outermost
+     * <code>endEdit()</code> completes with the new dsp process order and buffers of every
+     * edited graph, and publishes with a single atomic pointer swap. The audio thread applies it
+     * at the start of the next block. An update which the audio thread has not yet picked up is
+     * extended by the next batch. If the audio thread is applying it, the editing thread waits
+     * until it is done before it frees what is no longer used.
+     */
+    void beginEdit();
+    void endEdit();
+  
+    /** Deletes the object once the audio thread no longer uses it. */
+    void retireObject(MessageObject *object);
+  
+    /** Deletes the filter bank once the audio thread no longer uses it. */
+    void retireFilterBank(DspFilterBank *filterBank);
+  
+    /** Hands the given plan to the audio thread, which then processes the graph with it. */
+    void setDspGraphPlan(PdGraph *graph, DspGraphPlan *dspGraphPlan);
+  
+    /**
+     * Hands the given message connections to the audio thread, which dispatches the messages of
+     * the object to them.
+     */
+    void setDispatchMessageConnections(MessageObject *object, vector<list<ObjectLetPair> > *messageConnections);
+  
+    /** Hands the given inlets to the audio thread, which dispatches messages to the graph to them. */
+    void setDispatchInletList(PdGraph *graph, vector<MessageObject *> *inletList);
+  
+    /**
+     * Commits the planned buffers and state of the dsp object when the current edits are applied,
+     * or at once if the object is not part of an attached graph.
+     */
+    void updateDspState(DspObject *dspObject);
   
     /** Globally register a remote message receiver (e.g. [send] or [notein]). */
     void registerRemoteMessageReceiver(RemoteMessageReceiver *receiver);
@@ -106,18 +196,31 @@ class PdContext {
     void registerDelayReceiver(DelayReceiver *delayReceiver);
     
     void registerDspThrow(DspThrow *dspThrow);
+    void unregisterDspThrow(DspThrow *dspThrow);
     
     void registerDspCatch(DspCatch *dspCatch);
+    void unregisterDspCatch(DspCatch *dspCatch);
     
     void registerTable(MessageTable *table);
     
     void registerTableReceiver(TableReceiverInterface *tableReceiver);
     void unregisterTableReceiver(TableReceiverInterface *tableReceiver);
     
+    /**
+     * Returns the named table, as seen by the audio thread. Tables of newly attached graphs are
+     * found once the edits have been applied.
+     */
     MessageTable *getTable(const char *name);
     
     /** Returns the named global <code>DspCatch</code> object. */
     DspCatch *getDspCatch(const char *name);
+  
+    /**
+     * Returns the fft plan of the given size, which is shared by all objects of this context. The
+     * plan is created on first use and lives as long as the context. Returns <code>NULL</code> if
+     * the size is not a power of two. May be called from any thread.
+     */
+    RealFft *getRealFft(int size);
     
     /**
      * Sends the given message to all [receive] objects with the given <code>name</code>.
@@ -127,35 +230,57 @@ class PdContext {
      */
     void sendMessageToNamedReceivers(char *name, PdMessage *message);
   
+    /**
+     * Returns a handle for the named receiver which may be used to schedule external messages
+     * without looking up the name again. The handle remains valid for the lifetime of the context,
+     * even if no receiver by that name exists yet. Returns -1 if the name is <code>NULL</code>.
+     * A new name is handed a handle at once, which is bound to the receiver name on the audio
+     * thread at the start of the next block. The context is never locked.
+     */
+    int resolveReceiver(const char *receiverName);
+  
     /**
      * Schedules a message to be sent to all receivers at the start of the next block.
      * @returns The <code>PdMessage</code> which will be sent. It is intended that the programmer
      * will set the values of the message with a call to <code>setMessage()</code>.
      */
-    void scheduleExternalMessageV(const char *receiverName, double timestamp,
+    bool scheduleExternalMessageV(const char *receiverName, double timestamp,
+        const char *messageFormat, va_list ap);
+  
+    /** Schedules a formatted message to the receiver with the given handle. */
+    bool scheduleExternalMessageV(int receiverHandle, double timestamp,
         const char *messageFormat, va_list ap);
   
     /** Schedules a message to be sent to all receivers at the start of the next block. */
-    void scheduleExternalMessage(const char *receiverName, PdMessage *message);
+    bool scheduleExternalMessage(const char *receiverName, PdMessage *message);
+  
+    /**
+     * Schedules a message to the receiver with the given handle. The message is copied into a
+     * lock-free queue and is delivered during the next block. May be called from any thread.
+     * Returns false if the handle is invalid, or if the queue is full or the message too large for
+     * it, in which case the message is dropped. The context is never locked.
+     */
+    bool scheduleExternalMessage(int receiverHandle, PdMessage *message);
   
     /**
      * Schedules a message described by the given string to be sent to named receivers at the
      * given timestamp.
      */
-    void scheduleExternalMessage(const char *receiverName, double timestamp,
+    bool scheduleExternalMessage(const char *receiverName, double timestamp,
         const char *initString);
   
     /**
      * Schedules a <code>PdMessage</code> to be sent by the <code>MessageObject</code> from the
      * <code>outletIndex</code> at the specified <code>time</code>. The message will be copied
      * to the heap and the context will thereafter take over ownership and be responsible for
-     * freeing it. The pointer to the heap-message is returned.
+     * freeing it. The pointer to the heap-message is returned. It also serves as the handle with
+     * which the message may be cancelled.
      */
     PdMessage *scheduleMessage(MessageObject *messageObject, unsigned int outletIndex, PdMessage *message);
   
     /**
-     * Cancel a scheduled <code>PdMessage</code> according to its id. The message memory will
-     * be freed.
+     * Cancel a scheduled <code>PdMessage</code> according to the pointer returned by
+     * <code>scheduleMessage()</code>. The message memory will be freed.
      */
     void cancelMessage(MessageObject *messageObject, int outletIndex, PdMessage *message);
   
@@ -185,6 +310,24 @@ class PdContext {
     /** Returns the next globally unique graph id. */
     int getNextGraphId();
   
+    /**
+     * Sets the seed from which random number generators, e.g. those of [noise~], are seeded. Each
+     * generator created afterwards takes the next seed of a sequence derived from it, such that
+     * the context renders the same output whenever its graphs are created in the same order.
+     * The seed is zero by default. It should not be set while objects are being created.
+     */
+    void setRandomSeed(unsigned int seed);
+  
+    /**
+     * Returns the next seed of the sequence derived from the random seed of this context. May be
+     * called from any thread. Each call returns a different seed, though the order in which
+     * concurrent callers receive them is undefined.
+     */
+    unsigned int getNextRandomSeed();
+  
+    /** Returns the allocator of the messages which are copied while this context is processing. */
+    MessageAllocator *getMessageAllocator() { return messageAllocator; }
+  
     /** Used with MessageValue for keeping track of global variables. */
     void setValueForName(const char *name, float constant);
     float getValueForName(const char *name);
@@ -192,6 +335,10 @@ class PdContext {
     /** Create a new object in a graph. */
     MessageObject *newObject(const char *objectLabel, PdMessage *initMessage, PdGraph *graph);
   
+    /**
+     * Registers a receiver name whose messages are passed to the callback function. The name is
+     * registered at the start of the next block. The context is never locked.
+     */
     void registerExternalReceiver(const char *receiverName);
     void unregisterExternalReceiver(const char *receiverName);
   
@@ -208,12 +355,63 @@ class PdContext {
     /** Unregister an object label. */
     void unregisterExternalObject(const char *objectLabel);
   
-    BufferPool *getBufferPool() { return bufferPool; }
-  
   private:
     /** Returns <code>true</code> if the graph was successfully configured. <code>false</code> otherwise. */
     bool configureEmptyGraphWithParser(PdGraph *graph, PdFileParser *fileParser);
   
+    /**
+     * Partitions the root graphs into groups which share no global dsp resources. Each group may
+     * be processed on a different thread. Groups are ordered by their first graph. The new groups
+     * are added to the current update.
+     */
+    void updateGraphGroups();
+  
+    /** Adds the names of all global resources used by the given graph (and its subgraphs). */
+    void getSharedResourceNames(PdGraph *graph, list<string> *names);
+  
+    /** Processes one group of graphs. Used with the <code>DspWorkerPool</code>. */
+    static void processGraphGroup(void *context, int groupIndex);
+  
+    /**
+     * Executes the given requests made of the audio thread, in the order in which they were made.
+     * Called at the start of every block.
+     */
+    void executeGraphCommands(GraphCommand *commandList);
+  
+    /**
+     * Switches the audio thread to the graphs as planned by the editing thread. The records are
+     * applied in order, then the planned buffers of the dsp objects are committed and the new
+     * graph groups are used. Called at the start of a block.
+     */
+    void applyGraphUpdate(GraphUpdate *update);
+  
+    /**
+     * Atomically takes the published update which the audio thread has not yet picked up, if any.
+     * Called by the audio thread at the start of a block, and by an edit to extend the update.
+     */
+    GraphUpdate *takeGraphUpdate();
+  
+    /** Applies a single record of an update, which then holds anything it has replaced. */
+    void applyGraphUpdateRecord(GraphUpdateRecord *record);
+  
+    /** Deletes an update once applied, along with all objects which it has retired or replaced. */
+    static void freeGraphUpdate(GraphUpdate *update);
+  
+    /** Deletes a graph group plan and its output buffers. */
+    static void freeGraphGroupPlan(GraphGroupPlan *graphGroupPlan);
+  
+    /** Adds a record to the current update, making an edit of its own if there is none. */
+    void addGraphUpdateRecord(GraphUpdateRecord *record);
+  
+    /** Returns the named table as registered by the editing thread. */
+    MessageTable *getRegisteredTable(const char *name);
+  
+    /**
+     * Moves all externally injected messages into the message queue. Called at the start of every
+     * block.
+     */
+    void dequeueExternalMessages();
+  
     void initObjectInitMap();
 
     int numInputChannels;
@@ -224,11 +422,58 @@ class PdContext {
     /** Keeps track of the current global graph id. */
     unsigned int globalGraphId;
   
+    /** The seed from which random number generators are seeded, and the number of seeds taken from it. */
+    unsigned int randomSeed;
+    unsigned int numRandomSeeds;
+  
     /** A list of all top-level graphs in this context. */
     vector<PdGraph *> graphList;
   
-    /** A thread lock used to access critical sections of this context. */
-    pthread_mutex_t contextLock;
+    /** A recursive thread lock which serialises edits to the graphs. Never taken by the audio thread. */
+    pthread_mutex_t editLock;
+  
+    /** The nesting depth of <code>beginEdit()</code>. */
+    int editDepth;
+  
+    /** The update which is being planned by the current edit. <code>NULL</code> outside of edits. */
+    GraphUpdate *graphUpdate;
+  
+    /** The update which has been published but not yet picked up by the audio thread. */
+    GraphUpdate *volatile pendingGraphUpdate;
+  
+    /** The last published update, which the editing thread frees once it has been applied. */
+    GraphUpdate *publishedGraphUpdate;
+  
+    /** Set by the audio thread to the update which it has finished applying. */
+    GraphUpdate *volatile retiredGraphUpdate;
+  
+    /**
+     * Root graphs whose dsp process order must be recomputed completely at the end of the current
+     * edit, and the edited objects of all other graphs, whose order is only updated around them.
+     */
+    set<PdGraph *> reorderGraphSet;
+    map<PdGraph *, set<MessageObject *> > editedObjectMap;
+  
+    /**
+     * A thread lock protecting the message queue. Messages may be scheduled by dsp objects while
+     * graphs are being processed on several threads.
+     */
+    pthread_mutex_t messageQueueLock;
+  
+    /**
+     * The thread pool used to process independent graphs in parallel. <code>NULL</code> if none.
+     * The audio thread uses the pool of its graph group plan.
+     */
+    DspWorkerPool *workerPool;
+  
+    /**
+     * The groups of mutually independent root graphs with which the audio thread processes all
+     * graphs. <code>NULL</code> before any graph has been attached.
+     */
+    GraphGroupPlan *graphGroupPlan;
+  
+    /** <code>false</code> if the graph groups must be recomputed at the end of the current edit. */
+    bool isGraphGroupListValid;
     
     int numBytesInInputBuffers;
     int numBytesInOutputBuffers;
@@ -236,6 +481,34 @@ class PdContext {
     float *globalDspInputBuffers;
     float *globalDspOutputBuffers;
   
+    /** Requests of the audio thread waiting to be executed at the start of the next block. */
+    GraphCommandQueue *graphCommandQueue;
+  
+    /** Messages sent from outside of the audio thread, waiting to be scheduled. */
+    ExternalMessageQueue *externalMessageQueue;
+  
+    /** Allocates scheduled messages and messages queued at dsp objects. */
+    MessageAllocator *messageAllocator;
+  
+    /**
+     * The handles of receiver names which have been used to send external messages. Handles are
+     * numbered in the order in which names are first resolved. Guarded by the
+     * <code>receiverHandleLock</code>.
+     */
+    map<string, int> receiverHandleMap;
+  
+    /**
+     * A thread lock protecting the <code>receiverHandleMap</code>. It is only held for a lookup or
+     * insertion, never while the context is locked.
+     */
+    pthread_mutex_t receiverHandleLock;
+  
+    /**
+     * The name index in the <code>MessageSendController</code> of every receiver handle, or -1 if
+     * the handle has not yet been bound. Only accessed by the audio thread.
+     */
+    vector<int> receiverNameIndices;
+  
     /** A message queue keeping track of all scheduled messages. */
     OrderedMessageQueue *messageCallbackQueue;
   
@@ -268,16 +541,23 @@ class PdContext {
     
     /** A global list of all [table] objects. */
     list<MessageTable *> tableList;
+  
+    /** The tables as seen by the audio thread. */
+    list<MessageTable *> liveTableList;
     
     /** A global list of all table receivers (e.g., [tabread4~] and [tabplay~]) */
     list<TableReceiverInterface *> tableReceiverList;
   
     ObjectFactoryMap *objectFactoryMap;
   
-    BufferPool *bufferPool;
-  
     /** A global map storing values for Value objects. */
     map<string,float> valueMap;
+  
+    /** The shared fft plans, by size. Guarded by the <code>realFftLock</code>. */
+    map<int, RealFft *> realFftMap;
+  
+    /** A thread lock protecting the <code>realFftMap</code>. Objects may be created on any thread. */
+    pthread_mutex_t realFftLock;
 };
 
 #endif // _PD_CONTEXT_H_
@@ -20,13 +20,21 @@
  *
  */
 
+#include <limits.h>
+#include "BufferPool.h"
 #include "DeclareList.h"
+#include "DspConvolve.h"
+#include "DspFilter.h"
+#include "DspFilterBank.h"
 #include "DspImplicitAdd.h"
 #include "DspInlet.h"
 #include "DspOutlet.h"
+#include "DspReceive.h"
+#include "DspSend.h"
 #include "DspTablePlay.h"
 #include "DspTableRead.h"
 #include "DspTableRead4.h"
+#include "DspWorkerPool.h"
 #include "MessageInlet.h"
 #include "MessageOutlet.h"
 #include "MessageTableRead.h"
@@ -35,6 +43,18 @@
 #include "PdGraph.h"
 #include "StaticUtils.h"
 
+// graphs with fewer dsp objects than this are always processed serially
+#define MIN_PARALLEL_GRAPH_COST 32
+
+// levels with fewer dsp objects than this are processed on the calling thread
+#define MIN_PARALLEL_LEVEL_COST 8
+
+// levels with fewer independent filters than this process them one by one
+#define MIN_FILTER_BANK_SIZE 4
+
+// the number of buffers which partial reorders may retire before the whole root graph is reordered
+#define MIN_RETIRED_BUFFERS 64
+
 
 #pragma mark - Constructor/Deconstructor
 
@@ -45,14 +65,30 @@ PdGraph::PdGraph(PdMessage *initMessage, PdGraph *parentGraph, PdContext *contex
   this->parentGraph = parentGraph; // == NULL if this is a root graph
   this->context = context;
   inletList = vector<MessageObject *>();
+  dispatchInletList = new vector<MessageObject *>();
   outletList = vector<MessageObject *>();
   nodeList = list<MessageObject *>();
   dspNodeList = list<DspObject *>();
   declareList = new DeclareList();
   // all graphs start out unattached to any context, though they exist in a context
   isAttachedToContext = false;
+  isLiveGraph = false;
   switched = true; // graphs are switched on by default
   processFunction = &processGraph;
+  bufferPool = (parentGraph == NULL) ? new BufferPool(context->getBlockSize()) : NULL;
+  dspOutputBuffers = NULL;
+  workerPool = NULL;
+  isDspLevelListValid = false;
+  currentDspLevel = 0;
+  numDspLevelTasks = 0;
+  isDspProcessPlanValid = false;
+  isDspProcessPlanEnabled = true;
+  isDspSignalStateValid = false;
+  isDspFilterBankPlanValid = false;
+  isDspFilterBankEnabled = true;
+  numBuffersAfterReorder = 0;
+  dspGraphPlan = NULL;
+  isDspGraphPlanValid = false;
       
   // initialise the graph arguments
   this->graphId = graphId;
@@ -71,7 +107,7 @@ PdGraph::~PdGraph() {
   // remove all implicit +~~ objects
   for (list<DspObject *>::iterator it = dspNodeList.begin(); it != dspNodeList.end(); ++it) {
     DspObject *dspObject = *it;
-    if (!strcmp(dspObject->toString().c_str(), DspImplicitAdd::getObjectLabel())) {
+    if (dspObject->getObjectType() == DSP_IMPLICIT_ADD) {
       delete dspObject;
     }
   }
@@ -80,29 +116,20 @@ PdGraph::~PdGraph() {
   for (list<MessageObject *>::iterator it = nodeList.begin(); it != nodeList.end(); ++it) {
     delete *it;
   }
-}
-
-
-#pragma mark - Lock/Unlock Context
-
-void PdGraph::lockContextIfAttached() {
-  if (isAttachedToContext) {
-    context->lock();
-  }
-}
-
-void PdGraph::unlockContextIfAttached() {
-  if (isAttachedToContext) {
-    context->unlock();
+  
+  // the graph is only deleted once the audio thread no longer uses it
+  for (int i = 0; i < dspFilterBankPlan.size(); i++) {
+    delete dspFilterBankPlan[i].filterBank;
   }
+  delete dspGraphPlan;
+  delete dispatchInletList;
+  delete bufferPool;
 }
 
 
 #pragma mark - Add/Remove Objects
 
 void PdGraph::addObject(float canvasX, float canvasY, MessageObject *messageObject) {
-  lockContextIfAttached();
-  
   nodeList.push_back(messageObject); // all nodes are added to the node list regardless
   
   messageObject->setCanvasPosition(canvasX, canvasY);
@@ -111,6 +138,7 @@ void PdGraph::addObject(float canvasX, float canvasY, MessageObject *messageObje
     case MESSAGE_INLET:
     case DSP_INLET: {
       addLetObjectToLetList(messageObject, canvasX, &inletList);
+      updateDispatchInletList();
       break;
     }
     case MESSAGE_OUTLET:
@@ -127,12 +155,26 @@ void PdGraph::addObject(float canvasX, float canvasY, MessageObject *messageObje
     }
   }
   
-  unlockContextIfAttached();
+  // the new object may create a dependency between this graph and other graphs
+  if (isAttachedToContext) context->invalidateGraphGroups();
 }
 
 void PdGraph::removeObject(MessageObject *object) {
-  lockContextIfAttached();
-  
+  if (detachObject(object)) {
+    disposeObject(object);
+  }
+}
+
+void PdGraph::disposeObject(MessageObject *object) {
+  if (isLive()) {
+    context->retireObject(object);
+  } else {
+    delete object;
+  }
+}
+
+bool PdGraph::detachObject(MessageObject *object) {
+  bool isFound = false;
   list<MessageObject *>::iterator it = nodeList.begin();
   list<MessageObject *>::iterator end = nodeList.end();
   while (it != end) {
@@ -167,21 +209,22 @@ void PdGraph::removeObject(MessageObject *object) {
       // remove the object from the dspNodeList if the object processes audio
       if (object->doesProcessAudio()) {
         dspNodeList.remove((DspObject *) object);
+        invalidateDspLevelList();
       }
       
       // remove the object from any special lists if it is in any of them (e.g., receive, throw~, etc.)
       unregisterObject(object);
       
-      // delete the object
-      delete object;
+      if (isAttachedToContext) context->invalidateGraphGroups();
       
+      isFound = true;
       break;
     } else {
       it++;
     }
   }
   
-  unlockContextIfAttached();
+  return isFound;
 }
 
 void PdGraph::addLetObjectToLetList(MessageObject *inletObject, float newPosition, vector<MessageObject *> *letList) {
@@ -212,6 +255,20 @@ void PdGraph::addLetObjectToLetList(MessageObject *inletObject, float newPositio
   letList->push_back(inletObject);
 }
 
+void PdGraph::updateDispatchInletList() {
+  if (isLive()) {
+    context->setDispatchInletList(this, new vector<MessageObject *>(inletList));
+  } else {
+    *dispatchInletList = inletList;
+  }
+}
+
+void PdGraph::swapDispatchInletList(vector<MessageObject *> **inletList) {
+  vector<MessageObject *> *swapList = dispatchInletList;
+  dispatchInletList = *inletList;
+  *inletList = swapList;
+}
+
 
 #pragma mark - Register/Unregister Objects
 
@@ -257,6 +314,10 @@ void PdGraph::registerObject(MessageObject *messageObject) {
       context->registerDspReceive((DspReceive *) messageObject);
       break;
     }
+    case DSP_CONVOLVE: {
+      context->registerTableReceiver((DspConvolve *) messageObject);
+      break;
+    }
     case DSP_TABLE_PLAY: {
       context->registerTableReceiver((DspTablePlay *) messageObject);
       break;
@@ -303,6 +364,18 @@ void PdGraph::unregisterObject(MessageObject *messageObject) {
       context->unregisterDspReceive((DspReceive *) messageObject);
       break;
     }
+    case DSP_THROW: {
+      context->unregisterDspThrow((DspThrow *) messageObject);
+      break;
+    }
+    case DSP_CATCH: {
+      context->unregisterDspCatch((DspCatch *) messageObject);
+      break;
+    }
+    case DSP_CONVOLVE: {
+      context->unregisterTableReceiver((DspConvolve *) messageObject);
+      break;
+    }
     case DSP_TABLE_PLAY: {
       context->unregisterTableReceiver((DspTablePlay *) messageObject);
       break;
@@ -328,6 +401,8 @@ void PdGraph::attachToContext(bool isAttached) {
   // ensure that this function is only run on attachement change
   if (isAttachedToContext != isAttached) {
     isAttachedToContext = isAttached;
+    // once attached, the graph may be processed by the audio thread
+    if (isAttached && parentGraph == NULL) isLiveGraph = true;
     // ensure that all subgraphs know if they are attached or not
     for (list<MessageObject *>::iterator it = nodeList.begin(); it != nodeList.end(); ++it) {
       MessageObject *messageObject = *it;
@@ -400,28 +475,159 @@ void PdGraph::sendMessageToNamedReceivers(char *name, PdMessage *message) {
 #pragma mark - Message/DspObject Functions
 
 void PdGraph::receiveMessage(int inletIndex, PdMessage *message) {
-  MessageInlet *inlet = (MessageInlet *) inletList.at(inletIndex);
+  MessageInlet *inlet = (MessageInlet *) dispatchInletList->at(inletIndex);
   inlet->receiveMessage(0, message);
 }
 
 void PdGraph::processGraph(DspObject *dspObject, int fromIndex, int toIndex) {
   PdGraph *d = reinterpret_cast<PdGraph *>(dspObject);
   
-  if (d->switched) {
+  // only the plan is read here. The graph itself may be edited concurrently on the editing thread.
+  DspGraphPlan *plan = d->dspGraphPlan;
+  
+  // DSP processing elements are only executed if the graph is switched on. A graph without a plan
+  // has not been processed yet.
+  if (d->switched && plan != NULL) {
     // when inlets are processed, they will resolve their buffers and everything will proceed as normal
     
-    // process all dsp objects
-    // DSP processing elements are only executed if the graph is switched on
-    
     // TODO(mhroth): iterate depending on local blocksize relative to parent
+    if (!plan->dspLevelList.empty()) {
+      // execute all nodes level by level. All nodes of a level finish before the next one starts.
+      for (int i = 0; i < plan->dspLevelList.size(); ++i) {
+        vector<DspObject *> *dspLevel = &(plan->dspLevelList[i]);
+        if (plan->dspLevelCostList[i] >= MIN_PARALLEL_LEVEL_COST && dspLevel->size() > 1) {
+          d->currentDspLevel = i;
+          d->numDspLevelTasks = min((int) dspLevel->size(), 4 * (plan->workerPool->getNumThreads() + 1));
+          plan->workerPool->execute(&processDspLevelTask, d, d->numDspLevelTasks);
+        } else {
+          for (int j = 0; j < dspLevel->size(); ++j) {
+            DspObject *dspObject = dspLevel->at(j);
+            dspObject->processFunction(dspObject, 0, d->blockSizeInt);
+          }
+        }
+      }
+      return;
+    }
+    
+    if (!plan->dspFilterBankPlan.empty()) {
+      // execute all nodes level by level, with the filters of each level processed together. The
+      // plan does not skip switched off subgraphs, for which the process plan is used instead.
+      bool isSwitchedOn = true;
+      for (int i = 0; i < plan->dspFilterBankGraphs.size() && isSwitchedOn; ++i) {
+        isSwitchedOn = plan->dspFilterBankGraphs[i]->switched;
+      }
+      if (isSwitchedOn) {
+        int numSteps = plan->dspFilterBankPlan.size();
+        DspFilterBankStep *dspFilterBankPlan = &(plan->dspFilterBankPlan[0]);
+        int blockSize = d->blockSizeInt;
+        for (int i = 0; i < numSteps; ++i) {
+          DspFilterBankStep *step = dspFilterBankPlan + i;
+          if (step->dspObject != NULL) {
+            step->dspObject->processFunction(step->dspObject, 0, blockSize);
+          } else {
+            step->filterBank->process();
+          }
+        }
+        return;
+      }
+    }
+    
+    if (plan->isDspProcessPlanEnabled) {
+      // execute all nodes of this graph and its subgraphs in a single loop
+      int numSteps = plan->dspProcessPlan.size();
+      DspProcessStep *dspProcessPlan = (numSteps > 0) ? &(plan->dspProcessPlan[0]) : NULL;
+      int blockSize = d->blockSizeInt;
+      for (int i = 0; i < numSteps; ++i) {
+        DspProcessStep *step = dspProcessPlan + i;
+        if (step->numGraphSteps < 0) {
+          step->dspObject->processFunction(step->dspObject, 0, blockSize);
+        } else if (!reinterpret_cast<PdGraph *>(step->dspObject)->switched) {
+          i += step->numGraphSteps; // skip the subgraph
+        }
+      }
+      return;
+    }
+    
     // execute all nodes which process audio
-    for (list<DspObject *>::iterator it = d->dspNodeList.begin(); it != d->dspNodeList.end(); ++it) {
-      DspObject *dspObject = *it;
+    int numNodes = plan->dspNodeList.size();
+    for (int i = 0; i < numNodes; ++i) {
+      DspObject *dspObject = plan->dspNodeList[i];
       dspObject->processFunction(dspObject, 0, d->blockSizeInt);
     }
   }
 }
 
+void PdGraph::processDspLevelTask(void *graph, int taskIndex) {
+  PdGraph *d = reinterpret_cast<PdGraph *>(graph);
+  vector<DspObject *> *dspLevel = &(d->dspGraphPlan->dspLevelList[d->currentDspLevel]);
+  int numNodes = dspLevel->size();
+  int toNode = ((taskIndex+1) * numNodes) / d->numDspLevelTasks;
+  for (int i = (taskIndex * numNodes) / d->numDspLevelTasks; i < toNode; ++i) {
+    DspObject *dspObject = dspLevel->at(i);
+    dspObject->processFunction(dspObject, 0, d->blockSizeInt);
+  }
+}
+
+void PdGraph::swapDspGraphPlan(DspGraphPlan **dspGraphPlan) {
+  DspGraphPlan *swapPlan = this->dspGraphPlan;
+  this->dspGraphPlan = *dspGraphPlan;
+  *dspGraphPlan = swapPlan;
+}
+
+void PdGraph::updateDspGraphPlan() {
+  if (isDspGraphPlanValid) return;
+  
+  // objects skip work on constant buffers. Their states must match the new buffers.
+  if (!isDspSignalStateValid) linkDspSignalStates();
+  
+  // the buffers of any object may have changed, so all of them are committed along with the plans
+  vector<DspObject *> objectList;
+  getDspBufferObjects(&objectList);
+  for (int i = 0; i < objectList.size(); i++) {
+    context->updateDspState(objectList[i]);
+  }
+  
+  computeDspGraphPlan();
+}
+
+void PdGraph::computeDspGraphPlan() {
+  if (isDspGraphPlanValid) return;
+  
+  // subgraphs which are processed as nodes of this graph use plans of their own
+  for (list<MessageObject *>::iterator it = nodeList.begin(); it != nodeList.end(); ++it) {
+    if ((*it)->getObjectType() == OBJECT_PD) {
+      reinterpret_cast<PdGraph *>(*it)->computeDspGraphPlan();
+    }
+  }
+  
+  DspGraphPlan *plan = new DspGraphPlan();
+  plan->dspNodeList = vector<DspObject *>(dspNodeList.begin(), dspNodeList.end());
+  plan->workerPool = workerPool;
+  plan->isDspProcessPlanEnabled = isDspProcessPlanEnabled;
+  if (workerPool != NULL) {
+    if (!isDspLevelListValid) computeDspLevelList();
+    plan->dspLevelList = dspLevelList;
+    plan->dspLevelCostList = dspLevelCostList;
+  }
+  if (isDspProcessPlanEnabled) {
+    if (!isDspProcessPlanValid) computeDspProcessPlan();
+    plan->dspProcessPlan = dspProcessPlan;
+    if (isDspFilterBankEnabled && parentGraph == NULL) {
+      if (!isDspFilterBankPlanValid) computeDspFilterBankPlan();
+      plan->dspFilterBankPlan = dspFilterBankPlan;
+      plan->dspFilterBankGraphs = dspFilterBankGraphs;
+    }
+  }
+  context->setDspGraphPlan(this, plan);
+  isDspGraphPlanValid = true;
+}
+
+void PdGraph::invalidateDspGraphPlan() {
+  for (PdGraph *graph = this; graph != NULL; graph = graph->parentGraph) {
+    graph->isDspGraphPlanValid = false;
+  }
+}
+
 
 #pragma mark - Add/Remove Connections (High Level)
 
@@ -435,7 +641,6 @@ void PdGraph::addConnection(MessageObject *fromObject, int outletIndex, MessageO
     return;
   }
   
-  lockContextIfAttached();
   toObject->addConnectionFromObjectToInlet(fromObject, outletIndex, inletIndex);
   fromObject->addConnectionToObjectFromOutlet(toObject, inletIndex, outletIndex);
   
@@ -444,8 +649,6 @@ void PdGraph::addConnection(MessageObject *fromObject, int outletIndex, MessageO
   // the appropriate changes. Usually a complete reevaluation shouldn't be necessary, and otherwise
   // the use of a linked list to store the node list should make the reordering fast.
   //  computeDeepLocalDspProcessOrder(); 
-  
-  unlockContextIfAttached();
 }
 
 void PdGraph::addConnection(int fromObjectIndex, int outletIndex, int toObjectIndex, int inletIndex) {
@@ -465,10 +668,8 @@ void PdGraph::addConnection(int fromObjectIndex, int outletIndex, int toObjectIn
  * force a reevaluation, as the new connection may force a new constrained how how objects are ordered.
  */
 void PdGraph::removeConnection(MessageObject *fromObject, int outletIndex, MessageObject *toObject, int inletIndex) {
-  lockContextIfAttached();
   toObject->removeConnectionFromObjectToInlet(fromObject, outletIndex, inletIndex);
   fromObject->removeConnectionToObjectFromOutlet(toObject, inletIndex, outletIndex);
-  unlockContextIfAttached();
 }
 
 list<ObjectLetPair> PdGraph::getIncomingConnections(unsigned int inletIndex) {
@@ -615,6 +816,9 @@ list<DspObject *> PdGraph::getProcessOrder() {
     list<DspObject *> processOrder;
     for (vector<MessageObject *>::iterator it = inletList.begin(); it != inletList.end(); ++it) {
       MessageObject *messageObject = *it;
+      // the local ordered flags are only reset below, in computeDeepLocalDspProcessOrder(). Reset the
+      // inlet's flag now, otherwise the objects upstream of it are skipped when the graph is reordered.
+      messageObject->resetOrderedFlag();
       // NOTE(mhroth): try to use some "GraphInlet" interface here
       switch (messageObject->getObjectType()) {
         case MESSAGE_INLET: {
@@ -650,8 +854,6 @@ bool PdGraph::isLeafNode() {
 }
 
 void PdGraph::computeDeepLocalDspProcessOrder() {
-  lockContextIfAttached();
-
   /* clear/reset dspNodeList
    * Find all leaf nodes in nodeList. this includes PdGraphs as they are objects as well.
    * For each leaf node, generate an ordering for all of the nodes in the current graph.
@@ -670,11 +872,17 @@ void PdGraph::computeDeepLocalDspProcessOrder() {
     }
   }
   
+  // The buffers of all objects are reassigned when the whole graph is reordered. If buffers are
+  // reused, every outlet first gets a buffer of its own. They are shared once the order is known.
+  bool isAssigningBuffers = (parentGraph == NULL) && bufferPool->isReusingBuffers();
+  if (parentGraph == NULL) bufferPool->releaseAllBuffers();
+  if (isAssigningBuffers) bufferPool->setReuseBuffers(false);
+  
   // remove all +~~ objects
   for (list<DspObject *>::iterator it = dspNodeList.begin(); it != dspNodeList.end(); ++it) {
     DspObject *dspObject = *it;
-    if (!strcmp(dspObject->toString().c_str(), DspImplicitAdd::getObjectLabel())) {
-      delete dspObject;
+    if (dspObject->getObjectType() == DSP_IMPLICIT_ADD) {
+      disposeObject(dspObject);
     }
   }
   
@@ -687,6 +895,18 @@ void PdGraph::computeDeepLocalDspProcessOrder() {
     dspNodeList.splice(dspNodeList.end(), processSubList);
   }
   
+  invalidateDspLevelList();
+  
+  if (parentGraph == NULL) resolveDspReceives();
+  if (isAssigningBuffers) {
+    bufferPool->setReuseBuffers(true);
+    // while every outlet still has a buffer of its own, only actual dependencies between objects
+    // order the levels of the filter bank plan. The buffers are then assigned to suit both plans.
+    computeDspFilterBankPlan();
+    assignDspBuffers();
+  }
+  if (parentGraph == NULL) numBuffersAfterReorder = bufferPool->getNumTotalBuffers();
+  
   /* print out process order of local dsp objects (for debugging) */
   /*
   if (!dspNodeList.empty()) {
@@ -700,8 +920,676 @@ void PdGraph::computeDeepLocalDspProcessOrder() {
     printStd("\n");
   }
   */
+}
+
+void PdGraph::updateDspProcessOrder(set<MessageObject *> *objectSet) {
+  // The region consists of all objects which are connected, however indirectly, to the given
+  // objects. No other object depends on or is depended on by the region, so its order relative
+  // to the rest of the graph is free.
+  set<MessageObject *> regionSet(*objectSet);
+  list<MessageObject *> searchList(objectSet->begin(), objectSet->end());
+  bool isConnectedToParent = false;
+  bool isConnectedByName = false;
+  while (!searchList.empty()) {
+    MessageObject *object = searchList.back();
+    searchList.pop_back();
+    switch (object->getObjectType()) {
+      case MESSAGE_INLET:
+      case MESSAGE_OUTLET:
+      case DSP_INLET:
+      case DSP_OUTLET: isConnectedToParent = true; break;
+      case DSP_CATCH:
+      case DSP_DELAY_READ:
+      case DSP_DELAY_WRITE:
+      case DSP_RECEIVE:
+      case DSP_SEND:
+      case DSP_THROW:
+      case DSP_VARIABLE_DELAY: isConnectedByName = true; break;
+      default: break;
+    }
+    for (int i = 0; i < object->getNumInlets(); i++) {
+      list<ObjectLetPair> connections = object->getIncomingConnections(i);
+      for (list<ObjectLetPair>::iterator it = connections.begin(); it != connections.end(); ++it) {
+        if (regionSet.insert(it->first).second) searchList.push_back(it->first);
+      }
+    }
+    for (int i = 0; i < object->getNumOutlets(); i++) {
+      list<ObjectLetPair> connections = object->getOutgoingConnections(i);
+      for (list<ObjectLetPair>::iterator it = connections.begin(); it != connections.end(); ++it) {
+        if (regionSet.insert(it->first).second) searchList.push_back(it->first);
+      }
+    }
+  }
+  
+  if (isConnectedByName) {
+    // receive~s may read the input of a send~ anywhere in the root graph (see resolveDspReceives()).
+    // Likewise, throw~/catch~ and delwrite~/delread~/vd~ pairs must stay in order across graphs.
+    getRootGraph()->computeDeepLocalDspProcessOrder();
+  } else if (isConnectedToParent && parentGraph != NULL) {
+    // the region extends beyond this graph. Reorder the region around this graph in the parent.
+    set<MessageObject *> graphSet;
+    graphSet.insert(this);
+    parentGraph->updateDspProcessOrder(&graphSet);
+  } else if (parentGraph == NULL && 2 * regionSet.size() > nodeList.size()) {
+    computeDeepLocalDspProcessOrder(); // most of the graph is affected anyway
+  } else {
+    // remove the region from the process order, including the +~~ objects feeding into it
+    list<DspObject *>::iterator it = dspNodeList.begin();
+    while (it != dspNodeList.end()) {
+      DspObject *dspObject = *it;
+      if (dspObject->getObjectType() == DSP_IMPLICIT_ADD) {
+        DspImplicitAdd *dspAdd = reinterpret_cast<DspImplicitAdd *>(dspObject);
+        if (regionSet.find(dspAdd->getDestination()) != regionSet.end()) {
+          disposeObject(dspAdd);
+          it = dspNodeList.erase(it);
+          continue;
+        }
+      } else if (regionSet.find(dspObject) != regionSet.end()) {
+        it = dspNodeList.erase(it);
+        continue;
+      }
+      ++it;
+    }
+    
+    // The released buffers of the remaining objects may still be in use by them, and are retired.
+    // Buffers which none of them refer to are free, including those of the region itself and those
+    // retired by earlier partial reorders which have since been given up. The edit takes effect at
+    // the next block, so they are returned to the pool now. The region only uses these buffers and
+    // new ones, which it may reuse among its own objects as it is processed last.
+    PdGraph *rootGraph = getRootGraph();
+    BufferPool *bufferPool = getBufferPool();
+    vector<bool> isReferenced(bufferPool->getNumTotalBuffers(), false);
+    rootGraph->markReferencedDspBuffers(bufferPool, &regionSet, &isReferenced);
+    bufferPool->reclaimUnreferencedBuffers(&isReferenced);
+    
+    // order the region after all other objects. The given objects may already have been removed
+    // from the graph, so only objects in the nodeList are considered.
+    list<MessageObject *> leafNodeList;
+    for (list<MessageObject *>::iterator it = nodeList.begin(); it != nodeList.end(); ++it) {
+      MessageObject *object = *it;
+      if (regionSet.find(object) != regionSet.end()) {
+        object->resetOrderedFlag();
+        if (object->isLeafNode()) leafNodeList.push_back(object);
+      }
+    }
+    for (list<MessageObject *>::iterator it = leafNodeList.begin(); it != leafNodeList.end(); ++it) {
+      list<DspObject *> processSubList = (*it)->getProcessOrder();
+      dspNodeList.splice(dspNodeList.end(), processSubList);
+    }
+    
+    bufferPool->retireAvailableBuffers();
+    invalidateDspLevelList();
+    
+    // Buffers which remain referenced stay retired until a later reorder frees them, which may
+    // leave the pool fragmented. Repack it with a complete reorder if they start to add up.
+    if (bufferPool->getNumTotalBuffers() > 2 * rootGraph->numBuffersAfterReorder + MIN_RETIRED_BUFFERS) {
+      rootGraph->computeDeepLocalDspProcessOrder();
+    }
+  }
+}
+
+int PdGraph::getDspBufferAccess(DspObject *dspObject, set<float *> *readBuffers,
+    set<float *> *writeBuffers, bool *accessesGlobalResource, bool *sendsMessages,
+    bool *schedulesMessages) {
+  switch (dspObject->getObjectType()) {
+    case OBJECT_PD: {
+      // a subgraph accesses all buffers accessed by its own dsp objects
+      PdGraph *graph = reinterpret_cast<PdGraph *>(dspObject);
+      int cost = 0;
+      for (list<DspObject *>::iterator it = graph->dspNodeList.begin(); it != graph->dspNodeList.end(); ++it) {
+        cost += getDspBufferAccess(*it, readBuffers, writeBuffers, accessesGlobalResource,
+            sendsMessages, schedulesMessages);
+      }
+      return cost;
+    }
+    case DSP_CATCH:
+    case DSP_CONVOLVE:
+    case DSP_DAC:
+    case DSP_DELAY_READ:
+    case DSP_DELAY_WRITE:
+    case DSP_RECEIVE:
+    case DSP_SEND:
+    case DSP_TABLE_PLAY:
+    case DSP_TABLE_READ:
+    case DSP_TABLE_READ4:
+    case DSP_THROW:
+    case DSP_VARIABLE_DELAY: {
+      *accessesGlobalResource = true;
+      // allow fallthrough
+    }
+    default: {
+      if (dspObject->doesSendMessages()) *sendsMessages = true;
+      if (dspObject->doesScheduleMessages()) *schedulesMessages = true;
+      for (int i = 0; i < dspObject->getNumDspInlets(); i++) {
+        readBuffers->insert(dspObject->getDspBufferAtInlet(i));
+      }
+      for (int i = 0; i < dspObject->getNumDspOutlets(); i++) {
+        writeBuffers->insert(dspObject->getDspBufferAtOutlet(i));
+      }
+      return 1;
+    }
+  }
+}
+
+int PdGraph::getDspLevel(DspObject *dspObject, map<float *, int> *lastWriteLevel,
+    map<float *, int> *lastReadLevel, int *lastGlobalLevel, int *cost, vector<bool> *isExclusiveLevel) {
+  set<float *> readBuffers;
+  set<float *> writeBuffers;
+  bool accessesGlobalResource = false;
+  bool sendsMessages = false;
+  bool schedulesMessages = false;
+  *cost = getDspBufferAccess(dspObject, &readBuffers, &writeBuffers,
+      &accessesGlobalResource, &sendsMessages, &schedulesMessages);
+  if (sendsMessages) return -1;
   
-  unlockContextIfAttached();
+  // scheduled messages are queued in the same order if these objects keep their relative order
+  if (schedulesMessages) accessesGlobalResource = true;
+  
+  int level = 0;
+  for (set<float *>::iterator bit = readBuffers.begin(); bit != readBuffers.end(); ++bit) {
+    map<float *, int>::iterator mit = lastWriteLevel->find(*bit);
+    if (mit != lastWriteLevel->end()) level = max(level, mit->second + 1);
+  }
+  for (set<float *>::iterator bit = writeBuffers.begin(); bit != writeBuffers.end(); ++bit) {
+    map<float *, int>::iterator mit = lastWriteLevel->find(*bit);
+    if (mit != lastWriteLevel->end()) level = max(level, mit->second + 1);
+    mit = lastReadLevel->find(*bit);
+    if (mit != lastReadLevel->end()) level = max(level, mit->second + 1);
+  }
+  if (accessesGlobalResource) level = max(level, *lastGlobalLevel + 1);
+  if (isExclusiveLevel != NULL) {
+    if (schedulesMessages) {
+      // the object is processed alone, after all objects placed so far
+      level = max(level, (int) isExclusiveLevel->size());
+      isExclusiveLevel->resize(level+1, false);
+      (*isExclusiveLevel)[level] = true;
+    } else {
+      while (level < isExclusiveLevel->size() && (*isExclusiveLevel)[level]) level++;
+    }
+  }
+  if (accessesGlobalResource) *lastGlobalLevel = level;
+  
+  for (set<float *>::iterator bit = readBuffers.begin(); bit != readBuffers.end(); ++bit) {
+    map<float *, int>::iterator mit = lastReadLevel->find(*bit);
+    if (mit == lastReadLevel->end()) (*lastReadLevel)[*bit] = level;
+    else mit->second = max(mit->second, level);
+  }
+  for (set<float *>::iterator bit = writeBuffers.begin(); bit != writeBuffers.end(); ++bit) {
+    map<float *, int>::iterator mit = lastWriteLevel->find(*bit);
+    if (mit == lastWriteLevel->end()) (*lastWriteLevel)[*bit] = level;
+    else mit->second = max(mit->second, level);
+  }
+  return level;
+}
+
+void PdGraph::invalidateDspLevelList() {
+  // the buffers of a subgraph are part of the level list of all of its parents
+  for (PdGraph *graph = this; graph != NULL; graph = graph->parentGraph) {
+    graph->isDspLevelListValid = false;
+    graph->isDspProcessPlanValid = false;
+    graph->isDspSignalStateValid = false;
+    graph->isDspFilterBankPlanValid = false;
+    graph->isDspGraphPlanValid = false;
+  }
+}
+
+void PdGraph::computeDspProcessPlan() {
+  dspProcessPlan.clear();
+  appendToDspProcessPlan(this);
+  isDspProcessPlanValid = true;
+}
+
+void PdGraph::appendToDspProcessPlan(PdGraph *graph) {
+  for (list<DspObject *>::iterator it = graph->dspNodeList.begin(); it != graph->dspNodeList.end(); ++it) {
+    DspObject *dspObject = *it;
+    DspProcessStep step;
+    step.dspObject = dspObject;
+    step.numGraphSteps = -1;
+    if (dspObject->getObjectType() == OBJECT_PD) {
+      // the subgraph is replaced by its own dsp objects, preceded by a step checking its switch
+      int graphStepIndex = dspProcessPlan.size();
+      dspProcessPlan.push_back(step);
+      appendToDspProcessPlan(reinterpret_cast<PdGraph *>(dspObject));
+      dspProcessPlan[graphStepIndex].numGraphSteps = dspProcessPlan.size() - graphStepIndex - 1;
+    } else {
+      dspProcessPlan.push_back(step);
+    }
+  }
+}
+
+int PdGraph::getDspBufferObjects(vector<DspObject *> *objectList) {
+  if (!isDspProcessPlanValid) computeDspProcessPlan();
+  for (int i = 0; i < dspProcessPlan.size(); i++) {
+    if (dspProcessPlan[i].numGraphSteps < 0) objectList->push_back(dspProcessPlan[i].dspObject);
+  }
+  int numSteps = objectList->size();
+  list<PdGraph *> graphList(1, this);
+  while (!graphList.empty()) {
+    PdGraph *graph = graphList.front();
+    graphList.pop_front();
+    for (list<MessageObject *>::iterator it = graph->nodeList.begin(); it != graph->nodeList.end(); ++it) {
+      MessageObject *object = *it;
+      switch (object->getObjectType()) {
+        case OBJECT_PD: graphList.push_back(reinterpret_cast<PdGraph *>(object)); break;
+        case DSP_INLET:
+        case DSP_OUTLET: objectList->push_back(reinterpret_cast<DspObject *>(object)); break;
+        default: break;
+      }
+    }
+  }
+  return numSteps;
+}
+
+void PdGraph::markReferencedDspBuffers(BufferPool *bufferPool, set<MessageObject *> *excludedSet,
+    vector<bool> *isReferenced) {
+  // the objects refer to the buffers directly, so the base class accessors bypass any forwarding
+  vector<DspObject *> objectList(dspNodeList.begin(), dspNodeList.end());
+  for (list<MessageObject *>::iterator it = nodeList.begin(); it != nodeList.end(); ++it) {
+    MessageObject *object = *it;
+    switch (object->getObjectType()) {
+      case OBJECT_PD: {
+        reinterpret_cast<PdGraph *>(object)->markReferencedDspBuffers(bufferPool, excludedSet, isReferenced);
+        break;
+      }
+      case DSP_INLET:
+      case DSP_OUTLET: objectList.push_back(reinterpret_cast<DspObject *>(object)); break;
+      default: break;
+    }
+  }
+  for (int i = 0; i < objectList.size(); i++) {
+    DspObject *dspObject = objectList[i];
+    if (dspObject->getObjectType() == OBJECT_PD || excludedSet->find(dspObject) != excludedSet->end()) continue;
+    for (int j = 0; j < dspObject->getNumDspInlets(); j++) {
+      int index = bufferPool->getBufferIndex(dspObject->DspObject::getDspBufferAtInlet(j));
+      if (index >= 0) isReferenced->at(index) = true;
+    }
+    for (int j = 0; j < dspObject->getNumDspOutlets(); j++) {
+      int index = bufferPool->getBufferIndex(dspObject->DspObject::getDspBufferAtOutlet(j));
+      if (index >= 0) isReferenced->at(index) = true;
+    }
+  }
+}
+
+void PdGraph::resolveDspReceives() {
+  vector<DspObject *> objectList;
+  int numSteps = getDspBufferObjects(&objectList);
+  
+  // A receive~ which is processed after its send~ may as well not exist. The objects connected to
+  // it read the input of the send~ instead, which lives at least until they are processed. Chains
+  // of send~s and receive~s are followed to the first input, as all of them are ordered.
+  map<DspSend *, int> numBypassedReceivers;
+  map<float *, float *> bufferMap;
+  for (int i = 0; i < numSteps; i++) {
+    DspObject *dspObject = objectList[i];
+    switch (dspObject->getObjectType()) {
+      case DSP_SEND: {
+        numBypassedReceivers[reinterpret_cast<DspSend *>(dspObject)] = 0;
+        break;
+      }
+      case DSP_RECEIVE: {
+        DspReceive *dspReceive = reinterpret_cast<DspReceive *>(dspObject);
+        DspSend *dspSend = context->getDspSend(dspReceive->getName());
+        map<DspSend *, int>::iterator it = numBypassedReceivers.find(dspSend);
+        if (it != numBypassedReceivers.end()) {
+          float *buffer = dspSend->DspObject::getDspBufferAtInlet(0);
+          map<float *, float *>::iterator jt = bufferMap.find(buffer);
+          bufferMap[dspReceive->getDspBufferAtOutlet(0)] = (jt == bufferMap.end()) ? buffer : jt->second;
+          it->second++;
+          dspReceive->setBypassed(true);
+        } else {
+          dspReceive->setBypassed(false);
+        }
+        break;
+      }
+      default: break;
+    }
+  }
+  for (map<DspSend *, int>::iterator it = numBypassedReceivers.begin(); it != numBypassedReceivers.end(); ++it) {
+    it->first->setNumBypassedReceivers(it->second);
+  }
+  if (bufferMap.empty()) return;
+  
+  // the receive~s keep their own outlet buffers, which they still own
+  for (int i = 0; i < objectList.size(); i++) {
+    DspObject *dspObject = objectList[i];
+    for (int j = 0; j < dspObject->getNumDspInlets(); j++) {
+      map<float *, float *>::iterator it = bufferMap.find(dspObject->DspObject::getDspBufferAtInlet(j));
+      if (it != bufferMap.end()) dspObject->DspObject::setDspBufferAtInlet(it->second, j);
+    }
+    if (dspObject->getObjectType() == DSP_RECEIVE) continue;
+    for (int j = 0; j < dspObject->getNumDspOutlets(); j++) {
+      map<float *, float *>::iterator it = bufferMap.find(dspObject->DspObject::getDspBufferAtOutlet(j));
+      if (it != bufferMap.end()) dspObject->DspObject::setDspBufferAtOutlet(it->second, j);
+    }
+  }
+}
+
+void PdGraph::linkDspSignalStates() {
+  vector<DspObject *> objectList;
+  int numSteps = getDspBufferObjects(&objectList);
+  float *zeroBuffer = getBufferPool()->getZeroBuffer();
+  
+  map<float *, int> numWriters;
+  for (int i = 0; i < numSteps; i++) {
+    DspObject *dspObject = objectList[i];
+    for (int j = 0; j < dspObject->getNumDspOutlets(); j++) {
+      numWriters[dspObject->DspObject::getDspBufferAtOutlet(j)]++;
+    }
+  }
+  
+  // A buffer may be written by several objects in turn. Each inlet refers to the state of the last
+  // one before it. Buffers which are not written before they are read (e.g. those of receive~ or
+  // of an inlet~ of the root graph) are unknown.
+  map<float *, const SignalState *> lastWriters;
+  for (int i = 0; i < numSteps; i++) {
+    DspObject *dspObject = objectList[i];
+    for (int j = 0; j < dspObject->getNumDspInlets(); j++) {
+      float *buffer = dspObject->DspObject::getDspBufferAtInlet(j);
+      map<float *, const SignalState *>::iterator it = lastWriters.find(buffer);
+      if (it != lastWriters.end()) {
+        dspObject->setSignalStateAtInlet(it->second, j);
+      } else {
+        dspObject->setSignalStateAtInlet((buffer == zeroBuffer) ? DspObject::getSilentSignalState() : NULL, j);
+      }
+    }
+    for (int j = 0; j < dspObject->getNumDspOutlets(); j++) {
+      float *buffer = dspObject->DspObject::getDspBufferAtOutlet(j);
+      // the states themselves are only reset when the buffers are committed
+      dspObject->setRetainedAtOutlet(numWriters[buffer] == 1, j);
+      lastWriters[buffer] = dspObject->getSignalStateAtOutlet(j);
+    }
+  }
+  isDspSignalStateValid = true;
+}
+
+void PdGraph::assignDspBuffers() {
+  BufferPool *bufferPool = getBufferPool();
+  int numBuffers = bufferPool->getNumTotalBuffers();
+  
+  // All objects which may refer to buffers of the pool. These are the objects of the plan, in
+  // process order, followed by the inlet~ and outlet~ objects which pass buffers between graphs.
+  vector<DspObject *> objectList;
+  int numSteps = getDspBufferObjects(&objectList);
+  
+  // Every buffer is live from the first to the last step at which it is used. The objects refer
+  // to the buffers directly, so the base class accessors are used to bypass any forwarding.
+  vector<int> lastStep(numBuffers, -1);
+  for (int i = 0; i < numSteps; i++) {
+    DspObject *dspObject = objectList[i];
+    for (int j = 0; j < dspObject->getNumDspInlets(); j++) {
+      int index = bufferPool->getBufferIndex(dspObject->DspObject::getDspBufferAtInlet(j));
+      if (index >= 0) lastStep[index] = i;
+    }
+    for (int j = 0; j < dspObject->getNumDspOutlets(); j++) {
+      int index = bufferPool->getBufferIndex(dspObject->DspObject::getDspBufferAtOutlet(j));
+      if (index >= 0) lastStep[index] = i;
+    }
+  }
+  
+  // Every buffer is also live over an interval of the filter bank plan. Objects read at an even
+  // position and write at the following odd one. All filters of a bank read and write at the same
+  // (odd) position, as they are processed together.
+  map<DspObject *, int> planPositions;
+  for (int i = 0; i < dspFilterBankPlan.size(); i++) {
+    DspFilterBank *filterBank = dspFilterBankPlan[i].filterBank;
+    if (filterBank == NULL) {
+      planPositions[dspFilterBankPlan[i].dspObject] = 2*i;
+    } else {
+      for (int j = 0; j < filterBank->getNumFilters(); j++) planPositions[filterBank->getFilter(j)] = 2*i+1;
+    }
+  }
+  bool hasFilterBankPlan = isDspFilterBankPlanValid && !dspFilterBankPlan.empty();
+  vector<int> firstPosition(numBuffers, INT_MAX);
+  vector<int> lastPosition(numBuffers, -1);
+  for (int i = 0; i < numSteps && hasFilterBankPlan; i++) {
+    DspObject *dspObject = objectList[i];
+    map<DspObject *, int>::iterator it = planPositions.find(dspObject);
+    if (it == planPositions.end()) {
+      hasFilterBankPlan = false; // the plan is out of date
+      break;
+    }
+    for (int j = 0; j < dspObject->getNumDspInlets(); j++) {
+      int index = bufferPool->getBufferIndex(dspObject->DspObject::getDspBufferAtInlet(j));
+      if (index >= 0) {
+        firstPosition[index] = min(firstPosition[index], it->second);
+        lastPosition[index] = max(lastPosition[index], it->second);
+      }
+    }
+    for (int j = 0; j < dspObject->getNumDspOutlets(); j++) {
+      int index = bufferPool->getBufferIndex(dspObject->DspObject::getDspBufferAtOutlet(j));
+      if (index >= 0) {
+        firstPosition[index] = min(firstPosition[index], it->second | 1);
+        lastPosition[index] = max(lastPosition[index], it->second | 1);
+      }
+    }
+  }
+  
+  // Assign the buffers in process order. A new buffer takes the place of one which is not used
+  // anymore, the most recently freed first as it is likely still in the cache. Buffers used at
+  // the same step never share a place, such that no object writes to one of its own inputs.
+  // Objects which can process in place are the exception. Their last used inputs are freed before
+  // their outputs are assigned, such that an output takes the place of an input. With a filter
+  // bank plan, a place is only taken if it is also free over the interval of the buffer in that
+  // plan. The intervals of each place are kept by their first position.
+  vector<int> bufferColors(numBuffers, -1);
+  vector<map<int, int> > colorIntervals;
+  vector<int> freeColors;
+  vector<int> letIndices;
+  int numColors = 0;
+  for (int i = 0; i < numSteps; i++) {
+    DspObject *dspObject = objectList[i];
+    int numInlets = dspObject->getNumDspInlets();
+    letIndices.clear();
+    for (int j = 0; j < numInlets; j++) {
+      letIndices.push_back(bufferPool->getBufferIndex(dspObject->DspObject::getDspBufferAtInlet(j)));
+    }
+    for (int j = 0; j < dspObject->getNumDspOutlets(); j++) {
+      letIndices.push_back(bufferPool->getBufferIndex(dspObject->DspObject::getDspBufferAtOutlet(j)));
+    }
+    for (int j = 0; j < letIndices.size(); j++) {
+      if (j == numInlets && dspObject->canProcessInPlace()) {
+        for (int k = 0; k < numInlets; k++) {
+          int index = letIndices[k];
+          if (index >= 0 && lastStep[index] == i) {
+            freeColors.push_back(bufferColors[index]);
+            lastStep[index] = -1; // the buffer may be used at more than one inlet
+          }
+        }
+      }
+      int index = letIndices[j];
+      if (index >= 0 && bufferColors[index] < 0) {
+        int k = freeColors.size() - 1;
+        while (hasFilterBankPlan && k >= 0) {
+          map<int, int> *intervals = &colorIntervals[freeColors[k]];
+          map<int, int>::iterator it = intervals->upper_bound(lastPosition[index]);
+          if (it == intervals->begin() || (--it)->second < firstPosition[index]) break;
+          k--;
+        }
+        if (k < 0) {
+          bufferColors[index] = numColors++;
+          if (hasFilterBankPlan) colorIntervals.resize(numColors);
+        } else {
+          bufferColors[index] = freeColors[k];
+          freeColors.erase(freeColors.begin() + k);
+        }
+        if (hasFilterBankPlan) colorIntervals[bufferColors[index]][firstPosition[index]] = lastPosition[index];
+      }
+    }
+    for (int j = 0; j < letIndices.size(); j++) {
+      int index = letIndices[j];
+      if (index >= 0 && lastStep[index] == i) {
+        freeColors.push_back(bufferColors[index]);
+        lastStep[index] = -1;
+      }
+    }
+  }
+  
+  // Record the new buffer of every inlet and outlet before the old buffers are freed. Buffers
+  // which do not belong to the pool are left alone. Buffers which are never processed (e.g. at an
+  // unconnected inlet~) are replaced by the zero buffer.
+  vector<int> letColors;
+  for (int i = 0; i < objectList.size(); i++) {
+    DspObject *dspObject = objectList[i];
+    for (int j = 0; j < dspObject->getNumDspInlets(); j++) {
+      int index = bufferPool->getBufferIndex(dspObject->DspObject::getDspBufferAtInlet(j));
+      letColors.push_back((index < 0) ? -2 : bufferColors[index]);
+    }
+    for (int j = 0; j < dspObject->getNumDspOutlets(); j++) {
+      int index = bufferPool->getBufferIndex(dspObject->DspObject::getDspBufferAtOutlet(j));
+      letColors.push_back((index < 0) ? -2 : bufferColors[index]);
+    }
+  }
+  
+  bufferPool->repack(numColors);
+  
+  // the arenas of a live graph are freed once the audio thread has switched to the new buffers
+  if (!isLive()) bufferPool->freeReleasedArenas();
+  
+  int k = 0;
+  for (int i = 0; i < objectList.size(); i++) {
+    DspObject *dspObject = objectList[i];
+    for (int j = 0; j < dspObject->getNumDspInlets(); j++, k++) {
+      if (letColors[k] == -2) continue;
+      dspObject->DspObject::setDspBufferAtInlet((letColors[k] < 0)
+          ? bufferPool->getZeroBuffer() : bufferPool->getBufferAtIndex(letColors[k]), j);
+    }
+    for (int j = 0; j < dspObject->getNumDspOutlets(); j++, k++) {
+      if (letColors[k] == -2) continue;
+      dspObject->DspObject::setDspBufferAtOutlet((letColors[k] < 0)
+          ? bufferPool->getZeroBuffer() : bufferPool->getBufferAtIndex(letColors[k]), j);
+    }
+  }
+}
+
+void PdGraph::computeDspLevelList() {
+  dspLevelList.clear();
+  dspLevelCostList.clear();
+  isDspLevelListValid = true;
+  
+  /*
+   * The serial process order is a valid order. A node must be placed in a later level than any
+   * previous node which writes a buffer that it reads or writes (read/write-after-write), and any
+   * previous node which reads a buffer that it writes (write-after-read). The latter is necessary
+   * because buffers are reused by the BufferPool. Nodes accessing global resources keep their
+   * relative order.
+   */
+  map<float *, int> lastWriteLevel;
+  map<float *, int> lastReadLevel;
+  vector<bool> isExclusiveLevel;
+  int lastGlobalLevel = -1;
+  int totalCost = 0;
+  for (list<DspObject *>::iterator it = dspNodeList.begin(); it != dspNodeList.end(); ++it) {
+    DspObject *dspObject = *it;
+    int cost = 0;
+    int level = getDspLevel(dspObject, &lastWriteLevel, &lastReadLevel, &lastGlobalLevel, &cost,
+        &isExclusiveLevel);
+    if (level < 0) {
+      // messages sent while processing dsp may reach any object in the graph. Process serially.
+      dspLevelList.clear();
+      dspLevelCostList.clear();
+      return;
+    }
+    
+    if (level >= dspLevelList.size()) {
+      dspLevelList.resize(level+1);
+      dspLevelCostList.resize(level+1, 0);
+    }
+    dspLevelList[level].push_back(dspObject);
+    dspLevelCostList[level] += cost;
+    totalCost += cost;
+  }
+  
+  // small or narrow graphs are not worth the synchronisation overhead
+  if (totalCost < MIN_PARALLEL_GRAPH_COST || dspLevelList.size() == dspNodeList.size()) {
+    dspLevelList.clear();
+    dspLevelCostList.clear();
+  }
+}
+
+void PdGraph::computeDspFilterBankPlan() {
+  clearDspFilterBankPlan();
+  isDspFilterBankPlanValid = true;
+  if (parentGraph != NULL || !isDspFilterBankEnabled || !DspFilterBank::isAvailable()) return;
+  
+  // The objects of all subgraphs are placed in levels in the same way as in computeDspLevelList().
+  // Subgraphs are not nodes of their own, such that the filters of different subgraphs (e.g. the
+  // voices of a polyphonic patch) may be processed together.
+  if (!isDspProcessPlanValid) computeDspProcessPlan();
+  vector<vector<DspObject *> > levelList;
+  vector<int> numFiltersList;
+  map<float *, int> lastWriteLevel;
+  map<float *, int> lastReadLevel;
+  int lastGlobalLevel = -1;
+  for (int i = 0; i < dspProcessPlan.size(); i++) {
+    DspObject *dspObject = dspProcessPlan[i].dspObject;
+    if (dspProcessPlan[i].numGraphSteps >= 0) {
+      dspFilterBankGraphs.push_back(reinterpret_cast<PdGraph *>(dspObject));
+      continue;
+    }
+    int cost = 0;
+    int level = getDspLevel(dspObject, &lastWriteLevel, &lastReadLevel, &lastGlobalLevel, &cost, NULL);
+    if (level < 0) {
+      // messages sent while processing dsp may reach any object in the graph
+      clearDspFilterBankPlan();
+      return;
+    }
+    if (level >= levelList.size()) {
+      levelList.resize(level+1);
+      numFiltersList.resize(level+1, 0);
+    }
+    levelList[level].push_back(dspObject);
+    if (isDspFilter(dspObject)) numFiltersList[level]++;
+  }
+  
+  bool hasFilterBank = false;
+  for (int i = 0; i < levelList.size(); i++) {
+    DspFilterBank *filterBank = NULL;
+    if (numFiltersList[i] >= MIN_FILTER_BANK_SIZE) {
+      filterBank = new DspFilterBank(blockSizeInt);
+      hasFilterBank = true;
+    }
+    for (int j = 0; j < levelList[i].size(); j++) {
+      DspObject *dspObject = levelList[i][j];
+      if (filterBank != NULL && isDspFilter(dspObject)) {
+        filterBank->addFilter(reinterpret_cast<DspFilter *>(dspObject));
+      } else {
+        DspFilterBankStep step;
+        step.dspObject = dspObject;
+        step.filterBank = NULL;
+        dspFilterBankPlan.push_back(step);
+      }
+    }
+    if (filterBank != NULL) {
+      DspFilterBankStep step;
+      step.dspObject = NULL;
+      step.filterBank = filterBank;
+      dspFilterBankPlan.push_back(step);
+    }
+  }
+  
+  // the process plan is cheaper if there is nothing to process together
+  if (!hasFilterBank) clearDspFilterBankPlan();
+}
+
+void PdGraph::clearDspFilterBankPlan() {
+  for (int i = 0; i < dspFilterBankPlan.size(); i++) {
+    if (isLive()) {
+      context->retireFilterBank(dspFilterBankPlan[i].filterBank);
+    } else {
+      delete dspFilterBankPlan[i].filterBank;
+    }
+  }
+  dspFilterBankPlan.clear();
+  dspFilterBankGraphs.clear();
+}
+
+bool PdGraph::isDspFilter(DspObject *dspObject) {
+  switch (dspObject->getObjectType()) {
+    case DSP_BANDPASS_FILTER:
+    case DSP_HIGHPASS_FILTER:
+    case DSP_LOWPASS_FILTER: return true;
+    default: return false;
+  }
 }
 
 #pragma mark - Print
@@ -749,7 +1637,55 @@ float *PdGraph::getGlobalDspBufferAtInlet(int inletIndex) {
 }
 
 float *PdGraph::getGlobalDspBufferAtOutlet(int outletIndex) {
-  return context->getGlobalDspBufferAtOutlet(outletIndex);
+  if (parentGraph != NULL) {
+    return parentGraph->getGlobalDspBufferAtOutlet(outletIndex);
+  } else if (dspOutputBuffers != NULL) {
+    return dspOutputBuffers + (outletIndex * blockSizeInt);
+  } else {
+    return context->getGlobalDspBufferAtOutlet(outletIndex);
+  }
+}
+
+void PdGraph::setDspOutputBuffers(float *buffers) {
+  dspOutputBuffers = buffers;
+}
+
+void PdGraph::setDspProcessPlanEnabled(bool enabled) {
+  context->beginEdit();
+  isDspProcessPlanEnabled = enabled;
+  invalidateDspGraphPlan();
+  for (list<MessageObject *>::iterator it = nodeList.begin(); it != nodeList.end(); ++it) {
+    MessageObject *messageObject = *it;
+    if (messageObject->getObjectType() == OBJECT_PD) {
+      reinterpret_cast<PdGraph *>(messageObject)->setDspProcessPlanEnabled(enabled);
+    }
+  }
+  context->endEdit();
+}
+
+void PdGraph::setDspFilterBankEnabled(bool enabled) {
+  context->beginEdit();
+  isDspFilterBankEnabled = enabled;
+  isDspFilterBankPlanValid = false;
+  invalidateDspGraphPlan();
+  context->endEdit();
+}
+
+void PdGraph::setWorkerPool(DspWorkerPool *workerPool) {
+  this->workerPool = workerPool;
+  isDspLevelListValid = false;
+  isDspGraphPlanValid = false;
+  
+  if (workerPool != NULL && bufferPool != NULL && bufferPool->isReusingBuffers()) {
+    // A buffer which is reused by a later object makes that object depend on all earlier users of
+    // the buffer. Give every outlet its own buffer such that only real dependencies remain.
+    bufferPool->setReuseBuffers(false);
+    if (!dspNodeList.empty()) computeDeepLocalDspProcessOrder();
+  } else if (workerPool == NULL && bufferPool != NULL && !bufferPool->isReusingBuffers()) {
+    // the graph is processed serially again, such that buffers may be reused
+    bufferPool->setReuseBuffers(true);
+    if (!dspNodeList.empty()) computeDeepLocalDspProcessOrder();
+  }
 }
 
 PdMessage *PdGraph::getArguments() {
@@ -772,6 +1708,14 @@ bool PdGraph::isRootGraph() {
   return (parentGraph == NULL);
 }
 
+PdGraph *PdGraph::getRootGraph() {
+  return (parentGraph == NULL) ? this : parentGraph->getRootGraph();
+}
+
+bool PdGraph::isLive() {
+  return getRootGraph()->isLiveGraph;
+}
+
 MessageTable *PdGraph::getTable(char *name) {
   return context->getTable(name);
 }
@@ -835,5 +1779,5 @@ list<MessageObject *> PdGraph::getNodeList() {
 }
 
 BufferPool *PdGraph::getBufferPool() {
-  return context->getBufferPool();
+  return (parentGraph == NULL) ? bufferPool : parentGraph->getBufferPool();
 }
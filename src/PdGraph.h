@@ -23,6 +23,8 @@
 #ifndef _PD_GRAPH_H_
 #define _PD_GRAPH_H_
 
+#include <map>
+#include <set>
 #include "DspObject.h"
 #include "OrderedMessageQueue.h"
 
@@ -31,15 +33,54 @@ class DeclareList;
 class DelayReceiver;
 class DspCatch;
 class DspDelayWrite;
+class DspFilterBank;
 class DspReceive;
 class DspSend;
 class DspThrow;
+class DspWorkerPool;
 class LetInterface;
 class MessageObject;
 class MessageReceive;
 class MessageSend;
 class MessageTable;
 class PdContext;
+class PdGraph;
+
+/**
+ * A single step of the flat dsp process plan of a graph. A step either processes a dsp object, or
+ * marks the start of an inlined subgraph. In the latter case, the following
+ * <code>numGraphSteps</code> steps belong to the subgraph and are skipped if it is switched off.
+ */
+typedef struct DspProcessStep {
+  DspObject *dspObject;
+  int numGraphSteps; // -1 if the step processes the dsp object
+} DspProcessStep;
+
+/**
+ * A single step of the filter bank plan of a root graph. A step either processes a dsp object, or
+ * (if <code>dspObject</code> is <code>NULL</code>) a bank of filters which are processed together.
+ */
+typedef struct DspFilterBankStep {
+  DspObject *dspObject;
+  DspFilterBank *filterBank;
+} DspFilterBankStep;
+
+/**
+ * Everything which the audio thread needs to process a graph, planned by the editing thread. A
+ * graph is processed with the first of these which is not empty: the level list if there is a
+ * worker pool, the filter bank plan, the process plan if it is enabled, or else the node list.
+ * The filter banks belong to the graph, not to the plan.
+ */
+typedef struct DspGraphPlan {
+  vector<DspObject *> dspNodeList;
+  vector<vector<DspObject *> > dspLevelList;
+  vector<int> dspLevelCostList;
+  vector<DspProcessStep> dspProcessPlan;
+  vector<DspFilterBankStep> dspFilterBankPlan;
+  vector<PdGraph *> dspFilterBankGraphs;
+  DspWorkerPool *workerPool;
+  bool isDspProcessPlanEnabled;
+} DspGraphPlan;
 
 class PdGraph : public DspObject {
   
@@ -134,6 +175,36 @@ class PdGraph : public DspObject {
     /** Returns the global dsp buffer at the given outlet. Exclusively used by <code>DspDac</code>. */
     float *getGlobalDspBufferAtOutlet(int outletIndex);
   
+    /**
+     * Sets the buffers into which the [dac~] objects of this (root) graph mix their output. The
+     * buffers are channel-uninterleaved. If <code>NULL</code>, the context's global output buffers
+     * are used. This is used by the context when processing independent graphs in parallel.
+     */
+    void setDspOutputBuffers(float *buffers);
+  
+    /**
+     * Sets the worker pool with which the dsp objects of this (root) graph are processed in
+     * dependency levels. Objects in the same level do not depend on each other and are processed
+     * concurrently. If <code>NULL</code>, or if the graph is too small to benefit, the graph is
+     * processed serially.
+     */
+    void setWorkerPool(DspWorkerPool *workerPool);
+  
+    /**
+     * Enables or disables the flat dsp process plan, in which the dsp objects of all subgraphs
+     * are inlined into a single array. If disabled, subgraphs are processed recursively. The plan
+     * is enabled by default. The setting also applies to all subgraphs. Intended for benchmarking.
+     */
+    void setDspProcessPlanEnabled(bool enabled);
+  
+    /**
+     * Enables or disables the filter bank plan of this (root) graph, in which the independent
+     * filters of each dependency level are processed together in vector lanes. It is only used
+     * with the process plan, and only if the graph contains enough independent filters. It is
+     * enabled by default. Intended for benchmarking.
+     */
+    void setDspFilterBankEnabled(bool enabled);
+  
     int getNumInputChannels();
     int getNumOutputChannels();
   
@@ -146,6 +217,36 @@ class PdGraph : public DspObject {
     /** Computes the local tree and node processing ordering for dsp nodes, including subgraphs. */
     void computeDeepLocalDspProcessOrder();
   
+    /**
+     * Recomputes the dsp process order of only the region of this graph which is affected by edits
+     * to the given objects, i.e. all objects connected to them. The region is moved to the end of
+     * the process order and is assigned new buffers, while all other objects keep their order and
+     * buffers. If the region is connected to the inlets or outlets of this graph, the region
+     * around this graph in the parent graph is recomputed instead. The given objects may include
+     * objects which have since been removed from the graph.
+     */
+    void updateDspProcessOrder(set<MessageObject *> *objectSet);
+  
+    /**
+     * Plans the processing of this root graph and of all of its subgraphs whose plans are out of
+     * date, after their process order has been updated. The signal states are relinked, and all
+     * dsp objects of the graph are marked such that their planned buffers are committed along with
+     * the new plans. Called by the context on the editing thread.
+     */
+    void updateDspGraphPlan();
+  
+    /**
+     * Exchanges the plan with which this graph is processed with the given one. Called on the audio
+     * thread when an update is applied.
+     */
+    void swapDspGraphPlan(DspGraphPlan **dspGraphPlan);
+  
+    /**
+     * Exchanges the inlets to which messages arriving at this graph are dispatched with the given
+     * list. Called on the audio thread when an update is applied.
+     */
+    void swapDispatchInletList(vector<MessageObject *> **inletList);
+  
     /**
      * Get the process order as if this object (i.e. graph) were an atomic object. The internal
      * process order is not changed.
@@ -169,13 +270,32 @@ class PdGraph : public DspObject {
   
     /**
      * Remove the object from the graph, also removing all of the connections to and from ths object.
-     * The object is then deleted. The object reference is invalid after calling this function and
-     * it is an error to reuse it.
+     * The object is then deleted, once the audio thread no longer uses it if the graph is live. The
+     * object reference is invalid after calling this function and it is an error to reuse it.
      */
     void removeObject(MessageObject *object);
   
+    /**
+     * Removes the object and all of its connections from the graph, but does not delete it.
+     * Returns <code>false</code> if the object is not in this graph.
+     */
+    bool detachObject(MessageObject *object);
+  
     void attachToContext(bool isAttached);
   
+    /** Returns <code>true</code> if this graph is attached to a context. */
+    bool isAttached() { return isAttachedToContext; }
+  
+    /**
+     * Returns <code>true</code> if the root graph of this graph has ever been attached to the
+     * context, such that the audio thread may process it. Edits to live graphs only reach the
+     * audio thread when the context applies them.
+     */
+    bool isLive();
+  
+    /** Returns the top-level graph containing this graph. A root graph returns itself. */
+    PdGraph *getRootGraph();
+  
     /**
      * Searches all declared paths to find a file matching the given name. The given filename
      * should be a relative path, NOT a full path.
@@ -215,12 +335,10 @@ class PdGraph : public DspObject {
     list<ObjectLetPair> getIncomingConnections(unsigned int inletIndex);
     list<ObjectLetPair> getOutgoingConnections(unsigned int outletIndex);
   
-    /** Locks the context if this graph is attached. */
-    void lockContextIfAttached();
-    
-    /** Unlocks the context if this graph is attached. */
-    void unlockContextIfAttached();
-  
+    /**
+     * Returns the <code>BufferPool</code> from which the dsp buffers of this graph are taken. Each
+     * root graph has its own pool such that independent graphs never share a buffer.
+     */
     BufferPool *getBufferPool();
   
     /** Set the graph name. */
@@ -229,6 +347,122 @@ class PdGraph : public DspObject {
   private:
     static void processGraph(DspObject *dspObject, int fromIndex, int toIndex);
   
+    /** Processes the current dsp level. Used with the <code>DspWorkerPool</code>. */
+    static void processDspLevelTask(void *graph, int taskIndex);
+  
+    /**
+     * Groups <code>dspNodeList</code> into levels of mutually independent objects. Two objects
+     * are dependent if one writes a buffer which the other reads or writes, or if both access
+     * global resources (e.g. [send~], [dac~] or tables). Objects which schedule messages, such as
+     * [env~], are placed in levels of their own. The level list remains empty if the graph is better
+     * processed serially.
+     */
+    void computeDspLevelList();
+  
+    /** Marks the level list and all plans of this graph and all of its parents as invalid. */
+    void invalidateDspLevelList();
+  
+    /**
+     * Hands the plan of this graph and of all of its subgraphs whose plans are out of date to the
+     * context, computing whichever of their level lists and plans are used.
+     */
+    void computeDspGraphPlan();
+  
+    /** Marks the plan of this graph and of all of its parents as out of date. */
+    void invalidateDspGraphPlan();
+  
+    /**
+     * Groups the objects of the process plan of this root graph into levels of mutually independent
+     * objects, as in <code>computeDspLevelList()</code>, and recomputes
+     * <code>dspFilterBankPlan</code> from them. The filters of a level are processed together in a
+     * <code>DspFilterBank</code> after the other objects of the level. The plan remains empty if no
+     * level holds enough filters.
+     */
+    void computeDspFilterBankPlan();
+  
+    /**
+     * Deletes all steps of <code>dspFilterBankPlan</code>, including their filter banks. The filter
+     * banks of a live graph are deleted once the audio thread no longer uses them.
+     */
+    void clearDspFilterBankPlan();
+  
+    /** Recomputes <code>dspProcessPlan</code> from the process order of this graph and its subgraphs. */
+    void computeDspProcessPlan();
+  
+    /** Appends the process order of the given graph to <code>dspProcessPlan</code>, inlining subgraphs. */
+    void appendToDspProcessPlan(PdGraph *graph);
+  
+    /**
+     * Reassigns the buffers of this root graph and all of its subgraphs according to their lifetimes
+     * in the process plan. Buffers which are not used at the same time share the same memory, and
+     * all buffers are moved into a single contiguous arena of the <code>BufferPool</code>. An object
+     * which can process in place may write its output into the memory of its last used input. If
+     * the filter bank plan is valid, buffers only share memory if their lifetimes are also disjoint
+     * in its order, such that the graph may be processed in either order.
+     */
+    void assignDspBuffers();
+  
+    /**
+     * Appends all objects which may refer to buffers of this root graph to the given list. These
+     * are the objects of the process plan, in process order, followed by the <code>inlet~</code>
+     * and <code>outlet~</code> objects which pass buffers between graphs. Returns the number of
+     * objects in the plan.
+     */
+    int getDspBufferObjects(vector<DspObject *> *objectList);
+  
+    /**
+     * Marks the buffers of the given pool which are referred to by any dsp object of this graph or
+     * its subgraphs, other than the given objects. Unlike <code>getDspBufferObjects()</code>, this
+     * does not need a valid process plan.
+     */
+    void markReferencedDspBuffers(BufferPool *bufferPool, set<MessageObject *> *excludedSet,
+        vector<bool> *isReferenced);
+  
+    /**
+     * Connects the objects following every <code>receive~</code> which is processed after its
+     * <code>send~</code> directly to the input of the <code>send~</code>, such that the signal
+     * is not copied.
+     */
+    void resolveDspReceives();
+  
+    /**
+     * Links every inlet of the objects in this root graph to the signal state of the outlet which
+     * last wrote its buffer in process order, and resets the state of all outlets. An outlet whose
+     * buffer is not written by any other object is marked as retaining its content.
+     */
+    void linkDspSignalStates();
+  
+    /**
+     * Adds the buffers read and written by the given object (including all objects in subgraphs)
+     * to the given sets. Returns the number of dsp objects involved, a rough estimate of the cost.
+     */
+    static int getDspBufferAccess(DspObject *dspObject, set<float *> *readBuffers,
+        set<float *> *writeBuffers, bool *accessesGlobalResource, bool *sendsMessages,
+        bool *schedulesMessages);
+  
+    /**
+     * Returns the earliest level at which the given object may be processed, after all objects
+     * which were previously placed using the same maps of the last levels at which buffers were
+     * written and read. The maps are updated with the buffers of the object, and its cost is
+     * returned in <code>cost</code>. Returns -1 if the object sends messages while processing dsp.
+     * Objects which schedule messages keep their relative order. If <code>isExclusiveLevel</code> is
+     * given, they are also placed in a level of their own, which is marked in it.
+     */
+    static int getDspLevel(DspObject *dspObject, map<float *, int> *lastWriteLevel,
+        map<float *, int> *lastReadLevel, int *lastGlobalLevel, int *cost, vector<bool> *isExclusiveLevel);
+  
+    /** Returns true if the given object is a filter which can be processed in a <code>DspFilterBank</code>. */
+    static bool isDspFilter(DspObject *dspObject);
+  
+    /**
+     * Deletes an object which has been removed from this graph, or an implicit +~~ object. The
+     * objects of a live graph are deleted once the audio thread no longer uses them.
+     */
+    void disposeObject(MessageObject *object);
+  
+    /** Updates <code>dispatchInletList</code> after the inlet list has changed. */
+    void updateDispatchInletList();
+  
     /** Create a new object based on its initialisation string. */
     MessageObject *newObject(char *objectType, char *objectLabel, PdMessage *initMessage, PdGraph *graph);
   
@@ -250,6 +484,9 @@ class PdGraph : public DspObject {
      */
     bool isAttachedToContext;
   
+    /** <code>true</code> if this root graph has been attached to the context. Never reset. */
+    bool isLiveGraph;
+  
     /** The unique id for this subgraph. Defines "$0". */
     int graphId;
   
@@ -273,6 +510,13 @@ class PdGraph : public DspObject {
     
     /** A list of all inlet (message or audio) nodes in this subgraph. */
     vector<MessageObject *> inletList; // in fact contains only MessageInlet and DspInlet objects
+  
+    /**
+     * The inlets to which messages arriving at this graph are dispatched. A copy of
+     * <code>inletList</code> which only reaches the audio thread once the edits of a live graph are
+     * applied.
+     */
+    vector<MessageObject *> *dispatchInletList;
     
     /** A list of all outlet (message or audio) nodes in this subgraph. */
     vector<MessageObject *> outletList; // in fact contains only MessageOutlet and DspOutlet objects
@@ -282,6 +526,72 @@ class PdGraph : public DspObject {
   
     /** PdGraphs may have an associated name, such as their abstraction name. */
     string name;
+  
+    /** The buffer pool of a root graph. <code>NULL</code> for subgraphs, which use their parent's. */
+    BufferPool *bufferPool;
+  
+    /** The output buffers of a root graph. <code>NULL</code> if the global output buffers are used. */
+    float *dspOutputBuffers;
+  
+    /** The worker pool used to process dsp levels. <code>NULL</code> if the graph is processed serially. */
+    DspWorkerPool *workerPool;
+  
+    /** The dsp objects of <code>dspNodeList</code> grouped into levels, in process order. */
+    vector<vector<DspObject *> > dspLevelList;
+  
+    /** The estimated cost of each level in <code>dspLevelList</code>. */
+    vector<int> dspLevelCostList;
+  
+    /** <code>false</code> if the level list must be recomputed before the next block. */
+    bool isDspLevelListValid;
+  
+    /** The index of the level currently being processed by the worker pool, and its number of tasks. */
+    int currentDspLevel;
+    int numDspLevelTasks;
+  
+    /**
+     * The dsp objects of this graph and all of its subgraphs in process order, stored contiguously
+     * such that a block is processed in a single loop.
+     */
+    vector<DspProcessStep> dspProcessPlan;
+  
+    /** <code>false</code> if the process plan must be recomputed before the next block. */
+    bool isDspProcessPlanValid;
+  
+    /** <code>true</code> if the graph is processed using the process plan. */
+    bool isDspProcessPlanEnabled;
+  
+    /**
+     * The dsp objects of a root graph and all of its subgraphs in dependency levels, with the
+     * filters of each level in a filter bank. Used instead of the process plan while all subgraphs
+     * are switched on.
+     */
+    vector<DspFilterBankStep> dspFilterBankPlan;
+  
+    /** The subgraphs of the filter bank plan, which must all be switched on for it to be used. */
+    vector<PdGraph *> dspFilterBankGraphs;
+  
+    /** <code>false</code> if the filter bank plan must be recomputed before the next block. */
+    bool isDspFilterBankPlanValid;
+  
+    /** <code>true</code> if a root graph is processed using the filter bank plan where possible. */
+    bool isDspFilterBankEnabled;
+  
+    /** <code>false</code> if the signal states of a root graph must be relinked before the next block. */
+    bool isDspSignalStateValid;
+  
+    /** The plan with which the audio thread processes this graph. <code>NULL</code> if not yet planned. */
+    DspGraphPlan *dspGraphPlan;
+  
+    /** <code>false</code> if the plan must be recomputed before the edits to the graph are applied. */
+    bool isDspGraphPlanValid;
+  
+    /**
+     * The number of buffers in the pool of a root graph after its process order was last computed
+     * completely. Used to decide when the buffers retired by partial reorders have fragmented the
+     * pool enough that the whole process order should be recomputed and the pool repacked.
+     */
+    unsigned int numBuffersAfterReorder;
 };
 
 #endif // _PD_GRAPH_H_
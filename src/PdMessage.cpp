@@ -22,6 +22,7 @@
 
 #include "PdMessage.h"
 #include "StaticUtils.h"
+#include "SymbolTable.h"
 
 void PdMessage::initWithSARb(unsigned int maxElements, char *initString, PdMessage *arguments,
     char *buffer, unsigned int bufferLength) {
@@ -167,7 +168,7 @@ bool PdMessage::atomIsEqualTo(unsigned int index, MessageAtom *messageAtom) {
   if (atom->type == messageAtom->type) {
     switch (atom->type) {
       case FLOAT: return (atom->constant == messageAtom->constant);
-      case SYMBOL: return !strcmp(atom->symbol, messageAtom->symbol);
+      case SYMBOL: return (atom->symbol == messageAtom->symbol);
       case BANG: return true;
       default: return false;
     }
@@ -236,7 +237,7 @@ bool PdMessage::isSymbol(unsigned int index, const char *test) {
   if (index < numElements) {
     MessageAtom messageElement = (&messageAtom)[index];
     if (messageElement.type == SYMBOL) {
-      return !strcmp(messageElement.symbol, test);
+      return (messageElement.symbol == test) || !strcmp(messageElement.symbol, test);
     } else {
       return false;
     }
@@ -245,6 +246,11 @@ bool PdMessage::isSymbol(unsigned int index, const char *test) {
   }
 }
 
+bool PdMessage::isInternedSymbol(unsigned int index, const char *symbol) {
+  return (index < numElements) && ((&messageAtom)[index].type == SYMBOL) &&
+      ((&messageAtom)[index].symbol == symbol);
+}
+
 bool PdMessage::isBang(unsigned int index) {
   if (index < numElements) {
     return ((&messageAtom)[index].type == BANG);
@@ -292,9 +298,9 @@ char *PdMessage::getSymbol(unsigned int index) {
   return (&messageAtom)[index].symbol;
 }
 
-void PdMessage::setSymbol(unsigned int index, char *symbol) {
+void PdMessage::setSymbol(unsigned int index, const char *symbol) {
   (&messageAtom)[index].type = SYMBOL;
-  (&messageAtom)[index].symbol = symbol;
+  (&messageAtom)[index].symbol = SymbolTable::intern(symbol);
 }
 
 void PdMessage::setBang(unsigned int index) {
@@ -316,25 +322,22 @@ void PdMessage::setList(unsigned int index) {
 #pragma mark - copy/free
 
 PdMessage *PdMessage::copyToHeap() {
+  // symbols are interned, such that the pointers can be shared by the copy
   PdMessage *pdMessage = (PdMessage *) malloc(numBytes());
-  memcpy(pdMessage, this, numBytes()); // copy entire structure (but symbol pointers must be replaced)
-  for (int i = 0; i < numElements; i++) {
-    if (isSymbol(i)) {
-      pdMessage->setSymbol(i, StaticUtils::copyString(getSymbol(i)));
-    }
-  }
+  memcpy(pdMessage, this, numBytes());
   return pdMessage;
 }
 
 void PdMessage::freeMessage() {
-  for (int i = 0; i < numElements; i++) {
-    if (isSymbol(i)) {
-      free(getSymbol(i));
-    }
-  }
   free(this);
 }
 
+PdMessage *PdMessage::copyToBuffer(char *buffer) {
+  PdMessage *pdMessage = (PdMessage *) buffer;
+  memcpy(pdMessage, this, numBytes());
+  return pdMessage;
+}
+
 
 #pragma mark -
 #pragma mark toString
@@ -71,9 +71,8 @@ class PdMessage {
   
     /**
      * Initialise the message with a string, arguments, and a resolution buffer. The string will
-     * be resolved into the buffer using the arguments. Any resolved strings in the message will
-     * point into the resolution buffer. The buffer is generally intended to be a temporary storage
-     * for such strings while objects are created.
+     * be resolved into the buffer using the arguments. The buffer is generally intended to be a
+     * temporary storage for such strings while objects are created.
      */
     void initWithSARb(unsigned int maxElements, char *initString, PdMessage *arguments, char *buffer,
         unsigned int bufferLength);
@@ -102,13 +101,20 @@ class PdMessage {
   
     /**
      * Returns a copy of the message to the heap. Messages usually only exist temporarily on the
-     * stack and should be copied to the heap if it should persist. Symbol pointers are copied
-     * independently to the heap.
+     * stack and should be copied to the heap if it should persist. Symbols are interned and are
+     * shared by the copy.
      */
     PdMessage *copyToHeap();
   
-    /** The message memory is freed from the heap, including symbols. */
+    /** The message memory is freed from the heap. Symbols remain in the symbol table. */
     void freeMessage();
+  
+    /**
+     * Copies the message into the given buffer and returns the copy. The buffer must hold at least
+     * <code>numBytes()</code> bytes. The copy lives as long as the buffer and must not be freed with
+     * <code>freeMessage()</code>.
+     */
+    PdMessage *copyToBuffer(char *buffer);
     
     /**
      * Create a string representation of the message. Suitable for use by the print object.
@@ -120,6 +126,12 @@ class PdMessage {
     bool isFloat(unsigned int index);
     bool isSymbol(unsigned int index);
     bool isSymbol(unsigned int index, const char *test);
+  
+    /**
+     * Returns true if the indexed element is the given symbol, which must have been interned with
+     * <code>SymbolTable::intern()</code>. Unlike <code>isSymbol()</code>, this is a pointer compare.
+     */
+    bool isInternedSymbol(unsigned int index, const char *symbol);
     bool isBang(unsigned int index);
     bool hasFormat(const char *format);
     MessageElementType getType(unsigned int index);
@@ -130,6 +142,8 @@ class PdMessage {
      * This function does not check for the existence of the message element.
      */
     float getFloat(unsigned int index);
+  
+    /** Symbols are interned. The returned string must not be modified or freed. */
     char *getSymbol(unsigned int index);
   
     /**
@@ -137,7 +151,9 @@ class PdMessage {
      * for the existence of a message element.
      */
     void setFloat(unsigned int index, float value);
-    void setSymbol(unsigned int index, char *symbol);
+  
+    /** The symbol is interned, such that the given string need not outlive the message. */
+    void setSymbol(unsigned int index, const char *symbol);
     void setBang(unsigned int index);
     void setAnything(unsigned int index);
     void setList(unsigned int index);
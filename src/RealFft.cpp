@@ -0,0 +1,238 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ArrayArithmetic.h"
+#include "DspObject.h"
+#include "RealFft.h"
+
+#if ARRAY_ARITHMETIC_DISPATCH
+#include <immintrin.h>
+#endif
+
+/*
+ * A butterfly combines x0 = real0 + i*imag0 and x1 = real1 + i*imag1 with the twiddle factor w
+ * into x0 + w*x1 and x0 - w*x1. A stage of half-width h combines the points j and j+h of every
+ * group of 2h points, for j from 0 to h-1, using the twiddle factor w_j = e^(-i*pi*j/h).
+ */
+
+static void processStageScalar(float *real, float *imag, float *twReal, float *twImag, int length, int h) {
+  for (int k = 0; k < length; k += 2*h) {
+    float *real0 = real + k; float *imag0 = imag + k;
+    float *real1 = real0 + h; float *imag1 = imag0 + h;
+    for (int j = 0; j < h; j++) {
+      float tr = twReal[j] * real1[j] - twImag[j] * imag1[j];
+      float ti = twReal[j] * imag1[j] + twImag[j] * real1[j];
+      real1[j] = real0[j] - tr; imag1[j] = imag0[j] - ti;
+      real0[j] += tr; imag0[j] += ti;
+    }
+  }
+}
+
+#if __SSE__
+static void processStageSse(float *real, float *imag, float *twReal, float *twImag, int length, int h) {
+  for (int k = 0; k < length; k += 2*h) {
+    float *real0 = real + k; float *imag0 = imag + k;
+    float *real1 = real0 + h; float *imag1 = imag0 + h;
+    for (int j = 0; j < h; j += 4) {
+      __m128 wr = _mm_loadu_ps(twReal+j);
+      __m128 wi = _mm_loadu_ps(twImag+j);
+      __m128 r0 = _mm_loadu_ps(real0+j); __m128 i0 = _mm_loadu_ps(imag0+j);
+      __m128 r1 = _mm_loadu_ps(real1+j); __m128 i1 = _mm_loadu_ps(imag1+j);
+      __m128 tr = _mm_sub_ps(_mm_mul_ps(wr, r1), _mm_mul_ps(wi, i1));
+      __m128 ti = _mm_add_ps(_mm_mul_ps(wr, i1), _mm_mul_ps(wi, r1));
+      _mm_storeu_ps(real1+j, _mm_sub_ps(r0, tr)); _mm_storeu_ps(imag1+j, _mm_sub_ps(i0, ti));
+      _mm_storeu_ps(real0+j, _mm_add_ps(r0, tr)); _mm_storeu_ps(imag0+j, _mm_add_ps(i0, ti));
+    }
+  }
+}
+#endif // __SSE__
+
+#if ARRAY_ARITHMETIC_DISPATCH
+__attribute__((target("avx2")))
+static void processStageAvx(float *real, float *imag, float *twReal, float *twImag, int length, int h) {
+  for (int k = 0; k < length; k += 2*h) {
+    float *real0 = real + k; float *imag0 = imag + k;
+    float *real1 = real0 + h; float *imag1 = imag0 + h;
+    for (int j = 0; j < h; j += 8) {
+      __m256 wr = _mm256_loadu_ps(twReal+j);
+      __m256 wi = _mm256_loadu_ps(twImag+j);
+      __m256 r0 = _mm256_loadu_ps(real0+j); __m256 i0 = _mm256_loadu_ps(imag0+j);
+      __m256 r1 = _mm256_loadu_ps(real1+j); __m256 i1 = _mm256_loadu_ps(imag1+j);
+      __m256 tr = _mm256_sub_ps(_mm256_mul_ps(wr, r1), _mm256_mul_ps(wi, i1));
+      __m256 ti = _mm256_add_ps(_mm256_mul_ps(wr, i1), _mm256_mul_ps(wi, r1));
+      _mm256_storeu_ps(real1+j, _mm256_sub_ps(r0, tr)); _mm256_storeu_ps(imag1+j, _mm256_sub_ps(i0, ti));
+      _mm256_storeu_ps(real0+j, _mm256_add_ps(r0, tr)); _mm256_storeu_ps(imag0+j, _mm256_add_ps(i0, ti));
+    }
+  }
+}
+#endif // ARRAY_ARITHMETIC_DISPATCH
+
+RealFft::RealFft(int size) {
+  this->size = size;
+  halfSize = size >> 1;
+  
+  int log2HalfSize = 0;
+  while ((1 << log2HalfSize) < halfSize) log2HalfSize++;
+  bitReversal = (int *) malloc(halfSize * sizeof(int));
+  for (int i = 0; i < halfSize; i++) {
+    int r = 0;
+    for (int b = 0; b < log2HalfSize; b++) {
+      if (i & (1 << b)) r |= 1 << (log2HalfSize - 1 - b);
+    }
+    bitReversal[i] = r;
+  }
+  
+  // the factors are computed in double precision such that they are as accurate as possible
+  twiddleReal = ALLOC_ALIGNED_BUFFER(halfSize * sizeof(float));
+  twiddleImag = ALLOC_ALIGNED_BUFFER(halfSize * sizeof(float));
+  twiddleReal[0] = 1.0f; twiddleImag[0] = 0.0f; // unused
+  for (int h = 1; h < halfSize; h <<= 1) {
+    for (int j = 0; j < h; j++) {
+      twiddleReal[h+j] = (float) cos(M_PI * j / h);
+      twiddleImag[h+j] = (float) -sin(M_PI * j / h);
+    }
+  }
+  
+  int quarterSize = halfSize >> 1;
+  splitCos = (float *) malloc((quarterSize+1) * sizeof(float));
+  splitSin = (float *) malloc((quarterSize+1) * sizeof(float));
+  for (int k = 0; k <= quarterSize; k++) {
+    splitCos[k] = (float) cos(M_PI * k / halfSize);
+    splitSin[k] = (float) sin(M_PI * k / halfSize);
+  }
+  
+  #if ARRAY_ARITHMETIC_DISPATCH
+  if (ArrayArithmetic::getKernelLevel() >= ARRAY_ARITHMETIC_AVX2) {
+    vectorWidth = 8;
+    processStage = &processStageAvx;
+  } else {
+    vectorWidth = 4;
+    processStage = &processStageSse;
+  }
+  #elif __SSE__
+  vectorWidth = 4;
+  processStage = &processStageSse;
+  #else
+  vectorWidth = 1;
+  processStage = &processStageScalar;
+  #endif
+}
+
+RealFft::~RealFft() {
+  free(bitReversal);
+  FREE_ALIGNED_BUFFER(twiddleReal);
+  FREE_ALIGNED_BUFFER(twiddleImag);
+  free(splitCos);
+  free(splitSin);
+}
+
+bool RealFft::isValidSize(int size) {
+  return (size >= 2) && ((size & (size-1)) == 0);
+}
+
+int RealFft::getSize() {
+  return size;
+}
+
+void RealFft::transform(float *real, float *imag) {
+  for (int h = 1; h < halfSize; h <<= 1) {
+    if (h < vectorWidth) {
+      processStageScalar(real, imag, twiddleReal+h, twiddleImag+h, halfSize, h);
+    } else {
+      processStage(real, imag, twiddleReal+h, twiddleImag+h, halfSize, h);
+    }
+  }
+}
+
+/*
+ * The complex fft Z of z[n] = x[2n] + i*x[2n+1] yields the transforms of the even and odd samples,
+ * E[k] = (Z[k] + conj(Z[N/2-k]))/2 and O[k] = -i*(Z[k] - conj(Z[N/2-k]))/2, from which
+ * X[k] = E[k] + W^k*O[k] and X[N/2-k] = conj(E[k] - W^k*O[k]), with W = e^(-i*2*pi/N).
+ */
+void RealFft::forward(float *input, float *real, float *imag) {
+  for (int n = 0; n < halfSize; n++) {
+    real[bitReversal[n]] = input[2*n];
+    imag[bitReversal[n]] = input[2*n+1];
+  }
+  transform(real, imag);
+  
+  float z0 = real[0];
+  real[0] = z0 + imag[0];
+  real[halfSize] = z0 - imag[0];
+  imag[0] = 0.0f;
+  for (int k = 1, l = halfSize-1; k <= l; k++, l--) {
+    float evenReal = 0.5f * (real[k] + real[l]);
+    float evenImag = 0.5f * (imag[k] - imag[l]);
+    float oddReal = 0.5f * (imag[k] + imag[l]);
+    float oddImag = -0.5f * (real[k] - real[l]);
+    float c = splitCos[k]; float s = splitSin[k];
+    float wOddReal = c * oddReal + s * oddImag;
+    float wOddImag = c * oddImag - s * oddReal;
+    real[k] = evenReal + wOddReal;
+    imag[k] = evenImag + wOddImag;
+    if (k < l) {
+      real[l] = evenReal - wOddReal;
+      imag[l] = wOddImag - evenImag;
+    }
+  }
+  
+  memset(real+halfSize+1, 0, (halfSize-1) * sizeof(float));
+  memset(imag+halfSize, 0, halfSize * sizeof(float));
+}
+
+/*
+ * The inverse reverses the split of the forward transform, Z[k] = 2*(E[k] + i*O[k]) with
+ * E[k] = (X[k] + conj(X[N/2-k]))/2 and O[k] = W^-k*(X[k] - conj(X[N/2-k]))/2. The inverse
+ * complex fft is computed with the forward one by exchanging the real and imaginary parts.
+ */
+void RealFft::inverse(float *real, float *imag, float *output, float *buffer) {
+  float *zReal = buffer;
+  float *zImag = buffer + halfSize;
+  
+  zReal[0] = real[0] + real[halfSize];
+  zImag[0] = real[0] - real[halfSize];
+  for (int k = 1, l = halfSize-1; k <= l; k++, l--) {
+    // Pd ignores the imaginary parts of the first and the Nyquist bins
+    float evenReal = real[k] + real[l];
+    float evenImag = imag[k] - imag[l];
+    float diffReal = real[k] - real[l];
+    float diffImag = imag[k] + imag[l];
+    float c = splitCos[k]; float s = splitSin[k];
+    float oddReal = c * diffReal - s * diffImag;
+    float oddImag = c * diffImag + s * diffReal;
+    zReal[bitReversal[k]] = evenReal - oddImag;
+    zImag[bitReversal[k]] = evenImag + oddReal;
+    if (k < l) {
+      zReal[bitReversal[l]] = evenReal + oddImag;
+      zImag[bitReversal[l]] = oddReal - evenImag;
+    }
+  }
+  transform(zImag, zReal);
+  
+  for (int n = 0; n < halfSize; n++) {
+    output[2*n] = zReal[n];
+    output[2*n+1] = zImag[n];
+  }
+}
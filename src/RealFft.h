@@ -0,0 +1,95 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _REAL_FFT_H_
+#define _REAL_FFT_H_
+
+/**
+ * A <code>RealFft</code> is the plan of a real fft of one size. It holds the twiddle factors and
+ * the bit reversal permutation, and is shared by all objects of a <code>PdContext</code> which
+ * transform signals of that size (see <code>PdContext::getRealFft()</code>). A plan holds no state
+ * between transforms, such that it may be used by several threads at once.
+ *
+ * The transform of length <code>N</code> is computed as a complex fft of length <code>N/2</code>
+ * on the even and odd samples, on split real and imaginary arrays. The butterflies are vectorised
+ * with SSE, or AVX where <code>ArrayArithmetic</code> has selected it for the cpu.
+ */
+class RealFft {
+  
+  public:
+    /** The size must be a power of two, of at least two. */
+    RealFft(int size);
+    ~RealFft();
+  
+    /** Returns true if the given size can be transformed. */
+    static bool isValidSize(int size);
+  
+    int getSize();
+  
+    /**
+     * Computes the forward transform of <code>input</code>, in the same way as Pd's [rfft~]. The
+     * real parts of bins 0 to N/2 are written to <code>real</code>, the imaginary parts of bins 1
+     * to N/2-1 to <code>imag</code>, all other samples of both outputs are zero. All buffers have
+     * the length of the transform and must be distinct.
+     */
+    void forward(float *input, float *real, float *imag);
+  
+    /**
+     * Computes the (unnormalised) inverse transform, in the same way as Pd's [rifft~]. Only the
+     * real parts of bins 0 to N/2 and the imaginary parts of bins 1 to N/2-1 are read. The
+     * <code>buffer</code> is used as working memory. All buffers have the length of the transform
+     * and must be distinct.
+     */
+    void inverse(float *real, float *imag, float *output, float *buffer);
+  
+  private:
+    /** Computes the complex fft of length N/2 in place on bit-reversed split arrays. */
+    void transform(float *real, float *imag);
+  
+    /** The length of the transform. */
+    int size;
+  
+    /** The length of the complex fft, N/2. */
+    int halfSize;
+  
+    /** The bit-reversed index of every index of the complex fft. */
+    int *bitReversal;
+  
+    /**
+     * The twiddle factors of each stage. The butterflies of half-width <code>h</code> use the
+     * factors at indices <code>h</code> to <code>2h-1</code>.
+     */
+    float *twiddleReal;
+    float *twiddleImag;
+  
+    /** The factors e^(-i*pi*k/(N/2)) for k from 0 to N/4, which split the complex fft into bins. */
+    float *splitCos;
+    float *splitSin;
+  
+    /** The number of butterflies computed at once by <code>processStage</code>. */
+    int vectorWidth;
+  
+    /** Computes one stage of butterflies of the given half-width, which is at least the vector width. */
+    void (*processStage)(float *real, float *imag, float *twReal, float *twImag, int length, int h);
+};
+
+#endif // _REAL_FFT_H_
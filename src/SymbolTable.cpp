@@ -0,0 +1,111 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SymbolTable.h"
+
+// the number of hash buckets of the table. Must be a power of two.
+#define NUM_BUCKETS 4096
+
+typedef struct SymbolTableEntry {
+  struct SymbolTableEntry *next;
+  unsigned int hash;
+  char symbol[1];
+} SymbolTableEntry;
+
+/*
+ * Each bucket is a singly linked list to which new entries are prepended with a compare-and-swap.
+ * As entries are never removed, a list can always be traversed without locking. The buckets are
+ * zero-initialised before any static constructor runs, so symbols may be interned at any time.
+ */
+static SymbolTableEntry *volatile buckets[NUM_BUCKETS];
+static volatile unsigned int numSymbols = 0;
+
+char *const SymbolTable::SET = SymbolTable::intern("set");
+char *const SymbolTable::CLEAR = SymbolTable::intern("clear");
+char *const SymbolTable::STOP = SymbolTable::intern("stop");
+
+/** FNV-1a hash of the given string. Its length is returned in <code>length</code>. */
+static unsigned int hashString(const char *symbol, size_t *length) {
+  unsigned int hash = 2166136261u;
+  const char *c = symbol;
+  while (*c != '\0') {
+    hash = (hash ^ (unsigned char) *c++) * 16777619u;
+  }
+  *length = c - symbol;
+  return hash;
+}
+
+/** Searches the entries from <code>entry</code> up to (excluding) <code>last</code>. */
+static SymbolTableEntry *findEntry(SymbolTableEntry *entry, SymbolTableEntry *last,
+    unsigned int hash, const char *symbol) {
+  for (; entry != last; entry = entry->next) {
+    if (entry->hash == hash && !strcmp(entry->symbol, symbol)) return entry;
+  }
+  return NULL;
+}
+
+char *SymbolTable::intern(const char *symbol) {
+  if (symbol == NULL) return NULL;
+  
+  size_t length = 0;
+  unsigned int hash = hashString(symbol, &length);
+  SymbolTableEntry *volatile *bucket = buckets + (hash & (NUM_BUCKETS-1));
+  SymbolTableEntry *head = *bucket;
+  SymbolTableEntry *entry = findEntry(head, NULL, hash, symbol);
+  if (entry != NULL) return entry->symbol;
+  
+  SymbolTableEntry *newEntry = (SymbolTableEntry *) malloc(offsetof(SymbolTableEntry, symbol) + length + 1);
+  newEntry->hash = hash;
+  memcpy(newEntry->symbol, symbol, length + 1);
+  while (true) {
+    newEntry->next = head;
+    if (__sync_bool_compare_and_swap(bucket, head, newEntry)) {
+      __sync_add_and_fetch(&numSymbols, 1);
+      return newEntry->symbol;
+    }
+    
+    // another thread has added to the bucket in the meantime. Only the new entries must be checked.
+    SymbolTableEntry *newHead = *bucket;
+    entry = findEntry(newHead, head, hash, symbol);
+    if (entry != NULL) {
+      free(newEntry);
+      return entry->symbol;
+    }
+    head = newHead;
+  }
+}
+
+char *SymbolTable::lookup(const char *symbol) {
+  if (symbol == NULL) return NULL;
+  
+  size_t length = 0;
+  unsigned int hash = hashString(symbol, &length);
+  SymbolTableEntry *entry = findEntry(buckets[hash & (NUM_BUCKETS-1)], NULL, hash, symbol);
+  return (entry != NULL) ? entry->symbol : NULL;
+}
+
+unsigned int SymbolTable::getNumSymbols() {
+  return numSymbols;
+}
@@ -0,0 +1,60 @@
+/*
+ *  Copyright 2012 Reality Jockey, Ltd.
+ *                 info@rjdj.me
+ *                 http://rjdj.me/
+ *
+ *  This file is part of ZenGarden.
+ *
+ *  ZenGarden is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ZenGarden is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ZenGarden.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _SYMBOL_TABLE_H_
+#define _SYMBOL_TABLE_H_
+
+/**
+ * Interns the symbols of messages. Every distinct string is stored exactly once, such that
+ * interned symbols can be copied by pointer and compared for equality with <code>==</code>.
+ *
+ * The table is shared by all contexts, as messages may be passed between them and created through
+ * the API without reference to any context. Symbols are never removed. Lookups and insertions are
+ * lock-free and may happen on any thread, including the audio thread, where only the first use of
+ * a string allocates memory.
+ */
+class SymbolTable {
+  
+  public:
+    /**
+     * Returns the interned copy of the given string, adding it to the table if necessary. The
+     * returned string is valid for the lifetime of the process and must not be modified or freed.
+     * <code>NULL</code> is returned unchanged.
+     */
+    static char *intern(const char *symbol);
+  
+    /**
+     * Returns the interned copy of the given string, or <code>NULL</code> if it has never been
+     * interned. The table is not changed.
+     */
+    static char *lookup(const char *symbol);
+  
+    /** Returns the number of distinct symbols which have been interned. */
+    static unsigned int getNumSymbols();
+  
+    /** Symbols which are compared against in the message handlers of many objects. */
+    static char *const SET;
+    static char *const CLEAR;
+    static char *const STOP;
+};
+
+#endif // _SYMBOL_TABLE_H_
@@ -24,10 +24,12 @@
 #include <Accelerate/Accelerate.h>
 #endif
 #include <string.h>
+#include "BufferPool.h"
 #include "MessageTable.h"
 #include "PdContext.h"
 #include "PdFileParser.h"
 #include "PdGraph.h"
+#include "SymbolTable.h"
 #include "ZenGarden.h"
 
 /*
@@ -43,12 +45,16 @@ ZGObject *zg_graph_add_new_object(PdGraph *graph, const char *objectString, floa
   char resolutionBuffer[256];
   PdMessage *initMessage = PD_MESSAGE_ON_STACK(32);
   initMessage->initWithSARb(32, initString, graph->getArguments(), resolutionBuffer, 256);
-  MessageObject *messageObject = graph->getContext()->newObject(objectLabel, initMessage, graph);
+  // objects such as abstractions may edit the graph while they are created
+  PdContext *context = graph->getContext();
+  context->beginEdit();
+  MessageObject *messageObject = context->newObject(objectLabel, initMessage, graph);
   free(objectStringCopy);
   
   if (messageObject != NULL) {
-    graph->addObject(canvasX, canvasY, messageObject);
+    context->addObjectToGraph(graph, messageObject, canvasX, canvasY);
   }
+  context->endEdit();
   
   return messageObject;
 }
@@ -68,7 +74,7 @@ void zg_graph_delete(ZGGraph *graph) {
 #pragma mark - Object
 
 void zg_object_remove(MessageObject *object) {
-  object->getGraph()->removeObject(object);
+  object->getGraph()->getContext()->removeObjectFromGraph(object);
 }
 
 ZGConnectionType zg_object_get_connection_type(ZGObject *object, unsigned int outletIndex) {
@@ -114,9 +120,17 @@ const char *zg_object_get_label(ZGObject *object) {
 }
 
 void zg_object_send_message(MessageObject *object, unsigned int inletIndex, ZGMessage *message) {
-  object->getGraph()->lockContextIfAttached();
-  object->receiveMessage(inletIndex, message);
-  object->getGraph()->unlockContextIfAttached();
+  if (object->getGraph()->isLive()) {
+    // the message is delivered on the audio thread at the start of the next block
+    GraphCommand command;
+    command.type = GRAPH_COMMAND_SEND_MESSAGE;
+    command.toObject = object;
+    command.inletIndex = inletIndex;
+    command.message = message->copyToHeap();
+    object->getGraph()->getContext()->pushGraphCommand(&command);
+  } else {
+    object->receiveMessage(inletIndex, message);
+  }
 }
 
 void zg_object_get_canvas_position(ZGObject *object, float *x, float *y) {
@@ -291,6 +305,24 @@ void zg_context_process_s(ZGContext *context, short *inputBuffers, short *output
   #endif
 }
 
+void zg_context_set_num_worker_threads(ZGContext *context, int numThreads) {
+  context->setNumWorkerThreads(numThreads);
+}
+
+void zg_context_set_random_seed(ZGContext *context, unsigned int seed) {
+  context->setRandomSeed(seed);
+}
+
+void zg_context_get_stats(ZGContext *context, ZGContextStats *stats) {
+  MessageAllocator *messageAllocator = context->getMessageAllocator();
+  stats->numMessageAllocations = messageAllocator->getNumBlockAllocations();
+  stats->numArenaMessageAllocations = messageAllocator->getNumArenaAllocations();
+  stats->numFailedMessageAllocations = messageAllocator->getNumFailedAllocations();
+  stats->numMessageSlabs = messageAllocator->getNumSlabs();
+  stats->numLiveMessages = messageAllocator->getNumLiveBlocks();
+  stats->numSymbols = SymbolTable::getNumSymbols();
+}
+
 void *zg_context_get_userinfo(PdContext *context) {
   return context->callbackUserData;
 }
@@ -332,33 +364,56 @@ void zg_context_unregister_receiver(ZGContext *context, const char *receiverName
 #pragma mark - Context Send Message
 
 /** Send a message to the named receiver. */
-void zg_context_send_message(ZGContext *context, const char *receiverName, ZGMessage *message) {
-  context->scheduleExternalMessage(receiverName, message);
+int zg_context_send_message(ZGContext *context, const char *receiverName, ZGMessage *message) {
+  return context->scheduleExternalMessage(receiverName, message) ? 1 : 0;
 }
 
-void zg_context_send_message_from_string(ZGContext *context, const char *receiverName,
+int zg_context_send_message_from_string(ZGContext *context, const char *receiverName,
     double timestamp, const char *initString) {
-  context->scheduleExternalMessage(receiverName, timestamp, initString);
+  return context->scheduleExternalMessage(receiverName, timestamp, initString) ? 1 : 0;
 }
 
-void zg_context_send_messageV(PdContext *context, const char *receiverName, double timestamp,
+int zg_context_send_messageV(PdContext *context, const char *receiverName, double timestamp,
     const char *messageFormat, ...) {
   va_list ap;
   va_start(ap, messageFormat);
-  context->scheduleExternalMessageV(receiverName, 0.0, messageFormat, ap);
+  bool isQueued = context->scheduleExternalMessageV(receiverName, 0.0, messageFormat, ap);
   va_end(ap); // release the va_list
+  return isQueued ? 1 : 0;
 }
 
-void zg_context_send_message_at_blockindex(PdContext *context, const char *receiverName, double blockIndex,
+int zg_context_send_message_at_blockindex(PdContext *context, const char *receiverName, double blockIndex,
     const char *messageFormat, ...) {
   va_list ap;
   va_start(ap, messageFormat);
   double timestamp = context->getBlockStartTimestamp();
   if (blockIndex >= 0.0 && blockIndex <= (double) (context->getBlockSize()-1)) {
-    timestamp += blockIndex / context->getSampleRate();
+    timestamp += 1000.0 * blockIndex / context->getSampleRate();
+  }
+  bool isQueued = context->scheduleExternalMessageV(receiverName, timestamp, messageFormat, ap);
+  va_end(ap);
+  return isQueued ? 1 : 0;
+}
+
+ZGReceiverHandle zg_context_resolve_receiver(PdContext *context, const char *receiverName) {
+  return context->resolveReceiver(receiverName);
+}
+
+int zg_context_send_message_to_receiver(PdContext *context, ZGReceiverHandle receiver, ZGMessage *message) {
+  return context->scheduleExternalMessage(receiver, message) ? 1 : 0;
+}
+
+int zg_context_send_message_to_receiver_at_blockindex(PdContext *context, ZGReceiverHandle receiver,
+    double blockIndex, const char *messageFormat, ...) {
+  va_list ap;
+  va_start(ap, messageFormat);
+  double timestamp = context->getBlockStartTimestamp();
+  if (blockIndex >= 0.0 && blockIndex <= (double) (context->getBlockSize()-1)) {
+    timestamp += 1000.0 * blockIndex / context->getSampleRate();
   }
-  context->scheduleExternalMessageV(receiverName, timestamp, messageFormat, ap);
+  bool isQueued = context->scheduleExternalMessageV(receiver, timestamp, messageFormat, ap);
   va_end(ap);
+  return isQueued ? 1 : 0;
 }
 
 void zg_context_send_midinote(PdContext *context, int channel, int noteNumber, int velocity, double blockIndex) {
@@ -381,15 +436,15 @@ void zg_graph_attach(ZGGraph *graph) {
 }
 
 void zg_graph_unattach(ZGGraph *graph) {
-  graph->attachToContext(false);
+  graph->getContext()->unattachGraph(graph);
 }
 
 void zg_graph_add_connection(ZGGraph *graph, ZGObject *fromObject, int outletIndex, ZGObject *toObject, int inletIndex) {
-  graph->addConnection(fromObject, outletIndex, toObject, inletIndex);
+  graph->getContext()->addConnectionToGraph(graph, fromObject, outletIndex, toObject, inletIndex);
 }
 
 void zg_graph_remove_connection(ZGGraph *graph, ZGObject *fromObject, int outletIndex, ZGObject *toObject, int inletIndex) {
-  graph->removeConnection(fromObject, outletIndex, toObject, inletIndex);
+  graph->getContext()->removeConnectionFromGraph(graph, fromObject, outletIndex, toObject, inletIndex);
 }
 
 unsigned int zg_graph_get_dollar_zero(ZGGraph *graph) {
@@ -408,6 +463,10 @@ ZGObject **zg_graph_get_objects(ZGGraph *graph, unsigned int *n) {
   return nodeArray;
 }
 
+unsigned int zg_graph_get_num_peak_dsp_buffers(ZGGraph *graph) {
+  return (graph != NULL) ? graph->getBufferPool()->getNumPeakBuffers() : 0;
+}
+
 
 #pragma mark - Table
 
@@ -426,10 +485,19 @@ float *zg_table_get_buffer(MessageObject *table, unsigned int *n) {
 void zg_table_set_buffer(MessageObject *table, float *buffer, unsigned int n) {
   if (table != NULL && table->getObjectType() == MESSAGE_TABLE)  {
     MessageTable *messageTable = reinterpret_cast<MessageTable *>(table);
-    messageTable->getGraph()->lockContextIfAttached();
-    float *tableBuffer = messageTable->resizeBuffer(n); // resize the buffer to the new size (if necessary)
-    memcpy(tableBuffer, buffer, n*sizeof(float)); // copy the contents of the buffer to the table
-    messageTable->getGraph()->unlockContextIfAttached();
+    if (messageTable->getGraph()->isLive()) {
+      // the audio thread swaps in a copy of the buffer at the start of the next block
+      GraphCommand command;
+      command.type = GRAPH_COMMAND_SET_TABLE_BUFFER;
+      command.table = messageTable;
+      command.buffer = (float *) malloc(n * sizeof(float));
+      command.bufferLength = n;
+      memcpy(command.buffer, buffer, n*sizeof(float));
+      messageTable->getGraph()->getContext()->pushGraphCommand(&command);
+    } else {
+      float *tableBuffer = messageTable->resizeBuffer(n); // resize the buffer to the new size (if necessary)
+      memcpy(tableBuffer, buffer, n*sizeof(float)); // copy the contents of the buffer to the table
+    }
   }
 }
 
@@ -461,9 +529,7 @@ void zg_message_set_float(PdMessage *message, unsigned int index, float f) {
 }
 
 void zg_message_set_symbol(PdMessage *message, unsigned int index, const char *s) {
-  char *symbol = message->getSymbol(index);
-  free(symbol); // free it if it is not already NULL
-  message->setSymbol(index, StaticUtils::copyString((char *) s));
+  message->setSymbol(index, s);
 }
 
 void zg_message_set_bang(PdMessage *message, unsigned int index) {
@@ -497,3 +563,10 @@ const char *zg_message_get_symbol(PdMessage *message, unsigned int index) {
 char *zg_message_to_string(ZGMessage *message) {
   return message->toString();
 }
+
+
+#pragma mark - Symbol
+
+const char *zg_symbol_intern(const char *symbol) {
+  return SymbolTable::intern(symbol);
+}
@@ -46,6 +46,12 @@ typedef void ZGObject;
 typedef void ZGMessage;
 #endif
   
+/**
+ * A handle to a named receiver, as returned by <code>zg_context_resolve_receiver()</code>. A
+ * negative handle is invalid.
+ */
+typedef int ZGReceiverHandle;
+  
 typedef struct ZGConnectionPair {
   ZGObject *object;
   unsigned int letIndex;
@@ -67,6 +73,32 @@ typedef struct ZGReceiverMessagePair {
   ZGMessage *message;
 } ZGReceiverMessagePair;
   
+/** Counters of the resources used by a context, as returned by <code>zg_context_get_stats()</code>. */
+typedef struct ZGContextStats {
+  /** The number of messages which have been allocated from the free lists of the context. */
+  unsigned long long numMessageAllocations;
+  
+  /** The number of messages which have been copied into the per-block message arena. */
+  unsigned long long numArenaMessageAllocations;
+  
+  /**
+   * The number of message allocations which failed to be served from the reserved free lists and
+   * called <code>malloc()</code> on the calling thread, possibly the audio thread. This happens if a
+   * free list runs empty before it is refilled, or if a message is too large for the free lists.
+   * It should remain zero.
+   */
+  unsigned long long numFailedMessageAllocations;
+  
+  /** The number of slabs of message memory which have been allocated from the system. */
+  unsigned int numMessageSlabs;
+  
+  /** The number of messages which are currently allocated. */
+  int numLiveMessages;
+  
+  /** The number of distinct symbols which have been interned. The table is shared by all contexts. */
+  unsigned int numSymbols;
+} ZGContextStats;
+  
 /** Enumerates the kinds of connections in ZenGarden; Message and DSP */
 typedef enum ZGConnectionType {
   ZG_CONNECTION_MESSAGE,
@@ -132,28 +164,43 @@ typedef enum ZGConnectionType {
   /** Returns the $0 argument to a graph, allowing graph-specific receivers to be addressed. */
   unsigned int zg_graph_get_dollar_zero(ZGGraph *graph);
   
-  /** Attaches a graph to its context */
+  /**
+   * Attaches a graph to its context. The graph is processed from the start of the next call to
+   * zg_context_process(). Its dsp process order is computed on the calling thread, which does not
+   * wait on the audio thread unless that is just applying the previous edits.
+   */
   void zg_graph_attach(ZGGraph *graph);
   
-  /** Unattaches a graph to its context */
+  /** Unattaches a graph from its context, which unregisters its objects at the start of the next block. */
   void zg_graph_unattach(ZGGraph *graph);
   
   /** Returns all objects in this graph. The returned array, with length n, must be freed by the caller. */
   ZGObject **zg_graph_get_objects(ZGGraph *graph, unsigned int *n);
   
+  /**
+   * Returns the largest number of audio buffers which the graph has held since its process order was
+   * last computed completely. Directly after that, this is the number of buffers which are in use at
+   * the same time. A subgraph shares the buffers of its top-level graph.
+   */
+  unsigned int zg_graph_get_num_peak_dsp_buffers(ZGGraph *graph);
+  
   
 #pragma mark - Manage Connections
   
   /**
-   * Add a connection between two objects, both of which are in the given graph. The new connection
-   * may cause the object graph to be reordered and cause audio dropouts. If the arguments do
-   * not define a valid connection, then this function does nothing.
+   * Add a connection between two objects, both of which are in the given graph. If the arguments do
+   * not define a valid connection, then this function does nothing. If the graph is attached, the
+   * graph is reordered on the calling thread, and the audio thread switches to the new order at
+   * the start of the next call to zg_context_process(). The audio thread is never locked. The
+   * calling thread only waits on it if it is just applying the previous edits, which is brief.
    */
   void zg_graph_add_connection(ZGGraph *graph, ZGObject *fromObject, int outletIndex, ZGObject *toObject, int inletIndex);
   
   /**
    * Remove a connection between two objects, both of which are in the given graph. If the arguments
-   * do not define a valid connection, then this function does nothing.
+   * do not define a valid connection, then this function does nothing. As with
+   * zg_graph_add_connection(), the edit reaches the audio thread at the next block if the graph is
+   * attached.
    */
   void zg_graph_remove_connection(ZGGraph *graph, ZGObject *fromObject, int outletIndex, ZGObject *toObject, int inletIndex);
   
@@ -173,14 +220,44 @@ typedef enum ZGConnectionType {
   /** Process the given context. Audio buffers are channel-interleaved with signed short (16-bit) samples. */
   void zg_context_process_s(ZGContext *context, short *inputBuffers, short *outputBuffers);
   
+  /**
+   * Sets the number of additional threads with which zg_context_process() processes independent
+   * graphs in parallel. Graphs are independent if they share no [send~], [throw~], delay line or
+   * table names. The output of all graphs is mixed in a fixed order, so results do not depend on
+   * thread timing. Zero (the default) processes all graphs on the calling thread. If threads are
+   * used, the callback function may be called from any of them.
+   */
+  void zg_context_set_num_worker_threads(ZGContext *context, int numThreads);
+  
+  /**
+   * Sets the seed from which the random number generators of subsequently created objects, such as
+   * [noise~], are seeded. A context renders the same output whenever its graphs are created in the
+   * same order after the same seed. The seed is zero by default.
+   */
+  void zg_context_set_random_seed(ZGContext *context, unsigned int seed);
+  
+  /** Fills in the current counters of the context. May be called from any thread. */
+  void zg_context_get_stats(ZGContext *context, ZGContextStats *stats);
+  
   
 #pragma mark - Context Send Message
   
+  /*
+   * Messages may be sent from any thread, including the audio thread, e.g. from within the
+   * callback function. They are copied into a lock-free queue, from which they are scheduled at the
+   * start of the next block. A message sent from the audio thread while a block is processed is
+   * therefore only delivered in the following block, one block later than its timestamp, or than
+   * it would be delivered if sent between blocks. Sending never waits on the audio thread.
+   *
+   * All functions which send a message return 1 if it was queued, and 0 if it was dropped, because
+   * the queue is full, the message is too large for it, or the receiver is invalid.
+   */
+  
   /** Send a message to the named receiver. */
-  void zg_context_send_message(ZGContext *context, const char *receiverName, ZGMessage *message);
+  int zg_context_send_message(ZGContext *context, const char *receiverName, ZGMessage *message);
   
   /** Send a message described by the <code>initString</code> to the named receiver at the given timestamp. */
-  void zg_context_send_message_from_string(ZGContext *context, const char *receiverName,
+  int zg_context_send_message_from_string(ZGContext *context, const char *receiverName,
       double timestamp, const char *initString);
   
   /**
@@ -192,7 +269,7 @@ typedef enum ZGConnectionType {
    * E.g., zg_send_message(graph, "test", "s", "hello");
    * E.g., zg_send_message(graph, "test", "b");
    */
-  void zg_context_send_messageV(ZGContext *context, const char *receiverName, double timestamp,
+  int zg_context_send_messageV(ZGContext *context, const char *receiverName, double timestamp,
       const char *messageFormat, ...);
   
   /**
@@ -208,7 +285,29 @@ typedef enum ZGConnectionType {
    * sends a message containing three floats, each with value 0.0f, to all receivers named "#accelerate"
    * between samples 56th and 57th samples (counting from zero) of the block.
    */
-  void zg_context_send_message_at_blockindex(ZGContext *context, const char *receiverName,
+  int zg_context_send_message_at_blockindex(ZGContext *context, const char *receiverName,
+      double blockIndex, const char *messageFormat, ...);
+  
+  /**
+   * Returns a handle to the named receiver. Messages sent to a handle are delivered without the
+   * receiver name being looked up again, and without waiting on the audio thread. The handle
+   * remains valid for the lifetime of the context, including for receivers which are created
+   * after the handle has been resolved. Resolving a name never waits on the audio thread. A new
+   * name is bound to its receivers at the start of the next block, and messages sent to the handle
+   * before then are held back until it is.
+   */
+  ZGReceiverHandle zg_context_resolve_receiver(ZGContext *context, const char *receiverName);
+  
+  /** Send a message to the receiver with the given handle. */
+  int zg_context_send_message_to_receiver(ZGContext *context, ZGReceiverHandle receiver,
+      ZGMessage *message);
+  
+  /**
+   * Send a formatted message to the receiver with the given handle at the given block index. The
+   * <code>blockIndex</code> and <code>messageFormat</code> parameters behave in the same way as
+   * in <code>zg_context_send_message_at_blockindex()</code>.
+   */
+  int zg_context_send_message_to_receiver_at_blockindex(ZGContext *context, ZGReceiverHandle receiver,
       double blockIndex, const char *messageFormat, ...);
   
   /**
@@ -231,9 +330,9 @@ typedef enum ZGConnectionType {
   
   /**
    * Create a new object with a string, e.g. "osc~ 440", "+", or "pack t t s, and add it to the graph.
-   * If the graph is currently attached then audio may be interrupted
-   * while the object is attached the and graph reconfigured (if necessary). If the graph is unattached
-   * then no audio interruption will take place, even if reconfiguration takes place. The canvasX
+   * The object is created and added immediately. If the graph is currently attached, the audio
+   * thread only processes the object from the start of the next call to zg_context_process(). The
+   * dsp process order is updated on the calling thread. The canvasX
    * and canvasY arguments specify the canvas location of the object. This is only relevant for
    * input/~ and output/~ objects, otherwise 0 may be specified.
    */
@@ -242,7 +341,8 @@ typedef enum ZGConnectionType {
   /**
    * Removes the object from the graph and deletes it from memory. Any connections that this object
    * may have had in the graph are also deleted. The reference to the object after this function
-   * completes is invalid.
+   * completes is invalid. If the graph is attached, the audio thread stops processing the object
+   * at the start of the next call to zg_context_process(), after which it is deleted.
    */
   void zg_object_remove(ZGObject *object);
   
@@ -293,7 +393,8 @@ typedef enum ZGConnectionType {
   
   /**
    * The table's buffer is resized and copied from the given buffer. This set operation is thread-safe
-   * especially with regards to zg_context_process().
+   * especially with regards to zg_context_process(). If the graph is attached, the new buffer is
+   * swapped in at the start of the next block, until which zg_table_get_buffer() returns the old one.
    */
   void zg_table_set_buffer(ZGObject *table, float *buffer, unsigned int n);
   
@@ -311,7 +412,7 @@ typedef enum ZGConnectionType {
   
   void zg_message_set_float(ZGMessage *message, unsigned int index, float f);
   
-  /** The symbol parameter is copied into the message. Any previous symbol is freed from memory. */
+  /** The symbol parameter is interned and need not outlive the message. */
   void zg_message_set_symbol(ZGMessage *message, unsigned int index, const char *s);
   
   void zg_message_set_bang(ZGMessage *message, unsigned int index);
@@ -330,6 +431,18 @@ typedef enum ZGConnectionType {
   char *zg_message_to_string(ZGMessage *message);
   
   
+#pragma mark - Symbol
+  
+  /**
+   * Returns the interned copy of the given string. Symbols are interned when they are first set in
+   * a message, which allocates memory. Interning the symbols which will be sent to a context up
+   * front, for instance before audio is started, avoids doing so on the audio thread. The returned
+   * string is shared by all contexts, is valid for the lifetime of the process, and must not be
+   * modified or freed.
+   */
+  const char *zg_symbol_intern(const char *symbol);
+  
+  
 #ifdef __cplusplus
 }
 #endif
@@ -146,6 +146,24 @@ public class ZGContext {
   }
   native private void unregisterReceiver(String receiverName, long nativePtr);
   
+  /**
+   * Set the number of additional threads with which independent graphs and objects are processed
+   * in parallel. Zero (the default) processes everything on the calling thread.
+   */
+  public void setNumWorkerThreads(int numThreads) {
+    setNumWorkerThreads(numThreads, contextPtr);
+  }
+  native private void setNumWorkerThreads(int numThreads, long nativePtr);
+  
+  /**
+   * Set the seed from which the random number generators of subsequently created objects, such as
+   * [noise~], are seeded. The seed is interpreted as unsigned. It is zero by default.
+   */
+  public void setRandomSeed(int seed) {
+    setRandomSeed(seed, contextPtr);
+  }
+  native private void setRandomSeed(int seed, long nativePtr);
+  
   /**
    * Process the input buffer and return the results in the given output buffer. The buffers contain
    * <code>number of channels * block size</code> 16-bit (<code>short</code>) channel-interleaved 
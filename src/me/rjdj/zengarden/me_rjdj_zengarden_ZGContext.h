@@ -55,6 +55,22 @@ JNIEXPORT void JNICALL Java_me_rjdj_zengarden_ZGContext_registerReceiver
 JNIEXPORT void JNICALL Java_me_rjdj_zengarden_ZGContext_unregisterReceiver
   (JNIEnv *, jobject, jstring, jlong);
 
+/*
+ * Class:     me_rjdj_zengarden_ZGContext
+ * Method:    setNumWorkerThreads
+ * Signature: (IJ)V
+ */
+JNIEXPORT void JNICALL Java_me_rjdj_zengarden_ZGContext_setNumWorkerThreads
+  (JNIEnv *, jobject, jint, jlong);
+
+/*
+ * Class:     me_rjdj_zengarden_ZGContext
+ * Method:    setRandomSeed
+ * Signature: (IJ)V
+ */
+JNIEXPORT void JNICALL Java_me_rjdj_zengarden_ZGContext_setRandomSeed
+  (JNIEnv *, jobject, jint, jlong);
+
 /*
  * Class:     me_rjdj_zengarden_ZGContext
  * Method:    process
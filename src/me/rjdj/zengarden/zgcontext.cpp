@@ -163,6 +163,16 @@ JNIEXPORT void JNICALL Java_me_rjdj_zengarden_ZGContext_unregisterReceiver
   env->ReleaseStringUTFChars(jreceiverName, creceiverName);
 }
 
+JNIEXPORT void JNICALL Java_me_rjdj_zengarden_ZGContext_setNumWorkerThreads
+    (JNIEnv *env, jobject jobj, jint numThreads, jlong nativePtr) {
+  zg_context_set_num_worker_threads((ZGContext *) nativePtr, numThreads);
+}
+
+JNIEXPORT void JNICALL Java_me_rjdj_zengarden_ZGContext_setRandomSeed
+    (JNIEnv *env, jobject jobj, jint seed, jlong nativePtr) {
+  zg_context_set_random_seed((ZGContext *) nativePtr, (unsigned int) seed);
+}
+
 JNIEXPORT void JNICALL Java_me_rjdj_zengarden_ZGContext_sendMessage
     (JNIEnv *env, jobject jobj, jstring jreceiverName, jobject jmessage, jlong nativePtr) {
   const char *creceiverName = env->GetStringUTFChars(jreceiverName, NULL);
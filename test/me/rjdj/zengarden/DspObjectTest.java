@@ -23,6 +23,7 @@
 package me.rjdj.zengarden;
 
 import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertFalse;
 import static org.junit.Assert.fail;
 
 import org.junit.After;
@@ -31,6 +32,7 @@ import org.junit.Test;
 
 import java.io.File;
 import java.io.IOException;
+import java.util.Arrays;
 
 import javax.sound.sampled.AudioInputStream;
 import javax.sound.sampled.AudioSystem;
@@ -50,6 +52,9 @@ public class DspObjectTest implements ZenGardenListener {
   private static final short[] OUTPUT_BUFFER = new short[BLOCK_SIZE * NUM_OUTPUT_CHANNELS];
   private static final String TEST_PATHNAME = "./test/dsp";
   
+  /** The number of points of the cosine table of Pd vanilla, which osc~ and vcf~ interpolate. */
+  private static final int PD_COS_TABLE_SIZE = 512;
+  
   private AudioInputStream ais;
   private StringBuffer printBuffer;
   
@@ -64,11 +69,65 @@ public class DspObjectTest implements ZenGardenListener {
     if (ais != null) ais.close(); // no matter what, be sure to close the audio input stream
   }
   
+  /**
+   * Test the convolve~ object with an impulse response of several partitions, in a context whose
+   * block size is not a power of two. The impulse response is changed and re-read with a set
+   * message, and the input is later discarded with a clear message.
+   */
+  @Test
+  public void testDspConvolve() {
+    genericDspTest("DspConvolve.pd", 1000.0f, 48);
+  }
+  
+  /**
+   * Test that convolve~ reproduces its impulse response from an impulse, in contexts whose block
+   * size is and is not a power of two. The patch writes cos(0.7 i) exp(-0.02 i) into the table.
+   * Apart from the truncation to 16 bits, the output may only differ from this by rounding.
+   */
+  @Test
+  public void testDspConvolveImpulse() {
+    int[] blockSizes = {64, 48};
+    for (int blockSize : blockSizes) {
+      int numBlocks = 16;
+      int impulseIndex = 4 * blockSize;
+      short[] input = new short[numBlocks * blockSize];
+      input[impulseIndex] = 16384; // 0.5
+      float[] expected = new float[numBlocks * blockSize];
+      for (int i = 0; i < 200; i++) {
+        expected[impulseIndex + i] = 0.5f * (float) (Math.cos(0.7 * i) * Math.exp(-0.02 * i));
+      }
+      assertEqualsReference("Block size " + blockSize + ".", expected,
+          renderDsp("DspConvolveImpulse.pd", 1, 1, blockSize, input, null, null, null), 2.0f);
+    }
+  }
+  
   @Test
   public void testDspCos() {
     genericDspTest("DspCos.pd");
   }
   
+  /**
+   * Test the env~ object against Pd's algorithm (see <code>renderPdEnvelope()</code>). The input
+   * is a 440 Hz sine which rises from silence over 400 ms, with 40 silent blocks later on. It is
+   * analysed with a window of 1024 samples every 256 samples, and with a window of 1000 samples
+   * every 200 samples, which is rounded up to 256 as in Pd.
+   */
+  @Test
+  public void testDspEnvelope() {
+    short[] input = new short[690 * BLOCK_SIZE];
+    for (int i = 20 * BLOCK_SIZE; i < input.length; i++) {
+      if (i < 500 * BLOCK_SIZE || i >= 540 * BLOCK_SIZE) {
+        double amplitude = 0.9 * Math.min(1.0, (i - 20 * BLOCK_SIZE) / (0.4 * SAMPLE_RATE));
+        input[i] = toShort(amplitude * Math.sin(2.0 * Math.PI * 440.0 * i / SAMPLE_RATE));
+      }
+    }
+    float[][] output = renderDspEnvelope(input, new String[] {"env_a", "env_b"});
+    assertEqualsPdEnvelope("env~ 1024 256.",
+        renderPdEnvelope(toFloat(input, 1, 0), 1024, 256, BLOCK_SIZE), output[0]);
+    assertEqualsPdEnvelope("env~ 1000 200.",
+        renderPdEnvelope(toFloat(input, 1, 0), 1000, 200, BLOCK_SIZE), output[1]);
+  }
+  
   @Test
   public void testDspInletOutlet() {
     genericDspTest("DspInletOutlet.pd");
@@ -79,11 +138,82 @@ public class DspObjectTest implements ZenGardenListener {
     genericDspTest("DspLine.pd");
   }
 
+  /**
+   * Test that noise~ renders the same output from the same context seed, and that a seed message
+   * restarts its sequence.
+   */
+  @Test
+  public void testDspNoise() {
+    short[] output = renderDspNoise(1234, 0, 100);
+    assertArrayEquals("Output differs between contexts with the same seed.",
+        output, renderDspNoise(1234, 0, 100));
+    assertFalse("Output is the same for contexts with different seeds.",
+        Arrays.equals(output, renderDspNoise(1235, 0, 100)));
+    
+    // the sequence following a seed message does not depend on what came before it
+    assertArrayEquals("Output differs after the same seed message.",
+        renderDspNoise(1234, 10, 100), renderDspNoise(1235, 30, 100));
+  }
+  
   @Test
   public void testDspOsc() {
     genericDspTest("DspOsc.pd");
   }
   
+  /**
+   * Test the osc~ object at a constant frequency given by its argument, against Pd's algorithm
+   * (see <code>renderPdOsc()</code>).
+   */
+  @Test
+  public void testDspOscConstant() {
+    int numSamples = 690 * BLOCK_SIZE;
+    float[] frequency = new float[numSamples];
+    Arrays.fill(frequency, 440.0f);
+    assertEqualsReference("Constant frequency.", renderPdOsc(frequency, new int[0], new float[0]),
+        renderDsp("DspOscConstant.pd", 1, 1, BLOCK_SIZE, new short[numSamples], null, null, null), 2.0f);
+  }
+  
+  /**
+   * Test that the phase of the osc~ object is set through its right inlet, against Pd's algorithm
+   * (see <code>renderPdOsc()</code>). The phase is set every 76 blocks, to values from -0.5 to 1.5.
+   */
+  @Test
+  public void testDspOscPhase() {
+    int numSamples = 690 * BLOCK_SIZE;
+    float[] frequency = new float[numSamples];
+    Arrays.fill(frequency, 440.0f);
+    int[] messageBlocks = new int[9];
+    int[] phaseSamples = new int[messageBlocks.length];
+    float[] phases = new float[messageBlocks.length];
+    for (int i = 0; i < messageBlocks.length; i++) {
+      messageBlocks[i] = 76 * i + 5;
+      phaseSamples[i] = messageBlocks[i] * BLOCK_SIZE;
+      phases[i] = 0.25f * i - 0.5f;
+    }
+    assertEqualsReference("Phase messages.", renderPdOsc(frequency, phaseSamples, phases),
+        renderDsp("DspOscPhase.pd", 1, 1, BLOCK_SIZE, new short[numSamples], "phase", messageBlocks, phases),
+        2.0f);
+  }
+  
+  /**
+   * Test the osc~ object with a frequency given by a signal, against Pd's algorithm (see
+   * <code>renderPdOsc()</code>). The input, scaled by 1000, is 440 Hz modulated by +/- 200 Hz at 3 Hz.
+   */
+  @Test
+  public void testDspOscSignal() {
+    int numSamples = 690 * BLOCK_SIZE;
+    short[] input = new short[numSamples];
+    for (int i = 0; i < numSamples; i++) {
+      input[i] = toShort((440.0 + 200.0 * Math.sin(2.0 * Math.PI * 3.0 * i / SAMPLE_RATE)) / 1000.0);
+    }
+    float[] frequency = toFloat(input, 1, 0);
+    for (int i = 0; i < numSamples; i++) {
+      frequency[i] *= 1000.0f;
+    }
+    assertEqualsReference("Frequency signal.", renderPdOsc(frequency, new int[0], new float[0]),
+        renderDsp("DspOscSignal.pd", 1, 1, BLOCK_SIZE, input, null, null, null), 2.0f);
+  }
+  
   /**
    * Test the signal input component of the phasor~ object.
    */
@@ -102,6 +232,54 @@ public class DspObjectTest implements ZenGardenListener {
     genericDspTest("DspThrowCatch.pd");
   }
   
+  /**
+   * Test the vcf~ object with a center frequency set by messages between blocks, against Pd's
+   * algorithm (see <code>renderPdVcf()</code>). A sawtooth is filtered while the center frequency
+   * rises from 400 to 2400 Hz. The bandpass outlet is on the left channel, the lowpass outlet on
+   * the right.
+   */
+  @Test
+  public void testDspVCFMessage() {
+    int numSamples = 690 * BLOCK_SIZE;
+    short[] input = new short[numSamples];
+    float[] centerFrequency = new float[numSamples];
+    int[] messageBlocks = new int[69];
+    float[] messageValues = new float[messageBlocks.length];
+    for (int i = 0; i < messageBlocks.length; i++) {
+      messageBlocks[i] = 10 * i;
+      messageValues[i] = 400.0f + 2000.0f * Math.min(1.0f, messageBlocks[i] / 600.0f);
+      Arrays.fill(centerFrequency, messageBlocks[i] * BLOCK_SIZE, numSamples, messageValues[i]);
+    }
+    for (int i = 0; i < numSamples; i++) {
+      input[i] = toShort(0.9 * ((i * 110.0 / SAMPLE_RATE) % 1.0 - 0.5));
+    }
+    short[] output = renderDsp("DspVCFMessage.pd", 1, 2, BLOCK_SIZE, input, "cf",
+        messageBlocks, messageValues);
+    assertEqualsPdVcf(toFloat(input, 1, 0), centerFrequency, output);
+  }
+  
+  /**
+   * Test the vcf~ object with a center frequency given by a signal, against Pd's algorithm (see
+   * <code>renderPdVcf()</code>). A sawtooth on the left input channel is filtered while the right
+   * input channel, scaled by 4000, sweeps the center frequency between 400 and 2000 Hz at 1.5 Hz.
+   * The bandpass outlet is on the left channel, the lowpass outlet on the right.
+   */
+  @Test
+  public void testDspVCFSignal() {
+    int numSamples = 690 * BLOCK_SIZE;
+    short[] input = new short[2 * numSamples];
+    for (int i = 0; i < numSamples; i++) {
+      input[2*i] = toShort(0.9 * ((i * 110.0 / SAMPLE_RATE) % 1.0 - 0.5));
+      input[2*i+1] = toShort((1200.0 + 800.0 * Math.sin(2.0 * Math.PI * 1.5 * i / SAMPLE_RATE)) / 4000.0);
+    }
+    float[] centerFrequency = toFloat(input, 2, 1);
+    for (int i = 0; i < numSamples; i++) {
+      centerFrequency[i] *= 4000.0f;
+    }
+    short[] output = renderDsp("DspVCFSignal.pd", 2, 2, BLOCK_SIZE, input, null, null, null);
+    assertEqualsPdVcf(toFloat(input, 2, 0), centerFrequency, output);
+  }
+  
   @Test
   public void testDspWrap() {
     genericDspTest("DspWrap.pd");
@@ -120,8 +298,16 @@ public class DspObjectTest implements ZenGardenListener {
    * Executes the generic message test for at least the given minimum runtime (in milliseconds).
    */
   private void genericDspTest(String testFilename, float minmumRuntimeMs) {
+    genericDspTest(testFilename, minmumRuntimeMs, BLOCK_SIZE);
+  }
+  
+  /**
+   * Executes the generic message test for at least the given minimum runtime (in milliseconds),
+   * in a context with the given block size.
+   */
+  private void genericDspTest(String testFilename, float minmumRuntimeMs, int blockSize) {
     // create and configure a context
-    ZGContext context = new ZGContext(NUM_INPUT_CHANNELS, NUM_OUTPUT_CHANNELS, BLOCK_SIZE, SAMPLE_RATE);
+    ZGContext context = new ZGContext(NUM_INPUT_CHANNELS, NUM_OUTPUT_CHANNELS, blockSize, SAMPLE_RATE);
     context.addListener(this);
     ZGGraph graph = context.newGraph(new File(TEST_PATHNAME, testFilename));
     graph.attach();
@@ -139,15 +325,17 @@ public class DspObjectTest implements ZenGardenListener {
     
 //    assertEquals("The golden file does not have same length as the audio that will be produced.",
 //        numBlocksToProcess*BLOCK_SIZE, ais.getFrameLength());
-    int numBlocksToProcess = Math.min((int) (Math.floor(((minmumRuntimeMs/1000.0f)*SAMPLE_RATE)/BLOCK_SIZE)+1),
-        (int) (ais.getFrameLength()/BLOCK_SIZE));
+    int numBlocksToProcess = Math.min((int) (Math.floor(((minmumRuntimeMs/1000.0f)*SAMPLE_RATE)/blockSize)+1),
+        (int) (ais.getFrameLength()/blockSize));
     
-    byte[] buffer = new byte[2*BLOCK_SIZE];
-    short[] goldenBuffer = new short[BLOCK_SIZE];
+    short[] inputBuffer = new short[blockSize * NUM_INPUT_CHANNELS];
+    short[] outputBuffer = new short[blockSize * NUM_OUTPUT_CHANNELS];
+    byte[] buffer = new byte[2*blockSize];
+    short[] goldenBuffer = new short[blockSize];
     
     for (int i = 0; i < numBlocksToProcess; i++) {
       // process the context and fill the output buffer
-      context.process(INPUT_BUFFER, OUTPUT_BUFFER);
+      context.process(inputBuffer, outputBuffer);
       
       // read the next part of the golden buffer
       try {
@@ -162,11 +350,300 @@ public class DspObjectTest implements ZenGardenListener {
       }
       
       // ensure that the output and expected buffers are the same
-      float blockTimeSec = i*BLOCK_SIZE/SAMPLE_RATE;
+      float blockTimeSec = i*blockSize/SAMPLE_RATE;
       assertArrayEquals("Output not equal to golden file at time " + blockTimeSec + "s." +
           "\n\n" + printBuffer.toString(),
-          goldenBuffer, OUTPUT_BUFFER);
+          goldenBuffer, outputBuffer);
+    }
+  }
+ 
+  /**
+   * Renders a test patch with the given interleaved input and returns the interleaved output. The
+   * number of blocks follows from the length of the input. If a receiver name is given, the float
+   * <code>messageValues[i]</code> is sent to it before block <code>messageBlocks[i]</code> is
+   * processed, such that it takes effect at a block boundary, as in Pd.
+   */
+  private short[] renderDsp(String testFilename, int numInputChannels, int numOutputChannels,
+      int blockSize, short[] input, String receiverName, int[] messageBlocks, float[] messageValues) {
+    ZGContext context = new ZGContext(numInputChannels, numOutputChannels, blockSize, SAMPLE_RATE);
+    context.addListener(this);
+    ZGGraph graph = context.newGraph(new File(TEST_PATHNAME, testFilename));
+    graph.attach();
+    
+    short[] inputBuffer = new short[blockSize * numInputChannels];
+    short[] outputBuffer = new short[blockSize * numOutputChannels];
+    int numBlocks = input.length / inputBuffer.length;
+    short[] output = new short[numBlocks * outputBuffer.length];
+    int messageIndex = 0;
+    for (int i = 0; i < numBlocks; i++) {
+      while (receiverName != null && messageIndex < messageBlocks.length && messageBlocks[messageIndex] == i) {
+        context.sendMessage(receiverName, new Message(0.0, messageValues[messageIndex++]));
+      }
+      System.arraycopy(input, i * inputBuffer.length, inputBuffer, 0, inputBuffer.length);
+      context.process(inputBuffer, outputBuffer);
+      System.arraycopy(outputBuffer, 0, output, i * outputBuffer.length, outputBuffer.length);
+    }
+    return output;
+  }
+  
+  /**
+   * Asserts that every sample of a mono output is within the given number of 16-bit steps of the
+   * expected signal.
+   */
+  private void assertEqualsReference(String message, float[] expected, short[] output, float tolerance) {
+    assertEqualsReference(message, expected, output, 1, 0, tolerance);
+  }
+  
+  /**
+   * Asserts that every sample of one channel of an interleaved output is within the given number
+   * of 16-bit steps of the expected signal. The channel is every <code>stride</code>th sample,
+   * starting at <code>offset</code>. Output samples are truncated to 16 bits, so a tolerance of at
+   * least one step is needed even if the output is exact.
+   */
+  private void assertEqualsReference(String message, float[] expected, short[] output,
+      int stride, int offset, float tolerance) {
+    for (int i = 0; i < expected.length; i++) {
+      float difference = Math.abs(output[i*stride + offset] - 32767.0f * expected[i]);
+      if (difference > tolerance) {
+        fail(message + " Output differs from the reference by " + difference + " steps at sample " +
+            i + " (" + (i / SAMPLE_RATE) + "s)." + "\n\n" + printBuffer.toString());
+      }
+    }
+  }
+ 
+  /**
+   * Renders DspEnvelope.pd with the given input and returns the values which arrive at each of the
+   * given receivers, by the block at whose end their window ended. env~ sends each value at the
+   * start of the following block, as Pd does. Blocks without a value are NaN.
+   */
+  private float[][] renderDspEnvelope(short[] input, final String[] receiverNames) {
+    int numBlocks = input.length / BLOCK_SIZE;
+    final float[][] values = new float[receiverNames.length][numBlocks];
+    for (float[] receiverValues : values) {
+      Arrays.fill(receiverValues, Float.NaN);
+    }
+    final int[] blockIndex = new int[1];
+    
+    ZGContext context = new ZGContext(1, 1, BLOCK_SIZE, SAMPLE_RATE);
+    context.addListener(this);
+    context.addListener(new ZenGardenAdapter() {
+      @Override
+      public void onMessage(String receiverName, Message message) {
+        values[Arrays.asList(receiverNames).indexOf(receiverName)][blockIndex[0] - 1] = message.getFloat(0);
+      }
+    });
+    for (String receiverName : receiverNames) {
+      context.registerReceiver(receiverName);
+    }
+    ZGGraph graph = context.newGraph(new File(TEST_PATHNAME, "DspEnvelope.pd"));
+    graph.attach();
+    
+    // one more block delivers the values of the windows which end with the last block
+    short[] inputBuffer = new short[BLOCK_SIZE];
+    short[] outputBuffer = new short[BLOCK_SIZE];
+    for (blockIndex[0] = 0; blockIndex[0] <= numBlocks; blockIndex[0]++) {
+      if (blockIndex[0] < numBlocks) {
+        System.arraycopy(input, blockIndex[0] * BLOCK_SIZE, inputBuffer, 0, BLOCK_SIZE);
+      }
+      context.process(inputBuffer, outputBuffer);
+    }
+    return values;
+  }
+  
+  /**
+   * Asserts that env~ sent its values after the same blocks as Pd, and that each is within
+   * 0.001 dB of Pd's. Only the order in which the weighted squares are summed differs.
+   */
+  private void assertEqualsPdEnvelope(String message, float[] expected, float[] output) {
+    for (int i = 0; i < expected.length; i++) {
+      if (Float.isNaN(expected[i]) != Float.isNaN(output[i]) || Math.abs(output[i] - expected[i]) > 0.001f) {
+        fail(message + " The value after block " + i + " is " + output[i] + " dB, in Pd it is " +
+            expected[i] + " dB." + "\n\n" + printBuffer.toString());
+      }
+    }
+  }
+  
+  /**
+   * Analyses the input as <code>sigenv_perform()</code> in Pd vanilla's d_ctl.c does, and returns
+   * the value sent after each block, or NaN. The period is rounded up to a multiple of the block
+   * size. Every block, the squares of its samples are added to the sums of all windows which
+   * overlap it, newest sample first, weighted by (1 - cos(2 pi i / npoints)) / npoints. The first
+   * window ends with the first block. The mean square of each window is sent in dB, where 1 is
+   * 100 dB, as <code>powtodb()</code> computes it.
+   */
+  private static float[] renderPdEnvelope(float[] input, int npoints, int period, int blockSize) {
+    // the window is followed by zeros, which the windows that are still starting read
+    float[] buf = new float[npoints + blockSize];
+    for (int i = 0; i < npoints; i++) {
+      buf[i] = (float) ((1.0 - Math.cos((2 * 3.14159 * i) / npoints)) / npoints);
+    }
+    int realPeriod = (period % blockSize == 0) ? period : period + blockSize - period % blockSize;
+    float[] sums = new float[npoints / realPeriod + 2];
+    int phase = 0;
+    float[] output = new float[input.length / blockSize];
+    Arrays.fill(output, Float.NaN);
+    for (int b = 0; b < output.length; b++) {
+      int k = 0;
+      for (int count = phase; count < npoints; count += realPeriod, k++) {
+        float sum = sums[k];
+        for (int i = 0; i < blockSize; i++) {
+          float x = input[(b+1) * blockSize - 1 - i];
+          sum += buf[count + i] * (x * x);
+        }
+        sums[k] = sum;
+      }
+      sums[k] = 0.0f;
+      phase -= blockSize;
+      if (phase < 0) {
+        float result = sums[0];
+        k = 0;
+        for (int count = realPeriod; count < npoints; count += realPeriod, k++) {
+          sums[k] = sums[k+1];
+        }
+        sums[k] = 0.0f;
+        phase = realPeriod - blockSize;
+        output[b] = (result <= 0.0f) ? 0.0f :
+            Math.max(0.0f, (float) (100.0 + 10.0 / 2.302585092994 * Math.log(result)));
+      }
+    }
+    return output;
+  }
+  
+  /**
+   * Asserts that the stereo output of vcf~ 5 agrees with <code>renderPdVcf()</code>. With exact
+   * coefficients, it must agree within two steps. Pd interpolates the coefficients from its cosine
+   * table, which alone moves its output by up to about 6.5 steps for the signals of these tests,
+   * so the output must agree with Pd's within eight steps.
+   */
+  private void assertEqualsPdVcf(float[] input, float[] centerFrequency, short[] output) {
+    String[] outletNames = {"Bandpass", "Lowpass"};
+    float[][] exact = renderPdVcf(input, centerFrequency, 5.0f, false);
+    float[][] pd = renderPdVcf(input, centerFrequency, 5.0f, true);
+    for (int i = 0; i < outletNames.length; i++) {
+      assertEqualsReference(outletNames[i] + " outlet, exact coefficients.", exact[i], output, 2, i, 2.0f);
+      assertEqualsReference(outletNames[i] + " outlet, Pd's cosine table.", pd[i], output, 2, i, 8.0f);
+    }
+  }
+  
+  /** Returns the cosine table of Pd vanilla, which holds one cycle and a guard point. */
+  private static float[] getPdCosTable() {
+    float[] cosTable = new float[PD_COS_TABLE_SIZE + 1];
+    for (int i = 0; i <= PD_COS_TABLE_SIZE; i++) {
+      cosTable[i] = (float) Math.cos(2.0 * Math.PI * i / PD_COS_TABLE_SIZE);
+    }
+    return cosTable;
+  }
+  
+  /**
+   * Renders osc~ for the given frequency per sample, as <code>sigosc_perform()</code> in Pd
+   * vanilla's d_osc.c does. The phase counts points of the cosine table. It accumulates the float
+   * products of frequency and table points per sample in double precision, and the interpolated
+   * cosine of the phase before each increment is output. The phase is set to
+   * <code>phases[i]</code>, in cycles, before sample <code>phaseSamples[i]</code>.
+   */
+  private static float[] renderPdOsc(float[] frequency, int[] phaseSamples, float[] phases) {
+    float[] cosTable = getPdCosTable();
+    float conv = PD_COS_TABLE_SIZE / SAMPLE_RATE;
+    double phase = 0.0;
+    int phaseIndex = 0;
+    float[] output = new float[frequency.length];
+    for (int i = 0; i < frequency.length; i++) {
+      if (phaseIndex < phaseSamples.length && phaseSamples[phaseIndex] == i) {
+        phase = PD_COS_TABLE_SIZE * phases[phaseIndex++];
+      }
+      phase -= PD_COS_TABLE_SIZE * Math.floor(phase / PD_COS_TABLE_SIZE);
+      int index = (int) phase;
+      double frac = phase - index;
+      int j = index & (PD_COS_TABLE_SIZE - 1);
+      output[i] = (float) (cosTable[j] + frac * (cosTable[j+1] - cosTable[j]));
+      phase += frequency[i] * conv;
+    }
+    return output;
+  }
+  
+  /**
+   * Filters the input with a constant Q and the given center frequency per sample, as
+   * <code>sigvcf_perform()</code> in Pd vanilla's d_osc.c does, and returns the bandpass and the
+   * lowpass output. If <code>isCosineTableUsed</code> is true, the filter coefficients are
+   * linearly interpolated from a cosine table of <code>PD_COS_TABLE_SIZE</code> points, as in Pd.
+   * Otherwise they are computed exactly.
+   */
+  private static float[][] renderPdVcf(float[] input, float[] centerFrequency, float q,
+      boolean isCosineTableUsed) {
+    float[] cosTable = getPdCosTable();
+    float isr = 6.28318f / SAMPLE_RATE;
+    float qinv = (q > 0.0f) ? 1.0f / q : 0.0f;
+    float ampcorrect = 2.0f - 2.0f / (q + 2.0f);
+    float re = 0.0f;
+    float im = 0.0f;
+    float[][] output = new float[2][input.length];
+    for (int i = 0; i < input.length; i++) {
+      float cf = Math.max(0.0f, centerFrequency[i] * isr);
+      float r = (qinv > 0.0f) ? Math.max(0.0f, 1.0f - cf * qinv) : 0.0f;
+      float cfindx = cf * (PD_COS_TABLE_SIZE / 6.28318f);
+      float coefr;
+      float coefi;
+      if (isCosineTableUsed) {
+        int index = (int) Math.floor(cfindx);
+        float frac = cfindx - index;
+        int j = index & (PD_COS_TABLE_SIZE - 1);
+        coefr = r * (cosTable[j] + frac * (cosTable[j+1] - cosTable[j]));
+        j = (index - PD_COS_TABLE_SIZE/4) & (PD_COS_TABLE_SIZE - 1);
+        coefi = r * (cosTable[j] + frac * (cosTable[j+1] - cosTable[j]));
+      } else {
+        double angle = 2.0 * Math.PI * cfindx / PD_COS_TABLE_SIZE;
+        coefr = r * (float) Math.cos(angle);
+        coefi = r * (float) Math.sin(angle);
+      }
+      float re2 = re;
+      output[0][i] = re = ampcorrect * (1.0f - r) * input[i] + coefr * re2 - coefi * im;
+      output[1][i] = im = coefi * re2 + coefr * im;
+    }
+    return output;
+  }
+  
+  /** Converts a sample to 16 bits, as the input of a test is given to the context. */
+  private static short toShort(double sample) {
+    return (short) Math.round(32768.0 * sample);
+  }
+  
+  /**
+   * Returns one channel of an interleaved 16-bit signal as floats, as the context converts its
+   * input. The channel is every <code>stride</code>th sample, starting at <code>offset</code>.
+   */
+  private static float[] toFloat(short[] signal, int stride, int offset) {
+    float[] channel = new float[signal.length / stride];
+    for (int i = 0; i < channel.length; i++) {
+      channel[i] = signal[i*stride + offset] / 32768.0f;
+    }
+    return channel;
+  }
+ 
+  /**
+   * Renders the given number of blocks of DspNoise.pd in a context with the given random seed. The
+   * noise~ object is sent a seed message after <code>numBlocksBeforeSeed</code> blocks. Only the
+   * blocks following the message are returned.
+   */
+  private short[] renderDspNoise(int seed, int numBlocksBeforeSeed, int numBlocks) {
+    ZGContext context = new ZGContext(NUM_INPUT_CHANNELS, NUM_OUTPUT_CHANNELS, BLOCK_SIZE, SAMPLE_RATE);
+    context.addListener(this);
+    context.setRandomSeed(seed);
+    ZGGraph graph = context.newGraph(new File(TEST_PATHNAME, "DspNoise.pd"));
+    graph.attach();
+    
+    for (int i = 0; i < numBlocksBeforeSeed; i++) {
+      context.process(INPUT_BUFFER, OUTPUT_BUFFER);
+    }
+    if (numBlocksBeforeSeed > 0) {
+      context.sendMessage("noise", new Message(0.0, "seed", 7.0f));
+    }
+    
+    short[] output = new short[numBlocks * BLOCK_SIZE];
+    for (int i = 0; i < numBlocks; i++) {
+      context.process(INPUT_BUFFER, OUTPUT_BUFFER);
+      System.arraycopy(OUTPUT_BUFFER, 0, output, i * BLOCK_SIZE, BLOCK_SIZE);
     }
+    return output;
   }
  
   public void onPrintStd(String message) {
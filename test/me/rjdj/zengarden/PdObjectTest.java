@@ -61,6 +61,15 @@ public class PdObjectTest implements ZenGardenListener {
     // nothing to do
   }
 
+  /**
+   * Several [env~] are processed by worker threads. Their messages must arrive in the same order as
+   * when processed serially.
+   */
+  @Test
+  public void testDspEnvelopeParallel() {
+    genericMessageTest("DspEnvelopeParallel.pd", 500.0f, 3);
+  }
+  
   @Test
   public void testDspPrint() {
     genericMessageTest("DspPrint.pd");
@@ -402,11 +411,13 @@ public class PdObjectTest implements ZenGardenListener {
   }
   
   /**
-   * Executes the generic message test for at least the given minimum runtime (in milliseconds).
+   * Executes the generic message test for at least the given minimum runtime (in milliseconds),
+   * with the given number of worker threads.
    */
-  private void genericMessageTest(String testFilename, float minmumRuntimeMs) {
+  private void genericMessageTest(String testFilename, float minmumRuntimeMs, int numWorkerThreads) {
     ZGContext context = new ZGContext(NUM_INPUT_CHANNELS, NUM_OUTPUT_CHANNELS, BLOCK_SIZE, SAMPLE_RATE);
     context.addListener(this);
+    context.setNumWorkerThreads(numWorkerThreads);
     ZGGraph graph = context.newGraph(new File(TEST_PATHNAME, testFilename));
     graph.attach();
     
@@ -423,6 +434,13 @@ public class PdObjectTest implements ZenGardenListener {
     assertEquals(goldenOutput, printBuffer.toString());
   }
   
+  /**
+   * Executes the generic message test for at least the given minimum runtime (in milliseconds).
+   */
+  private void genericMessageTest(String testFilename, float minmumRuntimeMs) {
+    genericMessageTest(testFilename, minmumRuntimeMs, 0);
+  }
+  
   /**
    * Encompasses a generic test for message objects. It processes the graph once and compares the
    * standard output to the golden file, and ensures that the error output is empty.